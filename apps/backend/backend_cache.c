@@ -0,0 +1,376 @@
+/*
+ *
+  ***** BEGIN LICENSE BLOCK *****
+ 
+  Copyright (C) 2024 Olof Hagsand
+
+  This file is part of CLIXON.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Alternatively, the contents of this file may be used under the terms of
+  the GNU General Public License Version 3 or later (the "GPL"),
+  in which case the provisions of the GPL are applicable instead
+  of those above. If you wish to allow use of your version of this file only
+  under the terms of the GPL, and not to allow others to
+  use your version of this file under the terms of Apache License version 2, 
+  indicate your decision by deleting the provisions above and replace them with
+  the  notice and other provisions required by the GPL. If you do not delete
+  the provisions above, a recipient may use your version of this file under
+  the terms of any one of the Apache License version 2 or the GPL.
+
+  ***** END LICENSE BLOCK *****
+ *
+ * Backend cache of get and get-config replies
+ *
+ * Replies are cached keyed on the normalized request: datastore, content, depth,
+ * with-defaults, canonical xpath and namespace context, and the NACM identity (user name).
+ * Clients with binary replies are also keyed on their module mapping, see CLICON_IPC_BINARY.
+ * Each entry is stamped with the generation of the datastore and of running (where NACM
+ * rules are read) when the reply was produced, see xmldb_generation. An entry whose
+ * generations do not match the current generations is stale and removed on lookup.
+ * Replies with state data are only cached if all state data plugins allow it with a TTL,
+ * see ca_statedata_ttl, and expire after the TTL.
+ * Least recently used entries are evicted when the size exceeds CLICON_BACKEND_GET_CACHE_MAX.
+ * All access is in the main thread.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "clixon_config.h" /* generated by config & autoconf */
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <syslog.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+
+/* cligen */
+#include <cligen/cligen.h>
+
+/* clixon */
+#include <clixon/clixon.h>
+
+#include "clixon_backend_client.h"
+#include "backend_cache.h"
+
+/*
+ * Types
+ */
+struct cache_entry{
+    qelem_t        ge_qelem;   /* LRU list, least recently used first */
+    char          *ge_key;     /* Normalized request, see backend_cache_key */
+    uint64_t       ge_dbgen;   /* Generation of datastore */
+    uint64_t       ge_rgen;    /* Generation of running, for NACM rules */
+    struct timeval ge_expire;  /* Expiry if state data, or 0 if config only */
+    char          *ge_data;    /* Reply */
+    size_t         ge_len;     /* Length of reply */
+    size_t         ge_size;    /* Accounted memory of entry */
+};
+
+/*
+ * Variables
+ */
+static struct cache_entry *_cache_list = NULL;  /* LRU list */
+static clicon_hash_t      *_cache_hash = NULL;  /* Key -> entry pointer */
+static size_t              _cache_size = 0;
+static uint64_t            _cache_entries = 0;
+static uint64_t            _cache_hits = 0;
+static uint64_t            _cache_misses = 0;
+
+/*! Check if get reply cache is enabled
+ *
+ * @param[in]  h   Clixon handle
+ * @retval     1   Enabled
+ * @retval     0   Disabled
+ * @see CLICON_BACKEND_GET_CACHE_MAX
+ */
+int
+backend_cache_enabled(clixon_handle h)
+{
+    return clicon_option_int(h, "CLICON_BACKEND_GET_CACHE_MAX") > 0;
+}
+
+/*! Remove and free a cache entry
+ */
+static void
+cache_entry_free(struct cache_entry *ge)
+{
+    DELQ(ge, _cache_list, struct cache_entry *);
+    if (_cache_hash)
+        clicon_hash_del(_cache_hash, ge->ge_key);
+    _cache_size -= ge->ge_size;
+    _cache_entries--;
+    free(ge->ge_key);
+    if (ge->ge_data)
+        free(ge->ge_data);
+    free(ge);
+}
+
+/*! Lookup cache entry
+ */
+static struct cache_entry *
+cache_entry_find(const char *key)
+{
+    struct cache_entry **gep;
+
+    if (_cache_hash == NULL)
+        return NULL;
+    if ((gep = clicon_hash_value(_cache_hash, key, NULL)) == NULL)
+        return NULL;
+    return *gep;
+}
+
+/*! Create normalized key of a get request
+ *
+ * @param[in]  h        Clixon handle
+ * @param[in]  ce       Client entry, or NULL
+ * @param[in]  db       Datastore name
+ * @param[in]  content  Get config/state/both
+ * @param[in]  depth    Nr of levels to print, -1 is all, 0 is none
+ * @param[in]  wdef     With-defaults parameter
+ * @param[in]  username User name for NACM access, or NULL
+ * @param[in]  xpath    Canonical xpath, or NULL
+ * @param[in]  nsc      Namespace context of canonical xpath
+ * @param[out] keyp     Key, malloced, free with free()
+ * @retval     0        OK
+ * @retval    -1        Error
+ */
+int
+backend_cache_key(clixon_handle        h,
+                  struct client_entry *ce,
+                  const char          *db,
+                  netconf_content      content,
+                  int32_t              depth,
+                  withdefaults_type    wdef,
+                  const char          *username,
+                  const char          *xpath,
+                  cvec                *nsc,
+                  char               **keyp)
+{
+    int     retval = -1;
+    cbuf   *cb = NULL;
+    cg_var *cv = NULL;
+    int     i;
+
+    if ((cb = cbuf_new()) == NULL){
+        clixon_err(OE_UNIX, errno, "cbuf_new");
+        goto done;
+    }
+    cprintf(cb, "%s\n%d\n%d\n%d\n%s\n%s\n", db, content, depth, wdef,
+            username?username:"", xpath?xpath:"/");
+    while ((cv = cvec_each(nsc, cv)) != NULL)
+        cprintf(cb, "%s=%s ", cv_name_get(cv)?cv_name_get(cv):"", cv_string_get(cv));
+    if (ce && ce->ce_binary_len){
+        cprintf(cb, "\n");
+        for (i=0; i<ce->ce_binary_len; i++)
+            cprintf(cb, "%p ", ce->ce_binary_modules[i]);
+    }
+    if ((*keyp = strdup(cbuf_get(cb))) == NULL){
+        clixon_err(OE_UNIX, errno, "strdup");
+        goto done;
+    }
+    retval = 0;
+ done:
+    if (cb)
+        cbuf_free(cb);
+    return retval;
+}
+
+/*! Lookup a reply in cache and append it to cbret if found and valid
+ *
+ * @param[in]  h      Clixon handle
+ * @param[in]  key    Request key, see backend_cache_key
+ * @param[in]  dbgen  Current generation of datastore
+ * @param[in]  rgen   Current generation of running
+ * @param[out] cbret  Reply is appended if found
+ * @retval     1      Hit, reply appended to cbret
+ * @retval     0      Miss
+ * @retval    -1      Error
+ */
+int
+backend_cache_get(clixon_handle h,
+                  const char   *key,
+                  uint64_t      dbgen,
+                  uint64_t      rgen,
+                  cbuf         *cbret)
+{
+    int                 retval = -1;
+    struct cache_entry *ge;
+    struct timeval      now;
+
+    if ((ge = cache_entry_find(key)) == NULL)
+        goto miss;
+    if (ge->ge_dbgen != dbgen || ge->ge_rgen != rgen){
+        cache_entry_free(ge);
+        goto miss;
+    }
+    if (timerisset(&ge->ge_expire)){
+        gettimeofday(&now, NULL);
+        if (timercmp(&now, &ge->ge_expire, >=)){
+            cache_entry_free(ge);
+            goto miss;
+        }
+    }
+    if (cbuf_append_buf(cbret, ge->ge_data, ge->ge_len) < 0){
+        clixon_err(OE_UNIX, errno, "cbuf_append_buf");
+        goto done;
+    }
+    /* Move last in LRU list */
+    DELQ(ge, _cache_list, struct cache_entry *);
+    ADDQ(ge, _cache_list);
+    _cache_hits++;
+    retval = 1;
+ done:
+    return retval;
+ miss:
+    _cache_misses++;
+    retval = 0;
+    goto done;
+}
+
+/*! Add a reply to cache, evict least recently used entries if full
+ *
+ * @param[in]  h      Clixon handle
+ * @param[in]  key    Request key, see backend_cache_key
+ * @param[in]  dbgen  Generation of datastore when request was read
+ * @param[in]  rgen   Generation of running when request was read
+ * @param[in]  ttl    Seconds state data is valid, or 0 if config only
+ * @param[in]  data   Reply
+ * @param[in]  len    Length of reply
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+int
+backend_cache_put(clixon_handle h,
+                  const char   *key,
+                  uint64_t      dbgen,
+                  uint64_t      rgen,
+                  uint32_t      ttl,
+                  const char   *data,
+                  size_t        len)
+{
+    int                 retval = -1;
+    struct cache_entry *ge = NULL;
+    size_t              max;
+    struct timeval      t;
+
+    max = clicon_option_int(h, "CLICON_BACKEND_GET_CACHE_MAX");
+    if ((ge = cache_entry_find(key)) != NULL)
+        cache_entry_free(ge);
+    if (sizeof(*ge) + strlen(key) + len > max)
+        goto ok;
+    if (_cache_hash == NULL &&
+        (_cache_hash = clicon_hash_init()) == NULL)
+        goto done;
+    if ((ge = malloc(sizeof(*ge))) == NULL){
+        clixon_err(OE_UNIX, errno, "malloc");
+        goto done;
+    }
+    memset(ge, 0, sizeof(*ge));
+    if ((ge->ge_key = strdup(key)) == NULL){
+        clixon_err(OE_UNIX, errno, "strdup");
+        goto done;
+    }
+    if ((ge->ge_data = malloc(len)) == NULL){
+        clixon_err(OE_UNIX, errno, "malloc");
+        goto done;
+    }
+    memcpy(ge->ge_data, data, len);
+    ge->ge_len = len;
+    ge->ge_size = sizeof(*ge) + strlen(key) + len;
+    ge->ge_dbgen = dbgen;
+    ge->ge_rgen = rgen;
+    if (ttl){
+        gettimeofday(&ge->ge_expire, NULL);
+        t.tv_sec = ttl;
+        t.tv_usec = 0;
+        timeradd(&ge->ge_expire, &t, &ge->ge_expire);
+    }
+    if (clicon_hash_add(_cache_hash, key, &ge, sizeof(ge)) == NULL)
+        goto done;
+    while (_cache_list && _cache_size + ge->ge_size > max)
+        cache_entry_free(_cache_list);
+    ADDQ(ge, _cache_list);
+    _cache_size += ge->ge_size;
+    _cache_entries++;
+    ge = NULL;
+ ok:
+    retval = 0;
+ done:
+    if (ge){
+        if (ge->ge_key)
+            free(ge->ge_key);
+        if (ge->ge_data)
+            free(ge->ge_data);
+        free(ge);
+    }
+    return retval;
+}
+
+/*! Print cache statistics as XML
+ *
+ * @param[in]  h   Clixon handle
+ * @param[out] cb  XML appended
+ * @retval     0   OK
+ * @retval    -1   Error
+ * @see clixon-lib.yang stats rpc
+ */
+int
+backend_cache_stats(clixon_handle h,
+                    cbuf         *cb)
+{
+    cprintf(cb, "<get-cache xmlns=\"%s\">", CLIXON_LIB_NS);
+    cprintf(cb, "<entries>%" PRIu64 "</entries>", _cache_entries);
+    cprintf(cb, "<size>%zu</size>", _cache_size);
+    cprintf(cb, "<hits>%" PRIu64 "</hits>", _cache_hits);
+    cprintf(cb, "<misses>%" PRIu64 "</misses>", _cache_misses);
+    cprintf(cb, "</get-cache>");
+    return 0;
+}
+
+/*! Reset cache hit and miss counters
+ *
+ * @param[in]  h   Clixon handle
+ * @retval     0   OK
+ */
+int
+backend_cache_stats_reset(clixon_handle h)
+{
+    _cache_hits = 0;
+    _cache_misses = 0;
+    return 0;
+}
+
+/*! Free all cache entries
+ *
+ * @param[in]  h   Clixon handle
+ * @retval     0   OK
+ */
+int
+backend_cache_exit(clixon_handle h)
+{
+    while (_cache_list)
+        cache_entry_free(_cache_list);
+    if (_cache_hash){
+        clicon_hash_free(_cache_hash);
+        _cache_hash = NULL;
+    }
+    _cache_hits = 0;
+    _cache_misses = 0;
+    return 0;
+}
@@ -64,6 +64,7 @@
 
 /* clixon */
 #include <clixon/clixon.h>
+#include <clixon/clixon_probe.h>
 
 #include "clixon_backend_client.h"
 #include "clixon_backend_plugin.h"
@@ -71,6 +72,13 @@
 #include "backend_handle.h"
 #include "backend_get.h"
 #include "backend_client.h"
+#include "backend_cache.h"
+#include "backend_onchange.h"
+#include "backend_periodic.h"
+
+/* Forward */
+static int from_client_resume(int s, void *arg);
+int ce_event_cb(clixon_handle h, int op, stream_event *event, void *arg);
 
 /*! Find client by session-id 
  *
@@ -126,25 +134,406 @@ ce_client_descr(struct client_entry *ce,
     return retval;
 }
 
+/*! Number of bytes in output queue of client not yet written
+ */
+static size_t
+ce_outq_len(struct client_entry *ce)
+{
+    if (ce->ce_outq == NULL)
+        return 0;
+    return cbuf_len(ce->ce_outq) - ce->ce_outq_off;
+}
+
+/*! Resume reading input from client unless a reply is pending or output is blocked
+ *
+ * Already buffered messages are handled in a timeout, not in the calling context
+ * @param[in]  ce   Client entry
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+static int
+ce_input_resume(struct client_entry *ce)
+{
+    struct timeval t;
+
+    if (ce->ce_pending || ce->ce_blocked || ce->ce_s == 0)
+        return 0;
+    if (clixon_event_reg_fd(ce->ce_s, from_client, (void*)ce, "local netconf client socket") < 0)
+        return -1;
+    /* Messages already read are not signalled by socket */
+    if (ce->ce_reader && clicon_msg_reader_pending(ce->ce_reader)){
+        gettimeofday(&t, NULL);
+        if (clixon_event_reg_timeout(t, from_client_resume, (void*)ce, "local netconf client input") < 0)
+            return -1;
+    }
+    return 0;
+}
+
+/*! Write as much as possible of a buffer to client without blocking
+ *
+ * If the client has closed the socket (EPIPE/ECONNRESET), the rest of the buffer is
+ * discarded and the close is detected on input.
+ * @param[in]     h    Clixon handle
+ * @param[in]     ce   Client entry
+ * @param[in]     buf  Buffer
+ * @param[in]     len  Length of buffer
+ * @param[in,out] offp Start of unwritten data in buffer, len if all is written
+ * @retval        0    OK
+ * @retval       -1    Error
+ */
+static int
+ce_write(clixon_handle        h,
+         struct client_entry *ce,
+         char                *buf,
+         size_t               len,
+         size_t              *offp)
+{
+    ssize_t n;
+
+    while (*offp < len){
+        if ((n = write(ce->ce_s, buf + *offp, len - *offp)) < 0){
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            if (errno == EPIPE || errno == ECONNRESET || errno == EBADF){
+                clixon_log(h, LOG_WARNING, "client %d reset", ce->ce_nr);
+                *offp = len;
+                break;
+            }
+            clixon_err(OE_UNIX, errno, "write");
+            return -1;
+        }
+        *offp += n;
+    }
+    return 0;
+}
+
+/*! Write as much as possible of output queue of client without blocking
+ *
+ * @param[in]  h    Clixon handle
+ * @param[in]  ce   Client entry
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+static int
+ce_output_write(clixon_handle        h,
+                struct client_entry *ce)
+{
+    char   *buf;
+    size_t  len;
+
+    buf = cbuf_get(ce->ce_outq);
+    len = cbuf_len(ce->ce_outq);
+    if (ce_write(h, ce, buf, len, &ce->ce_outq_off) < 0)
+        return -1;
+    if (ce->ce_outq_off == len){
+        cbuf_reset(ce->ce_outq);
+        ce->ce_outq_off = 0;
+    }
+    else if (ce->ce_outq_off > len/2){ /* Move unwritten data to start of queue */
+        memmove(buf, buf + ce->ce_outq_off, len - ce->ce_outq_off);
+        cbuf_trunc(ce->ce_outq, len - ce->ce_outq_off);
+        ce->ce_outq_off = 0;
+    }
+    return 0;
+}
+
+/*! Block or unblock input from client depending on output queue high-water mark
+ *
+ * @param[in]  h    Clixon handle
+ * @param[in]  ce   Client entry
+ * @retval     0    OK
+ * @retval    -1    Error
+ * @see CLICON_BACKEND_OUTPUT_QUEUE_MAX
+ */
+static int
+ce_output_block(clixon_handle        h,
+                struct client_entry *ce)
+{
+    int max;
+
+    if ((max = clicon_option_int(h, "CLICON_BACKEND_OUTPUT_QUEUE_MAX")) <= 0)
+        max = 0;
+    if (max && ce_outq_len(ce) >= max){
+        if (ce->ce_blocked == 0){
+            clixon_debug(CLIXON_DBG_BACKEND, "Client %u output queue full, block input", ce->ce_id);
+            ce->ce_blocked = 1;
+            if (ce->ce_pending == 0)
+                clixon_event_unreg_fd(ce->ce_s, from_client);
+        }
+    }
+    else if (ce->ce_blocked){
+        clixon_debug(CLIXON_DBG_BACKEND, "Client %u output queue drained, resume input", ce->ce_id);
+        ce->ce_blocked = 0;
+        if (ce_input_resume(ce) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+/*! Client socket is ready for output, write queued messages
+ *
+ * @param[in]  s    Socket
+ * @param[in]  arg  Client entry
+ * @retval     0    OK
+ * @retval    -1    Error
+ * @see backend_client_send
+ */
+static int
+ce_output_cb(int   s,
+             void *arg)
+{
+    struct client_entry *ce = (struct client_entry *)arg;
+    clixon_handle        h = ce->ce_handle;
+
+    if (ce_output_write(h, ce) < 0)
+        return -1;
+    if (ce_outq_len(ce) == 0){
+        clixon_event_unreg_fd_write(s, ce_output_cb);
+        /* Pass events queued in stream subscriptions while output was pending */
+        if (stream_ss_resume(h, ce_event_cb, (void*)ce) < 0)
+            return -1;
+    }
+    return ce_output_block(h, ce);
+}
+
+/*! Disconnect client since its output queue is above high-water mark
+ *
+ * Close is detected on input and client is removed from event loop
+ * @param[in]  h        Clixon handle
+ * @param[in]  ce       Client entry
+ * @retval     0        OK
+ * @retval    -1        Error
+ */
+static int
+ce_output_disconnect(clixon_handle        h,
+                     struct client_entry *ce)
+{
+    shutdown(ce->ce_s, SHUT_RDWR);
+    cbuf_reset(ce->ce_outq);
+    ce->ce_outq_off = 0;
+    clixon_event_unreg_fd_write(ce->ce_s, ce_output_cb);
+    ce->ce_blocked = 0;
+    return ce_input_resume(ce);
+}
+
+/*! Apply CLICON_BACKEND_OUTPUT_QUEUE_POLICY if output queue of client is above high-water mark
+ *
+ * Replies are limited by not reading input from the client, but notifications are not.
+ * Therefore a notification above the high-water mark is never queued: it is dropped, or
+ * the session is disconnected.
+ * @param[in]  h        Clixon handle
+ * @param[in]  ce       Client entry
+ * @param[in]  descr    Description of client for logging
+ * @param[in]  notify   Message is a notification
+ * @retval     1        Queue message
+ * @retval     0        Drop message
+ * @retval    -1        Error
+ */
+static int
+ce_output_policy(clixon_handle        h,
+                 struct client_entry *ce,
+                 char                *descr,
+                 int                  notify)
+{
+    int max;
+
+    if ((max = clicon_option_int(h, "CLICON_BACKEND_OUTPUT_QUEUE_MAX")) <= 0 ||
+        ce_outq_len(ce) < max)
+        return 1;
+    switch (clicon_backend_output_queue_policy(h)){
+    case OQ_DISCONNECT:
+        clixon_log(h, LOG_WARNING, "Session %s output queue above %d bytes, disconnect",
+                   descr, max);
+        if (ce_output_disconnect(h, ce) < 0)
+            return -1;
+        return 0;
+    case OQ_DROP:
+        if (notify){
+            clixon_debug(CLIXON_DBG_BACKEND, "Session %s output queue full, drop notification",
+                         descr);
+            ce->ce_outq_drops++;
+            return 0;
+        }
+        break;
+    case OQ_BLOCK:
+    default:
+        if (notify){ /* Notifications cannot be blocked, and are not lost silently */
+            clixon_log(h, LOG_WARNING, "Session %s output queue above %d bytes on notification, disconnect",
+                       descr, max);
+            if (ce_output_disconnect(h, ce) < 0)
+                return -1;
+            return 0;
+        }
+        break;
+    }
+    return 1;
+}
+
+/*! Send a reply or notification to a client without blocking the backend
+ *
+ * The message is appended to the output queue of the client and as much as possible is
+ * written directly. The rest is written when the socket is ready for output.
+ * If the queue is above its high-water mark, CLICON_BACKEND_OUTPUT_QUEUE_POLICY applies.
+ * @param[in]  h        Clixon handle
+ * @param[in]  ce       Client entry
+ * @param[in]  data     Message data
+ * @param[in]  datalen  Length of data
+ * @param[in]  notify   Message is a notification (may be dropped)
+ * @retval     1        OK, message queued or sent
+ * @retval     0        Message dropped
+ * @retval    -1        Error
+ */
+static int
+backend_client_send(clixon_handle        h,
+                    struct client_entry *ce,
+                    char                *data,
+                    uint32_t             datalen,
+                    int                  notify)
+{
+    int    retval = -1;
+    size_t qlen;
+    int    shm;
+    cbuf  *cbce = NULL;
+    int    ret;
+
+    if (ce->ce_s == 0)
+        goto drop;
+    if (ce_client_descr(ce, &cbce) < 0)
+        goto done;
+    if ((ret = ce_output_policy(h, ce, cbuf_get(cbce), notify)) < 0)
+        goto done;
+    if (ret == 0)
+        goto drop;
+    qlen = ce_outq_len(ce);
+    if (ce->ce_outq == NULL &&
+        (ce->ce_outq = cbuf_new()) == NULL){
+        clixon_err(OE_UNIX, errno, "cbuf_new");
+        goto done;
+    }
+    /* Large reply to local client: pass shared memory if nothing is queued before it */
+    if (!notify && qlen == 0 && ce->ce_shm &&
+        (shm = clicon_option_int(h, "CLICON_IPC_SHM_THRESHOLD")) > 0 && datalen >= shm){
+        if ((ret = clicon_msg_send_shm(ce->ce_s, cbuf_get(cbce), data, datalen, ce->ce_outq)) < 0)
+            goto done;
+        if (ret == 1){ /* Rest of small descriptor message may be queued */
+            if (ce_outq_len(ce) != 0 &&
+                clixon_event_reg_fd_write(ce->ce_s, ce_output_cb, (void*)ce, "local netconf client output") < 0)
+                goto done;
+            retval = 1;
+            goto done;
+        }
+    }
+    clixon_debug(CLIXON_DBG_MSG, "Send [%s]: %s", cbuf_get(cbce), datalen?data:"");
+    if (clicon_msg_append(ce->ce_outq, data, datalen) < 0)
+        goto done;
+    if (qlen == 0){ /* Otherwise wait for output callback */
+        if (ce_output_write(h, ce) < 0)
+            goto done;
+        if (ce_outq_len(ce) != 0 &&
+            clixon_event_reg_fd_write(ce->ce_s, ce_output_cb, (void*)ce, "local netconf client output") < 0)
+            goto done;
+    }
+    if (ce_output_block(h, ce) < 0)
+        goto done;
+    retval = 1;
+ done:
+    if (cbce)
+        cbuf_free(cbce);
+    return retval;
+ drop:
+    retval = 0;
+    goto done;
+}
+
+/*! Send a notification message shared by all subscribers to a client
+ *
+ * The message is already framed, see STREAM_ENC_MSG. If the output queue is empty, it is
+ * written directly from the shared buffer and only what the socket does not take is
+ * copied to the output queue.
+ * @param[in]  h        Clixon handle
+ * @param[in]  ce       Client entry
+ * @param[in]  msg      Framed message, not modified
+ * @param[in]  msglen   Length of message
+ * @retval     1        OK, message queued or sent
+ * @retval     0        Message dropped
+ * @retval    -1        Error
+ * @see backend_client_send
+ */
+static int
+backend_client_send_msg(clixon_handle        h,
+                        struct client_entry *ce,
+                        char                *msg,
+                        size_t               msglen)
+{
+    int    retval = -1;
+    size_t qlen;
+    size_t off = 0;
+    cbuf  *cbce = NULL;
+    int    ret;
+
+    if (ce->ce_s == 0)
+        goto drop;
+    if (ce_client_descr(ce, &cbce) < 0)
+        goto done;
+    if ((ret = ce_output_policy(h, ce, cbuf_get(cbce), 1)) < 0)
+        goto done;
+    if (ret == 0)
+        goto drop;
+    clixon_debug(CLIXON_DBG_MSG, "Send [%s]: %s", cbuf_get(cbce), msg + sizeof(struct clicon_msg));
+    if ((qlen = ce_outq_len(ce)) == 0 &&
+        ce_write(h, ce, msg, msglen, &off) < 0)
+        goto done;
+    if (off < msglen){
+        if (ce->ce_outq == NULL &&
+            (ce->ce_outq = cbuf_new()) == NULL){
+            clixon_err(OE_UNIX, errno, "cbuf_new");
+            goto done;
+        }
+        if (cbuf_append_buf(ce->ce_outq, msg + off, msglen - off) < 0){
+            clixon_err(OE_UNIX, errno, "cbuf_append_buf");
+            goto done;
+        }
+        if (qlen == 0 && /* Otherwise already waiting for output callback */
+            clixon_event_reg_fd_write(ce->ce_s, ce_output_cb, (void*)ce, "local netconf client output") < 0)
+            goto done;
+    }
+    if (ce_output_block(h, ce) < 0)
+        goto done;
+    retval = 1;
+ done:
+    if (cbce)
+        cbuf_free(cbce);
+    return retval;
+ drop:
+    retval = 0;
+    goto done;
+}
+
 /*! Stream callback for netconf stream notification (RFC 5277)
  *
  * @param[in]  h     Clixon handle
  * @param[in]  op    0:event, 1:rm
  * @param[in]  event Event as XML
  * @param[in]  arg   Extra argument provided in stream_ss_add
+ * @retval     1     OK, output is pending: stream queues events until output is written
  * @retval     0     OK
  * @retval    -1     Error
  * @see stream_ss_add
+ * @see ce_output_cb  where stream_ss_resume is called
  */
 int
 ce_event_cb(clixon_handle h,
             int           op,
-            cxobj        *event,
+            stream_event *event,
             void         *arg)
 {
     int                  retval = -1;
     struct client_entry *ce = (struct client_entry *)arg;
-    cbuf                *cbce = NULL;
+    char                *data;
+    size_t               len;
+    int                  ret;
 
     clixon_debug(CLIXON_DBG_BACKEND, "op:%d", op);
     switch (op){
@@ -154,22 +543,23 @@ ce_event_cb(clixon_handle h,
             backend_client_rm(h, ce);
         break;
     default:
-        if (ce_client_descr(ce, &cbce) < 0)
+        /* Serialized once for all subscribers */
+        if (stream_event_encode(event, STREAM_ENC_MSG, &data, &len) < 0)
+            goto done;
+        if ((ret = backend_client_send_msg(h, ce, data, len)) < 0)
+            goto done;
+        if (ret == 1){
+            /* note there may be other notifications than RFC5277 streams */
+            ce->ce_out_notifications++;
+            netconf_monitoring_counter_inc(h, "out-notifications");
+        }
+        if (ce->ce_s && ce_outq_len(ce) != 0){
+            retval = 1; /* busy */
             goto done;
-        if (send_msg_notify_xml(h, ce->ce_s, cbuf_get(cbce), event) < 0){
-            if (errno == ECONNRESET || errno == EPIPE){
-                clixon_log(h, LOG_WARNING, "client %d reset", ce->ce_nr);
-            }
-            break;
         }
-        /* note there may be other notifications than RFC5277 streams */
-        ce->ce_out_notifications++;
-        netconf_monitoring_counter_inc(h, "out-notifications");
     }
     retval = 0;
  done:
-    if (cbce)
-        cbuf_free(cbce);
     return retval;
 }
 
@@ -272,6 +662,8 @@ backend_monitoring_state_get(clixon_handle h,
         cprintf(cb, "<in-bad-rpcs>%u</in-bad-rpcs>", ce->ce_in_bad_rpcs);
         cprintf(cb, "<out-rpc-errors>%u</out-rpc-errors>", ce->ce_out_rpc_errors);
         cprintf(cb, "<out-notifications>%u</out-notifications>", ce->ce_out_notifications);
+        cprintf(cb, "<out-queue xmlns=\"%s\">%zu</out-queue>", CLIXON_LIB_NS, ce_outq_len(ce));
+        cprintf(cb, "<out-queue-drops xmlns=\"%s\">%u</out-queue-drops>", CLIXON_LIB_NS, ce->ce_outq_drops);
         cprintf(cb, "</session>");
     }
     cprintf(cb, "</sessions>");
@@ -345,6 +737,9 @@ backend_client_rm(clixon_handle        h,
         if (c == ce){
             if (ce->ce_s){
                 clixon_event_unreg_fd(ce->ce_s, from_client);
+                clixon_event_unreg_fd_write(ce->ce_s, ce_output_cb);
+                while (clixon_event_unreg_timeout(from_client_resume, (void*)ce) == 0)
+                    ;
                 close(ce->ce_s);
                 ce->ce_s = 0;
                 if (release_all_dbs(h, ce->ce_id) < 0)
@@ -1043,6 +1438,61 @@ from_client_kill_session(clixon_handle h,
     return retval;
 }
 
+/*! Translate filter of subscription selecting data to canonical xpath
+ *
+ * The filter of on-change and periodic subscriptions selects config or state data,
+ * and is evaluated where the namespace context of the filter element is not known
+ * @param[in]  h        Clixon handle
+ * @param[in]  xfilter  Filter element of create-subscription
+ * @param[in]  selector Filter xpath
+ * @param[out] xpathp   Canonical xpath, free after use
+ * @param[out] cbret    Error reply if retval is 0
+ * @retval     1        OK
+ * @retval     0        Invalid filter, cbret set
+ * @retval    -1        Error
+ */
+static int
+create_subscription_filter(clixon_handle h,
+                           cxobj        *xfilter,
+                           const char   *selector,
+                           char        **xpathp,
+                           cbuf         *cbret)
+{
+    int        retval = -1;
+    yang_stmt *yspec;
+    cvec      *nsc0 = NULL;
+    cvec      *nsc = NULL;
+    cbuf      *cbreason = NULL;
+    int        ret;
+
+    if ((yspec = clicon_dbspec_yang(h)) == NULL){
+        clixon_err(OE_YANG, ENOENT, "No yang spec");
+        goto done;
+    }
+    if (xml_nsctx_node(xfilter, &nsc0) < 0)
+        goto done;
+    if ((ret = xpath2canonical(selector, nsc0, yspec, xpathp, &nsc, &cbreason)) < 0)
+        goto done;
+    if (ret == 0){
+        if (netconf_bad_attribute(cbret, "application",
+                                  "select", cbuf_get(cbreason)) < 0)
+            goto done;
+        goto fail;
+    }
+    retval = 1;
+ done:
+    if (cbreason)
+        cbuf_free(cbreason);
+    if (nsc)
+        xml_nsctx_free(nsc);
+    if (nsc0)
+        xml_nsctx_free(nsc0);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
 /*! Create a notification subscription
  *
  * @param[in]  h       Clixon handle
@@ -1059,6 +1509,7 @@ from_client_kill_session(clixon_handle h,
  *       <filter type="xpath" select="XPATH-EXPR"/>
  *       <startTime></startTime>
  *       <stopTime></stopTime>
+ *       <period></period> # Clixon extension, centiseconds of PERIODIC stream subscription
  *    </create-subscription> 
  */
 static int
@@ -1080,6 +1531,9 @@ from_client_create_subscription(clixon_handle h,
     struct timeval       start;
     struct timeval       stop;
     cvec                *nsc = NULL;
+    char                *xpath = NULL;
+    uint32_t             period = 0;
+    int                  ret;
 
     /* XXX should use prefix cf edit_config */
     if ((nsc = xml_nsctx_init(NULL, EVENT_RFC5277_NAMESPACE)) == NULL)
@@ -1102,6 +1556,17 @@ from_client_create_subscription(clixon_handle h,
             goto ok;
         }
     }
+    if ((x = xpath_first(xe, nsc, "//period")) != NULL){
+        if ((ret = netconf_parse_uint32("period", xml_body(x), NULL, 0, cbret, &period)) < 0)
+            goto done;
+        if (ret == 0)
+            goto ok;
+        if (period == 0){
+            if (netconf_bad_element(cbret, "application", "period", "Expected period in centiseconds") < 0)
+                goto done;
+            goto ok;
+        }
+    }
     if ((xfilter = xpath_first(xe, nsc, "//filter")) != NULL){
         if ((ftype = xml_find_value(xfilter, "type")) != NULL){
             /* Only accept xpath as filter type */
@@ -1119,11 +1584,42 @@ from_client_create_subscription(clixon_handle h,
             goto done;
         goto ok;
     }
-    /* Add subscriber to stream - to make notifications for this client */
-    if (stream_ss_add(h, stream, selector,
-                      starttime?&start:NULL, stoptime?&stop:NULL,
-                      ce_event_cb, (void*)ce) < 0)
-        goto done;
+    /* On-change and periodic filters select data, not events */
+    if (selector &&
+        (strcmp(stream, ON_CHANGE_STREAM) == 0 || strcmp(stream, PERIODIC_STREAM) == 0)){
+        if ((ret = create_subscription_filter(h, xfilter, selector, &xpath, cbret)) < 0)
+            goto done;
+        if (ret == 0)
+            goto ok;
+        selector = xpath;
+    }
+    if (strcmp(stream, PERIODIC_STREAM) == 0){
+        if (period == 0){
+            if (netconf_missing_element(cbret, "application", "period", "Periodic subscription requires period") < 0)
+                goto done;
+            goto ok;
+        }
+        /* State data is access controlled for the user of the subscription */
+        if (stream_ss_add_periodic(h, stream, selector, period, clicon_username_get(h),
+                                   ce_event_cb, (void*)ce) == NULL)
+            goto done;
+        if (backend_periodic_schedule(h) < 0)
+            goto done;
+    }
+    else {
+        if (period != 0){
+            if (netconf_bad_element(cbret, "application", "period", "Only periodic subscriptions have period") < 0)
+                goto done;
+            goto ok;
+        }
+        /* Add subscriber to stream - to make notifications for this client
+         * Config changes of ON-CHANGE are access controlled for the user of the
+         * subscription, and subscription state is only visible to its user */
+        if (stream_ss_add_user(h, stream, selector, clicon_username_get(h),
+                               starttime?&start:NULL, stoptime?&stop:NULL,
+                               ce_event_cb, (void*)ce) == NULL)
+            goto done;
+    }
     /* Replay of this stream to specific subscription according to start and
      * stop (if present). 
      * RFC 5277: If <startTime> is not present, this is not a replay
@@ -1138,6 +1634,8 @@ from_client_create_subscription(clixon_handle h,
  ok:
     retval = 0;
   done:
+    if (xpath)
+        free(xpath);
     if (nsc)
         xml_nsctx_free(nsc);
     return retval;
@@ -1325,6 +1823,31 @@ from_client_ping(clixon_handle h,
     return 0;
 }
 
+/*! Reset latency histograms and get cache counters
+ *
+ * @param[in]  h       Clixon handle
+ * @param[in]  xe      Request: <rpc><xn></rpc>
+ * @param[out] cbret   Return xml tree, eg <rpc-reply>..., <rpc-error..
+ * @param[in]  arg     client-entry
+ * @param[in]  regarg  User argument given at rpc_callback_register()
+ * @retval     0       OK
+ * @retval    -1       Error
+ */
+static int
+from_client_stats_reset(clixon_handle h,
+                        cxobj        *xe,
+                        cbuf         *cbret,
+                        void         *arg,
+                        void         *regarg)
+{
+    if (clixon_latency_reset() < 0)
+        return -1;
+    if (backend_cache_stats_reset(h) < 0)
+        return -1;
+    cprintf(cbret, "<rpc-reply xmlns=\"%s\"><ok/></rpc-reply>", NETCONF_BASE_NAMESPACE);
+    return 0;
+}
+
 /*! Check liveness of backend daemon,  just send a reply
  *
  * @param[in]  h       Clixon handle
@@ -1372,6 +1895,12 @@ from_client_stats(clixon_handle h,
 	if (clixon_stats_datastore_get(h, "startup", cbret) < 0)
 	    goto done;
     cprintf(cbret, "</datastores>");
+    if (backend_cache_stats(h, cbret) < 0)
+        goto done;
+    cprintf(cbret, "<latency xmlns=\"%s\">", CLIXON_LIB_NS);
+    if (clixon_latency_print(cbret, NULL) < 0)
+        goto done;
+    cprintf(cbret, "</latency>");
     /* per module-set, first configuration, then main dbspec, then mountpoints */
     cprintf(cbret, "<module-sets xmlns=\"%s\">", CLIXON_LIB_NS);
     cprintf(cbret, "<module-set><name>clixon-config</name>");
@@ -1528,6 +2057,11 @@ from_client_hello(clixon_handle       h,
 {
     int      retval = -1;
     char    *val;
+    cxobj   *xc;
+    cxobj   *xcap;
+    int      inext;
+    int      nr = 0;
+    int      ret;
 
     if ((val = xml_find_type_value(x, "cl", "transport", CX_ATTR)) != NULL){
         if ((ce->ce_transport = strdup(val)) == NULL){
@@ -1541,10 +2075,99 @@ from_client_hello(clixon_handle       h,
             goto done;
         }
     }
-    cprintf(cbret, "<hello xmlns=\"%s\"><session-id>%u</session-id></hello>",
-            NETCONF_BASE_NAMESPACE, ce->ce_id);
+    if ((xc = xml_find_type(x, NULL, "capabilities", CX_ELMNT)) != NULL){
+        inext = 0;
+        while ((xcap = xml_child_iter(xc, &inext, CX_ELMNT)) != NULL){
+            if ((val = xml_body(xcap)) == NULL)
+                continue;
+            /* Large replies in shared memory, local clients only */
+            if (strcmp(val, CLIXON_IPC_SHM_CAPABILITY) == 0){
+                if (clicon_option_int(h, "CLICON_IPC_SHM_THRESHOLD") > 0 &&
+                    ce->ce_addr.sa_family == AF_UNIX)
+                    ce->ce_shm = 1;
+                continue;
+            }
+            /* Modules announced for binary replies, accept those with same hash as here */
+            if (!clicon_option_bool(h, "CLICON_IPC_BINARY"))
+                continue;
+            if ((ret = clixon_bin_capability_parse(val, clicon_dbspec_yang(h),
+                                                   &ce->ce_binary_modules,
+                                                   &ce->ce_binary_len)) < 0)
+                goto done;
+            if (ret == 1)
+                nr++;
+        }
+        clixon_debug(CLIXON_DBG_BACKEND, "%d modules with binary encoding, shared memory:%d",
+                     nr, ce->ce_shm);
+    }
+    cprintf(cbret, "<hello xmlns=\"%s\">", NETCONF_BASE_NAMESPACE);
+    if (nr)
+        cprintf(cbret, "<capabilities><capability>%s</capability></capabilities>",
+                CLIXON_IPC_BINARY_CAPABILITY);
+    cprintf(cbret, "<session-id>%u</session-id></hello>", ce->ce_id);
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Echo the message-id of a request in its reply
+ *
+ * The attribute is added last in the rpc-reply start tag, unless already present, eg
+ * from validation errors. Replies that are not rpc-reply, eg hello, are not changed.
+ * Clients use it to match pipelined requests and replies.
+ * @param[in,out] cbret  Reply, XML or binary
+ * @param[in]     msgid  Message-id of request, or NULL
+ * @retval        0      OK
+ * @retval       -1      Error
+ * @see clicon_rpc_msg_async
+ */
+static int
+backend_reply_msgid(cbuf *cbret,
+                    char *msgid)
+{
+    int     retval = -1;
+    char   *str;
+    char   *e;
+    char   *tail = NULL;
+    char    c;
+    char   *found;
+    size_t  len = strlen("<rpc-reply");
+
+    if (msgid == NULL || cbuf_len(cbret) == 0)
+        goto ok;
+    str = cbuf_get(cbret);
+    if (clixon_bin_detect(str)){
+        if (clixon_bin_attr_add(cbret, "message-id", msgid) < 0)
+            goto done;
+        goto ok;
+    }
+    if (strncmp(str, "<rpc-reply", len) != 0 ||
+        (str[len] != ' ' && str[len] != '>' && str[len] != '/'))
+        goto ok;
+    if ((e = strchr(str, '>')) == NULL)
+        goto ok;
+    if (e[-1] == '/')
+        e--;
+    c = *e;
+    *e = '\0';
+    found = strstr(str, " message-id=");
+    *e = c;
+    if (found != NULL)
+        goto ok;
+    if ((tail = strdup(e)) == NULL){
+        clixon_err(OE_UNIX, errno, "strdup");
+        goto done;
+    }
+    cbuf_trunc(cbret, e - str);
+    cprintf(cbret, " message-id=\"");
+    xml_chardata_cbuf_append(cbret, msgid);
+    cprintf(cbret, "\"");
+    cbuf_append_str(cbret, tail);
+ ok:
     retval = 0;
  done:
+    if (tail)
+        free(tail);
     return retval;
 }
 
@@ -1582,9 +2205,13 @@ from_client_msg(clixon_handle        h,
     char                *rpcprefix;
     char                *namespace = NULL;
     int                  nr = 0;
-    cbuf                *cbce = NULL;
+    uint64_t             t0;
+    uint64_t             tstart;
+    cxobj               *xa;
+    char                *msgid = NULL;
 
     clixon_debug(CLIXON_DBG_BACKEND | CLIXON_DBG_DETAIL, "");
+    tstart = clixon_latency_now();
     yspec = clicon_dbspec_yang(h);
     /* Return netconf message. Should be filled in by the dispatch(sub) functions 
      * as wither rpc-error or by positive response.
@@ -1624,6 +2251,10 @@ from_client_msg(clixon_handle        h,
     }
     rpcname = xml_name(x);
     rpcprefix = xml_prefix(x);
+    /* Only an unprefixed message-id is echoed by the backend, others by the netconf client */
+    if ((xa = xml_find_type(x, NULL, "message-id", CX_ATTR)) != NULL &&
+        xml_prefix(xa) == NULL)
+        msgid = xml_value(xa);
     /* Sanity check:
      * op_id from internal message can be out-of-sync from client's sessions-id for the following reasons:
      * 1. Its a hello when the client starts with op_id=0 to get its proper id on hello reply
@@ -1755,7 +2386,29 @@ from_client_msg(clixon_handle        h,
             }
         }
         clixon_err_reset();
-        if ((ret = rpc_callback_call(h, xe, ce, &nr, cbret)) < 0){
+        CLIXON_PROBE2(rpc__dispatch, ce->ce_id, rpc);
+        t0 = clixon_latency_now();
+        ret = rpc_callback_call(h, xe, ce, &nr, cbret);
+        if (ce->ce_pending){ /* Recorded when reply is sent, see backend_client_reply_pending */
+            if (ce->ce_pending_rpc)
+                free(ce->ce_pending_rpc);
+            if ((ce->ce_pending_rpc = strdup(rpc)) == NULL){
+                clixon_err(OE_UNIX, errno, "strdup");
+                goto done;
+            }
+            ce->ce_pending_t0 = t0;
+            if (ce->ce_pending_msgid){
+                free(ce->ce_pending_msgid);
+                ce->ce_pending_msgid = NULL;
+            }
+            if (msgid && (ce->ce_pending_msgid = strdup(msgid)) == NULL){
+                clixon_err(OE_UNIX, errno, "strdup");
+                goto done;
+            }
+        }
+        else if (clixon_latency_record("rpc", rpc, NULL, clixon_latency_now() - t0) < 0)
+            goto done;
+        if (ret < 0){
             if (netconf_operation_failed(cbret, "application", clixon_err_reason())< 0)
                 goto done;
             clixon_log(h, LOG_NOTICE, "%s Error in rpc_callback_call:%s", __FUNCTION__, xml_name(xe));
@@ -1776,11 +2429,14 @@ from_client_msg(clixon_handle        h,
             goto reply;
         }
         if (xnacm){
-            xml_free(xnacm);
+            nacm_tree_release(xnacm);
             xnacm = NULL;
             if (clicon_nacm_cache_set(h, NULL) < 0)
                 goto done;
         }
+        /* Reply is made by a worker thread, see backend_client_reply_pending */
+        if (ce->ce_pending)
+            goto ok;
     } /* while */
  reply:
     if (cbuf_len(cbret) == 0)
@@ -1790,31 +2446,17 @@ from_client_msg(clixon_handle        h,
     // XXX    clixon_debug(CLIXON_DBG_MSG, "Reply:%s", cbuf_get(cbret));
     /* XXX problem here is that cbret has not been parsed so may contain 
        parse errors */
-    if (ce_client_descr(ce, &cbce) < 0)
+    if (backend_reply_msgid(cbret, msgid) < 0)
         goto done;
-    if (send_msg_reply(ce->ce_s, cbuf_get(cbce), cbuf_get(cbret), cbuf_len(cbret)+1) < 0){
-        switch (errno){
-        case EPIPE:
-            /* man (2) write: 
-             * EPIPE  fd is connected to a pipe or socket whose reading end is 
-             * closed.  When this happens the writing process will also receive 
-             * a SIGPIPE signal. 
-             * In Clixon this means a client, eg restconf, netconf or cli closes
-             * the (UNIX domain) socket.
-             */
-        case ECONNRESET:
-            clixon_log(h, LOG_WARNING, "client rpc reset");
-            break;
-        default:
-            goto done;
-        }
-    }
-    // ok:
+    CLIXON_PROBE4(rpc__reply, ce->ce_id, rpc, cbuf_len(cbret), clixon_latency_now() - tstart);
+    if (backend_client_send(h, ce, cbuf_get(cbret), cbuf_len(cbret)+1, 0) < 0)
+        goto done;
+ ok:
     retval = 0;
   done:
     clixon_debug(CLIXON_DBG_BACKEND | CLIXON_DBG_DETAIL, "retval:%d", retval);
     if (xnacm){
-        xml_free(xnacm);
+        nacm_tree_release(xnacm);
         if (clicon_nacm_cache_set(h, NULL) < 0)
             goto done;
     }
@@ -1822,8 +2464,6 @@ from_client_msg(clixon_handle        h,
         xml_free(xret);
     if (xt)
         xml_free(xt);
-    if (cbce)
-        cbuf_free(cbce);
     if (cbret)
         cbuf_free(cbret);
     /* Sanity: log if clixon_err() is not called ! */
@@ -1834,8 +2474,75 @@ from_client_msg(clixon_handle        h,
     return retval;// -1 here terminates backend
 }
 
-/*! An internal clicon message has arrived from a client. Receive and dispatch.
+/*! Dispatch messages buffered from a client
  *
+ * Stop if a reply is pending in a worker thread, or output to the client is blocked,
+ * and continue when resumed, so that replies are sent in request order.
+ * @param[in]   h    Clixon handle
+ * @param[in]   ce   Client entry, may be removed
+ * @retval      0    OK
+ * @retval     -1    Error
+ * @see ce_input_resume
+ */
+static int
+from_client_input(clixon_handle        h,
+                  struct client_entry *ce)
+{
+    int                  retval = -1;
+    struct clicon_msg   *msg;
+    struct client_entry *c;
+    uint32_t             id = ce->ce_id;
+    cbuf                *cbce = NULL;
+    int                  ret;
+
+    if (ce_client_descr(ce, &cbce) < 0)
+        goto done;
+    while (ce->ce_pending == 0 && ce->ce_blocked == 0){
+        if ((ret = clicon_msg_reader_next(ce->ce_reader, cbuf_get(cbce), &msg)) < 0){
+            clixon_log(h, LOG_WARNING, "client %d: %s, closing", ce->ce_nr, clixon_err_reason());
+            backend_client_rm(h, ce);
+            netconf_monitoring_counter_inc(h, "dropped-sessions");
+            break;
+        }
+        if (ret == 0)
+            break;
+        CLIXON_PROBE2(rpc__receive, ce->ce_id, ntohl(msg->op_len));
+        if (from_client_msg(h, ce, msg) < 0)
+            goto done;
+        /* Client may be removed by message, eg kill-session */
+        for (c = backend_client_list(h); c; c = c->ce_next)
+            if (c == ce && c->ce_id == id)
+                break;
+        if (c == NULL || ce->ce_s == 0)
+            break;
+    }
+    retval = 0;
+ done:
+    if (cbce)
+        cbuf_free(cbce);
+    return retval;
+}
+
+/*! Timeout callback to dispatch messages already buffered from a client
+ *
+ * @param[in]   s    Not used
+ * @param[in]   arg  Client entry
+ * @retval      0    OK
+ * @retval     -1    Error
+ * @see ce_input_resume
+ */
+static int
+from_client_resume(int   s,
+                   void *arg)
+{
+    struct client_entry *ce = (struct client_entry *)arg;
+
+    return from_client_input(ce->ce_handle, ce);
+}
+
+/*! Internal clicon messages have arrived from a client. Receive and dispatch.
+ *
+ * Read as much as is available, and dispatch all complete messages
  * @param[in]   s    Socket where message arrived. read from this.
  * @param[in]   arg  Client entry (from).
  * @retval      0    OK
@@ -1847,38 +2554,114 @@ from_client(int   s,
             void* arg)
 {
     int                  retval = -1;
-    struct clicon_msg   *msg = NULL;
     struct client_entry *ce = (struct client_entry *)arg;
     clixon_handle        h = ce->ce_handle;
     int                  eof = 0;
-    cbuf                *cbce = NULL;
+    int                  ret;
 
     clixon_debug(CLIXON_DBG_BACKEND | CLIXON_DBG_DETAIL, "");
     if (s != ce->ce_s){
         clixon_err(OE_NETCONF, EINVAL, "Internal error: s != ce->ce_s");
         goto done;
     }
-    if (ce_client_descr(ce, &cbce) < 0)
-        goto done;
-    if (clicon_msg_rcv(ce->ce_s, cbuf_get(cbce), 0, &msg, &eof) < 0)
+    if ((ret = clicon_msg_reader_read(ce->ce_reader, s, &eof)) < 0)
         goto done;
     if (eof){
         backend_client_rm(h, ce);
         netconf_monitoring_counter_inc(h, "dropped-sessions");
     }
-    else
-        if (from_client_msg(h, ce, msg) < 0)
-            goto done;
+    else if (ret == 1 && from_client_input(h, ce) < 0)
+        goto done;
     retval = 0;
   done:
     clixon_debug(CLIXON_DBG_BACKEND | CLIXON_DBG_DETAIL, "retval:%d", retval);
-    if (cbce)
-        cbuf_free(cbce);
-    if (msg)
-        free(msg);
     return retval; /* -1 here terminates backend */
 }
 
+/*! Mark client as having a pending reply made by a worker thread
+ *
+ * Stop reading input from the client until the reply is sent, so that replies are sent
+ * in request order.
+ * @param[in]  h    Clixon handle
+ * @param[in]  ce   Client entry
+ * @retval     0    OK
+ * @retval    -1    Error
+ * @see backend_client_reply_pending
+ */
+int
+backend_client_pending(clixon_handle        h,
+                       struct client_entry *ce)
+{
+    if (ce->ce_pending){
+        clixon_err(OE_NETCONF, EINVAL, "Client %u already has a pending reply", ce->ce_id);
+        return -1;
+    }
+    ce->ce_pending = 1;
+    if (ce->ce_blocked == 0)
+        clixon_event_unreg_fd(ce->ce_s, from_client);
+    return 0;
+}
+
+/*! Send a reply made by a worker thread and resume reading from client
+ *
+ * The client may have been removed while the reply was pending, in which case the reply
+ * is dropped.
+ * @param[in]  h      Clixon handle
+ * @param[in]  ce     Client entry, may be deleted
+ * @param[in]  id     Session id of client when request was made
+ * @param[in]  cbret  Reply
+ * @param[in]  error  Set if reply is an rpc-error
+ * @retval     0      OK
+ * @retval    -1      Error
+ * @see backend_client_pending
+ */
+int
+backend_client_reply_pending(clixon_handle        h,
+                             struct client_entry *ce,
+                             uint32_t             id,
+                             cbuf                *cbret,
+                             int                  error)
+{
+    int                  retval = -1;
+    struct client_entry *c;
+
+    for (c = backend_client_list(h); c; c = c->ce_next)
+        if (c == ce && c->ce_id == id && c->ce_pending)
+            break;
+    if (c == NULL){
+        clixon_debug(CLIXON_DBG_BACKEND, "Client %u removed, drop reply", id);
+        goto ok;
+    }
+    if (error){
+        ce->ce_out_rpc_errors++;
+        netconf_monitoring_counter_inc(h, "out-rpc-errors");
+    }
+    if (ce->ce_pending_rpc){
+        CLIXON_PROBE4(rpc__reply, ce->ce_id, ce->ce_pending_rpc, cbuf_len(cbret),
+                      clixon_latency_now() - ce->ce_pending_t0);
+        if (clixon_latency_record("rpc", ce->ce_pending_rpc, NULL,
+                                  clixon_latency_now() - ce->ce_pending_t0) < 0)
+            goto done;
+        free(ce->ce_pending_rpc);
+        ce->ce_pending_rpc = NULL;
+    }
+    if (backend_reply_msgid(cbret, ce->ce_pending_msgid) < 0)
+        goto done;
+    if (ce->ce_pending_msgid){
+        free(ce->ce_pending_msgid);
+        ce->ce_pending_msgid = NULL;
+    }
+    if (backend_client_send(h, ce, cbuf_get(cbret), cbuf_len(cbret)+1, 0) < 0)
+        goto done;
+    ce->ce_pending = 0;
+    if (ce_input_resume(ce) < 0)
+        goto done;
+ ok:
+    retval = 0;
+ done:
+    return retval;
+}
+
 /*! Init backend rpc: Set up standard netconf rpc callbacks
  *
  * @param[in]  h     Clixon handle
@@ -1955,6 +2738,9 @@ backend_rpc_init(clixon_handle h)
     if (rpc_callback_register(h, from_client_stats, NULL,
                               CLIXON_LIB_NS, "stats") < 0)
         goto done;
+    if (rpc_callback_register(h, from_client_stats_reset, NULL,
+                              CLIXON_LIB_NS, "stats-reset") < 0)
+        goto done;
     if (rpc_callback_register(h, from_client_restart_plugin, NULL,
                               CLIXON_LIB_NS, "restart-plugin") < 0)
         goto done;
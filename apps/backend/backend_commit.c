@@ -64,6 +64,7 @@
 
 /* clixon */
 #include <clixon/clixon.h>
+#include <clixon/clixon_probe.h>
 
 #include "clixon_backend_transaction.h"
 #include "clixon_backend_plugin.h"
@@ -71,6 +72,29 @@
 #include "backend_handle.h"
 #include "clixon_backend_commit.h"
 #include "backend_client.h"
+#include "backend_onchange.h"
+
+/*! Record latency of a transaction phase and restart timer
+ *
+ * @param[in]     phase  Name of phase
+ * @param[in,out] t0     Start time of phase, set to current time
+ * @retval        0      OK
+ * @retval       -1      Error
+ * @see clixon_latency_record
+ */
+static int
+transaction_phase(const char *phase,
+                  uint64_t   *t0)
+{
+    uint64_t t;
+
+    t = clixon_latency_now();
+    CLIXON_PROBE2(transaction__phase, phase, t - *t0);
+    if (clixon_latency_record("transaction", phase, NULL, t - *t0) < 0)
+        return -1;
+    *t0 = t;
+    return 0;
+}
 
 /*! Key values are checked for validity independent of user-defined callbacks
  *
@@ -486,7 +510,10 @@ validate_common(clixon_handle       h,
     int         i;
     cxobj      *xn;
     int         ret;
+    uint64_t    t0;
 
+    CLIXON_PROBE1(validate__start, db);
+    t0 = clixon_latency_now();
     if ((yspec = clicon_dbspec_yang(h)) == NULL){
         clixon_err(OE_FATAL, 0, "No DB_SPEC");
         goto done;
@@ -514,6 +541,8 @@ validate_common(clixon_handle       h,
     /* Clear flags xpath for get */
     xml_apply0(td->td_src, CX_ELMNT, (xml_applyfn_t*)xml_flag_reset,
                (void*)(XML_FLAG_MARK|XML_FLAG_CHANGE));
+    if (transaction_phase("load", &t0) < 0)
+        goto done;
     /* 3. Compute differences */
     if (xml_diff(td->td_src,
                  td->td_target,
@@ -548,9 +577,13 @@ validate_common(clixon_handle       h,
         xml_flag_set(xn, XML_FLAG_CHANGE);
         xml_apply_ancestor(xn, (xml_applyfn_t*)xml_flag_set, (void*)XML_FLAG_CHANGE);
     }
+    if (transaction_phase("diff", &t0) < 0)
+        goto done;
     /* 4. Call plugin transaction start callbacks */
     if (plugin_transaction_begin_all(h, td) < 0)
         goto done;
+    if (transaction_phase("begin", &t0) < 0)
+        goto done;
 
     /* 5. Make generic validation on all new or changed data.
        Note this is only call that uses 3-values */
@@ -558,16 +591,23 @@ validate_common(clixon_handle       h,
         goto done;
     if (ret == 0)
         goto fail;
+    if (transaction_phase("validate-generic", &t0) < 0)
+        goto done;
 
     /* 6. Call plugin transaction validate callbacks */
     if (plugin_transaction_validate_all(h, td) < 0)
         goto done;
+    if (transaction_phase("validate", &t0) < 0)
+        goto done;
 
     /* 7. Call plugin transaction complete callbacks */
     if (plugin_transaction_complete_all(h, td) < 0)
         goto done;
+    if (transaction_phase("complete", &t0) < 0)
+        goto done;
     retval = 1;
  done:
+    CLIXON_PROBE2(validate__done, db, retval);
     return retval;
  fail:
     retval = 0;
@@ -669,6 +709,7 @@ candidate_commit(clixon_handle h,
     int                 ret;
     cxobj              *xret = NULL;
     yang_stmt          *yspec;
+    uint64_t            t0;
 
     /* 1. Start transaction */
     if ((td = transaction_new()) == NULL)
@@ -706,16 +747,26 @@ candidate_commit(clixon_handle h,
             goto done;
         goto fail;
     }
+    t0 = clixon_latency_now();
     /* 7. Call plugin transaction commit callbacks */
     if (plugin_transaction_commit_all(h, td) < 0)
         goto done;
+    if (transaction_phase("commit", &t0) < 0)
+        goto done;
     /* After commit, make a post-commit call (sure that all plugins have committed) */
     if (plugin_transaction_commit_done_all(h, td) < 0)
         goto done;
+    if (transaction_phase("commit-done", &t0) < 0)
+        goto done;
+    /* On-change notifications of deleted nodes refer to the source tree */
+    if (backend_onchange_prepare(h, td) < 0)
+        goto done;
     /* 8. Success: Copy candidate to running 
      */
     if (xmldb_copy(h, db, "running") < 0)
         goto done;
+    if (transaction_phase("datastore-copy", &t0) < 0)
+        goto done;
     xmldb_modified_set(h, db, 0); /* reset dirty bit */
     /* Here pointers to old (source) tree are obsolete */
     if (td->td_dvec){
@@ -730,12 +781,23 @@ candidate_commit(clixon_handle h,
 
     /* 9. Call plugin transaction end callbacks */
     plugin_transaction_end_all(h, td);
+    if (transaction_phase("end", &t0) < 0)
+        goto done;
+    /* The commit is done, failing to notify subscribers does not fail it */
+    if (backend_onchange_send(h, 1) < 0){
+        clixon_log(h, LOG_WARNING, "%s: on-change notification: %s",
+                   __FUNCTION__, clixon_err_reason());
+        clixon_err_reset();
+        backend_onchange_send(h, 0); /* Discard notifications not sent */
+    }
     retval = 1;
  done:
     /* In case of failure (or error), call plugin transaction termination callbacks */
     if (td){
-        if (retval < 1)
+        if (retval < 1){
+            backend_onchange_send(h, 0);
             plugin_transaction_abort_all(h, td);
+        }
         transaction_free(td);
     }
     if (xret)
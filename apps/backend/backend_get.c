@@ -71,6 +71,30 @@
 #include "backend_client.h"
 #include "backend_handle.h"
 #include "backend_get.h"
+#include "backend_worker.h"
+#include "backend_cache.h"
+
+/*
+ * Types
+ */
+/* Get request handed off to a worker thread, all data is owned by the job */
+struct get_job{
+    yang_stmt        *gj_yspec;    /* Read-only yang spec, copied from handle in main thread */
+    cxobj            *gj_xret;     /* Result tree, private copy of datastore and state */
+    char             *gj_xpath;    /* Canonical xpath, or NULL */
+    cvec             *gj_nsc;      /* Namespace context of xpath */
+    char             *gj_username; /* User name for NACM access */
+    cxobj            *gj_xnacm;    /* Held NACM tree, or NULL if no NACM validation */
+    int32_t           gj_depth;
+    withdefaults_type gj_wdef;
+    int               gj_print_threads; /* CLICON_BACKEND_PRINT_THREADS */
+    yang_stmt       **gj_ymods;    /* Copy of modules for binary reply, or NULL for XML */
+    int               gj_nymods;
+    char             *gj_cachekey; /* Reply cache key, or NULL if not cached */
+    uint64_t          gj_dbgen;    /* Datastore generation of cache entry */
+    uint64_t          gj_rgen;     /* Running generation of cache entry */
+    uint32_t          gj_ttl;      /* State data TTL of cache entry */
+};
 
 /*! restrconf get capabilities
  *
@@ -154,7 +178,7 @@ client_get_streams(clixon_handle   h,
     /* Second argument is a hack to have the same function for the
      * RFC5277 and 8040 stream cases
      */
-    if (stream_get_xml(h, strcmp(top,"restconf-state")==0, cb) < 0)
+    if (stream_get_xml(h, strcmp(top,"restconf-state")==0, clicon_username_get(h), cb) < 0)
         goto done;
     cprintf(cb,"</%s>", top);
 
@@ -325,6 +349,49 @@ get_statedata(clixon_handle     h,
     goto done;
 }
 
+/*! Get a sample of state data with default values
+ *
+ * @param[in]  h       Clixon handle
+ * @param[in]  xpath   XPath selection, may be used to filter early
+ * @param[in]  nsc     XML Namespace context for xpath
+ * @param[out] xret    State data, or rpc-error if retval is 0. Free with xml_free
+ * @retval     1       OK
+ * @retval     0       Statedata callback failed (error in xret)
+ * @retval    -1       Error
+ * @see backend_periodic.c  Sampling of periodic subscriptions
+ */
+int
+backend_statedata_get(clixon_handle h,
+                      char         *xpath,
+                      cvec         *nsc,
+                      cxobj       **xret)
+{
+    int        retval = -1;
+    yang_stmt *yspec;
+    int        ret;
+
+    if ((yspec = clicon_dbspec_yang(h)) == NULL){
+        clixon_err(OE_YANG, ENOENT, "No yang spec");
+        goto done;
+    }
+    if ((*xret = xml_new(DATASTORE_TOP_SYMBOL, NULL, CX_ELMNT)) == NULL)
+        goto done;
+    if ((ret = get_statedata(h, xpath?xpath:"/", nsc, xret)) < 0)
+        goto done;
+    if (ret == 0)
+        goto fail;
+    if (xml_global_defaults(h, *xret, nsc, xpath, yspec, 1) < 0)
+        goto done;
+    if (xml_default_recurse(*xret, 1, 0) < 0)
+        goto done;
+    retval = 1;
+ done:
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
 /*! Help function to filter out anything that is outside of xpath 
  *
  * Code complex to filter out anything that is outside of xpath 
@@ -334,7 +401,6 @@ get_statedata(clixon_handle     h,
  * and we need to re-add it.
  * Note original xpath
  *
- * @param[in]  h       Clixon handle 
  * @param[in]  yspec   Yang spec
  * @param[in]  xret    Result XML tree
  * @param[in]  xvec    xpath lookup result on xret
@@ -345,8 +411,7 @@ get_statedata(clixon_handle     h,
  * @retval    -1       Error
  */
 static int
-filter_xpath_again(clixon_handle h,
-                   yang_stmt    *yspec,
+filter_xpath_again(yang_stmt    *yspec,
                    cxobj        *xret,
                    cxobj       **xvec,
                    size_t        xlen,
@@ -382,7 +447,7 @@ filter_xpath_again(clixon_handle h,
 
 /*! Help function for NACM access and return message
  *
- * @param[in]  h        Clixon handle 
+ * @param[in]  yspec    Yang spec
  * @param[in]  xret     Result XML tree
  * @param[in]  xvec    xpath lookup result on xret
  * @param[in]  xlen    length of xvec
@@ -391,12 +456,17 @@ filter_xpath_again(clixon_handle h,
  * @param[in]  username User name for NACM access
  * @param[in]  depth    Nr of levels to print, -1 is all, 0 is none
  * @param[in]  wdef     With-defaults parameter
+ * @param[in]  xnacm    NACM tree, or NULL if no NACM validation, see clicon_nacm_cache
+ * @param[in]  threads  Max nr of serialization threads, see CLICON_BACKEND_PRINT_THREADS
+ * @param[in]  ymods    Modules for binary reply indexed by client index, or NULL for XML
+ * @param[in]  nymods   Length of ymods
  * @param[out] cbret    Return xml tree, eg <rpc-reply>..., <rpc-error.. 
  * @retval     0        OK
  * @retval    -1        Error
+ * @note No clixon handle since this may run in a worker thread
  */
 static int
-get_nacm_and_reply(clixon_handle        h,
+get_nacm_and_reply(yang_stmt           *yspec,
                    cxobj               *xret,
                    cxobj              **xvec,
                    size_t               xlen,
@@ -405,17 +475,41 @@ get_nacm_and_reply(clixon_handle        h,
                    char                *username,
                    int32_t              depth,
                    withdefaults_type    wdef,
+                   cxobj               *xnacm,
+                   int                  threads,
+                   yang_stmt          **ymods,
+                   int                  nymods,
                    cbuf                *cbret)
 {
     int     retval = -1;
-    cxobj  *xnacm = NULL;
+    cxobj  *xrpl = NULL;
+    cxobj  *xd = NULL;
 
-    /* Pre-NACM access step */
-    xnacm = clicon_nacm_cache(h);
     if (xnacm != NULL){ /* Do NACM validation */
         /* NACM datanode/module read validation */
-        if (nacm_datanode_read(h, xret, xvec, xlen, username, xnacm) < 0) 
+        if (nacm_datanode_read(yspec, xret, xvec, xlen, username, xnacm) < 0) 
+            goto done;
+    }
+    if (ymods != NULL){ /* Binary reply, see CLICON_IPC_BINARY */
+        if ((xrpl = xml_new("rpc-reply", NULL, CX_ELMNT)) == NULL)
+            goto done;
+        if (xmlns_set(xrpl, NULL, NETCONF_BASE_NAMESPACE) < 0)
+            goto done;
+        if (xret == NULL){
+            if (xml_new(NETCONF_OUTPUT_DATA, xrpl, CX_ELMNT) == NULL)
+                goto done;
+        }
+        else {
+            if (xml_name_set(xret, NETCONF_OUTPUT_DATA) < 0)
+                goto done;
+            if (xml_addsub(xrpl, xret) < 0)
+                goto done;
+            xd = xret;
+        }
+        /* Top level is rpc-reply/data, so add 2 to depth if significant */
+        if (clixon_xml2bin(cbret, xrpl, depth>0?depth+2:depth, wdef, ymods, nymods) < 0)
             goto done;
+        goto ok;
     }
     cprintf(cbret, "<rpc-reply xmlns=\"%s\">", NETCONF_BASE_NAMESPACE);     /* OK */
     if (xret==NULL)
@@ -424,12 +518,17 @@ get_nacm_and_reply(clixon_handle        h,
         if (xml_name_set(xret, NETCONF_OUTPUT_DATA) < 0)
             goto done;
         /* Top level is data, so add 1 to depth if significant */
-        if (clixon_xml2cbuf1(cbret, xret, 0, 0, NULL, depth>0?depth+1:depth, 0, wdef) < 0)
+        if (clixon_xml2cbuf_parallel(cbret, xret, 0, 0, NULL, depth>0?depth+1:depth, 0, wdef, threads) < 0)
             goto done;
     }
     cprintf(cbret, "</rpc-reply>");
+ ok:
     retval = 0;
  done:
+    if (xd)
+        xml_rm(xd); /* Owned by caller */
+    if (xrpl)
+        xml_free(xrpl);
     return retval;
 }
 
@@ -723,7 +822,7 @@ get_list_pagination(clixon_handle        h,
     if (xpath_vec(xret, nsc, "%s", &xvec, &xlen, xpath?xpath:"/") < 0)
         goto done;
     /* Help function to filter out anything that is outside of xpath */
-    if (filter_xpath_again(h, yspec, xret, xvec, xlen, xpath, nsc) < 0)
+    if (filter_xpath_again(yspec, xret, xvec, xlen, xpath, nsc) < 0)
         goto done;
 #ifdef LIST_PAGINATION_REMAINING
     /* Add remaining attribute Sec 3.1.5: 
@@ -745,7 +844,10 @@ get_list_pagination(clixon_handle        h,
             cbuf_free(cba);
     }
 #endif /* LIST_PAGINATION_REMAINING */
-    if (get_nacm_and_reply(h, xret, xvec, xlen, xpath, nsc, username, depth, wdef, cbret) < 0)
+    if (get_nacm_and_reply(yspec, xret, xvec, xlen, xpath, nsc, username, depth, wdef, clicon_nacm_cache(h),
+                           clicon_option_int(h, "CLICON_BACKEND_PRINT_THREADS"),
+                           (ce && ce->ce_binary_len)?ce->ce_binary_modules:NULL,
+                           ce?ce->ce_binary_len:0, cbret) < 0)
         goto done;
  ok:
     retval = 0;
@@ -765,6 +867,166 @@ get_list_pagination(clixon_handle        h,
     return retval;
 }
 
+/*! Free get job, called in main thread
+ *
+ * If the job is successful and the reply is cacheable, add it to the reply cache
+ * @param[in]  h     Clixon handle
+ * @param[in]  arg   struct get_job
+ * @param[in]  cbret Reply if job is successful, or NULL
+ */
+static void
+get_job_free(clixon_handle h,
+             void         *arg,
+             cbuf         *cbret)
+{
+    struct get_job *gj = (struct get_job *)arg;
+
+    if (gj == NULL)
+        return;
+    if (cbret && gj->gj_cachekey){
+        /* Not fatal */
+        if (backend_cache_put(h, gj->gj_cachekey, gj->gj_dbgen, gj->gj_rgen, gj->gj_ttl,
+                              cbuf_get(cbret), cbuf_len(cbret)) < 0)
+            clixon_log(h, LOG_WARNING, "%s: %s", __FUNCTION__, clixon_err_reason());
+    }
+    if (gj->gj_cachekey)
+        free(gj->gj_cachekey);
+    if (gj->gj_xret)
+        xml_free(gj->gj_xret);
+    if (gj->gj_xpath)
+        free(gj->gj_xpath);
+    if (gj->gj_nsc)
+        xml_nsctx_free(gj->gj_nsc);
+    if (gj->gj_username)
+        free(gj->gj_username);
+    if (gj->gj_xnacm)
+        nacm_tree_release(gj->gj_xnacm);
+    if (gj->gj_ymods)
+        free(gj->gj_ymods);
+    free(gj);
+}
+
+/*! Filter, NACM read access and reply of get job, run in worker thread
+ *
+ * Only operates on data owned by the job and the read-only yang spec, no clixon handle
+ * since the handle hash is modified by the main thread, eg username and NACM cache.
+ * @param[in]  arg    struct get_job
+ * @param[out] cbret  Return xml tree, eg <rpc-reply>..., <rpc-error.. 
+ * @retval     0      OK
+ * @retval    -1      Error
+ * @see get_common    Same code in main thread
+ */
+static int
+get_job_run(void *arg,
+            cbuf *cbret)
+{
+    int             retval = -1;
+    struct get_job *gj = (struct get_job *)arg;
+    cxobj         **xvec = NULL;
+    size_t          xlen;
+
+    if (xpath_vec(gj->gj_xret, gj->gj_nsc, "%s", &xvec, &xlen, gj->gj_xpath?gj->gj_xpath:"/") < 0)
+        goto done;
+    if (filter_xpath_again(gj->gj_yspec, gj->gj_xret, xvec, xlen, gj->gj_xpath, gj->gj_nsc) < 0)
+        goto done;
+    if (get_nacm_and_reply(gj->gj_yspec, gj->gj_xret, xvec, xlen, gj->gj_xpath, gj->gj_nsc,
+                           gj->gj_username, gj->gj_depth, gj->gj_wdef, gj->gj_xnacm,
+                           gj->gj_print_threads, gj->gj_ymods, gj->gj_nymods, cbret) < 0)
+        goto done;
+    retval = 0;
+ done:
+    if (xvec)
+        free(xvec);
+    return retval;
+}
+
+/*! Hand off the rest of a get request to a worker thread
+ *
+ * The job takes over the result tree, xpath and namespace context. NACM tree is held
+ * since the cache is only valid during the request in the main thread.
+ * @param[in]     h        Clixon handle
+ * @param[in]     ce       Client entry
+ * @param[in]     yspec    Yang spec
+ * @param[in,out] xretp    Result tree, set to NULL
+ * @param[in,out] xpathp   XPath, set to NULL
+ * @param[in,out] nscp     Namespace context, set to NULL
+ * @param[in]     username User name for NACM access
+ * @param[in]     depth    Nr of levels to print, -1 is all, 0 is none
+ * @param[in]     wdef     With-defaults parameter
+ * @param[in]     xnacm    NACM tree, or NULL if no NACM validation
+ * @param[in,out] cachekeyp Reply cache key, or NULL if not cached, set to NULL
+ * @param[in]     dbgen    Datastore generation of cache entry
+ * @param[in]     rgen     Running generation of cache entry
+ * @param[in]     ttl      State data TTL of cache entry
+ * @retval        0        OK, reply is sent when job is done
+ * @retval       -1        Error
+ */
+static int
+get_worker_submit(clixon_handle        h,
+                  struct client_entry *ce,
+                  yang_stmt           *yspec,
+                  cxobj              **xretp,
+                  char               **xpathp,
+                  cvec               **nscp,
+                  char                *username,
+                  int32_t              depth,
+                  withdefaults_type    wdef,
+                  cxobj               *xnacm,
+                  char               **cachekeyp,
+                  uint64_t             dbgen,
+                  uint64_t             rgen,
+                  uint32_t             ttl)
+{
+    int             retval = -1;
+    struct get_job *gj;
+
+    if ((gj = malloc(sizeof(*gj))) == NULL){
+        clixon_err(OE_UNIX, errno, "malloc");
+        goto done;
+    }
+    memset(gj, 0, sizeof(*gj));
+    gj->gj_yspec = yspec;
+    gj->gj_depth = depth;
+    gj->gj_wdef = wdef;
+    gj->gj_print_threads = clicon_option_int(h, "CLICON_BACKEND_PRINT_THREADS");
+    gj->gj_xret = *xretp;
+    *xretp = NULL;
+    gj->gj_xpath = *xpathp;
+    *xpathp = NULL;
+    gj->gj_nsc = *nscp;
+    *nscp = NULL;
+    gj->gj_cachekey = *cachekeyp;
+    *cachekeyp = NULL;
+    gj->gj_dbgen = dbgen;
+    gj->gj_rgen = rgen;
+    gj->gj_ttl = ttl;
+    if (username && (gj->gj_username = strdup(username)) == NULL){
+        clixon_err(OE_UNIX, errno, "strdup");
+        get_job_free(h, gj, NULL);
+        goto done;
+    }
+    if (xnacm != NULL &&
+        (gj->gj_xnacm = nacm_tree_hold(xnacm)) == NULL){
+        get_job_free(h, gj, NULL);
+        goto done;
+    }
+    if (ce->ce_binary_len){
+        if ((gj->gj_ymods = malloc(ce->ce_binary_len*sizeof(yang_stmt*))) == NULL){
+            clixon_err(OE_UNIX, errno, "malloc");
+            get_job_free(h, gj, NULL);
+            goto done;
+        }
+        memcpy(gj->gj_ymods, ce->ce_binary_modules, ce->ce_binary_len*sizeof(yang_stmt*));
+        gj->gj_nymods = ce->ce_binary_len;
+    }
+    /* Frees gj on error */
+    if (backend_worker_submit(h, ce, get_job_run, get_job_free, gj) < 0)
+        goto done;
+    retval = 0;
+ done:
+    return retval;
+}
+
 /*! Common get/get-config code for retrieving  configuration and state information.
  *
  * @param[in]  h       Clixon handle 
@@ -811,6 +1073,12 @@ get_common(clixon_handle        h,
     uint32_t        limit = 0;
     withdefaults_type wdef;
     char             *wdefstr;
+    char             *cachekey = NULL;
+    uint64_t          dbgen = 0;
+    uint64_t          rgen = 0;
+    uint32_t          ttl = 0;
+    size_t            cblen0;
+    cxobj            *xnacm;
 
     wdef = WITHDEFAULTS_EXPLICIT;
     clixon_debug(CLIXON_DBG_BACKEND | CLIXON_DBG_DETAIL, "");
@@ -881,11 +1149,30 @@ get_common(clixon_handle        h,
             goto done;
         goto ok;
     }
+    /* Reply cache, state data only if all state plugins set a TTL */
+    if (backend_cache_enabled(h) &&
+        (content == CONTENT_CONFIG || (ttl = clixon_plugin_statedata_ttl(h)) > 0)){
+        if (backend_cache_key(h, ce, db, content, depth, wdef, username, xpath, nsc, &cachekey) < 0)
+            goto done;
+        dbgen = xmldb_generation(h, db);
+        rgen = xmldb_generation(h, "running");
+        if ((ret = backend_cache_get(h, cachekey, dbgen, rgen, cbret)) < 0)
+            goto done;
+        if (ret == 1)
+            goto ok;
+    }
+    xnacm = clicon_nacm_cache(h);
     /* Read configuration */
     switch (content){
     case CONTENT_CONFIG:    /* config data only */
-        /* specific xpath */
-        if (xmldb_get0(h, db, YB_MODULE, nsc, xpath?xpath:"/", 1, wdef, &xret, NULL, NULL) < 0) {
+        if (xnacm != NULL && username != NULL){
+            /* NACM read validation is made when copying from the datastore */
+            ret = xmldb_get_nacm(h, db, nsc, xpath?xpath:"/", wdef, username, xnacm, &xret);
+            xnacm = NULL;
+        }
+        else /* specific xpath */
+            ret = xmldb_get0(h, db, YB_MODULE, nsc, xpath?xpath:"/", 1, wdef, &xret, NULL, NULL);
+        if (ret < 0) {
             if ((cbmsg = cbuf_new()) == NULL){
                 clixon_err(OE_UNIX, errno, "cbuf_new");
                 goto done;
@@ -988,11 +1275,26 @@ get_common(clixon_handle        h,
             if (xml_apply(xret, CX_ELMNT, (xml_applyfn_t*)xml_flag_reset, (void*)XML_FLAG_MARK) < 0)
                 goto done;
         }
+    /* Filtering, NACM and reply in worker thread, if enabled */
+    if (ce != NULL && backend_worker_enabled(h)){
+        if (get_worker_submit(h, ce, yspec, &xret, &xpath, &nsc, username, depth, wdef, xnacm,
+                              &cachekey, dbgen, rgen, ttl) < 0)
+            goto done;
+        goto ok;
+    }
     if (xpath_vec(xret, nsc, "%s", &xvec, &xlen, xpath?xpath:"/") < 0)
         goto done;
-    if (filter_xpath_again(h, yspec, xret, xvec, xlen, xpath, nsc) < 0)
+    if (filter_xpath_again(yspec, xret, xvec, xlen, xpath, nsc) < 0)
+        goto done;
+    cblen0 = cbuf_len(cbret);
+    if (get_nacm_and_reply(yspec, xret, xvec, xlen, xpath, nsc, username, depth, wdef, xnacm,
+                           clicon_option_int(h, "CLICON_BACKEND_PRINT_THREADS"),
+                           (ce && ce->ce_binary_len)?ce->ce_binary_modules:NULL,
+                           ce?ce->ce_binary_len:0, cbret) < 0)
         goto done;
-    if (get_nacm_and_reply(h, xret, xvec, xlen, xpath, nsc, username, depth, wdef, cbret) < 0)
+    if (cachekey &&
+        backend_cache_put(h, cachekey, dbgen, rgen, ttl,
+                          cbuf_get(cbret)+cblen0, cbuf_len(cbret)-cblen0) < 0)
         goto done;
  ok:
     retval = 0;
@@ -1016,6 +1318,8 @@ get_common(clixon_handle        h,
         xml_free(xerr);
     if (xpath)
         free(xpath);
+    if (cachekey)
+        free(cachekey);
     return retval;
 }
 
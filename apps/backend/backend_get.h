@@ -43,5 +43,6 @@
 int from_client_get_config(clixon_handle h, cxobj *xe, cbuf *cbret, void *arg, void *regarg);
 int from_client_get(clixon_handle h, cxobj *xe, cbuf *cbret, void *arg, void *regarg);
 int from_client_get_pageable_list(clixon_handle h, cxobj *xe, cbuf *cbret, void *arg, void *regarg); /* XXX */
+int backend_statedata_get(clixon_handle h, char *xpath, cvec *nsc, cxobj **xret);
 
 #endif  /* _BACKEND_GET_H_ */
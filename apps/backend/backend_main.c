@@ -77,6 +77,10 @@
 #include "backend_handle.h"
 #include "backend_startup.h"
 #include "backend_plugin_restconf.h"
+#include "backend_worker.h"
+#include "backend_cache.h"
+#include "backend_onchange.h"
+#include "backend_periodic.h"
 
 /* Command line options to be passed to getopt(3) */
 #define BACKEND_OPTS "hVD:f:E:l:C:d:p:b:Fza:u:P:1qs:c:U:g:y:o:"
@@ -101,6 +105,11 @@ backend_terminate(clixon_handle h)
     cvec      *nsctx;
 
     clixon_debug(CLIXON_DBG_BACKEND, "");
+    /* Stop worker threads before freeing data they may use */
+    backend_worker_exit(h);
+    backend_cache_exit(h);
+    clixon_latency_free();
+    nacm_exit();
     if ((ss = clicon_socket_get(h)) != -1)
         close(ss);
     /* Disconnect datastore */
@@ -808,6 +817,12 @@ main(int    argc,
     if (clicon_option_exists(h, "CLICON_STREAM_PUB") &&
         stream_publish_init() < 0)
         goto done;
+    /* On-change stream of config changes, see CLICON_STREAM_ON_CHANGE */
+    if (backend_onchange_init(h) < 0)
+        goto done;
+    /* Periodic stream of state data, see CLICON_STREAM_PERIODIC */
+    if (backend_periodic_init(h) < 0)
+        goto done;
     /* Connect to plugin to get a handle */
     if (xmldb_connect(h) < 0)
         goto done;
@@ -1115,6 +1130,9 @@ main(int    argc,
 #endif
     if (stream_timer_setup(0, h) < 0)
         goto done;
+    /* Start worker threads for read-only requests, if configured */
+    if (backend_worker_init(h) < 0)
+        goto done;
     /* Just before event-loop, after socket bind/listen */
     if (netconf_monitoring_statistics_init(h) < 0)
         goto done;
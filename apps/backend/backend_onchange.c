@@ -0,0 +1,569 @@
+/*
+ *
+  ***** BEGIN LICENSE BLOCK *****
+ 
+  Copyright (C) 2024 Olof Hagsand
+
+  This file is part of CLIXON.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Alternatively, the contents of this file may be used under the terms of
+  the GNU General Public License Version 3 or later (the "GPL"),
+  in which case the provisions of the GPL are applicable instead
+  of those above. If you wish to allow use of your version of this file only
+  under the terms of the GPL, and not to allow others to
+  use your version of this file under the terms of Apache License version 2, 
+  indicate your decision by deleting the provisions above and replace them with
+  the  notice and other provisions required by the GPL. If you do not delete
+  the provisions above, a recipient may use your version of this file under
+  the terms of any one of the Apache License version 2 or the GPL.
+
+  ***** END LICENSE BLOCK *****
+ *
+ * On-change subscriptions of config changes
+ *
+ * If CLICON_STREAM_ON_CHANGE is set, clients may subscribe to the ON-CHANGE stream
+ * with an xpath filter selecting config data. After each commit of running, the
+ * changes of the commit, ie the add, delete and change vectors of the transaction, are
+ * matched with the nodes the filter selects in the target (or for deleted nodes
+ * in the source) datastore. A changed node matches if it or an ancestor is
+ * selected, or else its selected descendants match.
+ * The filter of subscriptions with equal filters and user is evaluated once and they
+ * get the same notification, see stream_notify_prepare. Nodes the user may not read
+ * are removed from the notification (RFC 8341 3.4.6):
+ * @code
+ *  <notification xmlns="urn:ietf:params:xml:ns:netconf:notification:1.0">
+ *    <eventTime>...</eventTime>
+ *    <on-change xmlns="http://clicon.org/lib">
+ *      <created>...</created>
+ *      <deleted>...</deleted>
+ *      <updated>...</updated>
+ *    </on-change>
+ *  </notification>
+ * @endcode
+ * The notifications are computed before running is updated since the source tree
+ * of deleted nodes is then gone, and sent when the commit has succeeded.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "clixon_config.h" /* generated by config & autoconf */
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <syslog.h>
+#include <sys/time.h>
+
+/* cligen */
+#include <cligen/cligen.h>
+
+/* clixon */
+#include <clixon/clixon.h>
+
+#include "clixon_backend_transaction.h"
+#include "clixon_backend_plugin.h"
+#include "backend_onchange.h"
+
+/* Argument of on-change event callback, see backend_onchange_prepare */
+struct onchange_arg{
+    transaction_data_t *oa_td;  /* Commit transaction */
+    cvec               *oa_nsc; /* Namespace context of canonical xpaths */
+};
+
+/* Ancestors of last copied node, see onchange_copy */
+struct onchange_path{
+    cxobj **op_anc;  /* Ancestors of current node, work vector */
+    cxobj **op_src;  /* Ancestors in datastore */
+    cxobj **op_dst;  /* Copies of ancestors in notification */
+    int     op_len;  /* Number of valid ancestors */
+    int     op_size; /* Allocated size of vectors */
+};
+
+/*! Create on-change stream if enabled
+ *
+ * @param[in]  h       Clixon handle
+ * @retval     0       OK
+ * @retval    -1       Error
+ */
+int
+backend_onchange_init(clixon_handle h)
+{
+    if (!clicon_option_bool(h, "CLICON_STREAM_ON_CHANGE"))
+        return 0;
+    return stream_add(h, ON_CHANGE_STREAM, "Config changes of running", 0, NULL);
+}
+
+/*! Mark nodes selected by xpath and their ancestors
+ *
+ * Selected nodes are marked with XML_FLAG_MARK and their ancestors with
+ * XML_FLAG_TRANSIENT
+ * @param[in]  xt      Datastore tree
+ * @param[in]  nsc     Namespace context
+ * @param[in]  xpath   Canonical xpath
+ * @param[out] vecp    Selected nodes, unmark with onchange_unmark
+ * @param[out] lenp    Length of vec
+ * @retval     0       OK
+ * @retval    -1       Error
+ */
+static int
+onchange_mark(cxobj      *xt,
+              cvec       *nsc,
+              const char *xpath,
+              cxobj    ***vecp,
+              size_t     *lenp)
+{
+    cxobj  *x;
+    size_t  i;
+
+    if (xpath_vec(xt, nsc, "%s", vecp, lenp, xpath) < 0)
+        return -1;
+    for (i = 0; i < *lenp; i++){
+        xml_flag_set((*vecp)[i], XML_FLAG_MARK);
+        x = (*vecp)[i];
+        while ((x = xml_parent(x)) != NULL && !xml_flag(x, XML_FLAG_TRANSIENT))
+            xml_flag_set(x, XML_FLAG_TRANSIENT);
+    }
+    return 0;
+}
+
+/*! Reset marks of selected nodes and their ancestors
+ *
+ * @param[in]  vec     Selected nodes
+ * @param[in]  len     Length of vec
+ * @see onchange_mark
+ */
+static void
+onchange_unmark(cxobj **vec,
+                size_t  len)
+{
+    cxobj  *x;
+    size_t  i;
+
+    for (i = 0; i < len; i++){
+        xml_flag_reset(vec[i], XML_FLAG_MARK);
+        x = vec[i];
+        while ((x = xml_parent(x)) != NULL && xml_flag(x, XML_FLAG_TRANSIENT))
+            xml_flag_reset(x, XML_FLAG_TRANSIENT);
+    }
+}
+
+/*! Copy a node without children except namespace declarations and list keys
+ *
+ * @param[in]  x       Node in datastore
+ * @param[in]  xp      Parent of copy
+ * @retval     xc      Copy
+ * @retval     NULL    Error
+ */
+static cxobj *
+onchange_copy_one(cxobj *x,
+                  cxobj *xp)
+{
+    cxobj     *xc;
+    cxobj     *xa = NULL;
+    cxobj     *xk;
+    cxobj     *xkc;
+    yang_stmt *y;
+    cg_var    *cvi = NULL;
+
+    if ((xc = xml_new(xml_name(x), xp, CX_ELMNT)) == NULL)
+        return NULL;
+    if (xml_copy_one(x, xc) < 0)
+        return NULL;
+    while ((xa = xml_child_each(x, xa, CX_ATTR)) != NULL){
+        if (strcmp(xml_name(xa), "xmlns") != 0 &&
+            (xml_prefix(xa) == NULL || strcmp(xml_prefix(xa), "xmlns") != 0))
+            continue;
+        if ((xkc = xml_new(xml_name(xa), xc, CX_ATTR)) == NULL)
+            return NULL;
+        if (xml_copy(xa, xkc) < 0)
+            return NULL;
+    }
+    if ((y = xml_spec(x)) != NULL && yang_keyword_get(y) == Y_LIST)
+        while ((cvi = cvec_each(yang_cvec_get(y), cvi)) != NULL){
+            if ((xk = xml_find_type(x, NULL, cv_string_get(cvi), CX_ELMNT)) == NULL)
+                continue;
+            if ((xkc = xml_new(xml_name(xk), xc, CX_ELMNT)) == NULL)
+                return NULL;
+            if (xml_copy(xk, xkc) < 0)
+                return NULL;
+        }
+    return xc;
+}
+
+/*! Copy a changed node with its ancestors to notification
+ *
+ * Copies of ancestors shared with the previous node are reused, since the nodes of a
+ * change vector are in document order.
+ * @param[in]  xcat    Change category element in notification, eg <created>
+ * @param[in]  op      Ancestors of previous node
+ * @param[in]  x       Changed node in datastore
+ * @param[in]  full    Copy x with all children, else lists and containers without
+ *                     children except list keys
+ * @retval     0       OK
+ * @retval    -1       Error
+ */
+static int
+onchange_copy(cxobj                *xcat,
+              struct onchange_path *op,
+              cxobj                *x,
+              int                   full)
+{
+    int        retval = -1;
+    cxobj     *xa;
+    cxobj     *xp;
+    cxobj     *xc;
+    cxobj    **vec;
+    int        depth = 0;
+    int        i;
+    yang_stmt *y;
+    int        ret;
+
+    /* Number of ancestors below top of datastore */
+    for (xa = xml_parent(x); xa != NULL && xml_parent(xa) != NULL; xa = xml_parent(xa))
+        depth++;
+    if (depth > op->op_size){
+        if ((vec = realloc(op->op_anc, depth*sizeof(*vec))) == NULL){
+            clixon_err(OE_UNIX, errno, "realloc");
+            goto done;
+        }
+        op->op_anc = vec;
+        if ((vec = realloc(op->op_src, depth*sizeof(*vec))) == NULL){
+            clixon_err(OE_UNIX, errno, "realloc");
+            goto done;
+        }
+        op->op_src = vec;
+        if ((vec = realloc(op->op_dst, depth*sizeof(*vec))) == NULL){
+            clixon_err(OE_UNIX, errno, "realloc");
+            goto done;
+        }
+        op->op_dst = vec;
+        op->op_size = depth;
+    }
+    xa = x;
+    for (i = depth-1; i >= 0; i--){
+        xa = xml_parent(xa);
+        op->op_anc[i] = xa;
+    }
+    /* Reuse copies of ancestors shared with previous node */
+    for (i = 0; i < depth && i < op->op_len; i++)
+        if (op->op_src[i] != op->op_anc[i])
+            break;
+    xp = i ? op->op_dst[i-1] : xcat;
+    for (; i < depth; i++){
+        if ((xp = onchange_copy_one(op->op_anc[i], xp)) == NULL)
+            goto done;
+        op->op_src[i] = op->op_anc[i];
+        op->op_dst[i] = xp;
+    }
+    op->op_len = depth;
+    y = xml_spec(x);
+    /* List keys are copied with the list */
+    if (y != NULL && yang_keyword_get(y) == Y_LEAF &&
+        yang_keyword_get(yang_parent_get(y)) == Y_LIST &&
+        (ret = yang_key_match(yang_parent_get(y), xml_name(x), NULL)) != 0){
+        if (ret < 0)
+            goto done;
+        goto ok;
+    }
+    if (full || y == NULL ||
+        (yang_keyword_get(y) != Y_LIST && yang_keyword_get(y) != Y_CONTAINER)){
+        if ((xc = xml_new(xml_name(x), xp, CX_ELMNT)) == NULL)
+            goto done;
+        if (xml_copy(x, xc) < 0)
+            goto done;
+    }
+    else if (onchange_copy_one(x, xp) == NULL)
+        goto done;
+ ok:
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Copy selected descendants of a changed node to notification
+ *
+ * @param[in]  xcat    Change category element in notification
+ * @param[in]  op      Ancestors of previous node
+ * @param[in]  x       Changed node, or descendant of changed node, with selected descendants
+ * @param[in]  full    Copy selected nodes with all children
+ * @retval     0       OK
+ * @retval    -1       Error
+ */
+static int
+onchange_copy_selected(cxobj                *xcat,
+                       struct onchange_path *op,
+                       cxobj                *x,
+                       int                   full)
+{
+    cxobj *xc = NULL;
+
+    while ((xc = xml_child_each(x, xc, CX_ELMNT)) != NULL){
+        if (xml_flag(xc, XML_FLAG_MARK)){
+            if (onchange_copy(xcat, op, xc, full) < 0)
+                return -1;
+        }
+        else if (xml_flag(xc, XML_FLAG_TRANSIENT)){
+            if (onchange_copy_selected(xcat, op, xc, full) < 0)
+                return -1;
+        }
+    }
+    return 0;
+}
+
+/*! Add changed nodes matching filter to a change category of notification
+ *
+ * @param[in]  xev     on-change element of notification
+ * @param[in]  name    Change category, eg created
+ * @param[in]  filter  If set, only nodes marked by onchange_mark match, else all
+ * @param[in]  vec     Change vector of transaction
+ * @param[in]  len     Length of vec
+ * @param[in]  full    Copy changed nodes with all children
+ * @retval     0       OK
+ * @retval    -1       Error
+ */
+static int
+onchange_add(cxobj  *xev,
+             char   *name,
+             int     filter,
+             cxobj **vec,
+             size_t  len,
+             int     full)
+{
+    int                  retval = -1;
+    struct onchange_path op = {0,};
+    cxobj               *xcat = NULL;
+    cxobj               *x;
+    cxobj               *xa;
+    size_t               i;
+
+    if ((xcat = xml_new(name, NULL, CX_ELMNT)) == NULL)
+        goto done;
+    for (i = 0; i < len; i++){
+        x = vec[i];
+        if (filter){
+            /* The node or an ancestor is selected */
+            for (xa = x; xa != NULL; xa = xml_parent(xa))
+                if (xml_flag(xa, XML_FLAG_MARK))
+                    break;
+            if (xa == NULL){
+                if (xml_flag(x, XML_FLAG_TRANSIENT) &&
+                    onchange_copy_selected(xcat, &op, x, full) < 0)
+                    goto done;
+                continue;
+            }
+        }
+        if (onchange_copy(xcat, &op, x, full) < 0)
+            goto done;
+    }
+    if (xml_child_nr_type(xcat, CX_ELMNT) != 0){
+        if (xml_addsub(xev, xcat) < 0)
+            goto done;
+        xcat = NULL;
+    }
+    retval = 0;
+ done:
+    if (xcat)
+        xml_free(xcat);
+    if (op.op_anc)
+        free(op.op_anc);
+    if (op.op_src)
+        free(op.op_src);
+    if (op.op_dst)
+        free(op.op_dst);
+    return retval;
+}
+
+/*! Remove nodes of an on-change event that the user may not read
+ *
+ * Each change category is access controlled as a datastore top, change categories
+ * with no nodes left are removed.
+ * @param[in]  h        Clixon handle
+ * @param[in]  username NACM user of filter group, or NULL
+ * @param[in]  xev      on-change element
+ * @retval     1        OK
+ * @retval     0        User may not read any nodes, drop event
+ * @retval    -1        Error
+ * @see RFC8341 3.4.6.  Outgoing <notification> Authorization
+ * @see stream_ss_add_user  on access control of the user of a subscription
+ */
+static int
+onchange_nacm(clixon_handle h,
+              char         *username,
+              cxobj        *xev)
+{
+    int        retval = -1;
+    cxobj     *xnacm = NULL;
+    yang_stmt *yspec;
+    cxobj     *xcat;
+    cxobj     *xprev;
+    int        ret;
+
+    if ((ret = nacm_access_pre(h, NULL, username, &xnacm)) < 0)
+        goto done;
+    if (ret == 1) /* Permitted */
+        goto ok;
+    if (username == NULL)
+        goto fail;
+    if ((yspec = clicon_dbspec_yang(h)) == NULL){
+        clixon_err(OE_YANG, ENOENT, "No yang spec");
+        goto done;
+    }
+    xcat = NULL;
+    xprev = NULL;
+    while ((xcat = xml_child_each(xev, xcat, CX_ELMNT)) != NULL){
+        if (nacm_datanode_read(yspec, xcat, NULL, 0, username, xnacm) < 0)
+            goto done;
+        if (xml_child_nr_type(xcat, CX_ELMNT) == 0){
+            if (xml_purge(xcat) < 0)
+                goto done;
+            xcat = xprev;
+            continue;
+        }
+        xprev = xcat;
+    }
+ ok:
+    retval = 1;
+ done:
+    if (xnacm)
+        nacm_tree_release(xnacm);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
+/*! Compute on-change event of a filter group, callback of stream_notify_prepare
+ *
+ * @param[in]  h       Clixon handle
+ * @param[in]  sf      Filter group, with canonical xpath or NULL for all changes, and user
+ * @param[in]  arg     struct onchange_arg
+ * @param[out] xevp    on-change element, or NULL if no changes matched
+ * @retval     0       OK
+ * @retval    -1       Error
+ */
+static int
+onchange_event(clixon_handle         h,
+               struct stream_filter *sf,
+               void                 *arg,
+               cxobj               **xevp)
+{
+    int                 retval = -1;
+    struct onchange_arg *oa = (struct onchange_arg *)arg;
+    transaction_data_t *td = oa->oa_td;
+    yang_stmt          *yspec;
+    cxobj             **tvec = NULL;
+    size_t              tlen = 0;
+    cxobj             **svec = NULL;
+    size_t              slen = 0;
+    cxobj              *xev = NULL;
+    char               *xpath = sf->sf_xpath;
+    int                 filter;
+    int                 ret;
+
+    *xevp = NULL;
+    if ((filter = (xpath != NULL)) != 0){
+        if (oa->oa_nsc == NULL){
+            if ((yspec = clicon_dbspec_yang(h)) == NULL){
+                clixon_err(OE_YANG, ENOENT, "No yang spec");
+                goto done;
+            }
+            if (xml_nsctx_yangspec(yspec, &oa->oa_nsc) < 0)
+                goto done;
+        }
+        if (onchange_mark(transaction_target(td), oa->oa_nsc, xpath, &tvec, &tlen) < 0)
+            goto done;
+        if (onchange_mark(transaction_src(td), oa->oa_nsc, xpath, &svec, &slen) < 0)
+            goto done;
+    }
+    if ((xev = xml_new("on-change", NULL, CX_ELMNT)) == NULL)
+        goto done;
+    if (xmlns_set(xev, NULL, CLIXON_LIB_NS) < 0)
+        goto done;
+    if (onchange_add(xev, "created", filter,
+                     transaction_avec(td), transaction_alen(td), 1) < 0)
+        goto done;
+    if (onchange_add(xev, "deleted", filter,
+                     transaction_dvec(td), transaction_dlen(td), 0) < 0)
+        goto done;
+    if (onchange_add(xev, "updated", filter,
+                     transaction_tcvec(td), transaction_clen(td), 1) < 0)
+        goto done;
+    if (xml_child_nr_type(xev, CX_ELMNT) != 0){
+        if ((ret = onchange_nacm(h, sf->sf_username, xev)) < 0)
+            goto done;
+        if (ret == 1 && xml_child_nr_type(xev, CX_ELMNT) != 0){
+            *xevp = xev;
+            xev = NULL;
+        }
+    }
+    retval = 0;
+ done:
+    if (tvec){
+        onchange_unmark(tvec, tlen);
+        free(tvec);
+    }
+    if (svec){
+        onchange_unmark(svec, slen);
+        free(svec);
+    }
+    if (xev)
+        xml_free(xev);
+    return retval;
+}
+
+/*! Compute on-change notifications of a commit
+ *
+ * Call before running is updated, send with backend_onchange_send
+ * @param[in]  h       Clixon handle
+ * @param[in]  td      Commit transaction with change vectors
+ * @retval     0       OK
+ * @retval    -1       Error
+ */
+int
+backend_onchange_prepare(clixon_handle       h,
+                         transaction_data_t *td)
+{
+    int                 retval = -1;
+    struct onchange_arg oa = {td, NULL};
+
+    if (!clicon_option_bool(h, "CLICON_STREAM_ON_CHANGE"))
+        goto ok;
+    if (stream_notify_prepare(h, ON_CHANGE_STREAM, onchange_event, &oa) < 0)
+        goto done;
+ ok:
+    retval = 0;
+ done:
+    if (oa.oa_nsc)
+        xml_nsctx_free(oa.oa_nsc);
+    return retval;
+}
+
+/*! Send or discard on-change notifications computed by backend_onchange_prepare
+ *
+ * @param[in]  h       Clixon handle
+ * @param[in]  send    If set send notifications, else discard, eg if commit failed
+ * @retval     0       OK
+ * @retval    -1       Error
+ */
+int
+backend_onchange_send(clixon_handle h,
+                      int           send)
+{
+    if (!clicon_option_bool(h, "CLICON_STREAM_ON_CHANGE"))
+        return 0;
+    return stream_notify_pending(h, ON_CHANGE_STREAM, send);
+}
@@ -0,0 +1,322 @@
+/*
+ *
+  ***** BEGIN LICENSE BLOCK *****
+ 
+  Copyright (C) 2024 Olof Hagsand
+
+  This file is part of CLIXON.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Alternatively, the contents of this file may be used under the terms of
+  the GNU General Public License Version 3 or later (the "GPL"),
+  in which case the provisions of the GPL are applicable instead
+  of those above. If you wish to allow use of your version of this file only
+  under the terms of the GPL, and not to allow others to
+  use your version of this file under the terms of Apache License version 2, 
+  indicate your decision by deleting the provisions above and replace them with
+  the  notice and other provisions required by the GPL. If you do not delete
+  the provisions above, a recipient may use your version of this file under
+  the terms of any one of the Apache License version 2 or the GPL.
+
+  ***** END LICENSE BLOCK *****
+ *
+ * Periodic subscriptions of state data
+ *
+ * If CLICON_STREAM_PERIODIC is set, clients may subscribe to the PERIODIC stream with
+ * a period in centiseconds and an xpath filter selecting state data:
+ * @code
+ *  <create-subscription xmlns="urn:ietf:params:xml:ns:netmod:notification">
+ *    <stream>PERIODIC</stream>
+ *    <filter type="xpath" select="..."/>
+ *    <period>100</period>
+ *  </create-subscription>
+ * @endcode
+ * Subscriptions are sampled on ticks aligned to multiples of their period since the
+ * epoch, so that subscriptions with compatible periods, eg 1s and 2s, are sampled on
+ * the same ticks. On each tick the state data callbacks are called once for all
+ * subscriptions due, with their filter if they all have the same, and each filter
+ * group of subscriptions with the same filter and period gets one notification
+ * which is serialized once. Filter groups are per NACM user, and nodes the user may
+ * not read are removed from the notification:
+ * @code
+ *  <notification xmlns="urn:ietf:params:xml:ns:netconf:notification:1.0">
+ *    <eventTime>...</eventTime>
+ *    <periodic xmlns="http://clicon.org/lib">
+ *      <data>...</data>
+ *    </periodic>
+ *  </notification>
+ * @endcode
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "clixon_config.h" /* generated by config & autoconf */
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <syslog.h>
+#include <sys/time.h>
+
+/* cligen */
+#include <cligen/cligen.h>
+
+/* clixon */
+#include <clixon/clixon.h>
+
+#include "backend_get.h"
+#include "backend_periodic.h"
+
+/* Argument of periodic event callback, see periodic_timeout */
+struct periodic_arg{
+    uint64_t  pa_tick;   /* Sampling tick in centiseconds since epoch */
+    cxobj    *pa_sample; /* State data sampled on tick */
+    cvec     *pa_nsc;    /* Namespace context of canonical xpaths */
+};
+
+/*
+ * Variables
+ */
+static uint64_t _periodic_tick = 0; /* Tick of registered timer, 0 if none */
+
+static int periodic_timeout(int fd, void *arg);
+
+/*! Create periodic stream if enabled
+ *
+ * @param[in]  h       Clixon handle
+ * @retval     0       OK
+ * @retval    -1       Error
+ */
+int
+backend_periodic_init(clixon_handle h)
+{
+    if (!clicon_option_bool(h, "CLICON_STREAM_PERIODIC"))
+        return 0;
+    return stream_add(h, PERIODIC_STREAM, "Periodic state data", 0, NULL);
+}
+
+/*! Current time in centiseconds since epoch
+ */
+static uint64_t
+periodic_now(void)
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec*100 + tv.tv_usec/10000;
+}
+
+/*! Schedule timer at next tick of periodic subscriptions
+ *
+ * Call when a periodic subscription is added. The timer is not rescheduled when
+ * there are no periodic subscriptions
+ * @param[in]  h       Clixon handle
+ * @retval     0       OK
+ * @retval    -1       Error
+ */
+int
+backend_periodic_schedule(clixon_handle h)
+{
+    int                         retval = -1;
+    event_stream_t             *es;
+    struct stream_subscription *ss;
+    uint64_t                    now;
+    uint64_t                    tick = 0;
+    uint64_t                    t;
+    struct timeval              tv;
+
+    if ((es = stream_find(h, PERIODIC_STREAM)) == NULL)
+        goto ok;
+    now = periodic_now();
+    if ((ss = es->es_subscription) != NULL)
+        do {
+            if (ss->ss_period && !ss->ss_terminated){
+                t = (now/ss->ss_period + 1)*ss->ss_period;
+                if (tick == 0 || t < tick)
+                    tick = t;
+            }
+            ss = NEXTQ(struct stream_subscription *, ss);
+        } while (ss != es->es_subscription);
+    if (tick == 0 || (_periodic_tick != 0 && _periodic_tick <= tick))
+        goto ok;
+    if (_periodic_tick != 0)
+        clixon_event_unreg_timeout(periodic_timeout, h);
+    tv.tv_sec = tick/100;
+    tv.tv_usec = (tick%100)*10000;
+    if (clixon_event_reg_timeout(tv, periodic_timeout, h, "periodic subscriptions") < 0)
+        goto done;
+    _periodic_tick = tick;
+ ok:
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Compute periodic event of a filter group, callback of stream_notify_prepare
+ *
+ * @param[in]  h       Clixon handle
+ * @param[in]  sf      Filter group, with filter, period and user
+ * @param[in]  arg     struct periodic_arg
+ * @param[out] xevp    periodic element, or NULL if group is not due on tick or user may
+ *                     not read state data
+ * @retval     0       OK
+ * @retval    -1       Error
+ * @see RFC8341 3.4.6.  Outgoing <notification> Authorization
+ * @see stream_ss_add_user  on access control of the user of a subscription
+ */
+static int
+periodic_event(clixon_handle         h,
+               struct stream_filter *sf,
+               void                 *arg,
+               cxobj               **xevp)
+{
+    int                  retval = -1;
+    struct periodic_arg *pa = (struct periodic_arg *)arg;
+    cxobj               *xev = NULL;
+    cxobj               *xdata = NULL;
+    cxobj              **xvec = NULL;
+    size_t               xlen = 0;
+    size_t               i;
+    cxobj               *xnacm = NULL;
+    yang_stmt           *yspec;
+    int                  ret;
+
+    *xevp = NULL;
+    if (sf->sf_period == 0 || pa->pa_tick % sf->sf_period != 0)
+        goto ok;
+    if ((ret = nacm_access_pre(h, NULL, sf->sf_username, &xnacm)) < 0)
+        goto done;
+    if (ret == 0 && sf->sf_username == NULL)
+        goto ok;
+    if ((xdata = xml_dup(pa->pa_sample)) == NULL)
+        goto done;
+    if (sf->sf_xpath != NULL){
+        if (xpath_vec(xdata, pa->pa_nsc, "%s", &xvec, &xlen, sf->sf_xpath) < 0)
+            goto done;
+        for (i=0; i<xlen; i++)
+            xml_flag_set(xvec[i], XML_FLAG_MARK);
+        /* Remove everything that is not selected */
+        if (!xml_flag(xdata, XML_FLAG_MARK))
+            if (xml_tree_prune_flagged_sub(xdata, XML_FLAG_MARK, 1, NULL) < 0)
+                goto done;
+        if (xml_apply(xdata, CX_ELMNT, (xml_applyfn_t*)xml_flag_reset, (void*)XML_FLAG_MARK) < 0)
+            goto done;
+    }
+    if (xnacm != NULL){
+        if ((yspec = clicon_dbspec_yang(h)) == NULL){
+            clixon_err(OE_YANG, ENOENT, "No yang spec");
+            goto done;
+        }
+        if (nacm_datanode_read(yspec, xdata, NULL, 0, sf->sf_username, xnacm) < 0)
+            goto done;
+    }
+    if (xml_name_set(xdata, "data") < 0)
+        goto done;
+    if ((xev = xml_new("periodic", NULL, CX_ELMNT)) == NULL)
+        goto done;
+    if (xmlns_set(xev, NULL, CLIXON_LIB_NS) < 0)
+        goto done;
+    if (xml_addsub(xev, xdata) < 0)
+        goto done;
+    xdata = NULL;
+    *xevp = xev;
+    xev = NULL;
+ ok:
+    retval = 0;
+ done:
+    if (xnacm)
+        nacm_tree_release(xnacm);
+    if (xvec)
+        free(xvec);
+    if (xdata)
+        xml_free(xdata);
+    if (xev)
+        xml_free(xev);
+    return retval;
+}
+
+/*! Sample state data for periodic subscriptions due on tick and send notifications
+ *
+ * The state data callbacks are called once for all subscriptions due on the tick
+ * @param[in]  fd      Not used
+ * @param[in]  arg     Clixon handle
+ * @retval     0       OK
+ * @retval    -1       Error
+ */
+static int
+periodic_timeout(int   fd,
+                 void *arg)
+{
+    int                         retval = -1;
+    clixon_handle               h = (clixon_handle)arg;
+    event_stream_t             *es;
+    struct stream_subscription *ss;
+    struct periodic_arg         pa = {0,};
+    yang_stmt                  *yspec;
+    char                       *xpath = NULL;
+    int                         due = 0;
+    int                         ret;
+
+    pa.pa_tick = _periodic_tick;
+    _periodic_tick = 0;
+    if ((es = stream_find(h, PERIODIC_STREAM)) == NULL)
+        goto ok;
+    /* Sample with filter of subscriptions due if they all have the same */
+    if ((ss = es->es_subscription) != NULL)
+        do {
+            if (ss->ss_period && !ss->ss_terminated &&
+                pa.pa_tick % ss->ss_period == 0){
+                if (due++ == 0)
+                    xpath = ss->ss_filter->sf_xpath;
+                else if (xpath != NULL &&
+                         (ss->ss_filter->sf_xpath == NULL ||
+                          strcmp(xpath, ss->ss_filter->sf_xpath) != 0))
+                    xpath = NULL;
+            }
+            ss = NEXTQ(struct stream_subscription *, ss);
+        } while (ss != es->es_subscription);
+    if (due == 0)
+        goto resched;
+    if ((yspec = clicon_dbspec_yang(h)) == NULL){
+        clixon_err(OE_YANG, ENOENT, "No yang spec");
+        goto done;
+    }
+    if (xml_nsctx_yangspec(yspec, &pa.pa_nsc) < 0)
+        goto done;
+    clixon_debug(CLIXON_DBG_STREAM, "tick:%" PRIu64 " subscriptions:%d", pa.pa_tick, due);
+    if ((ret = backend_statedata_get(h, xpath, pa.pa_nsc, &pa.pa_sample)) < 0)
+        goto done;
+    if (ret == 0){
+        clixon_log(h, LOG_WARNING, "%s: State data callback failed, no periodic notifications", __FUNCTION__);
+        goto resched;
+    }
+    if (stream_notify_prepare(h, PERIODIC_STREAM, periodic_event, &pa) < 0)
+        goto done;
+    if (stream_notify_pending(h, PERIODIC_STREAM, 1) < 0)
+        goto done;
+ resched:
+    if (backend_periodic_schedule(h) < 0)
+        goto done;
+ ok:
+    retval = 0;
+ done:
+    if (pa.pa_sample)
+        xml_free(pa.pa_sample);
+    if (pa.pa_nsc)
+        xml_nsctx_free(pa.pa_nsc);
+    return retval;
+}
@@ -48,6 +48,7 @@
 #include <unistd.h>
 #include <errno.h>
 #include <signal.h>
+#include <pthread.h>
 #include <syslog.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -59,11 +60,68 @@
 
 /* clixon */
 #include <clixon/clixon.h>
+#include <clixon/clixon_probe.h>
 
 #include "clixon_backend_transaction.h"
 #include "clixon_backend_plugin.h"
 #include "clixon_backend_commit.h"
 
+/*
+ * Types
+ */
+/*! State data callback of one plugin in a request, may be called in a thread
+ */
+struct statedata_job{
+    clixon_plugin_t *sj_cp;      /* Plugin */
+    clixon_handle    sj_h;       /* Clixon handle */
+    cvec            *sj_nsc;     /* Namespace context of xpath */
+    char            *sj_xpath;   /* XPath of request */
+    cxobj           *sj_x;       /* State tree of plugin */
+    int              sj_ret;     /* 1: OK, 0: callback failed */
+    char            *sj_reason;  /* Error reason if callback failed */
+    int              sj_thread;  /* Callback is called in thread sj_tid */
+    pthread_t        sj_tid;     /* Thread id */
+    uint64_t         sj_usec;    /* Latency of callback called in thread */
+};
+
+/*! Plugin callback is about to be called, fire tracepoint and start timer
+ *
+ * @param[in]  cp      Plugin handle
+ * @param[in]  cbname  Name of callback, eg "begin"
+ * @retval     t0      Start time in microseconds
+ * @see plugin_cb_exit
+ */
+static uint64_t
+plugin_cb_enter(clixon_plugin_t *cp,
+                const char      *cbname)
+{
+    CLIXON_PROBE2(plugin__enter, clixon_plugin_name_get(cp), cbname);
+    return clixon_latency_now();
+}
+
+/*! Plugin callback has returned, fire tracepoint and record latency
+ *
+ * @param[in]  cp      Plugin handle
+ * @param[in]  cbname  Name of callback, eg "begin"
+ * @param[in]  t0      Start time from plugin_cb_enter
+ * @param[in]  ret     Return value of callback
+ * @retval     0       OK
+ * @retval    -1       Error
+ * @see plugin_cb_enter
+ */
+static int
+plugin_cb_exit(clixon_plugin_t *cp,
+               const char      *cbname,
+               uint64_t         t0,
+               int              ret)
+{
+    uint64_t usec;
+
+    usec = clixon_latency_now() - t0;
+    CLIXON_PROBE4(plugin__exit, clixon_plugin_name_get(cp), cbname, ret, usec);
+    return clixon_latency_record("plugin", clixon_plugin_name_get(cp), cbname, usec);
+}
+
 /*! Request plugins to reset system state
  *
  * The system 'state' should be the same as the contents of running_db
@@ -289,6 +347,8 @@ clixon_plugin_statedata_one(clixon_plugin_t *cp,
     plgstatedata_t  *fn;          /* Plugin statedata fn */
     cxobj           *x = NULL;
     void            *wh = NULL;
+    int              ret;
+    uint64_t         t0;
 
     if ((fn = clixon_plugin_api_get(cp)->ca_statedata) != NULL){
         if ((x = xml_new(DATASTORE_TOP_SYMBOL, NULL, CX_ELMNT)) == NULL)
@@ -296,7 +356,11 @@ clixon_plugin_statedata_one(clixon_plugin_t *cp,
         wh = NULL;
         if (clixon_resource_check(h, &wh, clixon_plugin_name_get(cp), __FUNCTION__) < 0)
             goto done;
-        if (fn(h, nsc, xpath, x) < 0){
+        t0 = plugin_cb_enter(cp, "statedata");
+        ret = fn(h, nsc, xpath, x);
+        if (plugin_cb_exit(cp, "statedata", t0, ret) < 0)
+            goto done;
+        if (ret < 0){
             if (clixon_resource_check(h, &wh, clixon_plugin_name_get(cp), __FUNCTION__) < 0)
                 goto done;
             if (clixon_err_category() < 0)
@@ -317,10 +381,300 @@ clixon_plugin_statedata_one(clixon_plugin_t *cp,
     goto done;
 }
 
-/*! Go through all backend statedata callbacks and collect state data
+/*! Get leading child steps of a relative location path, leftmost first
+ *
+ * @param[in]  xt     Relative location path of parsed xpath
+ * @param[in]  yspec  Yang spec
+ * @param[in]  nsc    Namespace context of xpath
+ * @param[in]  cvv    Steps: name is module name, or NULL if not known, and string is node name
+ * @retval     1      All steps of xt are child steps with a node name
+ * @retval     0      A step is not, cvv has the steps before it
+ * @retval    -1      Error
+ */
+static int
+statedata_xpath_steps(xpath_tree *xt,
+                      yang_stmt  *yspec,
+                      cvec       *nsc,
+                      cvec       *cvv)
+{
+    xpath_tree *xs;
+    yang_stmt  *ymod;
+    char       *ns;
+    char       *modname = NULL;
+    int         ret;
+
+    if (xt == NULL || xt->xs_type != XP_RELLOCPATH)
+        return 0;
+    if (xt->xs_c1 != NULL){
+        if ((ret = statedata_xpath_steps(xt->xs_c0, yspec, nsc, cvv)) != 1)
+            return ret;
+        if (xt->xs_int == A_DESCENDANT_OR_SELF)
+            return 0;
+        xs = xt->xs_c1;
+    }
+    else
+        xs = xt->xs_c0;
+    if (xs == NULL || xs->xs_type != XP_STEP || xs->xs_int != A_CHILD)
+        return 0;
+    xs = xs->xs_c0;
+    if (xs == NULL || xs->xs_type != XP_NODE ||
+        xs->xs_s1 == NULL || strcmp(xs->xs_s1, "*") == 0)
+        return 0;
+    /* Predicates only select instances, they do not limit the schema nodes */
+    if (nsc != NULL &&
+        (ns = xml_nsctx_get(nsc, xs->xs_s0)) != NULL &&
+        (ymod = yang_find_module_by_namespace(yspec, ns)) != NULL)
+        modname = yang_argument_get(ymod);
+    if (cvec_add_string(cvv, modname, xs->xs_s1) < 0){
+        clixon_err(OE_UNIX, errno, "cvec_add_string");
+        return -1;
+    }
+    return 1;
+}
+
+/*! Get schema nodes a state data request may select, as leading child steps of its xpath
+ *
+ * @param[in]  yspec  Yang spec
+ * @param[in]  nsc    Namespace context of xpath
+ * @param[in]  xpath  XPath of request, or NULL
+ * @param[out] cvvp   Steps, see statedata_xpath_steps, or NULL if the request may select
+ *                    any state data. Free with cvec_free
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+static int
+statedata_request_steps(yang_stmt *yspec,
+                        cvec      *nsc,
+                        char      *xpath,
+                        cvec     **cvvp)
+{
+    int         retval = -1;
+    xpath_tree *xptree = NULL;
+    xpath_tree *xt;
+    cvec       *cvv = NULL;
+
+    *cvvp = NULL;
+    if (xpath == NULL)
+        goto ok;
+    if (xpath_parse(xpath, &xptree) < 0)
+        goto done;
+    /* Skip expression levels without operator, eg unions select any state data */
+    xt = xptree;
+    while (xt != NULL && xt->xs_c1 == NULL &&
+           (xt->xs_type == XP_EXP || xt->xs_type == XP_AND ||
+            xt->xs_type == XP_RELEX || xt->xs_type == XP_ADD ||
+            xt->xs_type == XP_UNION || xt->xs_type == XP_PATHEXPR))
+        xt = xt->xs_c0;
+    if (xt == NULL || xt->xs_type != XP_LOCPATH)
+        goto ok;
+    xt = xt->xs_c0;
+    if (xt != NULL && xt->xs_type == XP_ABSPATH){
+        if (xt->xs_int != A_ROOT)
+            goto ok;
+        xt = xt->xs_c0;
+    }
+    if ((cvv = cvec_new(0)) == NULL){
+        clixon_err(OE_UNIX, errno, "cvec_new");
+        goto done;
+    }
+    if (statedata_xpath_steps(xt, yspec, nsc, cvv) < 0)
+        goto done;
+    if (cvec_len(cvv) > 0){
+        *cvvp = cvv;
+        cvv = NULL;
+    }
+ ok:
+    retval = 0;
+ done:
+    if (cvv)
+        cvec_free(cvv);
+    if (xptree)
+        xpath_tree_free(xptree);
+    return retval;
+}
+
+/*! Check if a state data path of a plugin and the steps of a request intersect
+ *
+ * They intersect if the path is equal to, an ancestor of, or a descendant of the steps.
+ * Nodes without module name in the path have the module of their parent.
+ * @param[in]  path   Schema path, eg /example:state/counters
+ * @param[in]  steps  Request steps, see statedata_request_steps
+ * @retval     1      Intersects
+ * @retval     0      Disjoint
+ */
+static int
+statedata_path_match(const char *path,
+                     cvec       *steps)
+{
+    cg_var     *cv = NULL;
+    const char *p = path;
+    const char *name;
+    size_t      len;
+    const char *modname = NULL;
+    size_t      modlen = 0;
+    const char *c;
+    char       *str;
+
+    while ((cv = cvec_each(steps, cv)) != NULL){
+        while (*p == '/')
+            p++;
+        if (*p == '\0')
+            return 1;
+        len = strcspn(p, "/");
+        name = p;
+        if ((c = memchr(p, ':', len)) != NULL){
+            modname = p;
+            modlen = c - p;
+            name = c + 1;
+            len -= name - p;
+        }
+        str = cv_string_get(cv);
+        if (strlen(str) != len || strncmp(str, name, len) != 0)
+            return 0;
+        if (modname != NULL && (str = cv_name_get(cv)) != NULL &&
+            (strlen(str) != modlen || strncmp(str, modname, modlen) != 0))
+            return 0;
+        p = name + len;
+    }
+    return 1;
+}
+
+/*! Check if the state data callback of a plugin may provide data selected by a request
+ *
+ * @param[in]  cp     Plugin handle
+ * @param[in]  steps  Request steps, see statedata_request_steps
+ * @retval     1      Callback should be called
+ * @retval     0      No state data paths of the plugin intersect the request
+ * @see ca_statedata_paths
+ */
+static int
+statedata_provider_match(clixon_plugin_t *cp,
+                         cvec            *steps)
+{
+    const char **paths;
+
+    if ((paths = clixon_plugin_api_get(cp)->ca_statedata_paths) == NULL ||
+        steps == NULL)
+        return 1;
+    for (; *paths != NULL; paths++)
+        if (statedata_path_match(*paths, steps))
+            return 1;
+    return 0;
+}
+
+/*! Thread calling state data callback of a plugin
+ *
+ * @param[in]  arg  State data job, sj_x is created by caller
+ * @see clixon_plugin_statedata_one  for the main thread
+ */
+static void *
+statedata_job_thread(void *arg)
+{
+    struct statedata_job *sj = (struct statedata_job *)arg;
+    plgstatedata_t       *fn;
+    uint64_t              t0;
+    int                   ret;
+
+    fn = clixon_plugin_api_get(sj->sj_cp)->ca_statedata;
+    clixon_err_reset();
+    t0 = plugin_cb_enter(sj->sj_cp, "statedata");
+    ret = fn(sj->sj_h, sj->sj_nsc, sj->sj_xpath, sj->sj_x);
+    sj->sj_usec = clixon_latency_now() - t0;
+    CLIXON_PROBE4(plugin__exit, clixon_plugin_name_get(sj->sj_cp), "statedata", ret, sj->sj_usec);
+    if (ret < 0){
+        sj->sj_reason = strdup(clixon_err_reason());
+        sj->sj_ret = 0;
+    }
+    else
+        sj->sj_ret = 1;
+    return NULL;
+}
+
+/*! Call state data callbacks of selected plugins
+ *
+ * If more than one plugin is selected, the callbacks of plugins that set
+ * ca_statedata_threadsafe are called in one thread each, while the other callbacks are
+ * called in the main thread. All threads are joined before return.
+ * @param[in]  h      Clixon handle
+ * @param[in]  nsc    Namespace context of xpath
+ * @param[in]  xpath  XPath of request
+ * @param[in]  jobs   Vector of jobs, sj_cp set
+ * @param[in]  njobs  Length of jobs
+ * @retval     0      OK, sj_ret and sj_x are set in all jobs
+ * @retval    -1      Error
+ */
+static int
+statedata_jobs_run(clixon_handle         h,
+                   cvec                 *nsc,
+                   char                 *xpath,
+                   struct statedata_job *jobs,
+                   int                   njobs)
+{
+    int                   retval = -1;
+    struct statedata_job *sj;
+    int                   i;
+    sigset_t              sigset;
+    sigset_t              sigset0;
+
+    if (njobs > 1){
+        /* Signals are handled by the main thread: block them in created threads */
+        sigfillset(&sigset);
+        pthread_sigmask(SIG_BLOCK, &sigset, &sigset0);
+        for (i=0; i<njobs; i++){
+            sj = &jobs[i];
+            if (!clixon_plugin_api_get(sj->sj_cp)->ca_statedata_threadsafe)
+                continue;
+            if ((sj->sj_x = xml_new(DATASTORE_TOP_SYMBOL, NULL, CX_ELMNT)) == NULL)
+                break;
+            sj->sj_h = h;
+            sj->sj_nsc = nsc;
+            sj->sj_xpath = xpath;
+            if (pthread_create(&sj->sj_tid, NULL, statedata_job_thread, sj) == 0)
+                sj->sj_thread = 1;
+            else{ /* Call it in main thread instead */
+                xml_free(sj->sj_x);
+                sj->sj_x = NULL;
+            }
+        }
+        pthread_sigmask(SIG_SETMASK, &sigset0, NULL);
+        if (i < njobs)
+            goto done;
+    }
+    for (i=0; i<njobs; i++){
+        sj = &jobs[i];
+        if (sj->sj_thread)
+            continue;
+        if ((sj->sj_ret = clixon_plugin_statedata_one(sj->sj_cp, h, nsc, xpath, &sj->sj_x)) < 0)
+            goto done;
+        if (sj->sj_ret == 0 && (sj->sj_reason = strdup(clixon_err_reason())) == NULL){
+            clixon_err(OE_UNIX, errno, "strdup");
+            goto done;
+        }
+    }
+    retval = 0;
+ done:
+    for (i=0; i<njobs; i++){
+        sj = &jobs[i];
+        if (!sj->sj_thread)
+            continue;
+        pthread_join(sj->sj_tid, NULL);
+        sj->sj_thread = 0;
+        if (clixon_latency_record("plugin", clixon_plugin_name_get(sj->sj_cp), "statedata", sj->sj_usec) < 0)
+            retval = -1;
+        if (sj->sj_ret == 0 && (sj->sj_reason == NULL || *sj->sj_reason == '\0'))
+            clixon_log(h, LOG_WARNING, "%s: Internal error: State callback in plugin: %s returned -1 but did not make a clixon_err call",
+                       __FUNCTION__, clixon_plugin_name_get(sj->sj_cp));
+    }
+    return retval;
+}
+
+/*! Go through backend statedata callbacks and collect state data
  *
  * This is internal system call, plugin is invoked (does not call) this function
  * Backend plugins can register 
+ * Plugins that set ca_statedata_paths are only called if xpath may select data in one of
+ * their paths. Thread-safe callbacks are called in parallel, see statedata_jobs_run.
+ * State trees are merged in plugin order.
  * @param[in]     h       clicon handle
  * @param[in]     yspec   Yang spec
  * @param[in]     nsc     Namespace context
@@ -338,25 +692,54 @@ clixon_plugin_statedata_all(clixon_handle   h,
                             char           *xpath,
                             cxobj         **xret)
 {
-    int              retval = -1;
-    int              ret;
-    cxobj           *x = NULL;
-    clixon_plugin_t *cp = NULL;
-    cbuf            *cberr = NULL;
-    cxobj           *xerr = NULL;
+    int                   retval = -1;
+    int                   ret;
+    cxobj                *x;
+    clixon_plugin_t      *cp = NULL;
+    cbuf                 *cberr = NULL;
+    cxobj                *xerr = NULL;
+    cvec                 *steps = NULL;
+    struct statedata_job *jobs = NULL;
+    struct statedata_job *sj;
+    int                   njobs = 0;
+    int                   i;
 
     clixon_debug(CLIXON_DBG_BACKEND | CLIXON_DBG_DETAIL, "");
+    while ((cp = clixon_plugin_each(h, cp)) != NULL)
+        if (clixon_plugin_api_get(cp)->ca_statedata != NULL)
+            njobs++;
+    if (njobs == 0)
+        goto ok;
+    if ((jobs = calloc(njobs, sizeof(*jobs))) == NULL){
+        clixon_err(OE_UNIX, errno, "calloc");
+        goto done;
+    }
+    if (statedata_request_steps(yspec, nsc, xpath, &steps) < 0)
+        goto done;
+    njobs = 0;
     while ((cp = clixon_plugin_each(h, cp)) != NULL) {
-        if ((ret = clixon_plugin_statedata_one(cp, h, nsc, xpath, &x)) < 0)
-            goto done;
-        if (ret == 0){
+        if (clixon_plugin_api_get(cp)->ca_statedata == NULL)
+            continue;
+        if (statedata_provider_match(cp, steps) == 0){
+            clixon_debug(CLIXON_DBG_BACKEND | CLIXON_DBG_DETAIL, "%s: no state data paths match",
+                         clixon_plugin_name_get(cp));
+            continue;
+        }
+        jobs[njobs++].sj_cp = cp;
+    }
+    if (statedata_jobs_run(h, nsc, xpath, jobs, njobs) < 0)
+        goto done;
+    for (i=0; i<njobs; i++){
+        sj = &jobs[i];
+        cp = sj->sj_cp;
+        if (sj->sj_ret == 0){
             if ((cberr = cbuf_new()) == NULL){
                 clixon_err(OE_UNIX, errno, "cbuf_new");
                 goto done;
             }
             /* error reason should be in clixon_err_reason */
             cprintf(cberr, "Internal error, state callback in plugin %s returned invalid XML: %s",
-                    clixon_plugin_name_get(cp), clixon_err_reason());
+                    clixon_plugin_name_get(cp), sj->sj_reason?sj->sj_reason:"");
             if (netconf_operation_failed_xml(&xerr, "application", cbuf_get(cberr)) < 0)
                 goto done;
             xml_free(*xret);
@@ -364,13 +747,8 @@ clixon_plugin_statedata_all(clixon_handle   h,
             xerr = NULL;
             goto fail;
         }
-        if (x == NULL)
-            continue;
-        if (xml_child_nr(x) == 0){
-            xml_free(x);
-            x = NULL;
+        if ((x = sj->sj_x) == NULL || xml_child_nr(x) == 0)
             continue;
-        }
         clixon_debug_xml(CLIXON_DBG_BACKEND | CLIXON_DBG_DETAIL, x, "%s STATE:", clixon_plugin_name_get(cp));
         /* XXX: ret == 0 invalid yang binding should be handled as internal error */
         if ((ret = xml_bind_yang(h, x, YB_MODULE, yspec, &xerr)) < 0)
@@ -397,25 +775,60 @@ clixon_plugin_statedata_all(clixon_handle   h,
             if (ret == 0)
                 goto fail;
         }
-        if (x){
-            xml_free(x);
-            x = NULL;
-        }
-    } /* while plugin */
+    } /* for jobs */
+ ok:
     retval = 1;
  done:
+    if (jobs){
+        for (i=0; i<njobs; i++){
+            if (jobs[i].sj_x)
+                xml_free(jobs[i].sj_x);
+            if (jobs[i].sj_reason)
+                free(jobs[i].sj_reason);
+        }
+        free(jobs);
+    }
+    if (steps)
+        cvec_free(steps);
     if (xerr)
         xml_free(xerr);
     if (cberr)
         cbuf_free(cberr);
-    if (x)
-        xml_free(x);
     return retval;
  fail:
     retval = 0;
     goto done;
 }
 
+/*! Get time state data may be cached, as minimum of all backend plugin TTLs
+ *
+ * State data is only cached if at least one plugin sets a TTL, and no plugin with a
+ * statedata callback leaves it unset. System state, such as sessions and locks, is also
+ * cached for the same time.
+ * @param[in]  h    Clixon handle
+ * @retval     ttl  Seconds state data may be cached, 0 if not cached
+ * @see ca_statedata_ttl
+ */
+uint32_t
+clixon_plugin_statedata_ttl(clixon_handle h)
+{
+    clixon_plugin_t   *cp = NULL;
+    clixon_plugin_api *api;
+    uint32_t           ttl = 0;
+
+    while ((cp = clixon_plugin_each(h, cp)) != NULL) {
+        api = clixon_plugin_api_get(cp);
+        if (api->ca_statedata_ttl == 0){
+            if (api->ca_statedata != NULL)
+                return 0;
+            continue;
+        }
+        if (ttl == 0 || api->ca_statedata_ttl < ttl)
+            ttl = api->ca_statedata_ttl;
+    }
+    return ttl;
+}
+
 /*! Lock database status has changed status
  *
  * @param[in]  cp      Plugin handle
@@ -618,12 +1031,18 @@ plugin_transaction_begin_one(clixon_plugin_t    *cp,
     int         retval = -1;
     trans_cb_t *fn;
     void       *wh = NULL;
+    int         ret;
+    uint64_t    t0;
 
     if ((fn = clixon_plugin_api_get(cp)->ca_trans_begin) != NULL){
         wh = NULL;
         if (clixon_resource_check(h, &wh, clixon_plugin_name_get(cp), __FUNCTION__) < 0)
             goto done;
-        if (fn(h, (transaction_data)td) < 0){
+        t0 = plugin_cb_enter(cp, "begin");
+        ret = fn(h, (transaction_data)td);
+        if (plugin_cb_exit(cp, "begin", t0, ret) < 0)
+            goto done;
+        if (ret < 0){
             if (clixon_resource_check(h, &wh, clixon_plugin_name_get(cp), __FUNCTION__) < 0)
                 goto done;
             if (!clixon_err_category()) /* sanity: log if clixon_err() is not called ! */
@@ -681,12 +1100,18 @@ plugin_transaction_validate_one(clixon_plugin_t    *cp,
     int         retval = -1;
     trans_cb_t *fn;
     void       *wh = NULL;
+    int         ret;
+    uint64_t    t0;
 
     if ((fn = clixon_plugin_api_get(cp)->ca_trans_validate) != NULL){
         wh = NULL;
         if (clixon_resource_check(h, &wh, clixon_plugin_name_get(cp), __FUNCTION__) < 0)
             goto done;
-        if (fn(h, (transaction_data)td) < 0){
+        t0 = plugin_cb_enter(cp, "validate");
+        ret = fn(h, (transaction_data)td);
+        if (plugin_cb_exit(cp, "validate", t0, ret) < 0)
+            goto done;
+        if (ret < 0){
             if (clixon_resource_check(h, &wh, clixon_plugin_name_get(cp), __FUNCTION__) < 0)
                 goto done;
             if (!clixon_err_category()) /* sanity: log if clixon_err() is not called ! */
@@ -743,12 +1168,18 @@ plugin_transaction_complete_one(clixon_plugin_t    *cp,
     int         retval = -1;
     trans_cb_t *fn;
     void       *wh = NULL;
+    int         ret;
+    uint64_t    t0;
 
     if ((fn = clixon_plugin_api_get(cp)->ca_trans_complete) != NULL){
         wh = NULL;
         if (clixon_resource_check(h, &wh, clixon_plugin_name_get(cp), __FUNCTION__) < 0)
             goto done;
-        if (fn(h, (transaction_data)td) < 0){
+        t0 = plugin_cb_enter(cp, "complete");
+        ret = fn(h, (transaction_data)td);
+        if (plugin_cb_exit(cp, "complete", t0, ret) < 0)
+            goto done;
+        if (ret < 0){
             if (clixon_resource_check(h, &wh, clixon_plugin_name_get(cp), __FUNCTION__) < 0)
                 goto done;
             if (!clixon_err_category()) /* sanity: log if clixon_err() is not called ! */
@@ -837,12 +1268,18 @@ plugin_transaction_commit_one(clixon_plugin_t      *cp,
     int         retval = -1;
     trans_cb_t *fn;
     void       *wh = NULL;
+    int         ret;
+    uint64_t    t0;
 
     if ((fn = clixon_plugin_api_get(cp)->ca_trans_commit) != NULL){
         wh = NULL;
         if (clixon_resource_check(h, &wh, clixon_plugin_name_get(cp), __FUNCTION__) < 0)
             goto done;
-        if (fn(h, (transaction_data)td) < 0){
+        t0 = plugin_cb_enter(cp, "commit");
+        ret = fn(h, (transaction_data)td);
+        if (plugin_cb_exit(cp, "commit", t0, ret) < 0)
+            goto done;
+        if (ret < 0){
             if (clixon_resource_check(h, &wh, clixon_plugin_name_get(cp), __FUNCTION__) < 0)
                 goto done;
             if (!clixon_err_category()) /* sanity: log if clixon_err() is not called ! */
@@ -905,12 +1342,18 @@ plugin_transaction_commit_done_one(clixon_plugin_t    *cp,
     int         retval = -1;
     trans_cb_t *fn;
     void       *wh = NULL;
+    int         ret;
+    uint64_t    t0;
 
     if ((fn = clixon_plugin_api_get(cp)->ca_trans_commit_done) != NULL){
         wh = NULL;
         if (clixon_resource_check(h, &wh, clixon_plugin_name_get(cp), __FUNCTION__) < 0)
             goto done;
-        if (fn(h, (transaction_data)td) < 0){
+        t0 = plugin_cb_enter(cp, "commit-done");
+        ret = fn(h, (transaction_data)td);
+        if (plugin_cb_exit(cp, "commit-done", t0, ret) < 0)
+            goto done;
+        if (ret < 0){
             if (clixon_resource_check(h, &wh, clixon_plugin_name_get(cp), __FUNCTION__) < 0)
                 goto done;
             if (!clixon_err_category()) /* sanity: log if clixon_err() is not called ! */
@@ -966,12 +1409,18 @@ plugin_transaction_end_one(clixon_plugin_t    *cp,
     int         retval = -1;
     trans_cb_t *fn;
     void       *wh = NULL;
+    int         ret;
+    uint64_t    t0;
 
     if ((fn = clixon_plugin_api_get(cp)->ca_trans_end) != NULL){
         wh = NULL;
         if (clixon_resource_check(h, &wh, clixon_plugin_name_get(cp), __FUNCTION__) < 0)
             goto done;
-        if (fn(h, (transaction_data)td) < 0){
+        t0 = plugin_cb_enter(cp, "end");
+        ret = fn(h, (transaction_data)td);
+        if (plugin_cb_exit(cp, "end", t0, ret) < 0)
+            goto done;
+        if (ret < 0){
             if (clixon_resource_check(h, &wh, clixon_plugin_name_get(cp), __FUNCTION__) < 0)
                 goto done;
             if (!clixon_err_category()) /* sanity: log if clixon_err() is not called ! */
@@ -1019,12 +1468,18 @@ plugin_transaction_abort_one(clixon_plugin_t    *cp,
     int         retval = -1;
     trans_cb_t *fn;
     void       *wh = NULL;
+    int         ret;
+    uint64_t    t0;
 
     if ((fn = clixon_plugin_api_get(cp)->ca_trans_abort) != NULL){
         wh = NULL;
         if (clixon_resource_check(h, &wh, clixon_plugin_name_get(cp), __FUNCTION__) < 0)
             goto done;
-        if (fn(h, (transaction_data)td) < 0){
+        t0 = plugin_cb_enter(cp, "abort");
+        ret = fn(h, (transaction_data)td);
+        if (plugin_cb_exit(cp, "abort", t0, ret) < 0)
+            goto done;
+        if (ret < 0){
             if (clixon_resource_check(h, &wh, clixon_plugin_name_get(cp), __FUNCTION__) < 0)
                 goto done;
             if (!clixon_err_category()) /* sanity: log if clixon_err() is not called ! */
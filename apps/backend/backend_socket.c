@@ -291,6 +291,14 @@ backend_accept_client(int   fd,
         break;
     }
     ce->ce_s = s;
+    /* Replies and notifications are queued if the client does not keep up, see
+     * backend_client_send */
+    if (fcntl(s, F_SETFL, O_NONBLOCK) < 0){
+        clixon_err(OE_UNIX, errno, "fcntl");
+        goto done;
+    }
+    if ((ce->ce_reader = clicon_msg_reader_new()) == NULL)
+        goto done;
 
     /*
      * Here we register callbacks for actual data socket 
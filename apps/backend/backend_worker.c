@@ -0,0 +1,361 @@
+/*
+ *
+  ***** BEGIN LICENSE BLOCK *****
+ 
+  Copyright (C) 2024 Olof Hagsand
+
+  This file is part of CLIXON.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Alternatively, the contents of this file may be used under the terms of
+  the GNU General Public License Version 3 or later (the "GPL"),
+  in which case the provisions of the GPL are applicable instead
+  of those above. If you wish to allow use of your version of this file only
+  under the terms of the GPL, and not to allow others to
+  use your version of this file under the terms of Apache License version 2, 
+  indicate your decision by deleting the provisions above and replace them with
+  the  notice and other provisions required by the GPL. If you do not delete
+  the provisions above, a recipient may use your version of this file under
+  the terms of any one of the Apache License version 2 or the GPL.
+
+  ***** END LICENSE BLOCK *****
+ *
+ * Backend worker threads for read-only requests
+ *
+ * The backend event loop is single-threaded. Long-running read-only requests, such as
+ * get of a large tree, may be handed off to a pool of worker threads so that other
+ * clients are served meanwhile. The data of a request is collected in the main thread and
+ * owned by the job, the worker only processes this private data and produces the reply.
+ * While a job is pending, no more input is read from the client, so that replies are
+ * sent in the order requests are received.
+ * When a worker is done, it signals the main thread via a pipe which is registered in the
+ * event loop. The main thread then sends the reply and resumes reading from the client.
+ *
+ * @see CLICON_BACKEND_WORKER_THREADS
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "clixon_config.h" /* generated by config & autoconf */
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <pthread.h>
+#include <syslog.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+
+/* cligen */
+#include <cligen/cligen.h>
+
+/* clixon */
+#include <clixon/clixon.h>
+
+#include "clixon_backend_client.h"
+#include "backend_client.h"
+#include "backend_worker.h"
+
+/*
+ * Types
+ */
+struct backend_job{
+    qelem_t                 bj_qelem;   /* List header */
+    struct client_entry    *bj_ce;      /* Client, may be deleted when job is done */
+    uint32_t                bj_ce_id;   /* Session id of client, to verify bj_ce */
+    backend_worker_fn      *bj_fn;      /* Run in worker thread */
+    backend_worker_free_fn *bj_freefn;  /* Free bj_arg, in main thread */
+    void                   *bj_arg;     /* Argument to fn and freefn */
+    cbuf                   *bj_cbret;   /* Reply */
+    int                     bj_retval;  /* Return value of fn */
+    char                   *bj_reason;  /* Error reason if retval < 0 */
+};
+
+/*
+ * Internal variables
+ * Worker pool is global, there is a single backend event loop
+ */
+static pthread_t          *_workers = NULL;   /* Worker threads */
+static int                 _workers_nr = 0;   /* Number of worker threads */
+static pthread_mutex_t     _workers_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t      _workers_cond = PTHREAD_COND_INITIALIZER;
+static struct backend_job *_jobs_queued = NULL; /* Waiting for a worker */
+static struct backend_job *_jobs_done = NULL;   /* Done, waiting for main thread */
+static int                 _workers_exit = 0; /* Set to terminate workers */
+static int                 _done_pipe[2] = {-1, -1}; /* Worker -> main thread signal */
+
+/*! Worker thread: take jobs from queue and run them
+ *
+ * @param[in]  arg  Not used
+ */
+static void *
+backend_worker_thread(void *arg)
+{
+    struct backend_job *bj;
+    char                ch = 0;
+
+    while (1){
+        pthread_mutex_lock(&_workers_mutex);
+        while (_jobs_queued == NULL && !_workers_exit)
+            pthread_cond_wait(&_workers_cond, &_workers_mutex);
+        if (_workers_exit){
+            pthread_mutex_unlock(&_workers_mutex);
+            break;
+        }
+        bj = _jobs_queued;
+        DELQ(bj, _jobs_queued, struct backend_job *);
+        pthread_mutex_unlock(&_workers_mutex);
+        clixon_err_reset();
+        if ((bj->bj_retval = bj->bj_fn(bj->bj_arg, bj->bj_cbret)) < 0)
+            bj->bj_reason = strdup(clixon_err_category()?clixon_err_reason():"unknown");
+        pthread_mutex_lock(&_workers_mutex);
+        ADDQ(bj, _jobs_done);
+        pthread_mutex_unlock(&_workers_mutex);
+        /* Wake up main thread */
+        while (write(_done_pipe[1], &ch, 1) < 0 && errno == EINTR)
+            ;
+    }
+    return NULL;
+}
+
+/*! Free a job, in main thread
+ *
+ * @param[in]  h   Clixon handle
+ * @param[in]  bj  Job
+ */
+static void
+backend_job_free(clixon_handle       h,
+                 struct backend_job *bj)
+{
+    if (bj->bj_freefn)
+        bj->bj_freefn(h, bj->bj_arg, NULL);
+    if (bj->bj_cbret)
+        cbuf_free(bj->bj_cbret);
+    if (bj->bj_reason)
+        free(bj->bj_reason);
+    free(bj);
+}
+
+/*! Main thread: worker(s) are done, send replies to clients
+ *
+ * @param[in]  s    Read end of done pipe
+ * @param[in]  arg  Clixon handle
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+static int
+backend_worker_done(int   s,
+                    void *arg)
+{
+    int                 retval = -1;
+    clixon_handle       h = (clixon_handle)arg;
+    struct backend_job *bj;
+    char                buf[64];
+
+    /* Drain signal pipe, it is non-blocking */
+    while (read(s, buf, sizeof(buf)) == sizeof(buf))
+        ;
+    while (1){
+        pthread_mutex_lock(&_workers_mutex);
+        if ((bj = _jobs_done) != NULL)
+            DELQ(bj, _jobs_done, struct backend_job *);
+        pthread_mutex_unlock(&_workers_mutex);
+        if (bj == NULL)
+            break;
+        if (bj->bj_retval < 0){
+            cbuf_reset(bj->bj_cbret);
+            if (netconf_operation_failed(bj->bj_cbret, "application", bj->bj_reason) < 0){
+                backend_job_free(h, bj);
+                goto done;
+            }
+        }
+        /* Before the reply is sent, since the message-id of the request is added to it
+         * and it may be cached by freefn */
+        if (bj->bj_freefn && bj->bj_retval == 0){
+            bj->bj_freefn(h, bj->bj_arg, bj->bj_cbret);
+            bj->bj_freefn = NULL;
+        }
+        if (backend_client_reply_pending(h, bj->bj_ce, bj->bj_ce_id, bj->bj_cbret,
+                                         bj->bj_retval < 0) < 0){
+            backend_job_free(h, bj);
+            goto done;
+        }
+        backend_job_free(h, bj);
+    }
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Check if worker threads are enabled
+ *
+ * @param[in]  h   Clixon handle
+ * @retval     1   Worker threads are running
+ * @retval     0   No worker threads, handle requests in main thread
+ */
+int
+backend_worker_enabled(clixon_handle h)
+{
+    return _workers_nr > 0;
+}
+
+/*! Hand off a job to a worker thread and defer the reply to the client
+ *
+ * The client entry is marked as pending and no more input is read from it until the
+ * reply is sent.
+ * @param[in]  h       Clixon handle
+ * @param[in]  ce      Client entry
+ * @param[in]  fn      Function to run in worker thread
+ * @param[in]  freefn  Function to free arg, called in main thread when job is done
+ * @param[in]  arg     Job argument, owned by the job, freed with freefn also on error
+ * @retval     0       OK
+ * @retval    -1       Error
+ */
+int
+backend_worker_submit(clixon_handle           h,
+                      struct client_entry    *ce,
+                      backend_worker_fn      *fn,
+                      backend_worker_free_fn *freefn,
+                      void                   *arg)
+{
+    int                 retval = -1;
+    struct backend_job *bj = NULL;
+
+    if ((bj = malloc(sizeof(*bj))) == NULL){
+        clixon_err(OE_UNIX, errno, "malloc");
+        goto done;
+    }
+    memset(bj, 0, sizeof(*bj));
+    bj->bj_ce = ce;
+    bj->bj_ce_id = ce->ce_id;
+    bj->bj_fn = fn;
+    bj->bj_freefn = freefn;
+    bj->bj_arg = arg;
+    if ((bj->bj_cbret = cbuf_new()) == NULL){
+        clixon_err(OE_UNIX, errno, "cbuf_new");
+        goto done;
+    }
+    if (backend_client_pending(h, ce) < 0)
+        goto done;
+    pthread_mutex_lock(&_workers_mutex);
+    ADDQ(bj, _jobs_queued);
+    pthread_cond_signal(&_workers_cond);
+    pthread_mutex_unlock(&_workers_mutex);
+    bj = NULL;
+    retval = 0;
+ done:
+    if (bj)
+        backend_job_free(h, bj);
+    else if (retval < 0 && freefn)
+        freefn(h, arg, NULL);
+    return retval;
+}
+
+/*! Start worker threads according to CLICON_BACKEND_WORKER_THREADS
+ *
+ * @param[in]  h   Clixon handle
+ * @retval     0   OK
+ * @retval    -1   Error
+ */
+int
+backend_worker_init(clixon_handle h)
+{
+    int      retval = -1;
+    int      nr;
+    int      i;
+    sigset_t sigset;
+    sigset_t sigset0;
+
+    if ((nr = clicon_option_int(h, "CLICON_BACKEND_WORKER_THREADS")) <= 0)
+        goto ok;
+    if (pipe(_done_pipe) < 0){
+        clixon_err(OE_UNIX, errno, "pipe");
+        goto done;
+    }
+    for (i=0; i<2; i++){
+        if (fcntl(_done_pipe[i], F_SETFL, O_NONBLOCK) < 0 ||
+            fcntl(_done_pipe[i], F_SETFD, FD_CLOEXEC) < 0){
+            clixon_err(OE_UNIX, errno, "fcntl");
+            goto done;
+        }
+    }
+    if (clixon_event_reg_fd(_done_pipe[0], backend_worker_done, h, "backend worker") < 0)
+        goto done;
+    if ((_workers = calloc(nr, sizeof(pthread_t))) == NULL){
+        clixon_err(OE_UNIX, errno, "calloc");
+        goto done;
+    }
+    _workers_exit = 0;
+    /* Signals are handled by the main thread event loop: block them in workers */
+    sigfillset(&sigset);
+    pthread_sigmask(SIG_BLOCK, &sigset, &sigset0);
+    for (_workers_nr=0; _workers_nr<nr; _workers_nr++){
+        if ((errno = pthread_create(&_workers[_workers_nr], NULL, backend_worker_thread, NULL)) != 0){
+            clixon_err(OE_UNIX, errno, "pthread_create");
+            break;
+        }
+    }
+    pthread_sigmask(SIG_SETMASK, &sigset0, NULL);
+    if (_workers_nr < nr)
+        goto done;
+    clixon_debug(CLIXON_DBG_BACKEND, "%d worker threads", _workers_nr);
+ ok:
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Stop worker threads and free pending jobs
+ *
+ * Running jobs are completed. Pending replies are not sent.
+ * @param[in]  h   Clixon handle
+ * @retval     0   OK
+ */
+int
+backend_worker_exit(clixon_handle h)
+{
+    struct backend_job *bj;
+    int                 i;
+
+    pthread_mutex_lock(&_workers_mutex);
+    _workers_exit = 1;
+    pthread_cond_broadcast(&_workers_cond);
+    pthread_mutex_unlock(&_workers_mutex);
+    for (i=0; i<_workers_nr; i++)
+        pthread_join(_workers[i], NULL);
+    if (_workers)
+        free(_workers);
+    _workers = NULL;
+    _workers_nr = 0;
+    while ((bj = _jobs_queued) != NULL){
+        DELQ(bj, _jobs_queued, struct backend_job *);
+        backend_job_free(h, bj);
+    }
+    while ((bj = _jobs_done) != NULL){
+        DELQ(bj, _jobs_done, struct backend_job *);
+        backend_job_free(h, bj);
+    }
+    for (i=0; i<2; i++)
+        if (_done_pipe[i] != -1){
+            if (i == 0)
+                clixon_event_unreg_fd(_done_pipe[i], backend_worker_done);
+            close(_done_pipe[i]);
+            _done_pipe[i] = -1;
+        }
+    return 0;
+}
@@ -0,0 +1,70 @@
+/*
+ *
+  ***** BEGIN LICENSE BLOCK *****
+ 
+  Copyright (C) 2024 Olof Hagsand
+
+  This file is part of CLIXON.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Alternatively, the contents of this file may be used under the terms of
+  the GNU General Public License Version 3 or later (the "GPL"),
+  in which case the provisions of the GPL are applicable instead
+  of those above. If you wish to allow use of your version of this file only
+  under the terms of the GPL, and not to allow others to
+  use your version of this file under the terms of Apache License version 2, 
+  indicate your decision by deleting the provisions above and replace them with
+  the  notice and other provisions required by the GPL. If you do not delete
+  the provisions above, a recipient may use your version of this file under
+  the terms of any one of the Apache License version 2 or the GPL.
+
+  ***** END LICENSE BLOCK *****
+ *
+ * Backend worker threads for read-only requests
+ */
+
+#ifndef _BACKEND_WORKER_H_
+#define _BACKEND_WORKER_H_
+
+/*
+ * Types
+ */
+/*! Job function, run in a worker thread
+ *
+ * Must only access data owned by the job, not the handle or other backend state
+ * @param[in]  arg    Job argument
+ * @param[out] cbret  Reply
+ * @retval     0      OK
+ * @retval    -1      Error, a netconf operation-failed reply is sent using error reason
+ */
+typedef int (backend_worker_fn)(void *arg, cbuf *cbret);
+
+/*! Free function of job argument, called in main thread
+ *
+ * @param[in]  h      Clixon handle
+ * @param[in]  arg    Job argument
+ * @param[in]  cbret  Reply if job is done and successful, otherwise NULL
+ */
+typedef void (backend_worker_free_fn)(clixon_handle h, void *arg, cbuf *cbret);
+
+/*
+ * Prototypes
+ */
+int backend_worker_init(clixon_handle h);
+int backend_worker_exit(clixon_handle h);
+int backend_worker_enabled(clixon_handle h);
+int backend_worker_submit(clixon_handle h, struct client_entry *ce,
+                          backend_worker_fn *fn, backend_worker_free_fn *freefn, void *arg);
+
+#endif  /* _BACKEND_WORKER_H_ */
@@ -73,6 +73,19 @@ struct client_entry{
     uint32_t              ce_in_bad_rpcs;    /* Not correct <rpc> messages */
     uint32_t              ce_out_rpc_errors; /*  <rpc-error> messages*/
     uint32_t              ce_out_notifications; /* Outgoing notifications */
+    int                   ce_pending; /* Reply pending in worker thread, input not read */
+    char                 *ce_pending_rpc; /* Name of pending rpc, for latency histogram */
+    uint64_t              ce_pending_t0;  /* Start time of pending rpc, see clixon_latency_now */
+    char                 *ce_pending_msgid; /* Message-id of pending rpc, echoed in reply */
+    clicon_msg_reader    *ce_reader;  /* Buffered input, may hold several messages */
+    cbuf                 *ce_outq;    /* Output queue: encoded messages not yet written */
+    size_t                ce_outq_off; /* Start of unwritten data in ce_outq */
+    int                   ce_blocked; /* Output queue above high-water mark, input not read */
+    uint32_t              ce_outq_drops; /* Notifications dropped due to full output queue */
+    yang_stmt           **ce_binary_modules; /* Modules of binary replies indexed by client index,
+                                                see CLICON_IPC_BINARY */
+    int                   ce_binary_len; /* Length of ce_binary_modules, 0 means XML replies */
+    int                   ce_shm;     /* Large replies in shared memory, see CLICON_IPC_SHM_THRESHOLD */
 };
 typedef struct client_entry client_entry;
 
@@ -201,6 +201,16 @@ backend_client_delete(clixon_handle        h,
                 free(ce->ce_transport);
             if (ce->ce_source_host)
                 free(ce->ce_source_host);
+            if (ce->ce_outq)
+                cbuf_free(ce->ce_outq);
+            if (ce->ce_reader)
+                clicon_msg_reader_free(ce->ce_reader);
+            if (ce->ce_binary_modules)
+                free(ce->ce_binary_modules);
+            if (ce->ce_pending_rpc)
+                free(ce->ce_pending_rpc);
+            if (ce->ce_pending_msgid)
+                free(ce->ce_pending_msgid);
             free(ce);
             break;
         }
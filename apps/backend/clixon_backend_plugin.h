@@ -101,6 +101,7 @@ int clixon_plugin_pre_daemon_all(clixon_handle h);
 int clixon_plugin_daemon_all(clixon_handle h);
 
 int clixon_plugin_statedata_all(clixon_handle h, yang_stmt *yspec, cvec *nsc, char *xpath, cxobj **xtop);
+uint32_t clixon_plugin_statedata_ttl(clixon_handle h);
 int clixon_plugin_lockdb_all(clixon_handle h, char *db, int lock, int id);
 
 int clixon_pagination_cb_register(clixon_handle h, handler_function fn, char *path, void *arg);
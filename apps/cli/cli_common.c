@@ -1414,9 +1414,9 @@ cli_notification_cb(int   s,
         goto done;
     if (eof){
         clixon_err(OE_PROTO, ESHUTDOWN, "Socket unexpected close");
+        clixon_event_unreg_fd(s, cli_notification_cb);
         close(s);
         errno = ESHUTDOWN;
-        clixon_event_unreg_fd(s, cli_notification_cb);
         goto done;
     }
     /* XXX pass yang_spec and use xerr*/
@@ -219,7 +219,6 @@ netconf_rpc_message(clixon_handle h,
     int                  retval = -1;
     cxobj               *xret = NULL; /* Return (out) */
     int                  ret;
-    cbuf                *cbret = NULL;
     cxobj               *xc;
     netconf_framing_type framing;
 
@@ -231,15 +230,7 @@ netconf_rpc_message(clixon_handle h,
         /* Copy attributes from incoming request to reply. Skip already present (dont overwrite) */
         if (netconf_add_request_attr(xrpc, xret) < 0)
             goto done;
-        if ((cbret = cbuf_new()) == NULL){
-            clixon_err(OE_XML, errno, "cbuf_new");
-            goto done;
-        }
-        if (clixon_xml2cbuf(cbret, xret, 0, 0, NULL, -1, 0) < 0)
-            goto done;
-        if (netconf_output_encap(framing, cbret) < 0)
-            goto done;
-        if (netconf_output(1, cbret, "rpc-error") < 0)
+        if (netconf_output_xml(1, framing, xret, "rpc-error") < 0)
             goto done;
         *eof = 1;
         goto ok;
@@ -252,15 +243,7 @@ netconf_rpc_message(clixon_handle h,
     if (ret == 0){
         if (netconf_add_request_attr(xrpc, xret) < 0)
             goto done;
-        if ((cbret = cbuf_new()) == NULL){
-            clixon_err(OE_XML, errno, "cbuf_new");
-            goto done;
-        }
-        if (clixon_xml2cbuf(cbret, xret, 0, 0, NULL, -1, 0) < 0)
-            goto done;
-        if (netconf_output_encap(framing, cbret) < 0)
-            goto done;
-        if (netconf_output(1, cbret, "rpc-error") < 0)
+        if (netconf_output_xml(1, framing, xret, "rpc-error") < 0)
             goto done;
         goto ok;
     }
@@ -273,15 +256,7 @@ netconf_rpc_message(clixon_handle h,
             goto done;
         if (netconf_add_request_attr(xrpc, xret) < 0)
             goto done;
-        if ((cbret = cbuf_new()) == NULL){
-            clixon_err(OE_XML, errno, "cbuf_new");
-            goto done;
-        }
-        if (clixon_xml2cbuf(cbret, xret, 0, 0, NULL, -1, 0) < 0)
-            goto done;
-        if (netconf_output_encap(framing, cbret) < 0)
-            goto done;
-        if (netconf_output(1, cbret, "rpc-error") < 0)
+        if (netconf_output_xml(1, framing, xret, "rpc-error") < 0)
             goto done;
         goto ok;
     }
@@ -289,22 +264,12 @@ netconf_rpc_message(clixon_handle h,
         /* Copy attributes from incoming request to reply. Skip already present (dont overwrite) */
         if (netconf_add_request_attr(xrpc, xc) < 0)
             goto done;
-        if ((cbret = cbuf_new()) == NULL){
-            clixon_err(OE_XML, errno, "cbuf_new");
-            goto done;
-        }
-        if (clixon_xml2cbuf(cbret, xml_child_i(xret,0), 0, 0, NULL, -1, 0) < 0)
-            goto done;
-        if (netconf_output_encap(framing, cbret) < 0)
-            goto done;
-        if (netconf_output(1, cbret, "rpc-reply") < 0)
+        if (netconf_output_xml(1, framing, xml_child_i(xret,0), "rpc-reply") < 0)
             goto done;
     }
  ok:
     retval = 0;
  done:
-    if (cbret)
-        cbuf_free(cbret);
     if (xret)
         xml_free(xret);
     return retval;
@@ -450,7 +450,6 @@ netconf_notification_cb(int   s,
     struct clicon_msg *reply = NULL;
     int                eof;
     int                retval = -1;
-    cbuf              *cb = NULL;
     cxobj             *xn = NULL; /* event xml */
     cxobj             *xt = NULL; /* top xml */
     clixon_handle      h = (clixon_handle)arg;
@@ -466,9 +465,9 @@ netconf_notification_cb(int   s,
     /* handle close from remote end: this will exit the client */
     if (eof){
         clixon_err(OE_PROTO, ESHUTDOWN, "Socket unexpected close");
+        clixon_event_unreg_fd(s, netconf_notification_cb);
         close(s);
         errno = ESHUTDOWN;
-        clixon_event_unreg_fd(s, netconf_notification_cb);
         goto done;
     }
     yspec = clicon_dbspec_yang(h);
@@ -482,22 +481,12 @@ netconf_notification_cb(int   s,
         goto done;
     if ((xn = xpath_first(xt, nsc, "notification")) == NULL)
         goto ok;
-    /* create netconf message */
-    if ((cb = cbuf_new()) == NULL){
-        clixon_err(OE_PLUGIN, errno, "cbuf_new");
-        goto done;
-    }
-    if (clixon_xml2cbuf(cb, xn, 0, 0, NULL, -1, 0) < 0)
-        goto done;
     /* Send it to listening client on stdout */
-    if (netconf_output_encap(clicon_data_int_get(h, NETCONF_FRAMING_TYPE), cb) < 0){
-        goto done;
-    }
-    if (netconf_output(1, cb, "notification") < 0){
+    if (netconf_output_xml(1, clicon_data_int_get(h, NETCONF_FRAMING_TYPE), xn, "notification") < 0){
         clixon_err(OE_PROTO, ESHUTDOWN, "Socket unexpected close");
+        clixon_event_unreg_fd(s, netconf_notification_cb);
         close(s);
         errno = ESHUTDOWN;
-        clixon_event_unreg_fd(s, netconf_notification_cb);
         goto done;
     }
     fflush(stdout);
@@ -505,8 +494,6 @@ netconf_notification_cb(int   s,
     retval = 0;
  done:
     clixon_debug(CLIXON_DBG_NETCONF, "retval:%d", retval);
-    if (cb)
-        cbuf_free(cb);
     if (nsc)
         xml_nsctx_free(nsc);
     if (xt != NULL)
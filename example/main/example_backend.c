@@ -46,6 +46,7 @@
   *  -u  enable upgrade function - auto-upgrade testing
   *  -U  general-purpose upgrade
   *  -t  enable transaction logging (call syslog for every transaction)
+  *  -c  enable state callback logging (call syslog with a counter for every state callback)
   *  -V <xpath> Failing validate and commit if <xpath> is present (synthetic error)
  */
 #include <stdio.h>
@@ -70,7 +71,7 @@
 #include <clixon/clixon_backend.h>
 
 /* Command line options to be passed to getopt(3) */
-#define BACKEND_EXAMPLE_OPTS "a:m:M:nrsS:x:iuUtV:"
+#define BACKEND_EXAMPLE_OPTS "a:m:M:nN:rsS:x:iP:uUtcV:"
 
 /* Enabling this improves performance in tests, but there may trigger the "double XPath"
  * problem.
@@ -101,6 +102,13 @@ static char *_mount_namespace = NULL;
  */
 static int _notification_stream = 0;
 
+/*! Notification rate
+ *
+ * Events per second on the notification stream, for benchmarks. 0 means one event every 5s
+ * Start backend with -- -N <rate>
+ */
+static int _notification_rate = 0;
+
 /*! Variable to control if reset code is run.
  *
  * The reset code inserts "extra XML" which assumes ietf-interfaces is
@@ -138,6 +146,13 @@ static char *_state_xpath = NULL;
  */
 static int _state_file_cached = 0;
 
+/*! Schema path of state XML read from file, if _state_file is set
+ *
+ * The state callback is only called for requests that may select data in this path
+ * Start backend with -- -sS <file> -P <path>, eg -P /example:state
+ */
+static const char *_state_paths[] = {NULL, NULL};
+
 /*! Cache control of read state file pagination example,
  *
  * keep xml tree cache as long as db is locked
@@ -166,6 +181,13 @@ static int _general_upgrade = 0;
  */
 static int _transaction_log = 0;
 
+/*! Variable to control state callback logging, and number of state callbacks
+ *
+ * Start backend with -- -c
+ */
+static int      _state_log = 0;
+static uint32_t _state_calls = 0;
+
 /*! Variable to trigger validation/commit errors (synthetic errors) for tests
  *
  * XPath to trigger validation error, ie if the XPath matches, then validate fails
@@ -306,10 +328,14 @@ example_stream_timer(int   fd,
 {
     int                    retval = -1;
     clixon_handle          h = (clixon_handle)arg;
+    int                    i;
 
     /* XXX Change to actual netconf notifications and namespace */
-    if (stream_notify(h, "EXAMPLE", "<event xmlns=\"urn:example:clixon\"><event-class>fault</event-class><reportingEntity><card>Ethernet0</card></reportingEntity><severity>major</severity></event>") < 0)
-        goto done;
+    i = 0;
+    do {
+        if (stream_notify(h, "EXAMPLE", "<event xmlns=\"urn:example:clixon\"><event-class>fault</event-class><reportingEntity><card>Ethernet0</card></reportingEntity><severity>major</severity></event>") < 0)
+            goto done;
+    } while (++i < _notification_rate/100); /* Timer every 10ms */
     if (example_stream_timer_setup(h) < 0)
         goto done;
     retval = 0;
@@ -325,7 +351,12 @@ example_stream_timer_setup(clixon_handle h)
     struct timeval t, t1;
 
     gettimeofday(&t, NULL);
-    t1.tv_sec = 5; t1.tv_usec = 0;
+    if (_notification_rate){
+        t1.tv_sec = 0; t1.tv_usec = 10000;
+    }
+    else{
+        t1.tv_sec = 5; t1.tv_usec = 0;
+    }
     timeradd(&t, &t1, &t);
     return clixon_event_reg_timeout(t, example_stream_timer, h, "example stream timer");
 }
@@ -470,6 +501,8 @@ example_statedata(clixon_handle   h,
 
     if (!_state)
         goto ok;
+    if (_state_log)
+        clixon_log(h, LOG_NOTICE, "%s: call %u", __FUNCTION__, ++_state_calls);
     if ((cb = cbuf_new()) == NULL){
         clixon_err(OE_UNIX, errno, "cbuf_new");
         goto done;
@@ -569,6 +602,8 @@ example_statefile(clixon_handle     h,
     /* If -S is set, then read state data from file */
     if (!_state || !_state_file)
         goto ok;
+    if (_state_log)
+        clixon_log(h, LOG_NOTICE, "%s: call %u", __FUNCTION__, ++_state_calls);
     yspec = clicon_dbspec_yang(h);
     /* Read state file if either not cached, or the cache is NULL */
     if (_state_file_cached == 0 ||
@@ -1453,6 +1488,10 @@ clixon_plugin_init(clixon_handle h)
         case 'n':
             _notification_stream = 1;
             break;
+        case 'N':
+            _notification_stream = 1;
+            _notification_rate = atoi(optarg);
+            break;
         case 'r':
             _reset = 1;
             break;
@@ -1468,6 +1507,9 @@ clixon_plugin_init(clixon_handle h)
         case 'i': /* read state file on init not by request (requires -sS <file> */
             _state_file_cached = 1;
             break;
+        case 'P': /* state file schema path (requires -sS <file>) */
+            _state_paths[0] = optarg;
+            break;
        case 'u': /* module-specific upgrade */
            _module_upgrade = 1;
            break;
@@ -1477,6 +1519,9 @@ clixon_plugin_init(clixon_handle h)
         case 't': /* transaction log */
             _transaction_log = 1;
             break;
+        case 'c': /* state callback log */
+            _state_log = 1;
+            break;
         case 'V': /* validate fail */
             _validate_fail_xpath = optarg;
             break;
@@ -1487,6 +1532,8 @@ clixon_plugin_init(clixon_handle h)
     }
     if (_state_file){
         api.ca_statedata = example_statefile; /* Switch state data callback */
+        if (_state_paths[0])
+            api.ca_statedata_paths = _state_paths;
         if (_state_xpath){
             /* State pagination callbacks */
             if (clixon_pagination_cb_register(h,
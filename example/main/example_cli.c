@@ -160,6 +160,94 @@ example_client_rpc(clixon_handle h,
     return retval;
 }
 
+/*! Reply callback of example_client_rpc_async, check message-id and print reply
+ *
+ * @param[in]  h     Clixon handle
+ * @param[in]  id    Request id
+ * @param[in]  xret  Reply as xml tree, or NULL if backend closed the socket
+ * @param[in]  arg   Message-id of rpc, malloced
+ * @retval     0     OK
+ * @retval    -1     Error
+ */
+static int
+example_client_rpc_async_cb(clixon_handle h,
+                            uint32_t      id,
+                            cxobj        *xret,
+                            void         *arg)
+{
+    int    retval = -1;
+    char  *msgid = (char*)arg;
+    cxobj *xreply;
+    char  *msgid1;
+
+    if (xret == NULL){
+        clixon_err(OE_PROTO, ESHUTDOWN, "No reply to rpc %s", msgid);
+        goto done;
+    }
+    if ((xreply = xpath_first(xret, NULL, "rpc-reply")) == NULL ||
+        (msgid1 = xml_find_type_value(xreply, NULL, "message-id", CX_ATTR)) == NULL ||
+        strcmp(msgid, msgid1) != 0){
+        clixon_err(OE_PROTO, EINVAL, "Reply does not match rpc %s", msgid);
+        goto done;
+    }
+    cligen_output(stdout, "%s: %s\n", msgid, xml_find_body(xreply, "x"));
+    retval = 0;
+ done:
+    free(msgid);
+    return retval;
+}
+
+/*! Example of several RPCs to the backend without waiting for replies
+ *
+ * Send n example rpcs, then wait for all replies.
+ */
+int
+example_client_rpc_async(clixon_handle h,
+                         cvec         *cvv,
+                         cvec         *argv)
+{
+    int       retval = -1;
+    cg_var   *cva;
+    cg_var   *cvn;
+    cbuf     *cb = NULL;
+    char     *msgid = NULL;
+    uint32_t  i;
+
+    cva = cvec_find(cvv, "a");
+    cvn = cvec_find(cvv, "n");
+    if ((cb = cbuf_new()) == NULL){
+        clixon_err(OE_UNIX, errno, "cbuf_new");
+        goto done;
+    }
+    for (i=0; i<cv_uint32_get(cvn); i++){
+        cbuf_reset(cb);
+        cprintf(cb, "async-%u", i);
+        if ((msgid = strdup(cbuf_get(cb))) == NULL){
+            clixon_err(OE_UNIX, errno, "strdup");
+            goto done;
+        }
+        cbuf_reset(cb);
+        cprintf(cb, "<rpc xmlns=\"%s\" username=\"%s\" message-id=\"%s\">"
+                "<example xmlns=\"urn:example:clixon\"><x>%s%u</x></example></rpc>",
+                NETCONF_BASE_NAMESPACE,
+                clicon_username_get(h),
+                msgid,
+                cv_string_get(cva), i);
+        if (clicon_rpc_netconf_async(h, cbuf_get(cb), example_client_rpc_async_cb, msgid, NULL) < 0)
+            goto done;
+        msgid = NULL; /* Freed by callback */
+    }
+    if (clicon_rpc_async_wait(h, 0) < 0)
+        goto done;
+    retval = 0;
+ done:
+    if (msgid)
+        free(msgid);
+    if (cb)
+        cbuf_free(cb);
+    return retval;
+}
+
 /*! Translate function from an original value to a new.
  *
  * In this case, assume string and increment characters, eg HAL->IBM
@@ -60,6 +60,7 @@ typedef struct {
                                  * reset by commit, discard
                                  */
     int            de_empty;    /* Empty on read from file, xmldb_readfile and xmldb_put sets it */
+    uint64_t       de_gen;      /* Generation, new value on every change, see xmldb_generation */
 } db_elmnt;
 
 /*
@@ -53,6 +53,8 @@ int xmldb_get(clixon_handle h, const char *db, cvec *nsc, char *xpath, cxobj **x
 int xmldb_get0(clixon_handle h, const char *db, yang_bind yb,
                cvec *nsc, const char *xpath, int copy, withdefaults_type wdef,
                cxobj **xret, modstate_diff_t *msd, cxobj **xerr);
+int xmldb_get_nacm(clixon_handle h, const char *db, cvec *nsc, const char *xpath,
+                   withdefaults_type wdef, char *username, cxobj *xnacm, cxobj **xret);
 int xmldb_put(clixon_handle h, const char *db, enum operation_type op, cxobj *xt, char *username, cbuf *cbret); /* in clixon_datastore_write.[ch] */
 int xmldb_copy(clixon_handle h, const char *from, const char *to);
 int xmldb_lock(clixon_handle h, const char *db, uint32_t id);
@@ -70,6 +72,8 @@ cxobj *xmldb_cache_get(clixon_handle h, const char *db);
 int xmldb_modified_get(clixon_handle h, const char *db);
 int xmldb_modified_set(clixon_handle h, const char *db, int value);
 int xmldb_empty_get(clixon_handle h, const char *db);
+uint64_t xmldb_generation(clixon_handle h, const char *db);
+int xmldb_generation_bump(clixon_handle h, const char *db);
 int xmldb_print(clixon_handle h, FILE *f);
 int xmldb_rename(clixon_handle h, const char *db, const char *newdb, const char *suffix);
 int xmldb_populate(clixon_handle h, const char *db);
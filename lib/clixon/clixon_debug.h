@@ -81,10 +81,14 @@
 
 /*
  * Macros
+ * The debug level is checked before the call so that arguments are not evaluated
+ * (and no varargs call is made) when debugging is disabled for the subject
  */
 #if defined(__GNUC__)
 #define clixon_debug(l, _fmt, args...) \
 	do { \
+		if (!clixon_debug_isset(l)) \
+			break; \
 		_Pragma("GCC diagnostic push") \
 		_Pragma("GCC diagnostic ignored \"-Wformat-zero-length\"") \
 		clixon_debug_fn(NULL, __FUNCTION__, __LINE__, (l), NULL, _fmt, ##args); \
@@ -93,6 +97,8 @@
 
 #define clixon_debug_xml(l, x, _fmt, args...) \
 	do { \
+		if (!clixon_debug_isset(l)) \
+			break; \
 		_Pragma("GCC diagnostic push") \
 		_Pragma("GCC diagnostic ignored \"-Wformat-zero-length\"") \
 		clixon_debug_fn(NULL, __FUNCTION__, __LINE__, (l), (x), _fmt, ##args); \
@@ -102,6 +108,8 @@
 #elif defined(__clang__)
 #define clixon_debug(l, _fmt, args...) \
 	do { \
+		if (!clixon_debug_isset(l)) \
+			break; \
 		_Pragma("clang diagnostic push") \
 		_Pragma("clangGCC diagnostic ignored \"-Wformat-zero-length\"") \
 		clixon_debug_fn(NULL, __FUNCTION__, __LINE__, (l), NULL, _fmt, ##args); \
@@ -110,6 +118,8 @@
 
 #define clixon_debug_xml(l, x, _fmt, args...) \
 	do { \
+		if (!clixon_debug_isset(l)) \
+			break; \
 		_Pragma("clangGCC diagnostic push") \
 		_Pragma("clangGCC diagnostic ignored \"-Wformat-zero-length\"") \
 		clixon_debug_fn(NULL, __FUNCTION__, __LINE__, (l), (x), _fmt, ##args); \
@@ -118,9 +128,15 @@
 
 #else
 #define clixon_debug(l, _fmt, args...) \
-		clixon_debug_fn(NULL, __FUNCTION__, __LINE__, (l), NULL, _fmt, ##args)
+	do { \
+		if (clixon_debug_isset(l)) \
+			clixon_debug_fn(NULL, __FUNCTION__, __LINE__, (l), NULL, _fmt, ##args); \
+	} while (0)
 #define clixon_debug_xml(l, x, _fmt, args...) \
-		clixon_debug_fn(NULL, __FUNCTION__, __LINE__, (l), (x), _fmt, ##args)
+	do { \
+		if (clixon_debug_isset(l)) \
+			clixon_debug_fn(NULL, __FUNCTION__, __LINE__, (l), (x), _fmt, ##args); \
+	} while (0)
 #endif
 
 /*
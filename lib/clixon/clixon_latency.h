@@ -0,0 +1,68 @@
+/*
+ *
+  ***** BEGIN LICENSE BLOCK *****
+
+  Copyright (C) 2024 Olof Hagsand
+
+  This file is part of CLIXON.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Alternatively, the contents of this file may be used under the terms of
+  the GNU General Public License Version 3 or later (the "GPL"),
+  in which case the provisions of the GPL are applicable instead
+  of those above. If you wish to allow use of your version of this file only
+  under the terms of the GPL, and not to allow others to
+  use your version of this file under the terms of Apache License version 2, indicate
+  your decision by deleting the provisions above and replace them with the
+  notice and other provisions required by the GPL. If you do not delete
+  the provisions above, a recipient may use your version of this file under
+  the terms of any one of the Apache License version 2 or the GPL.
+
+  ***** END LICENSE BLOCK *****
+  * Latency histograms of backend RPCs, transaction phases and plugin callbacks
+  */
+
+#ifndef _CLIXON_LATENCY_H_
+#define _CLIXON_LATENCY_H_
+
+/*
+ * Types
+ */
+typedef struct clixon_histogram clixon_histogram;
+
+/*
+ * Prototypes
+ */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+clixon_histogram *clixon_histogram_new(void);
+int      clixon_histogram_free(clixon_histogram *hg);
+int      clixon_histogram_record(clixon_histogram *hg, uint64_t value);
+int      clixon_histogram_reset(clixon_histogram *hg);
+uint64_t clixon_histogram_count(clixon_histogram *hg);
+uint64_t clixon_histogram_percentile(clixon_histogram *hg, double pct);
+int      clixon_histogram_print(cbuf *cb, clixon_histogram *hg);
+uint64_t clixon_latency_now(void);
+int      clixon_latency_record(const char *group, const char *name, const char *sub, uint64_t usec);
+int      clixon_latency_print(cbuf *cb, const char *group);
+int      clixon_latency_reset(void);
+int      clixon_latency_free(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* _CLIXON_LATENCY_H_ */
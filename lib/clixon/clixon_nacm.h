@@ -57,12 +57,17 @@ enum nacm_access{
  * Prototypes
  */
 int nacm_rpc(char *rpc, char *module, char *username, cxobj *xnacm, cbuf *cbret);
-int nacm_datanode_read(clixon_handle h, cxobj *xt, cxobj **xvec, size_t xlen, char *username,
+int nacm_datanode_read(yang_stmt *yspec, cxobj *xt, cxobj **xvec, size_t xlen, char *username,
                        cxobj *nacm_xtree);
+int nacm_datanode_read_copy(clixon_handle h, cxobj *x0t, cxobj *x1t, char *username,
+                            cxobj *xnacm);
 int nacm_datanode_write(clixon_handle h, cxobj *xr, cxobj *xt,
                         enum nacm_access access,
                         char *username, cxobj *xnacm, cbuf *cbret);
 int nacm_access_pre(clixon_handle h, char *peername, char *username, cxobj **xnacmp);
+cxobj *nacm_tree_hold(cxobj *xnacm);
+int nacm_tree_release(cxobj *xnacm);
+int nacm_exit(void);
 int verify_nacm_user(clixon_handle h, enum nacm_credentials_t cred, char *peername, char *nacmname, cbuf *cbret);
 
 #endif /* _CLIXON_NACM_H */
@@ -85,6 +85,20 @@ enum nacm_credentials_t{
     NC_EXCEPT    /* Exact match except for root and www user  */
 };
 
+/*! See clixon-config.yang type output_queue_policy */
+enum output_queue_policy_t{
+    OQ_BLOCK=0,     /* Queue replies, block session input, disconnect on notifications */
+    OQ_DROP,        /* Drop notifications */
+    OQ_DISCONNECT   /* Disconnect session */
+};
+
+/*! See clixon-config.yang type stream_queue_policy */
+enum stream_queue_policy_t{
+    SQ_DROP_OLDEST=0, /* Drop oldest queued event */
+    SQ_DROP_NEWEST,   /* Drop new event */
+    SQ_TERMINATE      /* Terminate subscription */
+};
+
 /*! yang clixon regexp engine
  *
  * @see regexp_mode in clixon-config.yang
@@ -193,6 +207,8 @@ int   clicon_startup_mode(clixon_handle h);
 enum priv_mode_t clicon_backend_privileges_mode(clixon_handle h);
 enum priv_mode_t clicon_restconf_privileges_mode(clixon_handle h);
 enum nacm_credentials_t clicon_nacm_credentials(clixon_handle h);
+enum output_queue_policy_t clicon_backend_output_queue_policy(clixon_handle h);
+enum stream_queue_policy_t clicon_stream_queue_policy(clixon_handle h);
 
 enum regexp_mode clicon_yang_regexp(clixon_handle h);
 /*-- Specific option access functions for non-yang options --*/
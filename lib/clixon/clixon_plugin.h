@@ -223,6 +223,11 @@ typedef int (plgreset_t)(clixon_handle h, const char *db);
  *
  * @note The system will make an xpath check and filter out non-matching trees
  * @note The system does not validate the xml, unless CLICON_VALIDATE_STATE_XML is set
+ * @note If ca_statedata_paths is set, the callback is only called if xpath may select
+ *       data in one of the paths. Paths are schema node paths with module name prefixes as
+ *       in RFC 8040 api-path, eg "/example:state" or "/ietf-interfaces:interfaces/interface"
+ * @note If ca_statedata_threadsafe is set, the callback may be called in a thread other than
+ *       the main thread, concurrently with callbacks of other plugins
  * @see clixon_pagination_cb_register for special paginated state data callback
  */
 typedef int (plgstatedata_t)(clixon_handle h, cvec *nsc, char *xpath, cxobj *xtop);
@@ -406,6 +411,9 @@ struct clixon_plugin_api{
             trans_cb_t       *cb_trans_end;      /* Transaction completed  */
             trans_cb_t       *cb_trans_abort;    /* Transaction aborted */
             datastore_upgrade_t *cb_datastore_upgrade; /* General-purpose datastore upgrade */
+            uint32_t          cb_statedata_ttl;  /* Seconds state data may be cached, 0: not cached */
+            const char      **cb_statedata_paths; /* Schema paths of state data, NULL-terminated, NULL: any */
+            int               cb_statedata_threadsafe; /* Statedata callback may be called in a thread */
         } cau_backend;
     } u;
 };
@@ -428,6 +436,9 @@ struct clixon_plugin_api{
 #define ca_trans_end      u.cau_backend.cb_trans_end
 #define ca_trans_abort    u.cau_backend.cb_trans_abort
 #define ca_datastore_upgrade  u.cau_backend.cb_datastore_upgrade
+#define ca_statedata_ttl  u.cau_backend.cb_statedata_ttl
+#define ca_statedata_paths u.cau_backend.cb_statedata_paths
+#define ca_statedata_threadsafe u.cau_backend.cb_statedata_threadsafe
 
 /*
  * Macros
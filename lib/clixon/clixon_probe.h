@@ -0,0 +1,89 @@
+/*
+ *
+  ***** BEGIN LICENSE BLOCK *****
+
+  Copyright (C) 2024 Olof Hagsand
+
+  This file is part of CLIXON.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Alternatively, the contents of this file may be used under the terms of
+  the GNU General Public License Version 3 or later (the "GPL"),
+  in which case the provisions of the GPL are applicable instead
+  of those above. If you wish to allow use of your version of this file only
+  under the terms of the GPL, and not to allow others to
+  use your version of this file under the terms of Apache License version 2, indicate
+  your decision by deleting the provisions above and replace them with the
+  notice and other provisions required by the GPL. If you do not delete
+  the provisions above, a recipient may use your version of this file under
+  the terms of any one of the Apache License version 2 or the GPL.
+
+  ***** END LICENSE BLOCK *****
+  * Static tracepoints (USDT) for perf, bpftrace, systemtap, etc
+  *
+  * If <sys/sdt.h> is found by configure (HAVE_SYS_SDT_H), probes are compiled in as
+  * no-op instructions with argument locations described in the .note.stapsdt ELF section.
+  * Otherwise the macros expand to nothing. Arguments should be cheap to evaluate since they
+  * are evaluated also when no tracer is attached.
+  * All probes have provider "clixon". Names use double underscore which is shown as dash,
+  * eg rpc__dispatch is rpc-dispatch in some tools.
+  *
+  * Probe                      Arguments
+  * rpc__receive               session-id, message length
+  * rpc__dispatch              session-id, rpc name
+  * rpc__reply                 session-id, rpc name, reply length, microseconds
+  * datastore__read__start     db, xpath
+  * datastore__read__done      db, retval
+  * datastore__write__start    db, operation
+  * datastore__write__done     db, retval
+  * datastore__copy            from db, to db, microseconds
+  * datastore__file__write     db, microseconds
+  * xpath__eval__start         xpath
+  * xpath__eval__done          xpath, retval
+  * validate__start            db
+  * validate__done             db, retval
+  * transaction__phase         phase, microseconds
+  * plugin__enter              plugin, callback
+  * plugin__exit               plugin, callback, retval, microseconds
+  * notify__fanout             stream, subscriptions notified, microseconds
+  *
+  * Example:
+  *   bpftrace -e 'usdt:/usr/local/sbin/clixon_backend:clixon:rpc__reply { printf("%s %d\n", str(arg1), arg3); }'
+  * @see doc/clixon_probes.bt
+  */
+
+#ifndef _CLIXON_PROBE_H_
+#define _CLIXON_PROBE_H_
+
+#ifdef HAVE_SYS_SDT_H
+#include <sys/sdt.h>
+
+#define CLIXON_PROBE0(name)                  DTRACE_PROBE(clixon, name)
+#define CLIXON_PROBE1(name, a1)              DTRACE_PROBE1(clixon, name, a1)
+#define CLIXON_PROBE2(name, a1, a2)          DTRACE_PROBE2(clixon, name, a1, a2)
+#define CLIXON_PROBE3(name, a1, a2, a3)      DTRACE_PROBE3(clixon, name, a1, a2, a3)
+#define CLIXON_PROBE4(name, a1, a2, a3, a4)  DTRACE_PROBE4(clixon, name, a1, a2, a3, a4)
+
+#else /* HAVE_SYS_SDT_H */
+
+/* Arguments are referenced but never evaluated, to avoid unused variable warnings */
+#define CLIXON_PROBE0(name)                  do {} while (0)
+#define CLIXON_PROBE1(name, a1)              do { if (0) { (void)(a1); } } while (0)
+#define CLIXON_PROBE2(name, a1, a2)          do { if (0) { (void)(a1); (void)(a2); } } while (0)
+#define CLIXON_PROBE3(name, a1, a2, a3)      do { if (0) { (void)(a1); (void)(a2); (void)(a3); } } while (0)
+#define CLIXON_PROBE4(name, a1, a2, a3, a4)  do { if (0) { (void)(a1); (void)(a2); (void)(a3); (void)(a4); } } while (0)
+
+#endif /* HAVE_SYS_SDT_H */
+
+#endif  /* _CLIXON_PROBE_H_ */
@@ -40,9 +40,17 @@
 #ifndef _CLIXON_PROTO_H_
 #define _CLIXON_PROTO_H_
 
+/*
+ * Constants
+ */
+/* Internal hello capability: client accepts large replies in shared memory
+ * passed as a descriptor on the UNIX socket, see CLICON_IPC_SHM_THRESHOLD */
+#define CLIXON_IPC_SHM_CAPABILITY "urn:clixon:params:ipc:shm:1.0"
+
 /*
  * Types
  */
+struct iovec;
 
 /* Protocol message header */
 struct clicon_msg {
@@ -51,6 +59,13 @@ struct clicon_msg {
     char        op_body[0]; /* rest of message, actual data */
 };
 
+/* Buffered reader of internal IPC messages, see clicon_msg_reader_new */
+typedef struct clicon_msg_reader clicon_msg_reader;
+
+/* Received message with reference count, body in heap or in mapped shared memory,
+ * see clicon_msg_rcv_buf */
+typedef struct clicon_msg_buf clicon_msg_buf;
+
 /*
  * Prototypes
  */
@@ -76,6 +91,8 @@ int clicon_rpc(int sock, const char *descr, struct clicon_msg *msg, char **xret,
 
 int clicon_rpc1(int sock, const char *descr, cbuf *msgin, cbuf *msgret, int *eof);
 
+int clicon_rpc_buf(int sock, const char *descr, struct clicon_msg *msg, clicon_msg_buf **mb, int *eof);
+
 int clicon_msg_send(int s, const char *descr, struct clicon_msg *msg);
 
 int clicon_msg_send1(int s, const char *descr, cbuf *cb);
@@ -84,11 +101,28 @@ int clicon_msg_rcv(int s, const char *descr, int intr, struct clicon_msg **msg,
 
 int clicon_msg_rcv1(int s, const char *descr, cbuf *cb, int *eof);
 
+int clicon_msg_rcv_buf(int s, const char *descr, int intr, clicon_msg_buf **mb, int *eof);
+clicon_msg_buf *clicon_msg_buf_ref(clicon_msg_buf *mb);
+void clicon_msg_buf_unref(clicon_msg_buf *mb);
+char *clicon_msg_buf_body(clicon_msg_buf *mb);
+size_t clicon_msg_buf_len(clicon_msg_buf *mb);
+
+clicon_msg_reader *clicon_msg_reader_new(void);
+void clicon_msg_reader_free(clicon_msg_reader *mr);
+int clicon_msg_reader_read(clicon_msg_reader *mr, int s, int *eof);
+int clicon_msg_reader_next(clicon_msg_reader *mr, const char *descr, struct clicon_msg **msg);
+int clicon_msg_reader_pending(clicon_msg_reader *mr);
+
 int send_msg_notify_xml(clixon_handle h, int s, const char *descr, cxobj *xev);
 
 int send_msg_reply(int s, const char *descr, char *data, uint32_t datalen);
+int clicon_msg_append(cbuf *cb, const char *data, uint32_t datalen);
+int clicon_msg_send_shm(int s, const char *descr, const char *data, uint32_t datalen, cbuf *cb);
+
+int clixon_writev(int fd, struct iovec *iov, int iovcnt);
 
 int detect_endtag(char *tag, char  ch, int  *state);
+size_t detect_endtag_buf(char *tag, const char *buf, size_t len, cbuf *cb, int *state, int *found);
 
 int clixon_inet2sin(const char *addrtype, const char *addrstr, uint16_t port, struct sockaddr *sa, size_t *sa_len);
 
@@ -42,9 +42,30 @@
 #ifndef _CLIXON_PROTO_CLIENT_H_
 #define _CLIXON_PROTO_CLIENT_H_
 
+/*
+ * Types
+ */
+/*! Reply callback of asynchronous rpc
+ *
+ * @param[in]  h     Clixon handle
+ * @param[in]  id    Request id as returned by clicon_rpc_msg_async
+ * @param[in]  xret  Reply as XML tree, or NULL if socket closed. Freed by caller
+ * @param[in]  arg   Argument given to clicon_rpc_msg_async
+ * @retval     0     OK
+ * @retval    -1     Error
+ */
+typedef int (clicon_rpc_async_cb)(clixon_handle h, uint32_t id, cxobj *xret, void *arg);
+
+/*
+ * Prototypes
+ */
 int clicon_rpc_connect(clixon_handle h, int *sock0);
 int clicon_rpc_msg(clixon_handle h, struct clicon_msg *msg, cxobj **xret0);
 int clicon_rpc_msg_persistent(clixon_handle h, struct clicon_msg *msg, cxobj **xret0, int *sock0);
+int clicon_rpc_async_pending(clixon_handle h);
+int clicon_rpc_msg_async(clixon_handle h, struct clicon_msg *msg, clicon_rpc_async_cb *fn, void *arg, uint32_t *idp);
+int clicon_rpc_async_wait(clixon_handle h, uint32_t id);
+int clicon_rpc_netconf_async(clixon_handle h, char *xmlstr, clicon_rpc_async_cb *fn, void *arg, uint32_t *idp);
 int clicon_rpc_netconf(clixon_handle h, char *xmlst, cxobj **xret, int *sp);
 int clicon_rpc_netconf_xml(clixon_handle h, cxobj *xml, cxobj **xret, int *sp);
 int clicon_rpc_get_config(clixon_handle h, char *username, char *db, char *xpath, cvec *nsc, char *defaults, cxobj **xret);
@@ -45,15 +45,49 @@
 /*
  * Types
  */
+/* Encodings of a serialized event, see stream_event_encode */
+enum stream_encoding{
+    STREAM_ENC_XML,  /* XML */
+    STREAM_ENC_JSON, /* JSON */
+    STREAM_ENC_MSG,  /* XML with terminating null in internal message, see clicon_msg_append */
+    STREAM_ENC_NR    /* Number of encodings */
+};
+
+/* Notification event shared by all subscribers, serialized at most once per encoding.
+ * Reference counted, see stream_event_ref and stream_event_free
+ */
+typedef struct stream_event stream_event;
+
 /*! Subscription callback 
  *
  * @param[in]  h     Clicon handle
  * @param[in]  op    Operation: 0 OK, 1 Close
- * @param[in]  event Event as XML
+ * @param[in]  event Event, use stream_event_encode or stream_event_xml. NULL on close
  * @param[in]  arg   Extra argument provided in stream_ss_add
+ * @retval     1     OK, subscriber is busy: queue events until stream_ss_resume
+ * @retval     0     OK
+ * @retval    -1     Error
  * @see stream_ss_add
+ * @see CLICON_STREAM_QUEUE_MAX
+ */
+typedef int (*stream_fn_t)(clixon_handle h, int op, stream_event *event, void *arg);
+
+struct stream_filter;
+
+/*! Callback computing the event of a filter group
+ *
+ * Used for events that depend on the filter, eg on-change subscriptions where the
+ * filter selects config data instead of the event.
+ * @param[in]  h     Clicon handle
+ * @param[in]  sf    Filter group, sf_xpath is canonical filter xpath or NULL if no filter,
+ *                   sf_username is NACM user of its subscriptions
+ * @param[in]  arg   Extra argument provided in stream_notify_prepare
+ * @param[out] xevp  Event element, child of notification. NULL if no event
+ * @retval     0     OK
+ * @retval    -1     Error
+ * @see stream_notify_prepare
  */
-typedef int (*stream_fn_t)(clixon_handle h, int op, cxobj *event, void *arg);
+typedef int (stream_prepare_fn_t)(clixon_handle h, struct stream_filter *sf, void *arg, cxobj **xevp);
 
 struct stream_subscription{
     qelem_t                     ss_q;   /* queue header */
@@ -63,13 +97,53 @@ struct stream_subscription{
     struct timeval              ss_stoptime; /* Replay stoptime */
     stream_fn_t                 ss_fn;     /* Callback when event occurs */
     void                       *ss_arg;    /* Callback argument */
+    struct stream_filter       *ss_filter; /* Filter group of subscription */
+    uint32_t                    ss_id;     /* Subscription id, unique in stream */
+    int                         ss_busy;   /* Subscriber busy, queue events */
+    stream_event              **ss_queue;  /* Ring of queued events */
+    int                         ss_qmax;   /* Size of ss_queue, 0: no queue */
+    int                         ss_qhead;  /* Oldest event in ss_queue */
+    int                         ss_qlen;   /* Number of events in ss_queue */
+    uint32_t                    ss_drops;  /* Events dropped since queue was full */
+    int                         ss_terminated; /* Terminated, no more events */
+    uint32_t                    ss_period; /* Period in centiseconds if periodic, else 0 */
+    char                       *ss_username; /* NACM user of events computed per user, or NULL */
 };
 
-/* Replay time-series */
+/* Subscriptions of a stream with the same filter, and period and user if set
+ * The filter is parsed once and evaluated once per event for all its subscriptions
+ */
+struct stream_filter{
+    qelem_t                      sf_q;     /* queue header */
+    char                        *sf_xpath; /* Canonical xpath, or NULL if no filter */
+    struct xpath_tree           *sf_tree;  /* Parsed xpath */
+    char                        *sf_name;  /* Event element name xpath requires, or NULL */
+    int                          sf_len;   /* Length of sf_vec */
+    struct stream_subscription **sf_vec;   /* Subscriptions using filter */
+    uint32_t                     sf_period; /* Period of subscriptions, 0 if not periodic */
+    char                        *sf_username; /* NACM user of subscriptions, or NULL */
+    stream_event                *sf_pending; /* Event to send, see stream_notify_prepare */
+};
+
+/* Replay log segment: serialized events appended in time order
+ * If CLICON_STREAM_REPLAY_DIR is set, a segment is also an append-only file
+ */
+struct stream_replay_seg{
+    qelem_t        rs_q;      /* queue header */
+    uint64_t       rs_seq;    /* Sequence number, name of segment file */
+    int            rs_fd;     /* Segment file if appended to, else -1 */
+    int            rs_live;   /* Number of events not evicted */
+    size_t         rs_size;   /* Allocated size of rs_buf */
+    size_t         rs_len;    /* Used length of rs_buf */
+    char          *rs_buf;    /* Event records, see stream_replay_add */
+};
+
+/* Replay time index entry, in ring es_replay ordered by time */
 struct stream_replay{
-    qelem_t        r_q;   /* queue header */
-    struct timeval r_tv;  /* time index */
-    cxobj         *r_xml; /* event in xml form */
+    struct timeval            r_tv;  /* time index */
+    char                     *r_str; /* event serialized as XML, in segment */
+    size_t                    r_len; /* strlen of r_str */
+    struct stream_replay_seg *r_seg; /* Segment of event */
 };
 
 /* See RFC8040 9.3, stream list, no replay support for now
@@ -79,9 +153,20 @@ struct event_stream{
     char                *es_name; /* name of notification event stream */
     char                *es_description;
     struct stream_subscription *es_subscription;
+    uint32_t             es_ss_id;        /* Id of next subscription */
+    struct stream_filter *es_filters;     /* Filters matching any event element name */
+    clicon_hash_t        *es_filter_index; /* Event element name -> filters requiring it */
     int                  es_replay_enabled; /* set if replay is enables */
     struct timeval       es_retention; /* replay retention - how much to save */
-    struct stream_replay *es_replay;
+    struct stream_replay *es_replay;      /* Ring of replay time index */
+    size_t               es_replay_size;  /* Allocated entries of es_replay */
+    size_t               es_replay_head;  /* Oldest entry in es_replay */
+    size_t               es_replay_len;   /* Number of entries in es_replay */
+    size_t               es_replay_bytes; /* Serialized size of replay events */
+    size_t               es_replay_max;   /* Max es_replay_bytes, 0 is no limit */
+    char                *es_replay_dir;   /* Directory of segment files, or NULL */
+    uint64_t             es_replay_seq;   /* Sequence number of next segment */
+    struct stream_replay_seg *es_replay_segs; /* Replay log segments, oldest first */
 
 };
 typedef struct event_stream event_stream_t;
@@ -92,23 +177,37 @@ typedef struct event_stream event_stream_t;
 event_stream_t *stream_find(clixon_handle h, const char *name);
 int stream_add(clixon_handle h, const char *name, const char *description, int replay_enabled, struct timeval *retention);
 int stream_delete_all(clixon_handle h, int force);
-int stream_get_xml(clixon_handle h, int access, cbuf *cb);
+int stream_get_xml(clixon_handle h, int access, char *username, cbuf *cb);
 int stream_timer_setup(int fd, void *arg);
 /* Subscriptions */
 struct stream_subscription *stream_ss_add(clixon_handle h, char *stream,
                   char *xpath, struct timeval *start, struct timeval *stop,
                   stream_fn_t fn, void *arg);
+struct stream_subscription *stream_ss_add_user(clixon_handle h, char *stream,
+                  char *xpath, char *username, struct timeval *start, struct timeval *stop,
+                  stream_fn_t fn, void *arg);
+struct stream_subscription *stream_ss_add_periodic(clixon_handle h, char *stream,
+                  char *xpath, uint32_t period, char *username, stream_fn_t fn, void *arg);
 int stream_ss_rm(clixon_handle h, event_stream_t *es, struct stream_subscription *ss, int force);
 struct stream_subscription *stream_ss_find(event_stream_t *es,
                                            stream_fn_t fn, void *arg);
 int stream_ss_delete_all(clixon_handle h, stream_fn_t fn, void *arg);
 int stream_ss_delete(clixon_handle h, char *name, stream_fn_t fn, void *arg);
+int stream_ss_resume(clixon_handle h, stream_fn_t fn, void *arg);
 
 int stream_notify_xml(clixon_handle h, char *stream, cxobj *xml);
 int stream_notify(clixon_handle h, char *stream, const char *event, ...)  __attribute__ ((format (printf, 3, 4)));
+int stream_notify_prepare(clixon_handle h, char *stream, stream_prepare_fn_t *fn, void *arg);
+int stream_notify_pending(clixon_handle h, char *stream, int send);
+
+/* Events */
+stream_event *stream_event_ref(stream_event *se);
+int    stream_event_free(stream_event *se);
+cxobj *stream_event_xml(stream_event *se);
+int    stream_event_encode(stream_event *se, enum stream_encoding enc, char **datap, size_t *lenp);
 
 /* Replay */
-int stream_replay_add(event_stream_t *es, struct timeval *tv, cxobj *xv);
+int stream_replay_add(event_stream_t *es, struct timeval *tv, stream_event *se);
 int stream_replay_trigger(clixon_handle h, char *stream, stream_fn_t fn, void *arg);
 
 /* Experimental publish streams using SSE. CLIXON_PUBLISH_STREAMS should be set */
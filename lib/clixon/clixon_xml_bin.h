@@ -0,0 +1,65 @@
+/*
+ *
+  ***** BEGIN LICENSE BLOCK *****
+
+  Copyright (C) 2024 Olof Hagsand
+
+  This file is part of CLIXON.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Alternatively, the contents of this file may be used under the terms of
+  the GNU General Public License Version 3 or later (the "GPL"),
+  in which case the provisions of the GPL are applicable instead
+  of those above. If you wish to allow use of your version of this file only
+  under the terms of the GPL, and not to allow others to
+  use your version of this file under the terms of Apache License version 2, indicate
+  your decision by deleting the provisions above and replace them with the
+  notice and other provisions required by the GPL. If you do not delete
+  the provisions above, a recipient may use your version of this file under
+  the terms of any one of the Apache License version 2 or the GPL.
+
+  ***** END LICENSE BLOCK *****
+  * Binary encoding of YANG-bound XML trees on the internal IPC socket
+  */
+
+#ifndef _CLIXON_XML_BIN_H_
+#define _CLIXON_XML_BIN_H_
+
+/* Internal hello capability announcing a module for binary encoding, with parameters:
+ * ?module=<name>&revision=<rev>&hash=<hash>&index=<i>
+ * where index is the position of the module in the client yang spec
+ */
+#define CLIXON_IPC_BINARY_CAPABILITY "urn:clixon:params:ipc:binary:1.0"
+
+/*
+ * Prototypes
+ */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int clixon_bin_module_hash(yang_stmt *ymod, uint32_t *hash);
+int clixon_bin_capabilities(cbuf *cb, yang_stmt *yspec);
+int clixon_bin_capability_parse(char *capability, yang_stmt *yspec, yang_stmt ***ymods, int *nymods);
+int clixon_bin_detect(const char *buf);
+int clixon_xml2bin(cbuf *cb, cxobj *x, int32_t depth, withdefaults_type wdef,
+                   yang_stmt **ymods, int nymods);
+int clixon_bin_attr_add(cbuf *cb, const char *name, const char *value);
+int clixon_bin_parse(clixon_handle h, const char *buf, yang_stmt *yspec, cxobj **xt, cxobj **xerr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* _CLIXON_XML_BIN_H_ */
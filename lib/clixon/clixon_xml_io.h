@@ -40,9 +40,21 @@
 #ifndef _CLIXON_XML_IO_H_
 #define _CLIXON_XML_IO_H_
 
+/*
+ * Types
+ */
+/*! Output sink for streaming serialization
+ *
+ * Called with the accumulated output in cb, and finally with last set.
+ * The sink consumes the data and resets cb.
+ * @see clixon_xml2sink
+ */
+typedef int (clixon_output_sink)(cbuf *cb, int last, void *arg);
+
 /*
  * Prototypes
  */
+int   xml2output_wdef(cxobj *x, withdefaults_type wdef, int *tag);
 int   clixon_xml2file1(FILE *f, cxobj *xn, int level, int pretty, char *prefix,
                        clicon_output_cb *fn, int skiptop, int autocliext, withdefaults_type wdef);
 int   clixon_xml2file(FILE *f, cxobj *xn, int level, int pretty, char *prefix, clicon_output_cb *fn, int skiptop, int autocliext);
@@ -52,6 +64,11 @@ int   clixon_xml2cbuf1(cbuf *cb, cxobj *x, int level, int prettyprint, char *pre
                        int32_t depth, int skiptop, withdefaults_type wdef);
 int   clixon_xml2cbuf(cbuf *cb, cxobj *x, int level, int prettyprint, char *prefix, int32_t depth, 
 int skiptop);
+int   clixon_xml2sink(cbuf *cb, cxobj *xn, int level, int pretty, char *prefix,
+                      int32_t depth, int skiptop, withdefaults_type wdef,
+                      size_t threshold, clixon_output_sink *fn, void *arg);
+int   clixon_xml2cbuf_parallel(cbuf *cb, cxobj *xn, int level, int pretty, char *prefix,
+                               int32_t depth, int skiptop, withdefaults_type wdef, int threads);
 int   xmltree2cbuf(cbuf *cb, cxobj *x, int level);
 int   clixon_xml_parse_file(FILE *f, yang_bind yb, yang_stmt *yspec, cxobj **xt, cxobj **xerr);
 int   clixon_xml_parse_string(const char *str, yang_bind yb, yang_stmt *yspec, cxobj **xt, cxobj **xerr);
@@ -457,6 +457,7 @@ clicon_nacm_ext(clixon_handle h)
 
 /*! Set NACM (rfc 8341) external XML parse tree, free old if any
  *
+ * Also sets a new "nacm-ext-generation" so that compiled NACM rules are rebuilt
  * @param[in]  h   Clixon handle
  * @param[in]  xn  XML Nacm tree
  * @note only used if config option CLICON_NACM_MODE is external
@@ -467,9 +468,13 @@ clicon_nacm_ext_set(clixon_handle h,
                      cxobj        *x)
 {
     cxobj *x0 = NULL;
+    int    gen;
 
     if ((x0 = clicon_nacm_ext(h)) != NULL)
         xml_free(x0);
+    gen = clicon_data_int_get(h, "nacm-ext-generation");
+    if (clicon_data_int_set(h, "nacm-ext-generation", gen<=0?1:gen+1) < 0)
+        return -1;
     return clicon_ptr_set(h, "nacm_xml", x);
 }
 
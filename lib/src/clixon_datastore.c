@@ -82,9 +82,17 @@
 #include "clixon_xml_io.h"
 #include "clixon_json.h"
 #include "clixon_datastore.h"
+#include "clixon_latency.h"
+#include "clixon_probe.h"
 #include "clixon_datastore_write.h"
 #include "clixon_datastore_read.h"
 
+/*
+ * Variables
+ */
+/* Last datastore generation given, shared by all datastores so that a value is never reused */
+static uint64_t _xmldb_generation = 0;
+
 /*! Translate from symbolic database name to actual filename in file-system
  *
  * @param[in]   th       text handle handle
@@ -190,8 +198,10 @@ xmldb_copy(clixon_handle h,
     db_elmnt            de0 = {0,};
     cxobj              *x1 = NULL;  /* from */
     cxobj              *x2 = NULL;  /* to */
+    uint64_t            t0;
 
     clixon_debug(CLIXON_DBG_DATASTORE, "%s %s", from, to);
+    t0 = clixon_latency_now();
     /* XXX lock */
     /* Copy in-memory cache */
     /* 1. "to" xml tree in x1 */
@@ -228,6 +238,8 @@ xmldb_copy(clixon_handle h,
         de0 = *de2;
     de0.de_xml = x2; /* The new tree */
     clicon_db_elmnt_set(h, to, &de0);
+    if (xmldb_generation_bump(h, to) < 0)
+        goto done;
 
     /* Copy the files themselves (above only in-memory cache) */
     if (xmldb_db2file(h, from, &fromfile) < 0)
@@ -237,6 +249,7 @@ xmldb_copy(clixon_handle h,
     if (clicon_file_copy(fromfile, tofile) < 0)
         goto done;
     retval = 0;
+    CLIXON_PROBE3(datastore__copy, from, to, clixon_latency_now() - t0);
  done:
     clixon_debug(CLIXON_DBG_DATASTORE, "retval:%d", retval);
     if (fromfile)
@@ -423,6 +436,7 @@ xmldb_clear(clixon_handle h,
             xml_free(xt);
             de->de_xml = NULL;
         }
+        de->de_gen = ++_xmldb_generation;
     }
     return 0;
 }
@@ -485,6 +499,7 @@ xmldb_create(clixon_handle h,
             xml_free(xt);
             de->de_xml = NULL;
         }
+        de->de_gen = ++_xmldb_generation;
     }
     if (xmldb_db2file(h, db, &filename) < 0)
         goto done;
@@ -609,6 +624,48 @@ xmldb_modified_set(clixon_handle h,
     return 0;
 }
 
+/*! Get generation of datastore
+ *
+ * The generation gets a new, higher, value every time the datastore is changed by edit,
+ * copy, delete, etc. Values are not reused, also not between datastores.
+ * Can be used to check if data derived from the datastore is still valid.
+ * @param[in]  h     Clixon handle
+ * @param[in]  db    Database name
+ * @retval     gen   Generation, 0 if datastore is not loaded
+ * @see xmldb_generation_bump
+ */
+uint64_t
+xmldb_generation(clixon_handle h,
+                 const char   *db)
+{
+    db_elmnt *de;
+
+    if ((de = clicon_db_elmnt_get(h, db)) == NULL)
+        return 0;
+    return de->de_gen;
+}
+
+/*! Set new generation of datastore after a change
+ *
+ * Called by the datastore functions that change a datastore. Code that modifies the XML
+ * cache of a datastore directly should also call this.
+ * @param[in]  h     Clixon handle
+ * @param[in]  db    Database name
+ * @retval     0     OK, also if datastore is not loaded
+ * @retval    -1     Error
+ * @see xmldb_generation
+ */
+int
+xmldb_generation_bump(clixon_handle h,
+                      const char   *db)
+{
+    db_elmnt *de;
+
+    if ((de = clicon_db_elmnt_get(h, db)) != NULL)
+        de->de_gen = ++_xmldb_generation;
+    return 0;
+}
+
 /* Print the datastore meta-info to file
  */
 int
@@ -675,6 +732,10 @@ xmldb_rename(clixon_handle h,
         clixon_err(OE_UNIX, errno, "rename: %s", strerror(errno));
         goto done;
     };
+    if (xmldb_generation_bump(h, db) < 0)
+        goto done;
+    if (newdb && xmldb_generation_bump(h, newdb) < 0)
+        goto done;
     retval = 0;
  done:
     if (cb)
@@ -716,6 +777,8 @@ xmldb_populate(clixon_handle h,
         if (xml_default_recurse(x, 0, 0) < 0)
             goto done;
     }
+    if (xmldb_generation_bump(h, db) < 0)
+        goto done;
     retval = ret;
  done:
     return retval;
@@ -785,7 +848,9 @@ xmldb_write_cache2file(clixon_handle h,
     cxobj      *xt;
     FILE       *f = NULL;
     char       *dbfile = NULL;
+    uint64_t    t0;
 
+    t0 = clixon_latency_now();
     if (xmldb_db2file(h, db, &dbfile) < 0)
         goto done;
     if (dbfile==NULL){
@@ -806,6 +871,10 @@ xmldb_write_cache2file(clixon_handle h,
         fclose(f);
         f = NULL;
     }
+    t0 = clixon_latency_now() - t0;
+    CLIXON_PROBE2(datastore__file__write, db, t0);
+    if (clixon_latency_record("datastore", db, "file-write", t0) < 0)
+        goto done;
     retval = 0;
  done:
     if (dbfile)
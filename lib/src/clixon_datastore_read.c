@@ -83,6 +83,7 @@
 #include "clixon_xml_nsctx.h"
 #include "clixon_datastore.h"
 #include "clixon_datastore_read.h"
+#include "clixon_probe.h"
 
 #define handle(xh) (assert(text_handle_check(xh)==0),(struct text_handle *)(xh))
 
@@ -670,6 +671,8 @@ xmldb_readfile(clixon_handle    h,
  * @param[in]  nsc    External XML namespace context, or NULL
  * @param[in]  xpath  String with XPath syntax. or NULL for all
  * @param[in]  wdef   With-defaults parameter, see RFC 6243
+ * @param[in]  username User name for NACM read validation
+ * @param[in]  xnacm  NACM tree, or NULL if no NACM read validation
  * @param[out] xret   Single return XML tree. Free with xml_free()
  * @param[out] msdiff If set, return modules-state differences
  * @param[out] xerr   XML error if retval is 0
@@ -684,6 +687,8 @@ xmldb_get_cache(clixon_handle     h,
                 cvec             *nsc,
                 const char       *xpath,
                 withdefaults_type wdef,
+                char             *username,
+                cxobj            *xnacm,
                 cxobj           **xret,
                 modstate_diff_t  *msdiff,
                 cxobj           **xerr)
@@ -705,6 +710,7 @@ xmldb_get_cache(clixon_handle     h,
         clixon_err(OE_DB, EINVAL, "xret is NULL");
         return -1;
     }
+    CLIXON_PROBE2(datastore__read__start, db, xpath);
     if ((yspec = clicon_dbspec_yang(h)) == NULL){
         clixon_err(OE_YANG, ENOENT, "No yang spec");
         goto done;
@@ -724,6 +730,8 @@ xmldb_get_cache(clixon_handle     h,
         if (de)
             de0.de_id = de->de_id;
         clicon_db_elmnt_set(h, db, &de0); /* Content is copied */
+        if (xmldb_generation_bump(h, db) < 0)
+            goto done;
         /* Add default global values (to make xpath below include defaults) */
         // Alt:  xmldb_populate(h, db)
         if (xml_global_defaults(h, x0t, nsc, xpath, yspec, 0) < 0)
@@ -751,7 +759,26 @@ xmldb_get_cache(clixon_handle     h,
         goto done;
     xml_flag_set(x1t, XML_FLAG_TOP);
     xml_spec_set(x1t, xml_spec(x0t));
-    if (xlen < 1000){
+    if (xnacm != NULL){
+        /* Mark matches and their ancestors, and copy them omitting nodes the user may
+         * not read. Denied subtrees are not copied
+         */
+        for (i=0; i<xlen; i++){
+            x0 = xvec[i];
+            xml_flag_set(x0, XML_FLAG_MARK);
+            xml_apply_ancestor(x0, (xml_applyfn_t*)xml_flag_set, (void*)XML_FLAG_CHANGE);
+        }
+        ret = nacm_datanode_read_copy(h, x0t, x1t, username, xnacm);
+        /* Reset marks also on error, x0t is the shared cache */
+        for (i=0; i<xlen; i++){
+            x0 = xvec[i];
+            xml_flag_reset(x0, XML_FLAG_MARK);
+            xml_apply_ancestor(x0, (xml_applyfn_t*)xml_flag_reset, (void*)XML_FLAG_CHANGE);
+        }
+        if (ret < 0)
+            goto done;
+    }
+    else if (xlen < 1000){
         /* This is optimized for the case when the tree is large and xlen is small
          * If the tree is large and xlen too, then the other is better.
          * This only works if yang bind
@@ -772,10 +799,11 @@ xmldb_get_cache(clixon_handle     h,
             xml_flag_set(x0, XML_FLAG_MARK);
             xml_apply_ancestor(x0, (xml_applyfn_t*)xml_flag_set, (void*)XML_FLAG_CHANGE);
         }
-        if (xml_copy_marked(x0t, x1t) < 0) /* config */
-            goto done;
+        ret = xml_copy_marked(x0t, x1t); /* config */
         if (xml_apply(x0t, CX_ELMNT, (xml_applyfn_t*)xml_flag_reset, (void*)(XML_FLAG_MARK|XML_FLAG_CHANGE)) < 0)
             goto done;
+        if (ret < 0)
+            goto done;
         if (xml_apply(x1t, CX_ELMNT, (xml_applyfn_t*)xml_flag_reset, (void*)(XML_FLAG_MARK|XML_FLAG_CHANGE)) < 0)
             goto done;
     }
@@ -790,6 +818,7 @@ xmldb_get_cache(clixon_handle     h,
     retval = 1;
  done:
     clixon_debug(CLIXON_DBG_DATASTORE | CLIXON_DBG_DETAIL, "retval:%d", retval);
+    CLIXON_PROBE2(datastore__read__done, db, retval);
     if (xvec)
         free(xvec);
     return retval;
@@ -888,8 +917,8 @@ xmldb_get0(clixon_handle    h,
     cxobj *x = NULL;
 
     if (wdef != WITHDEFAULTS_EXPLICIT)
-        return xmldb_get_cache(h, db, yb, nsc, xpath, 0, xret, msdiff, xerr);
-    if ((ret = xmldb_get_cache(h, db, yb, nsc, xpath, 0, &x, msdiff, xerr)) < 0)
+        return xmldb_get_cache(h, db, yb, nsc, xpath, 0, NULL, NULL, xret, msdiff, xerr);
+    if ((ret = xmldb_get_cache(h, db, yb, nsc, xpath, 0, NULL, NULL, &x, msdiff, xerr)) < 0)
         goto done;
     if (ret == 0)
         goto fail;
@@ -906,3 +935,54 @@ xmldb_get0(clixon_handle    h,
     retval = 0;
     goto done;
 }
+
+/*! Get content of datastore with NACM read validation applied to the copy
+ *
+ * Nodes that the user may not read are omitted as the matching sub-trees are copied from
+ * the cache, instead of first being copied and then removed by nacm_datanode_read.
+ * @param[in]  h        Clixon handle
+ * @param[in]  db       Name of datastore, eg "running"
+ * @param[in]  nsc      External XML namespace context, or NULL
+ * @param[in]  xpath    String with XPath syntax. or NULL for all
+ * @param[in]  wdef     With-defaults parameter, see RFC 6243
+ * @param[in]  username User name for NACM read validation
+ * @param[in]  xnacm    NACM tree, see clicon_nacm_cache
+ * @param[out] xret     Single return XML tree. Free with xml_free()
+ * @retval     1        OK
+ * @retval     0        Parse OK but yang assigment not made (or only partial)
+ * @retval    -1        Error
+ * @see xmldb_get0
+ * @see nacm_datanode_read_copy
+ */
+int
+xmldb_get_nacm(clixon_handle     h,
+               const char       *db,
+               cvec             *nsc,
+               const char       *xpath,
+               withdefaults_type wdef,
+               char             *username,
+               cxobj            *xnacm,
+               cxobj           **xret)
+{
+    int    retval = -1;
+    int    ret;
+    cxobj *x = NULL;
+
+    if ((ret = xmldb_get_cache(h, db, YB_MODULE, nsc, xpath, 0, username, xnacm, &x, NULL, NULL)) < 0)
+        goto done;
+    if (ret == 0)
+        goto fail;
+    if (wdef == WITHDEFAULTS_EXPLICIT &&
+        xml_default_nopresence(x, 2, 0) < 0)
+        goto done;
+    *xret = x;
+    x = NULL;
+    retval = 1;
+ done:
+    if (x)
+        xml_free(x);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
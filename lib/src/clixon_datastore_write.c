@@ -84,6 +84,7 @@
 #include "clixon_datastore.h"
 #include "clixon_datastore_write.h"
 #include "clixon_datastore_read.h"
+#include "clixon_probe.h"
 
 /*! Given an attribute name and its expected namespace, find its value
  * 
@@ -1236,6 +1237,7 @@ xmldb_put(clixon_handle       h,
     cxobj      *xerr = NULL;
 
     clixon_debug(CLIXON_DBG_DATASTORE|CLIXON_DBG_DETAIL, "db %s", db);
+    CLIXON_PROBE2(datastore__write__start, db, (int)op);
     if (cbret == NULL){
         clixon_err(OE_XML, EINVAL, "cbret is NULL");
         goto done;
@@ -1314,12 +1316,15 @@ xmldb_put(clixon_handle       h,
         de0.de_xml = x0;
     de0.de_empty = (xml_child_nr(de0.de_xml) == 0);
     clicon_db_elmnt_set(h, db, &de0);
+    if (xmldb_generation_bump(h, db) < 0)
+        goto done;
     /* Write cache to file */
     if (xmldb_write_cache2file(h, db) < 0)
         goto done;
     retval = 1;
  done:
     clixon_debug(CLIXON_DBG_DATASTORE | CLIXON_DBG_DETAIL, "retval:%d", retval);
+    CLIXON_PROBE2(datastore__write__done, db, retval);
     if (xerr)
         xml_free(xerr);
     if (nsc)
@@ -108,14 +108,16 @@ static clixon_handle _err_clixon_h = NULL;
 /* Internal global list of category callbacks */
 static clixon_err_cats *_err_cat_list = NULL;
 
+/* Error state is per thread, eg parallel serialization and backend worker threads */
+
 /* See enum clixon_err XXX: hide this and change to err_category */
-static int  _err_category         = 0; 
+static __thread int  _err_category         = 0; 
 
 /* Corresponds to errno.h XXX: change to errno */
-static int  _err_subnr      = 0;
+static __thread int  _err_subnr      = 0;
 
 /* Clixon error reason */
-static char _err_reason[ERR_STRLEN] = {0, };
+static __thread char _err_reason[ERR_STRLEN] = {0, };
 
 /*
  * Error descriptions. Must stop with NULL element.
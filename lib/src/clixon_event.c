@@ -50,9 +50,14 @@
 #include <string.h>
 #include <signal.h>
 #include <syslog.h>
+#include <limits.h>
+#include <poll.h>
 #include <sys/param.h>
 #include <sys/types.h>
 #include <sys/time.h>
+#ifdef HAVE_EPOLL_CREATE1
+#include <sys/epoll.h>
+#endif
 
 #include <cligen/cligen.h>
 
@@ -73,27 +78,80 @@
  */
 #define EVENT_STRLEN 32
 
+/* Max number of ready file descriptors handled in one event loop iteration */
+#define EVENT_MAXREADY 64
+
+/* Polled events of a file descriptor */
+#ifdef HAVE_EPOLL_CREATE1
+#define EVENT_IN  EPOLLIN
+#define EVENT_OUT EPOLLOUT
+#define EVENT_ERR (EPOLLERR|EPOLLHUP)
+#else
+#define EVENT_IN  POLLIN
+#define EVENT_OUT POLLOUT
+#define EVENT_ERR (POLLERR|POLLHUP)
+#endif
+
 /*
  * Types
  */
 struct event_data{
-    struct event_data *e_next;     /* next in list */
+    struct event_data *e_next;     /* next in list of same fd */
     int (*e_fn)(int, void*);            /* function */
     enum {EVENT_FD, EVENT_TIME} e_type;        /* type of event */
     int e_fd;                      /* File descriptor */
     struct timeval e_time;         /* Timeout */
+    uint64_t e_seq;                /* Timeout: registration order, for equal timeouts */
+    int e_index;                   /* Timeout: position in timer heap */
     void *e_arg;                   /* function argument */
     char e_string[EVENT_STRLEN];             /* string for debugging */
 };
 
+/* Registered callbacks of one file descriptor, indexed by fd in ee_fds */
+struct event_fd{
+    struct event_data *ef_list;    /* Input callbacks, most recently registered first */
+    struct event_data *ef_wlist;   /* Output (write-ready) callbacks */
+    int                ef_events;  /* Polled events: EVENT_IN and/or EVENT_OUT, 0 if not polled */
+    int                ef_always;  /* Cannot be polled (eg regular file), always ready */
+#ifndef HAVE_EPOLL_CREATE1
+    int                ef_pollix;  /* Index in ee_pollfds */
+#endif
+};
+
 /*
  * Internal variables
  * XXX consider use handle variables instead of global
  */
-static struct event_data *ee = NULL;
-static struct event_data *ee_timers = NULL;
+/* File descriptor callbacks indexed by fd */
+static struct event_fd *ee_fds = NULL;
+static int              ee_fds_len = 0;
+
+/* Number of registered fds that cannot be polled and are always ready */
+static int ee_always = 0;
+
+/* Timeouts as a binary min-heap ordered by time and registration order */
+static struct event_data **ee_timers = NULL;
+static int                 ee_timers_len = 0;
+static int                 ee_timers_size = 0;
+static uint64_t            ee_timers_seq = 0;
+
+#ifdef HAVE_EPOLL_CREATE1
+/* Epoll instance for all registered file descriptors */
+static int ee_epfd = -1;
+#else
+/* Poll vector of all registered file descriptors */
+static struct pollfd *ee_pollfds = NULL;
+static int            ee_pollfds_len = 0;
+static int            ee_pollfds_size = 0;
+static int            ee_pollfds_start = 0; /* Rotate start of scan for fairness */
+#endif
+
+/* Ready fds of current event loop iteration, set to -1 if unregistered by callback */
+static int ee_ready[EVENT_MAXREADY];
+static int ee_ready_ev[EVENT_MAXREADY]; /* Returned events of ready fds */
+static int ee_nready = 0;
 
-/* Set if element in ee is deleted (clixon_event_unreg_fd). Check in ee loops */
+/* Set if a callback of an fd is deleted (clixon_event_unreg_fd). Check in dispatch loop */
 static int _ee_unreg = 0;
 
 /* If set (eg by signal handler) exit select loop on next run and return 0 */
@@ -166,6 +224,277 @@ clicon_sig_ignore_get(void)
     return _clicon_sig_ignore;
 }
 
+/*! Ensure fd table has a slot for fd
+ *
+ * @param[in]  fd  File descriptor
+ * @retval     0   OK
+ * @retval    -1   Error
+ */
+static int
+event_fds_grow(int fd)
+{
+    struct event_fd *ef;
+    int              len;
+
+    if (fd < ee_fds_len)
+        return 0;
+    len = ee_fds_len ? ee_fds_len : 64;
+    while (len <= fd)
+        len *= 2;
+    if ((ef = realloc(ee_fds, len*sizeof(*ef))) == NULL){
+        clixon_err(OE_EVENTS, errno, "realloc");
+        return -1;
+    }
+    memset(&ef[ee_fds_len], 0, (len-ee_fds_len)*sizeof(*ef));
+    ee_fds = ef;
+    ee_fds_len = len;
+    return 0;
+}
+
+/*! Update polled events of a file descriptor from its registered callbacks
+ *
+ * Start polling when the first callback is registered, stop when the last is removed, and
+ * poll for output only while there are output callbacks.
+ * If the fd cannot be polled, eg a regular file, it is marked as always ready, as
+ * select() would do.
+ * @param[in]  fd  File descriptor
+ * @retval     0   OK
+ * @retval    -1   Error
+ */
+static int
+event_fd_update(int fd)
+{
+    struct event_fd    *ef = &ee_fds[fd];
+    int                 events = 0;
+    int                 i;
+#ifdef HAVE_EPOLL_CREATE1
+    struct epoll_event  ev = {0,};
+    int                 op;
+#else
+    struct pollfd      *pfd;
+#endif
+
+    if (ef->ef_list)
+        events |= EVENT_IN;
+    if (ef->ef_wlist)
+        events |= EVENT_OUT;
+    if (events == ef->ef_events)
+        return 0;
+#ifdef HAVE_EPOLL_CREATE1
+    if (events == 0){
+        /* fd may already be closed, which removes it from epoll */
+        if (ee_epfd != -1 && !ef->ef_always)
+            epoll_ctl(ee_epfd, EPOLL_CTL_DEL, fd, NULL);
+    }
+    else if (!ef->ef_always){
+        if (ee_epfd == -1 &&
+            (ee_epfd = epoll_create1(EPOLL_CLOEXEC)) < 0){
+            clixon_err(OE_EVENTS, errno, "epoll_create1");
+            return -1;
+        }
+        ev.events = events;
+        ev.data.fd = fd;
+        op = ef->ef_events ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+        if (epoll_ctl(ee_epfd, op, fd, &ev) < 0){
+            if (errno == EPERM){ /* Regular file or directory */
+                ef->ef_always++;
+                ee_always++;
+            }
+            /* EEXIST/ENOENT: fd was closed and reused without unregistering callback */
+            else if ((errno == EEXIST || errno == ENOENT) &&
+                     epoll_ctl(ee_epfd, errno==EEXIST?EPOLL_CTL_MOD:EPOLL_CTL_ADD, fd, &ev) == 0)
+                ;
+            else {
+                clixon_err(OE_EVENTS, errno, "epoll_ctl");
+                return -1;
+            }
+        }
+    }
+#else
+    if (events == 0){
+        /* Move last entry into the hole */
+        i = ef->ef_pollix;
+        pfd = &ee_pollfds[--ee_pollfds_len];
+        if (i != ee_pollfds_len){
+            ee_pollfds[i] = *pfd;
+            ee_fds[pfd->fd].ef_pollix = i;
+        }
+    }
+    else if (ef->ef_events == 0){
+        if (ee_pollfds_len == ee_pollfds_size){
+            ee_pollfds_size = ee_pollfds_size ? 2*ee_pollfds_size : 64;
+            if ((pfd = realloc(ee_pollfds, ee_pollfds_size*sizeof(*pfd))) == NULL){
+                clixon_err(OE_EVENTS, errno, "realloc");
+                return -1;
+            }
+            ee_pollfds = pfd;
+        }
+        pfd = &ee_pollfds[ee_pollfds_len];
+        pfd->fd = fd;
+        pfd->events = events;
+        pfd->revents = 0;
+        ef->ef_pollix = ee_pollfds_len++;
+    }
+    else
+        ee_pollfds[ef->ef_pollix].events = events;
+#endif
+    ef->ef_events = events;
+    if (events == 0){
+        /* Not polled anymore: remove it from ready fds of current iteration */
+        if (ef->ef_always){
+            ef->ef_always = 0;
+            ee_always--;
+        }
+        for (i=0; i<ee_nready; i++)
+            if (ee_ready[i] == fd)
+                ee_ready[i] = -1;
+    }
+    return 0;
+}
+
+/*! Wait for input on file descriptors, or until timeout
+ *
+ * Set ee_ready to ready file descriptors and ee_ready_ev to their returned events
+ * @param[in]  timeout  Timeout in milliseconds, -1 is infinite
+ * @retval     n        Number of ready file descriptors, 0 on timeout
+ * @retval    -1        Error, errno set
+ */
+static int
+event_wait(int timeout)
+{
+    int                n = 0;
+    int                fd;
+#ifdef HAVE_EPOLL_CREATE1
+    struct epoll_event events[EVENT_MAXREADY];
+    int                i;
+
+    if (ee_always)
+        timeout = 0;
+    if (ee_epfd == -1){ /* No fds registered */
+        if (poll(NULL, 0, timeout) < 0)
+            return -1;
+    }
+    else {
+        if ((n = epoll_wait(ee_epfd, events, EVENT_MAXREADY, timeout)) < 0)
+            return -1;
+        for (i=0; i<n; i++){
+            ee_ready[i] = events[i].data.fd;
+            ee_ready_ev[i] = events[i].events;
+        }
+    }
+#else
+    int                i;
+    int                j;
+
+    if (ee_always)
+        timeout = 0;
+    if (poll(ee_pollfds, ee_pollfds_len, timeout) < 0)
+        return -1;
+    /* Rotate start so that low entries do not starve others if more than max is ready */
+    if (ee_pollfds_start >= ee_pollfds_len)
+        ee_pollfds_start = 0;
+    for (i=0; i<ee_pollfds_len && n<EVENT_MAXREADY; i++){
+        j = (ee_pollfds_start + i) % ee_pollfds_len;
+        if (ee_pollfds[j].revents != 0){
+            ee_ready[n] = ee_pollfds[j].fd;
+            ee_ready_ev[n++] = ee_pollfds[j].revents;
+        }
+    }
+    ee_pollfds_start++;
+#endif
+    /* Add fds that cannot be polled */
+    for (fd=0; ee_always && fd<ee_fds_len && n<EVENT_MAXREADY; fd++)
+        if (ee_fds[fd].ef_always){
+            ee_ready[n] = fd;
+            ee_ready_ev[n++] = ee_fds[fd].ef_events;
+        }
+    ee_nready = n;
+    return n;
+}
+
+/*! Add a callback to the input or output callback list of a file descriptor
+ *
+ * @param[in]  fd   File descriptor
+ * @param[in]  fn   Function to call when fd is ready
+ * @param[in]  arg  Argument to function fn
+ * @param[in]  str  Describing string for logging
+ * @param[in]  out  0: call fn on input, 1: call fn when fd is ready for output
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+static int
+event_reg_fd(int   fd,
+             int (*fn)(int, void*),
+             void *arg,
+             char *str,
+             int   out)
+{
+    struct event_data  *e;
+    struct event_data **elist;
+
+    if (fd < 0){
+        clixon_err(OE_EVENTS, EBADF, "fd %d", fd);
+        return -1;
+    }
+    if (event_fds_grow(fd) < 0)
+        return -1;
+    if ((e = (struct event_data *)malloc(sizeof(struct event_data))) == NULL){
+        clixon_err(OE_EVENTS, errno, "malloc");
+        return -1;
+    }
+    memset(e, 0, sizeof(struct event_data));
+    strncpy(e->e_string, str, EVENT_STRLEN-1);
+    e->e_fd = fd;
+    e->e_fn = fn;
+    e->e_arg = arg;
+    e->e_type = EVENT_FD;
+    elist = out ? &ee_fds[fd].ef_wlist : &ee_fds[fd].ef_list;
+    e->e_next = *elist;
+    *elist = e;
+    if (event_fd_update(fd) < 0){
+        *elist = e->e_next;
+        free(e);
+        return -1;
+    }
+    clixon_debug(CLIXON_DBG_EVENT | CLIXON_DBG_DETAIL, "registering %s", e->e_string);
+    return 0;
+}
+
+/*! Remove a callback from the input or output callback list of a file descriptor
+ *
+ * @param[in]  s    File descriptor
+ * @param[in]  fn   Function to remove
+ * @param[in]  out  0: input callback, 1: output callback
+ * @retval     0    OK
+ * @retval    -1    Error, not found
+ */
+static int
+event_unreg_fd(int   s,
+               int (*fn)(int, void*),
+               int   out)
+{
+    struct event_data  *e;
+    struct event_data **e_prev;
+    int                 found = 0;
+
+    if (s < 0 || s >= ee_fds_len)
+        return -1;
+    e_prev = out ? &ee_fds[s].ef_wlist : &ee_fds[s].ef_list;
+    for (e = *e_prev; e; e = e->e_next){
+        if (fn == e->e_fn) {
+            found++;
+            *e_prev = e->e_next;
+            _ee_unreg++;
+            free(e);
+            break;
+        }
+        e_prev = &e->e_next;
+    }
+    if (found && event_fd_update(s) < 0)
+        return -1;
+    return found?0:-1;
+}
+
 /*! Register a callback function to be called on input on a file descriptor.
  *
  * @param[in]  fd  File descriptor
@@ -176,8 +505,9 @@ clicon_sig_ignore_get(void)
  * int fn(int fd, void *arg){
  * }
  * clixon_event_reg_fd(fd, fn, (void*)42, "call fn on input on fd");
- * @endcode 
+ * @endcode
  * @see clixon_event_unreg_fd
+ * @see clixon_event_reg_fd_write  for output
  */
 int
 clixon_event_reg_fd(int   fd,
@@ -185,22 +515,7 @@ clixon_event_reg_fd(int   fd,
                     void *arg,
                     char *str)
 {
-    struct event_data *e;
-
-    if ((e = (struct event_data *)malloc(sizeof(struct event_data))) == NULL){
-        clixon_err(OE_EVENTS, errno, "malloc");
-        return -1;
-    }
-    memset(e, 0, sizeof(struct event_data));
-    strncpy(e->e_string, str, EVENT_STRLEN-1);
-    e->e_fd = fd;
-    e->e_fn = fn;
-    e->e_arg = arg;
-    e->e_type = EVENT_FD;
-    e->e_next = ee;
-    ee = e;
-    clixon_debug(CLIXON_DBG_EVENT | CLIXON_DBG_DETAIL, "registering %s", e->e_string);
-    return 0;
+    return event_reg_fd(fd, fn, arg, str, 0);
 }
 
 /*! Deregister a file descriptor callback
@@ -217,22 +532,109 @@ int
 clixon_event_unreg_fd(int   s,
                       int (*fn)(int, void*))
 {
-    struct event_data      *e;
-        struct event_data **e_prev;
-    int                found = 0;
+    return event_unreg_fd(s, fn, 0);
+}
+
+/*! Register a callback function to be called when a file descriptor is ready for output
+ *
+ * Typically registered by a writer on a non-blocking socket when a write is incomplete,
+ * and deregistered by the callback when all pending output is written.
+ * The callback is also called on error or hangup of the fd.
+ * @param[in]  fd  File descriptor
+ * @param[in]  fn  Function to call when fd is ready for output
+ * @param[in]  arg Argument to function fn
+ * @param[in]  str Describing string for logging
+ * @retval     0   OK
+ * @retval    -1   Error
+ * @see clixon_event_unreg_fd_write
+ */
+int
+clixon_event_reg_fd_write(int   fd,
+                          int (*fn)(int, void*),
+                          void *arg,
+                          char *str)
+{
+    return event_reg_fd(fd, fn, arg, str, 1);
+}
 
-    e_prev = &ee;
-    for (e = ee; e; e = e->e_next){
-        if (fn == e->e_fn && s == e->e_fd) {
-            found++;
-            *e_prev = e->e_next;
-            _ee_unreg++;
-            free(e);
+/*! Deregister a file descriptor output callback
+ *
+ * @param[in]  s   File descriptor
+ * @param[in]  fn  Function to call when fd is ready for output
+ * @retval     0   OK
+ * @retval    -1   Error
+ * @see clixon_event_reg_fd_write
+ */
+int
+clixon_event_unreg_fd_write(int   s,
+                            int (*fn)(int, void*))
+{
+    return event_unreg_fd(s, fn, 1);
+}
+
+/*! Compare two timeouts: first by time, then by registration order
+ */
+static inline int
+event_timer_lt(struct event_data *e1,
+               struct event_data *e2)
+{
+    if (timercmp(&e1->e_time, &e2->e_time, !=))
+        return timercmp(&e1->e_time, &e2->e_time, <);
+    return e1->e_seq < e2->e_seq;
+}
+
+/*! Place timeout at position i in heap
+ */
+static inline void
+event_timer_set(int                i,
+                struct event_data *e)
+{
+    ee_timers[i] = e;
+    e->e_index = i;
+}
+
+/*! Restore heap order by moving timeout at position i up or down
+ *
+ * @param[in]  i  Position in heap
+ */
+static void
+event_timer_sift(int i)
+{
+    struct event_data *e = ee_timers[i];
+    int                c;
+
+    /* Up */
+    while (i > 0 && event_timer_lt(e, ee_timers[(i-1)/2])){
+        event_timer_set(i, ee_timers[(i-1)/2]);
+        i = (i-1)/2;
+    }
+    /* Down */
+    while ((c = 2*i+1) < ee_timers_len){
+        if (c+1 < ee_timers_len && event_timer_lt(ee_timers[c+1], ee_timers[c]))
+            c++;
+        if (!event_timer_lt(ee_timers[c], e))
             break;
-        }
-        e_prev = &e->e_next;
+        event_timer_set(i, ee_timers[c]);
+        i = c;
     }
-    return found?0:-1;
+    event_timer_set(i, e);
+}
+
+/*! Remove timeout at position i from heap
+ *
+ * @param[in]  i  Position in heap
+ * @retval     e  Removed timeout, not freed
+ */
+static struct event_data *
+event_timer_remove(int i)
+{
+    struct event_data *e = ee_timers[i];
+
+    if (i != --ee_timers_len){
+        event_timer_set(i, ee_timers[ee_timers_len]);
+        event_timer_sift(i);
+    }
+    return e;
 }
 
 /*! Call a callback function at an absolute time
@@ -250,30 +652,38 @@ clixon_event_unreg_fd(int   s,
  *   t1.tv_sec = 1; t1.tv_usec = 0;
  *   timeradd(&t, &t1, &t);
  *   clixon_event_reg_timeout(t, fn, NULL, "call every second");
- * } 
- * @endcode 
- * 
+ * }
+ * @endcode
+ *
  * @note  The timestamp is an absolute timestamp, not relative.
  * @note  The callback is not periodic, you need to make a new registration for each period, see example.
  * @note  The first argument to fn is a dummy, just to get the same signature as for file-descriptor callbacks.
+ * @note  Timeouts with equal time are called in registration order
  * @see clixon_event_reg_fd
  * @see clixon_event_unreg_timeout
  */
 int
-clixon_event_reg_timeout(struct timeval t, 
+clixon_event_reg_timeout(struct timeval t,
                          int          (*fn)(int, void*),
                          void          *arg,
                          char          *str)
 {
     int                 retval = -1;
     struct event_data  *e;
-    struct event_data  *e1;
-    struct event_data **e_prev;
+    struct event_data **vec;
 
     if (str == NULL || fn == NULL){
         clixon_err(OE_CFG, EINVAL, "str or fn is NULL");
         goto done;
     }
+    if (ee_timers_len == ee_timers_size){
+        ee_timers_size = ee_timers_size ? 2*ee_timers_size : 16;
+        if ((vec = realloc(ee_timers, ee_timers_size*sizeof(*vec))) == NULL){
+            clixon_err(OE_EVENTS, errno, "realloc");
+            goto done;
+        }
+        ee_timers = vec;
+    }
     if ((e = (struct event_data *)malloc(sizeof(struct event_data))) == NULL){
         clixon_err(OE_EVENTS, errno, "malloc");
         return -1;
@@ -284,15 +694,10 @@ clixon_event_reg_timeout(struct timeval t,
     e->e_arg = arg;
     e->e_type = EVENT_TIME;
     e->e_time = t;
-    /* Sort into right place */
-    e_prev = &ee_timers;
-    for (e1=ee_timers; e1; e1=e1->e_next){
-        if (timercmp(&e->e_time, &e1->e_time, <))
-            break;
-        e_prev = &e1->e_next;
-    }
-    e->e_next = e1;
-    *e_prev = e;
+    e->e_seq = ee_timers_seq++;
+    /* Insert last in heap and sift up into right place */
+    event_timer_set(ee_timers_len++, e);
+    event_timer_sift(e->e_index);
     clixon_debug(CLIXON_DBG_EVENT | CLIXON_DBG_DETAIL, "%s", str);
     retval = 0;
  done:
@@ -304,6 +709,7 @@ clixon_event_reg_timeout(struct timeval t,
  * Note: deregister when exactly function and function arguments match, not time. So you
  * cannot have same function and argument callback on different timeouts. This is a little
  * different from clixon_event_unreg_fd.
+ * If several match, the one with the earliest timeout is deregistered.
  * @param[in]  fn   Function to call at time t
  * @param[in]  arg  Argument to function fn
  * @retval     0    OK, timeout unregistered
@@ -315,20 +721,75 @@ int
 clixon_event_unreg_timeout(int (*fn)(int, void*),
                            void *arg)
 {
-    struct event_data *e, **e_prev;
-    int found = 0;
+    struct event_data *e;
+    struct event_data *efound = NULL;
+    int                i;
+
+    for (i=0; i<ee_timers_len; i++){
+        e = ee_timers[i];
+        if (fn == e->e_fn && arg == e->e_arg &&
+            (efound == NULL || event_timer_lt(e, efound)))
+            efound = e;
+    }
+    if (efound == NULL)
+        return -1;
+    event_timer_remove(efound->e_index);
+    free(efound);
+    return 0;
+}
 
-    e_prev = &ee_timers;
-    for (e = ee_timers; e; e = e->e_next){
-        if (fn == e->e_fn && arg == e->e_arg) {
-            found++;
-            *e_prev = e->e_next;
-            free(e);
+/*! Call all expired timeouts
+ *
+ * Only timeouts registered before the call are considered, so that a callback
+ * re-registering itself with an expired time does not loop.
+ * @retval     0    OK
+ * @retval    -1    Error in callback
+ */
+static int
+event_timeouts(void)
+{
+    struct event_data *e;
+    struct timeval     t0;
+    uint64_t           seq = ee_timers_seq;
+
+    gettimeofday(&t0, NULL);
+    while (ee_timers_len > 0 &&
+           (e = ee_timers[0]) != NULL &&
+           timercmp(&e->e_time, &t0, <=) &&
+           e->e_seq < seq){
+        if (clixon_exit_get() == 1)
             break;
+        event_timer_remove(0);
+        clixon_debug(CLIXON_DBG_EVENT | CLIXON_DBG_DETAIL, "timeout: %s", e->e_string);
+        if ((*e->e_fn)(0, e->e_arg) < 0){
+            free(e);
+            return -1;
         }
-        e_prev = &e->e_next;
+        free(e);
     }
-    return found?0:-1;
+    return 0;
+}
+
+/*! Milliseconds to wait until first timeout, rounded up
+ *
+ * @retval     ms   Milliseconds, 0 if expired
+ * @retval    -1    No timeouts, wait forever
+ */
+static int
+event_timeout_ms(void)
+{
+    struct timeval t;
+    struct timeval t0;
+
+    if (ee_timers_len == 0)
+        return -1;
+    gettimeofday(&t0, NULL);
+    timersub(&ee_timers[0]->e_time, &t0, &t);
+    if (t.tv_sec < 0)
+        return 0;
+    if (t.tv_sec >= INT_MAX/1000 - 1)
+        return INT_MAX;
+    return t.tv_sec*1000 + (t.tv_usec+999)/1000;
 }
 
 /*! Poll to see if there is any data available on this file descriptor.
@@ -341,59 +802,72 @@ clixon_event_unreg_timeout(int (*fn)(int, void*),
 int
 clixon_event_poll(int fd)
 {
-    int            retval = -1;
-    fd_set         fdset;
-    struct timeval tnull = {0,};
-
-    FD_ZERO(&fdset);
-    FD_SET(fd, &fdset);
-    if ((retval = select(FD_SETSIZE, &fdset, NULL, NULL, &tnull)) < 0)
-        clixon_err(OE_EVENTS, errno, "select");
+    int           retval = -1;
+    struct pollfd pfd = {0,};
+
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    if ((retval = poll(&pfd, 1, 0)) < 0)
+        clixon_err(OE_EVENTS, errno, "poll");
     return retval;
 }
 
+/*! Call callbacks of a ready file descriptor
+ *
+ * Stop if a callback is deregistered, since the list may have changed
+ * @param[in]  elist  Input or output callback list of fd
+ * @retval     0      OK
+ * @retval    -1      Error in callback
+ */
+static int
+event_fd_call(struct event_data *elist)
+{
+    struct event_data *e;
+    struct event_data *e_next;
+
+    _ee_unreg = 0;
+    for (e=elist; e; e=e_next){
+        e_next = e->e_next;
+        clixon_debug(CLIXON_DBG_EVENT | CLIXON_DBG_DETAIL, "ready: %s", e->e_string);
+        if ((*e->e_fn)(e->e_fd, e->e_arg) < 0){
+            clixon_debug(CLIXON_DBG_EVENT, "Error in: %s", e->e_string);
+            return -1;
+        }
+        if (_ee_unreg){ /* List of fd may have changed */
+            _ee_unreg = 0;
+            break;
+        }
+    }
+    return 0;
+}
+
 /*! Dispatch file descriptor events (and timeouts) by invoking callbacks.
  *
+ * Expired timeouts are called in every iteration before file descriptor callbacks, so
+ * that a socket with continuous input does not starve timeouts.
+ * File descriptors are waited for using epoll if available, otherwise poll. Neither is
+ * limited by FD_SETSIZE.
  * @param[in] h  Clixon handle
  * @retval    0  OK
- * @retval   -1  Error: eg select, callback, timer, 
- * @note There is an issue with fairness between timeouts and events
- *       Currently a socket that is not read/emptied properly starve timeouts.
- *       One could try to poll the file descriptors after a timeout?
+ * @retval   -1  Error: eg select, callback, timer,
  */
 int
 clixon_event_loop(clixon_handle h)
 {
-    struct event_data *e;
-    struct event_data *e_next;
     int                n;
-    struct timeval     t;
-    struct timeval     t0;
-    struct timeval     tnull = {0,};
-    fd_set             fdset;
+    int                i;
+    int                fd;
     int                retval = -1;
 
     while (clixon_exit_get() != 1){
-        FD_ZERO(&fdset);
         if (clicon_sig_child_get()){
             /* Go through processes and wait for child processes */
             if (clixon_process_waitpid(h) < 0)
                 goto err;
             clicon_sig_child_set(0);
         }
-        for (e=ee; e; e=e->e_next)
-            if (e->e_type == EVENT_FD)
-                FD_SET(e->e_fd, &fdset);
-        if (ee_timers != NULL){
-            gettimeofday(&t0, NULL);
-            timersub(&ee_timers->e_time, &t0, &t);
-            if (t.tv_sec < 0)
-                n = select(FD_SETSIZE, &fdset, NULL, NULL, &tnull);
-            else
-                n = select(FD_SETSIZE, &fdset, NULL, NULL, &t);
-        }
-        else
-            n = select(FD_SETSIZE, &fdset, NULL, NULL, NULL);
+        ee_nready = 0;
+        n = event_wait(event_timeout_ms());
         if (clixon_exit_get() == 1){
             break;
         }
@@ -409,9 +883,9 @@ clixon_event_loop(clixon_handle h)
                  *     New select loop is called
                  * (3) Other signals result in an error and return -1.
                  */
-                clixon_debug(CLIXON_DBG_EVENT | CLIXON_DBG_DETAIL, "select: %s", strerror(errno));
+                clixon_debug(CLIXON_DBG_EVENT | CLIXON_DBG_DETAIL, "wait: %s", strerror(errno));
                 if (clixon_exit_get() == 1){
-                    clixon_err(OE_EVENTS, errno, "select");
+                    clixon_err(OE_EVENTS, errno, "wait");
                     retval = 0;
                 }
                 else if (clicon_sig_child_get()){
@@ -426,46 +900,39 @@ clixon_event_loop(clixon_handle h)
                     continue;
                 }
                 else
-                    clixon_err(OE_EVENTS, errno, "select");
+                    clixon_err(OE_EVENTS, errno, "wait");
             }
             else
-                clixon_err(OE_EVENTS, errno, "select");
+                clixon_err(OE_EVENTS, errno, "wait");
             goto err;
         }
-        if (n==0){ /* Timeout */
-            e = ee_timers;
-            ee_timers = ee_timers->e_next;
-            clixon_debug(CLIXON_DBG_EVENT | CLIXON_DBG_DETAIL, "timeout: %s", e->e_string);
-            if ((*e->e_fn)(0, e->e_arg) < 0){
-                free(e);
-                goto err;
-            }
-            free(e);
-        }
-        _ee_unreg = 0;
-        for (e=ee; e; e=e_next){
+        /* Timeouts, also if fds are ready */
+        if (event_timeouts() < 0)
+            goto err;
+        for (i=0; i<ee_nready; i++){
             if (clixon_exit_get() == 1){
                 break;
             }
-            e_next = e->e_next;
-            if(e->e_type == EVENT_FD && FD_ISSET(e->e_fd, &fdset)){
-                clixon_debug(CLIXON_DBG_EVENT | CLIXON_DBG_DETAIL, "FD_ISSET: %s", e->e_string);
-                if ((*e->e_fn)(e->e_fd, e->e_arg) < 0){
-                    clixon_debug(CLIXON_DBG_EVENT, "Error in: %s", e->e_string);
-                    goto err;
-                }
-                if (_ee_unreg){
-                    _ee_unreg = 0;
-                    break;
-                }
-            }
+            if ((fd = ee_ready[i]) < 0) /* Unregistered by earlier callback */
+                continue;
+            /* Output first, so that input callbacks may queue more output */
+            if ((ee_ready_ev[i] & (EVENT_OUT|EVENT_ERR)) &&
+                event_fd_call(ee_fds[fd].ef_wlist) < 0)
+                goto err;
+            if (ee_ready[i] < 0) /* Unregistered by output callback */
+                continue;
+            if ((ee_ready_ev[i] & ~EVENT_OUT) &&
+                event_fd_call(ee_fds[fd].ef_list) < 0)
+                goto err;
         }
+        ee_nready = 0;
         clixon_exit_decr(); /* If exit is set and > 1, decrement it (and exit when 1) */
         continue;
       err:
         clixon_debug(CLIXON_DBG_EVENT, "err");
         break;
     }
+    ee_nready = 0;
     if (clixon_exit_get() == 1)
         retval = 0;
     clixon_debug(CLIXON_DBG_EVENT, "retval:%d", retval);
@@ -476,18 +943,44 @@ int
 clixon_event_exit(void)
 {
     struct event_data *e, *e_next;
+    int                fd;
+    int                i;
 
-    e_next = ee;
-    while ((e = e_next) != NULL){
-        e_next = e->e_next;
-        free(e);
-    }
-    ee = NULL;
-    e_next = ee_timers;
-    while ((e = e_next) != NULL){
-        e_next = e->e_next;
-        free(e);
+    for (fd=0; fd<ee_fds_len; fd++){
+        e_next = ee_fds[fd].ef_list;
+        while ((e = e_next) != NULL){
+            e_next = e->e_next;
+            free(e);
+        }
+        e_next = ee_fds[fd].ef_wlist;
+        while ((e = e_next) != NULL){
+            e_next = e->e_next;
+            free(e);
+        }
     }
+    if (ee_fds)
+        free(ee_fds);
+    ee_fds = NULL;
+    ee_fds_len = 0;
+    ee_always = 0;
+    for (i=0; i<ee_timers_len; i++)
+        free(ee_timers[i]);
+    if (ee_timers)
+        free(ee_timers);
     ee_timers = NULL;
+    ee_timers_len = 0;
+    ee_timers_size = 0;
+#ifdef HAVE_EPOLL_CREATE1
+    if (ee_epfd != -1)
+        close(ee_epfd);
+    ee_epfd = -1;
+#else
+    if (ee_pollfds)
+        free(ee_pollfds);
+    ee_pollfds = NULL;
+    ee_pollfds_len = 0;
+    ee_pollfds_size = 0;
+#endif
+    ee_nready = 0;
     return 0;
 }
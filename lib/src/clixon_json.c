@@ -83,7 +83,7 @@
 */
 #define VEC_ARRAY 1
 
-/* Size of json read buffer when reading from file*/
+/* Initial size of json read buffer when reading from file*/
 #define BUFLEN 1024
 
 /* Name of xml top object created by parse functions */
@@ -115,6 +115,7 @@ enum childtype{
 static enum childtype
 child_type(cxobj *x)
 {
+    int    inext;
     cxobj *xc;   /* the only child of x */
     int    clen; /* nr of children */
 
@@ -126,8 +127,8 @@ child_type(cxobj *x)
     if (clen > 1)
         return ANY_CHILD;
     /* From here exactly one noattr child, get it */
-    xc = NULL;
-    while ((xc = xml_child_each(x, xc, -1)) != NULL)
+    inext = 0;
+    while ((xc = xml_child_iter(x, &inext, -1)) != NULL)
         if (xml_type(xc) != CX_ATTR)
             break;
     if (xc == NULL)
@@ -244,6 +245,7 @@ array_eval(cxobj *xprev,
 
 /*! Escape a json string as well as decode xml cdata
  *
+ * Runs of characters not needing escape are found with strcspn() and appended as blocks
  * @param[out] cb   cbuf   (encoded)
  * @param[in]  str  string (unencoded)
  * @retval     0    OK
@@ -253,37 +255,43 @@ json_str_escape_cdata(cbuf *cb,
                       char *str)
 {
     int    retval = -1;
-    size_t len;
-    int    i;
+    size_t n;
+    char  *esc;
 
-    len = strlen(str);
-    for (i=0; i<len; i++)
-        switch (str[i]){
+    while (1){
+        n = strcspn(str, "\"\\\b\f\n\r\t");
+        if (n)
+            cbuf_append_buf(cb, str, n);
+        str += n;
+        switch (*str){
+        case '\0':
+            goto ok;
         case '\"':
-            cprintf(cb, "\\\"");
+            esc = "\\\"";
             break;
         case '\\':
-            cprintf(cb, "\\\\");
+            esc = "\\\\";
             break;
         case '\b':
-            cprintf(cb, "\\b");
+            esc = "\\b";
             break;
         case '\f':
-            cprintf(cb, "\\f");
+            esc = "\\f";
             break;
         case '\n':
-            cprintf(cb, "\\n");
+            esc = "\\n";
             break;
         case '\r':
-            cprintf(cb, "\\r");
-            break;
-        case '\t':
-            cprintf(cb, "\\t");
+            esc = "\\r";
             break;
-        default: /* fall thru */
-            cprintf(cb, "%c", str[i]);
+        default: /* '\t' */
+            esc = "\\t";
             break;
         }
+        cbuf_append_str(cb, esc);
+        str++;
+    }
+ ok:
     retval = 0;
     // done:
     return retval;
@@ -409,6 +417,7 @@ int
 json2xml_decode(cxobj     *x,
                 cxobj    **xerr)
 {
+    int           inext;
     int           retval = -1;
     yang_stmt    *y;
     enum rfc_6020 keyword;
@@ -434,8 +443,8 @@ json2xml_decode(cxobj     *x,
             }
         }
     }
-    xc = NULL;
-    while ((xc = xml_child_each(x, xc, CX_ELMNT)) != NULL){
+    inext = 0;
+    while ((xc = xml_child_iter(x, &inext, CX_ELMNT)) != NULL){
         if ((ret = json2xml_decode(xc, xerr)) < 0)
             goto done;
         if (ret == 0)
@@ -1146,13 +1155,14 @@ clixon_json2cbuf(cbuf  *cb,
                  int    skiptop,
                  int    autocliext)
 {
+    int    inext;
     int    retval = -1;
     cxobj *xc;
     int    i=0;
 
     if (skiptop){
-        xc = NULL;
-        while ((xc = xml_child_each(xt, xc, CX_ELMNT)) != NULL){
+        inext = 0;
+        while ((xc = xml_child_iter(xt, &inext, CX_ELMNT)) != NULL){
             if (i++)
                 cprintf(cb, ",");
             if (xml2json_cbuf1(cb, xc, pretty, autocliext) < 0)
@@ -1190,6 +1200,7 @@ xml2json_cbuf_vec(cbuf      *cb,
                   int        pretty,
                   int        skiptop)
 {
+    int    inext;
     int    retval = -1;
     int    level = 0;
     cxobj *xp = NULL;
@@ -1208,7 +1219,8 @@ xml2json_cbuf_vec(cbuf      *cb,
             goto done;
         if (skiptop){
             cxobj *x = NULL;
-            while ((x = xml_child_each(xc0, x, CX_ELMNT)) != NULL) {
+            inext = 0;
+            while ((x = xml_child_iter(xc0, &inext, CX_ELMNT)) != NULL) {
                 if ((xc = xml_dup(x)) == NULL)
                     goto done;
                 xml_addsub(xp, xc);
@@ -1349,77 +1361,11 @@ xml2json_vec(FILE             *f,
     return retval;
 }
 
-/*! Translate from JSON module:name to XML default ns: xmlns="uri" recursively
- *
- * Assume an xml tree where prefix:name have been split into "module":"name"
- * In other words, from JSON to XML namespace trees
- * 
- * @param[in]     yspec Yang spec
- * @param[in,out] x     XML tree. Translate it in-line
- * @param[out]    xerr  Reason for invalid tree returned as netconf err msg or NULL
- * @retval        1     OK 
- * @retval        0     Invalid, wrt namespace.  xerr set
- * @retval       -1     Error
- * @note the opposite - xml2ns is made inline in xml2json1_cbuf
- * Example: <top><module:input> --> <top><input xmlns="">
- * @see RFC7951 Sec 4
- */
-static int
-json_xmlns_translate(yang_stmt *yspec,
-                     cxobj     *x,
-                     cxobj    **xerr)
-{
-    int        retval = -1;
-    yang_stmt *ymod;
-    char      *namespace;
-    char      *modname = NULL;
-    cxobj     *xc;
-    int        ret;
-
-    if ((modname = xml_prefix(x)) != NULL){ /* prefix is here module name */
-        /* Special case for ietf-netconf -> ietf-restconf translation
-         * A special case is for return data on the form {"data":...}
-         * See also xml2json1_cbuf
-         */
-        if (strcmp(modname, "ietf-restconf") == 0)
-            modname = "ietf-netconf";
-        if ((ymod = yang_find_module_by_name(yspec, modname)) == NULL){
-            if (xerr &&
-                netconf_unknown_namespace_xml(xerr, "application",
-                                              modname,
-                                              "No yang module found corresponding to prefix") < 0)
-                goto done;
-            goto fail;
-        }
-        namespace = yang_find_mynamespace(ymod);
-        /* It would be possible to use canonical prefixes here, but probably not
-         * necessary or even right. Therefore, the namespace given by the JSON prefix / module
-         * is always the default namespace with prefix NULL.
-         * If not, this would be the prefix to pass instead of NULL
-         * prefix = yang_find_myprefix(ymod);
-         */
-        if (xml_namespace_change(x, namespace, NULL) < 0)
-            goto done;
-    }
-    xc = NULL;
-    while ((xc = xml_child_each(x, xc, CX_ELMNT)) != NULL){
-        if ((ret = json_xmlns_translate(yspec, xc, xerr)) < 0)
-            goto done;
-        if (ret == 0)
-            goto fail;
-    }
-    retval = 1;
- done:
-    return retval;
- fail:
-    retval = 0;
-    goto done;
-}
-
 /*! Parse a string containing JSON and return an XML tree
  *
  * Parsing using yacc according to JSON syntax. Names with <prefix>:<id>
- * are split and interpreted as in RFC7951
+ * are split and interpreted as in RFC7951, ie the module name is translated to
+ * a namespace as each node is created.
  *
  * @param[in]  str    Input string containing JSON
  * @param[in]  rfc7951 Do sanity checks according to RFC 7951 JSON Encoding of Data Modeled with YANG
@@ -1456,6 +1402,8 @@ _json_parse(char      *str,
     jy.jy_linenum = 1;
     jy.jy_current = xt;
     jy.jy_xtop = xt;
+    jy.jy_yspec = yspec;
+    jy.jy_xerr = xerr;
     if (json_scan_init(&jy) < 0)
         goto done;
     if (json_parse_init(&jy) < 0)
@@ -1485,11 +1433,12 @@ _json_parse(char      *str,
                 goto fail;
             }
         }
-        /* Names are split into name/prefix, but now add namespace info */
-        if ((ret = json_xmlns_translate(yspec, x, xerr)) < 0)
-            goto done;
-        if (ret == 0)
-            goto fail;
+    }
+    /* Names were split into name/prefix and translated to namespaces by the parser */
+    if (jy.jy_invalid)
+        goto fail;
+    for (i = 0; i < jy.jy_xlen; i++) {
+        x = jy.jy_xvec[i];
         /* Now assign yang stmts to each XML node 
          * XXX should be xml_bind_yang0_parent() sometimes.
          */
@@ -1637,11 +1586,9 @@ clixon_json_parse_file(FILE      *fp,
     int       retval = -1;
     int       ret;
     char     *jsonbuf = NULL;
-    int       jsonbuflen = BUFLEN; /* start size */
-    int       oldjsonbuflen;
-    char     *ptr;
-    char      ch;
-    int       len = 0;
+    size_t    jsonbuflen = BUFLEN; /* start size */
+    size_t    len = 0;
+    size_t    n;
 
     if (xt==NULL){
         clixon_err(OE_JSON, EINVAL, "xt is NULL");
@@ -1651,38 +1598,31 @@ clixon_json_parse_file(FILE      *fp,
         clixon_err(OE_JSON, errno, "malloc");
         goto done;
     }
-    memset(jsonbuf, 0, jsonbuflen);
-    ptr = jsonbuf;
-    while (1){
-        if ((ret = fread(&ch, 1, 1, fp)) < 0){
-            clixon_err(OE_JSON, errno, "read");
-            break;
-        }
-        if (ret != 0)
-            jsonbuf[len++] = ch;
-        if (ret == 0){
-            if (*xt == NULL)
-                if ((*xt = xml_new(JSON_TOP_SYMBOL, NULL, CX_ELMNT)) == NULL)
-                    goto done;
-            if (len){
-                if ((ret = _json_parse(ptr, rfc7951, yb, yspec, *xt, xerr)) < 0)
-                    goto done;
-                if (ret == 0)
-                    goto fail;
-            }
-            break;
-        }
-        if (len >= jsonbuflen-1){ /* Space: one for the null character */
-            oldjsonbuflen = jsonbuflen;
+    /* Read in blocks, not byte by byte. Space: one for the null character */
+    while ((n = fread(jsonbuf+len, 1, jsonbuflen-len-1, fp)) > 0){
+        len += n;
+        if (len >= jsonbuflen-1){
             jsonbuflen *= 2;
             if ((jsonbuf = realloc(jsonbuf, jsonbuflen)) == NULL){
                 clixon_err(OE_JSON, errno, "realloc");
                 goto done;
             }
-            memset(jsonbuf+oldjsonbuflen, 0, jsonbuflen-oldjsonbuflen);
-            ptr = jsonbuf;
         }
     }
+    if (ferror(fp)){
+        clixon_err(OE_JSON, errno, "read");
+        goto done;
+    }
+    jsonbuf[len] = '\0';
+    if (*xt == NULL)
+        if ((*xt = xml_new(JSON_TOP_SYMBOL, NULL, CX_ELMNT)) == NULL)
+            goto done;
+    if (len){
+        if ((ret = _json_parse(jsonbuf, rfc7951, yb, yspec, *xt, xerr)) < 0)
+            goto done;
+        if (ret == 0)
+            goto fail;
+    }
     retval = 1;
  done:
     if (retval < 0 && *xt){
@@ -49,6 +49,10 @@ struct clixon_json_yacc {
     cxobj    **jy_xvec;         /* Vector of created top-level nodes (to know which are created) */
     int        jy_xlen;         /* Length of jy_xvec */
     cbuf      *jy_cbuf_str;     /* cbuf used for strings, if error needs to be deallocated */
+    yang_stmt *jy_yspec;        /* Yang spec for module:name -> namespace translation */
+    yang_stmt *jy_ymod;         /* Cache of last module looked up by name */
+    cxobj    **jy_xerr;         /* Netconf error of first invalid module name, or NULL */
+    int        jy_invalid;      /* Set if a module name could not be translated */
 };
 typedef struct clixon_json_yacc clixon_json_yacc;
 
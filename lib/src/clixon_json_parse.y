@@ -134,6 +134,9 @@ object.
 #include "clixon_log.h"
 #include "clixon_debug.h"
 #include "clixon_string.h"
+#include "clixon_yang_module.h"
+#include "clixon_xml_map.h"
+#include "clixon_netconf_lib.h"
 
 #include "clixon_json_parse.h"
 
@@ -175,9 +178,62 @@ json_parse_exit(clixon_json_yacc *jy)
     return 0;
 }
 
+/*! Translate from JSON module:name to XML default ns: xmlns="uri" on a new node
+ *
+ * Done as the node is created instead of in a separate pass over the tree after
+ * parsing. Parents are created, and thereby translated, before their children.
+ * @param[in]  jy      JSON parser context
+ * @param[in]  x       New XML node with prefix set to module name
+ * @param[in]  modname Module name (JSON prefix)
+ * @retval     0       OK, or invalid in which case jy_invalid is set
+ * @retval    -1       Error
+ * @see RFC7951 Sec 4
+ */
+static int
+json_current_xmlns(clixon_json_yacc *jy,
+                   cxobj            *x,
+                   char             *modname)
+{
+    int        retval = -1;
+    yang_stmt *ymod;
+    char      *namespace;
+
+    /* Special case for ietf-netconf -> ietf-restconf translation
+     * A special case is for return data on the form {"data":...}
+     * See also xml2json1_cbuf
+     */
+    if (strcmp(modname, "ietf-restconf") == 0)
+        modname = "ietf-netconf";
+    /* Siblings and descendants are usually in the same module */
+    if ((ymod = jy->jy_ymod) == NULL ||
+        strcmp(yang_argument_get(ymod), modname) != 0){
+        if ((ymod = yang_find_module_by_name(jy->jy_yspec, modname)) == NULL){
+            if (jy->jy_invalid == 0 && jy->jy_xerr &&
+                netconf_unknown_namespace_xml(jy->jy_xerr, "application",
+                                              modname,
+                                              "No yang module found corresponding to prefix") < 0)
+                goto done;
+            jy->jy_invalid++;
+            goto ok;
+        }
+        jy->jy_ymod = ymod;
+    }
+    namespace = yang_find_mynamespace(ymod);
+    /* It would be possible to use canonical prefixes here, but probably not
+     * necessary or even right. Therefore, the namespace given by the JSON prefix / module
+     * is always the default namespace with prefix NULL.
+     */
+    if (xml_namespace_change(x, namespace, NULL) < 0)
+        goto done;
+ ok:
+    retval = 0;
+ done:
+    return retval;
+}
+
 /*! Create xml object from json object name (eg "string") 
  *
- *  Split name into prefix:name (extended JSON RFC7951)
+ *  Split name into prefix:name (extended JSON RFC7951) and translate prefix to namespace
  */
 static int
 json_current_new(clixon_json_yacc *jy,
@@ -196,7 +252,8 @@ json_current_new(clixon_json_yacc *jy,
         goto done;
     if (xml_prefix_set(x, prefix) < 0)
         goto done;
-
+    if (prefix && json_current_xmlns(jy, x, prefix) < 0)
+        goto done;
     /* If topmost, add to top-list created list */
     if (jy->jy_current == jy->jy_xtop){
         if (cxvec_append(x, &jy->jy_xvec, &jy->jy_xlen) < 0)
@@ -244,7 +301,11 @@ json_current_clone(clixon_json_yacc *jy)
         } else {
             maybe_prefixed_name = strdup(name);
         }
-        json_current_new(jy, maybe_prefixed_name);
+        if (json_current_new(jy, maybe_prefixed_name) < 0){
+            if (maybe_prefixed_name)
+                free(maybe_prefixed_name);
+            return -1;
+        }
         if (maybe_prefixed_name)
             free(maybe_prefixed_name);
     }
@@ -297,7 +358,8 @@ objlist       : pair             { _PARSE_DEBUG("objlist->pair");}
               | objlist ',' pair { _PARSE_DEBUG("objlist->objlist , pair");}
               ;
 
-pair          : string { json_current_new(_JY, cbuf_get($1));cbuf_free($1); _JY->jy_cbuf_str = NULL;} ':'
+pair          : string { int ret = json_current_new(_JY, cbuf_get($1)); cbuf_free($1); _JY->jy_cbuf_str = NULL;
+                         if (ret < 0) _YYERROR("json_current_new"); } ':'
                 value  { json_current_pop(_JY);}{ _PARSE_DEBUG("pair->string : value");}
               ;
 
@@ -0,0 +1,422 @@
+/*
+ *
+  ***** BEGIN LICENSE BLOCK *****
+
+  Copyright (C) 2024 Olof Hagsand
+
+  This file is part of CLIXON.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Alternatively, the contents of this file may be used under the terms of
+  the GNU General Public License Version 3 or later (the "GPL"),
+  in which case the provisions of the GPL are applicable instead
+  of those above. If you wish to allow use of your version of this file only
+  under the terms of the GPL, and not to allow others to
+  use your version of this file under the terms of Apache License version 2, indicate
+  your decision by deleting the provisions above and replace them with the
+  notice and other provisions required by the GPL. If you do not delete
+  the provisions above, a recipient may use your version of this file under
+  the terms of any one of the Apache License version 2 or the GPL.
+
+  ***** END LICENSE BLOCK *****
+  * Latency histograms of backend RPCs, transaction phases and plugin callbacks
+  *
+  * A histogram has log-linear buckets in the style of HDR histograms: values below
+  * HG_SUB are counted exactly, above that each power of two is split into HG_SUB buckets,
+  * so that the relative error of a reported value is at most 1/HG_SUB.
+  * Values are in microseconds, larger values than 2^HG_MAXBITS are counted in the last
+  * bucket.
+  * Histograms are registered by group and name on first use, eg group "rpc" and name
+  * "edit-config". Recording is made in the main thread only.
+  * @see clixon-lib.yang stats rpc
+  */
+
+#ifdef HAVE_CONFIG_H
+#include "clixon_config.h" /* generated by config & autoconf */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+/* cligen */
+#include <cligen/cligen.h>
+
+/* clixon */
+#include "clixon_queue.h"
+#include "clixon_hash.h"
+#include "clixon_string.h"
+#include "clixon_handle.h"
+#include "clixon_yang.h"
+#include "clixon_xml.h"
+#include "clixon_err.h"
+#include "clixon_latency.h"
+
+/*
+ * Constants
+ */
+/* Number of bits of sub-buckets per power of two */
+#define HG_SUBBITS  4
+#define HG_SUB      (1 << HG_SUBBITS)
+
+/* Values are counted up to 2^HG_MAXBITS, ie ~12 days in microseconds */
+#define HG_MAXBITS  40
+
+#define HG_NBUCKETS ((HG_MAXBITS - HG_SUBBITS + 1) * HG_SUB)
+
+/*
+ * Types
+ */
+struct clixon_histogram{
+    uint64_t hg_count;
+    uint64_t hg_sum;
+    uint64_t hg_min;
+    uint64_t hg_max;
+    uint64_t hg_buckets[HG_NBUCKETS];
+};
+
+/* Registered histogram */
+struct latency_entry{
+    qelem_t           le_qelem;  /* List in registration order */
+    char             *le_group;  /* Group, eg rpc, transaction, plugin */
+    char             *le_name;   /* Name in group */
+    clixon_histogram *le_hg;
+};
+
+/*
+ * Variables
+ */
+static struct latency_entry *_latency_list = NULL;
+static clicon_hash_t        *_latency_hash = NULL; /* group/name -> entry pointer */
+
+/*! Bucket index of value
+ */
+static int
+hg_index(uint64_t v)
+{
+    int msb;
+    int shift;
+
+    if (v < HG_SUB)
+        return v;
+    if (v >= ((uint64_t)1 << HG_MAXBITS))
+        return HG_NBUCKETS - 1;
+    msb = 63 - __builtin_clzll(v);
+    shift = msb - HG_SUBBITS;
+    return (shift + 1) * HG_SUB + ((v >> shift) & (HG_SUB - 1));
+}
+
+/*! Highest value counted in bucket
+ */
+static uint64_t
+hg_upper(int i)
+{
+    int shift;
+
+    if (i < HG_SUB)
+        return i;
+    shift = i / HG_SUB - 1;
+    return (((uint64_t)(HG_SUB + i % HG_SUB)) << shift) + ((uint64_t)1 << shift) - 1;
+}
+
+/*! Create a new histogram
+ *
+ * @retval    hg    Histogram, free with clixon_histogram_free
+ * @retval    NULL  Error
+ */
+clixon_histogram *
+clixon_histogram_new(void)
+{
+    clixon_histogram *hg;
+
+    if ((hg = malloc(sizeof(*hg))) == NULL){
+        clixon_err(OE_UNIX, errno, "malloc");
+        return NULL;
+    }
+    memset(hg, 0, sizeof(*hg));
+    return hg;
+}
+
+/*! Free histogram
+ *
+ * @param[in]  hg   Histogram
+ * @retval     0    OK
+ */
+int
+clixon_histogram_free(clixon_histogram *hg)
+{
+    if (hg)
+        free(hg);
+    return 0;
+}
+
+/*! Record a value in histogram
+ *
+ * @param[in]  hg     Histogram
+ * @param[in]  value  Value, eg latency in microseconds
+ * @retval     0      OK
+ */
+int
+clixon_histogram_record(clixon_histogram *hg,
+                        uint64_t          value)
+{
+    if (hg->hg_count == 0 || value < hg->hg_min)
+        hg->hg_min = value;
+    if (value > hg->hg_max)
+        hg->hg_max = value;
+    hg->hg_count++;
+    hg->hg_sum += value;
+    hg->hg_buckets[hg_index(value)]++;
+    return 0;
+}
+
+/*! Reset all counts of histogram
+ *
+ * @param[in]  hg   Histogram
+ * @retval     0    OK
+ */
+int
+clixon_histogram_reset(clixon_histogram *hg)
+{
+    memset(hg, 0, sizeof(*hg));
+    return 0;
+}
+
+/*! Get number of recorded values
+ *
+ * @param[in]  hg     Histogram
+ * @retval     count  Number of recorded values
+ */
+uint64_t
+clixon_histogram_count(clixon_histogram *hg)
+{
+    return hg->hg_count;
+}
+
+/*! Get value at percentile
+ *
+ * @param[in]  hg     Histogram
+ * @param[in]  pct    Percentile, 0-100, eg 99.9
+ * @retval     value  Highest value of bucket where percentile is reached, 0 if empty
+ */
+uint64_t
+clixon_histogram_percentile(clixon_histogram *hg,
+                            double            pct)
+{
+    uint64_t rank;
+    uint64_t n = 0;
+    uint64_t v;
+    int      i;
+
+    if (hg->hg_count == 0)
+        return 0;
+    rank = (uint64_t)(pct * hg->hg_count / 100.0 + 0.5);
+    if (rank == 0)
+        rank = 1;
+    if (rank > hg->hg_count)
+        rank = hg->hg_count;
+    for (i=0; i<HG_NBUCKETS; i++){
+        n += hg->hg_buckets[i];
+        if (n >= rank)
+            break;
+    }
+    v = hg_upper(i);
+    if (v > hg->hg_max)
+        v = hg->hg_max;
+    if (v < hg->hg_min)
+        v = hg->hg_min;
+    return v;
+}
+
+/*! Print histogram as XML: count, min, max, mean, percentiles and non-empty buckets
+ *
+ * @param[out] cb   CLIgen buffer
+ * @param[in]  hg   Histogram
+ * @retval     0    OK
+ * @see clixon-lib.yang grouping latency-histogram
+ */
+int
+clixon_histogram_print(cbuf             *cb,
+                       clixon_histogram *hg)
+{
+    int i;
+
+    cprintf(cb, "<count>%" PRIu64 "</count>", hg->hg_count);
+    cprintf(cb, "<min>%" PRIu64 "</min>", hg->hg_min);
+    cprintf(cb, "<max>%" PRIu64 "</max>", hg->hg_max);
+    cprintf(cb, "<mean>%" PRIu64 "</mean>", hg->hg_count?hg->hg_sum/hg->hg_count:0);
+    cprintf(cb, "<p50>%" PRIu64 "</p50>", clixon_histogram_percentile(hg, 50.0));
+    cprintf(cb, "<p90>%" PRIu64 "</p90>", clixon_histogram_percentile(hg, 90.0));
+    cprintf(cb, "<p99>%" PRIu64 "</p99>", clixon_histogram_percentile(hg, 99.0));
+    cprintf(cb, "<p999>%" PRIu64 "</p999>", clixon_histogram_percentile(hg, 99.9));
+    for (i=0; i<HG_NBUCKETS; i++){
+        if (hg->hg_buckets[i] == 0)
+            continue;
+        cprintf(cb, "<bucket><upper>%" PRIu64 "</upper><count>%" PRIu64 "</count></bucket>",
+                hg_upper(i), hg->hg_buckets[i]);
+    }
+    return 0;
+}
+
+/*! Get monotonic time in microseconds, for latency measurements
+ *
+ * @retval  usec  Microseconds since an unspecified start point
+ */
+uint64_t
+clixon_latency_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec*1000000 + ts.tv_nsec/1000;
+}
+
+/*! Record a latency in the histogram of a group and name, register histogram on first use
+ *
+ * @param[in]  group  Group, eg "rpc", "transaction" or "plugin"
+ * @param[in]  name   Name, eg rpc name or plugin name
+ * @param[in]  sub    Sub-name, eg callback, appended to name as <name>:<sub>, or NULL
+ * @param[in]  usec   Latency in microseconds
+ * @retval     0      OK
+ * @retval    -1      Error
+ * @note Not thread-safe, call in main thread only
+ */
+int
+clixon_latency_record(const char *group,
+                      const char *name,
+                      const char *sub,
+                      uint64_t    usec)
+{
+    int                   retval = -1;
+    char                  key[256];
+    struct latency_entry *le = NULL;
+    struct latency_entry **lep;
+
+    if (sub)
+        snprintf(key, sizeof(key), "%s/%s:%s", group, name, sub);
+    else
+        snprintf(key, sizeof(key), "%s/%s", group, name);
+    if (_latency_hash == NULL &&
+        (_latency_hash = clicon_hash_init()) == NULL)
+        goto done;
+    if ((lep = clicon_hash_value(_latency_hash, key, NULL)) == NULL){
+        if ((le = malloc(sizeof(*le))) == NULL){
+            clixon_err(OE_UNIX, errno, "malloc");
+            goto done;
+        }
+        memset(le, 0, sizeof(*le));
+        if ((le->le_group = strdup(group)) == NULL){
+            clixon_err(OE_UNIX, errno, "strdup");
+            goto done;
+        }
+        /* Name is key after group/ */
+        if ((le->le_name = strdup(key + strlen(group) + 1)) == NULL){
+            clixon_err(OE_UNIX, errno, "strdup");
+            goto done;
+        }
+        if ((le->le_hg = clixon_histogram_new()) == NULL)
+            goto done;
+        if (clicon_hash_add(_latency_hash, key, &le, sizeof(le)) == NULL)
+            goto done;
+        ADDQ(le, _latency_list);
+        clixon_histogram_record(le->le_hg, usec);
+        le = NULL;
+    }
+    else
+        clixon_histogram_record((*lep)->le_hg, usec);
+    retval = 0;
+ done:
+    if (le){
+        if (le->le_group)
+            free(le->le_group);
+        if (le->le_name)
+            free(le->le_name);
+        if (le->le_hg)
+            clixon_histogram_free(le->le_hg);
+        free(le);
+    }
+    return retval;
+}
+
+/*! Print registered histograms as XML
+ *
+ * @param[out] cb     CLIgen buffer
+ * @param[in]  group  Only histograms of this group, or NULL for all
+ * @retval     0      OK
+ * @see clixon-lib.yang grouping latency-histograms
+ */
+int
+clixon_latency_print(cbuf       *cb,
+                     const char *group)
+{
+    struct latency_entry *le;
+
+    if ((le = _latency_list) != NULL)
+        do {
+            if (group == NULL || strcmp(group, le->le_group) == 0){
+                cprintf(cb, "<histogram><group>%s</group>", le->le_group);
+                cprintf(cb, "<name>");
+                xml_chardata_cbuf_append(cb, le->le_name);
+                cprintf(cb, "</name>");
+                clixon_histogram_print(cb, le->le_hg);
+                cprintf(cb, "</histogram>");
+            }
+            le = NEXTQ(struct latency_entry *, le);
+        } while (le && le != _latency_list);
+    return 0;
+}
+
+/*! Reset all registered histograms
+ *
+ * @retval     0      OK
+ */
+int
+clixon_latency_reset(void)
+{
+    struct latency_entry *le;
+
+    if ((le = _latency_list) != NULL)
+        do {
+            clixon_histogram_reset(le->le_hg);
+            le = NEXTQ(struct latency_entry *, le);
+        } while (le && le != _latency_list);
+    return 0;
+}
+
+/*! Free all registered histograms
+ *
+ * @retval     0      OK
+ */
+int
+clixon_latency_free(void)
+{
+    struct latency_entry *le;
+
+    while ((le = _latency_list) != NULL){
+        DELQ(le, _latency_list, struct latency_entry *);
+        free(le->le_group);
+        free(le->le_name);
+        clixon_histogram_free(le->le_hg);
+        free(le);
+    }
+    if (_latency_hash){
+        clicon_hash_free(_latency_hash);
+        _latency_hash = NULL;
+    }
+    return 0;
+}
@@ -49,6 +49,7 @@
 #include <assert.h>
 #include <syslog.h>
 #include <sys/time.h>
+#include <pthread.h>
 
 /* cligen */
 #include <cligen/cligen.h>
@@ -74,50 +75,600 @@
 #include "clixon_xml_map.h"
 #include "clixon_path.h"
 #include "clixon_xml_vec.h"
+#include "clixon_xml_sort.h"
 #include "clixon_nacm.h"
 
 /* NACM namespace for use with xml namespace contexts and xpath */
 #define NACM_NS "urn:ietf:params:xml:ns:yang:ietf-netconf-acm"
 
-/*! Match nacm access operations according to RFC8341 3.4.4.  
+/* NACM access-operations as bits, see nacm_access_bits */
+#define NACM_OP_CREATE 0x01
+#define NACM_OP_READ   0x02
+#define NACM_OP_UPDATE 0x04
+#define NACM_OP_DELETE 0x08
+#define NACM_OP_EXEC   0x10
+#define NACM_OP_ALL    0x1f
+
+/* Origin of the NACM tree of a ruleset, see CLICON_NACM_MODE */
+enum nacm_source{
+    NACM_SRC_NONE,     /* Given by caller, not cached */
+    NACM_SRC_INTERNAL, /* nacm subtree of running datastore */
+    NACM_SRC_EXTERNAL  /* External NACM file, see clicon_nacm_ext */
+};
+
+/* NACM rule action */
+enum nacm_action{
+    NACM_ACTION_NONE,
+    NACM_ACTION_PERMIT,
+    NACM_ACTION_DENY
+};
+
+/* Compiled NACM rule. Strings point into the NACM XML tree of the ruleset */
+struct nacm_rule{
+    int                nr_index;        /* Order of rule in all rule-lists */
+    char              *nr_name;         /* Rule name */
+    char              *nr_module;       /* module-name, or NULL */
+    char              *nr_rpc;          /* rpc-name, or NULL */
+    char              *nr_notification; /* notification-name, or NULL */
+    int                nr_haspath;      /* Rule has path, ie rule-type is data-node */
+    char              *nr_path;         /* Trimmed path (malloced), or NULL */
+    clixon_path       *nr_cplist;       /* Parsed path resolved to YANG, or NULL */
+    int                nr_cplen;        /* Number of steps in nr_cplist */
+    clixon_path      **nr_cpvec;        /* Steps of nr_cplist as vector, or NULL */
+    int                nr_access;       /* access-operations as NACM_OP_* bits */
+    enum nacm_action   nr_action;       /* Rule action */
+};
+
+/* Rules that apply to a user */
+struct nacm_user{
+    int                nu_len;          /* Length of nu_rules */
+    struct nacm_rule **nu_rules;        /* Rules of rule-lists of user's groups, in order */
+};
+
+/* NACM config compiled for access validation.
+ * A ruleset is built from the NACM XML tree once and is used until the NACM config
+ * changes. It is reference counted since requests may hold it in other threads.
+ */
+struct nacm_ruleset{
+    qelem_t            rs_qelem;        /* List of rulesets in use */
+    int                rs_refcnt;       /* Reference count */
+    int                rs_registered;   /* In list of rulesets, see nacm_ruleset_find */
+    cxobj             *rs_xnacm;        /* NACM XML tree, root "nacm", or NULL if no config */
+    int                rs_owner;        /* rs_xnacm is freed with ruleset */
+    enum nacm_source   rs_source;       /* Origin of rs_xnacm */
+    uint64_t           rs_gen;          /* Generation of origin when read */
+    int                rs_enabled;      /* enable-nacm is true */
+    char              *rs_read_default; /* read-default */
+    char              *rs_write_default;/* write-default */
+    char              *rs_exec_default; /* exec-default */
+    int                rs_nrules;       /* Length of rs_rules */
+    struct nacm_rule  *rs_rules;        /* All rules in rule-list order */
+    clicon_hash_t     *rs_users;        /* Username -> struct nacm_user pointer */
+};
+typedef struct nacm_ruleset nacm_ruleset;
+
+/* Rulesets in use: the current ruleset and old rulesets still held by requests */
+static nacm_ruleset   *_nacm_rulesets = NULL;
+
+/* Ruleset of the current NACM config, see nacm_ruleset_current */
+static nacm_ruleset   *_nacm_current = NULL;
+
+/* Rulesets may be held and released by backend worker threads */
+static pthread_mutex_t _nacm_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*! Translate nacm access operations to bits according to RFC8341 3.4.4 and 3.4.5
  *
- * Incoming RPC Message Validation Step 7 (c)
- *  The rule's "access-operations" leaf has the "exec" bit set or
- *  has the special value "*".
- * @param[in] mode  Primary mode, eg read, create, update, delete, exec
- * @param[in] mode2 Secondary mode, eg "write"
- * @retval    1     Match
- * @retval    0     No match
- * @note access_operations is bit-fields
+ * @param[in] access_operations  Value of access-operations leaf, eg "read update" or "*"
+ * @retval    bits               NACM_OP_* bits
+ * @note access_operations is bit-fields, "write" is accepted as create, update and delete
  */
 static int
-match_access(char *access_operations,
-             char *mode,
-             char *mode2)
+nacm_access_bits(char *access_operations)
 {
-    if (access_operations==NULL)
+    int bits = 0;
+
+    if (access_operations == NULL)
         return 0;
-    if (strcmp(access_operations,"*")==0)
-        return 1;
-    if (strstr(access_operations, mode)!=NULL)
-        return 1;
-    if (mode2 && strstr(access_operations, mode2)!=NULL)
-        return 1;
+    if (strcmp(access_operations, "*") == 0)
+        return NACM_OP_ALL;
+    if (strstr(access_operations, "create") != NULL)
+        bits |= NACM_OP_CREATE;
+    if (strstr(access_operations, "read") != NULL)
+        bits |= NACM_OP_READ;
+    if (strstr(access_operations, "update") != NULL)
+        bits |= NACM_OP_UPDATE;
+    if (strstr(access_operations, "delete") != NULL)
+        bits |= NACM_OP_DELETE;
+    if (strstr(access_operations, "exec") != NULL)
+        bits |= NACM_OP_EXEC;
+    if (strstr(access_operations, "write") != NULL)
+        bits |= NACM_OP_CREATE|NACM_OP_UPDATE|NACM_OP_DELETE;
+    return bits;
+}
+
+/*! Make vector of the steps of a rule path
+ *
+ * The vector is only made if all steps are in a module with a namespace, otherwise the
+ * path does not match any node, see clixon_path_search
+ * @param[in]  rule  Rule with parsed and resolved path
+ * @retval     0     OK
+ * @retval    -1     Error
+ */
+static int
+nacm_rule_cpvec(struct nacm_rule *rule)
+{
+    clixon_path *cp;
+    int          len = 0;
+
+    if ((cp = rule->nr_cplist) == NULL)
+        return 0;
+    do {
+        if (yang_find_mynamespace(cp->cp_yang) == NULL)
+            return 0;
+        len++;
+        cp = NEXTQ(clixon_path *, cp);
+    } while (cp != rule->nr_cplist);
+    if ((rule->nr_cpvec = calloc(len, sizeof(*rule->nr_cpvec))) == NULL){
+        clixon_err(OE_UNIX, errno, "calloc");
+        return -1;
+    }
+    do {
+        rule->nr_cpvec[rule->nr_cplen++] = cp;
+        cp = NEXTQ(clixon_path *, cp);
+    } while (cp != rule->nr_cplist);
+    return 0;
+}
+
+/*! Get rules that apply to a user
+ *
+ * @param[in]  rs       Ruleset
+ * @param[in]  username User name
+ * @retval     nu       User rules
+ * @retval     NULL     User is not member of any group
+ */
+static struct nacm_user *
+nacm_user_get(nacm_ruleset *rs,
+              char         *username)
+{
+    void *p;
+
+    if (rs->rs_users == NULL ||
+        (p = clicon_hash_value(rs->rs_users, username, NULL)) == NULL)
+        return NULL;
+    return *(struct nacm_user **)p;
+}
+
+/*! Compute ordered rules of a user from the rule-lists of the user's groups
+ *
+ * RFC8341 3.4.4/3.4.5: Process all rule-list entries, in the order they appear in the
+ * configuration.  If a rule-list's "group" leaf-list does not match any of the user's
+ * groups, proceed to the next rule-list entry.
+ * @param[in]  rs       Ruleset with rules set
+ * @param[in]  nu       User
+ * @param[in]  username User name
+ * @param[in]  groups   Group membership as (user-name, group) pairs
+ * @retval     0        OK
+ * @retval    -1        Error
+ */
+static int
+nacm_user_rules(nacm_ruleset     *rs,
+                struct nacm_user *nu,
+                char             *username,
+                cvec             *groups)
+{
+    cxobj  *xrl;
+    cxobj  *x;
+    cg_var *cv;
+    char   *gname;
+    int     member;
+    int     i = 0;
+
+    if (rs->rs_nrules &&
+        (nu->nu_rules = calloc(rs->rs_nrules, sizeof(*nu->nu_rules))) == NULL){
+        clixon_err(OE_UNIX, errno, "calloc");
+        return -1;
+    }
+    xrl = NULL;
+    while ((xrl = xml_child_each(rs->rs_xnacm, xrl, CX_ELMNT)) != NULL){
+        if (strcmp(xml_name(xrl), "rule-list") != 0)
+            continue;
+        member = 0;
+        x = NULL;
+        while (!member && (x = xml_child_each(xrl, x, CX_ELMNT)) != NULL){
+            if (strcmp(xml_name(x), "group") != 0 || (gname = xml_body(x)) == NULL)
+                continue;
+            cv = NULL;
+            while ((cv = cvec_each(groups, cv)) != NULL)
+                if (strcmp(cv_name_get(cv), username) == 0 &&
+                    strcmp(cv_string_get(cv), gname) == 0){
+                    member++;
+                    break;
+                }
+        }
+        x = NULL;
+        while ((x = xml_child_each(xrl, x, CX_ELMNT)) != NULL){
+            if (strcmp(xml_name(x), "rule") != 0)
+                continue;
+            if (member)
+                nu->nu_rules[nu->nu_len++] = &rs->rs_rules[i];
+            i++;
+        }
+    }
     return 0;
 }
 
+/*! Free NACM ruleset
+ *
+ * @param[in]  rs    Ruleset
+ * @retval     0     OK
+ * @retval    -1     Error
+ */
+static int
+nacm_ruleset_free(nacm_ruleset *rs)
+{
+    struct nacm_user *nu;
+    char            **keys = NULL;
+    size_t            klen;
+    size_t            i;
+    int               j;
+
+    if (rs->rs_users){
+        if (clicon_hash_keys(rs->rs_users, &keys, &klen) < 0)
+            return -1;
+        for (i=0; i<klen; i++){
+            if ((nu = nacm_user_get(rs, keys[i])) == NULL)
+                continue;
+            if (nu->nu_rules)
+                free(nu->nu_rules);
+            free(nu);
+        }
+        if (keys)
+            free(keys);
+        clicon_hash_free(rs->rs_users);
+    }
+    for (j=0; j<rs->rs_nrules; j++){
+        if (rs->rs_rules[j].nr_path)
+            free(rs->rs_rules[j].nr_path);
+        if (rs->rs_rules[j].nr_cplist)
+            clixon_path_free(rs->rs_rules[j].nr_cplist);
+        if (rs->rs_rules[j].nr_cpvec)
+            free(rs->rs_rules[j].nr_cpvec);
+    }
+    if (rs->rs_rules)
+        free(rs->rs_rules);
+    if (rs->rs_owner && rs->rs_xnacm)
+        xml_free(rs->rs_xnacm);
+    free(rs);
+    return 0;
+}
+
+/*! Compile NACM XML tree into a ruleset
+ *
+ * Groups are indexed by user, rules are stored in rule-list order per user, and rule paths
+ * are parsed and resolved to YANG, so that access validation does not need to search the
+ * NACM tree.
+ * @param[in]  yspec  YANG spec for resolving rule paths, or NULL if paths are not used
+ * @param[in]  xnacm  NACM XML tree with root "nacm", or NULL if there is no NACM config
+ * @param[in]  owner  If set, xnacm is freed with the ruleset (not on error)
+ * @retval     rs     Ruleset with one reference, release with nacm_ruleset_unref
+ * @retval     NULL   Error
+ */
+static nacm_ruleset *
+nacm_ruleset_compile(yang_stmt *yspec,
+                     cxobj     *xnacm,
+                     int        owner)
+{
+    nacm_ruleset     *retval = NULL;
+    nacm_ruleset     *rs = NULL;
+    struct nacm_rule *rule;
+    struct nacm_user *nu;
+    cxobj            *xgroups;
+    cxobj            *xg;
+    cxobj            *xu;
+    cxobj            *xrl;
+    cxobj            *xr;
+    cxobj            *x;
+    char             *body;
+    char             *gname;
+    cvec             *groups = NULL;
+    cg_var           *cv;
+    int               nrules = 0;
+    int               ret;
+
+    if ((rs = calloc(1, sizeof(*rs))) == NULL){
+        clixon_err(OE_UNIX, errno, "calloc");
+        goto done;
+    }
+    rs->rs_refcnt = 1;
+    rs->rs_xnacm = xnacm;
+    if (xnacm == NULL)
+        goto ok;
+    if ((body = xml_find_body(xnacm, "enable-nacm")) != NULL && strcmp(body, "true") == 0)
+        rs->rs_enabled = 1;
+    rs->rs_read_default = xml_find_body(xnacm, "read-default");
+    rs->rs_write_default = xml_find_body(xnacm, "write-default");
+    rs->rs_exec_default = xml_find_body(xnacm, "exec-default");
+    /* Rules of all rule-lists in order */
+    xrl = NULL;
+    while ((xrl = xml_child_each(xnacm, xrl, CX_ELMNT)) != NULL){
+        if (strcmp(xml_name(xrl), "rule-list") != 0)
+            continue;
+        xr = NULL;
+        while ((xr = xml_child_each(xrl, xr, CX_ELMNT)) != NULL)
+            if (strcmp(xml_name(xr), "rule") == 0)
+                nrules++;
+    }
+    if (nrules && (rs->rs_rules = calloc(nrules, sizeof(*rs->rs_rules))) == NULL){
+        clixon_err(OE_UNIX, errno, "calloc");
+        goto done;
+    }
+    xrl = NULL;
+    while ((xrl = xml_child_each(xnacm, xrl, CX_ELMNT)) != NULL){
+        if (strcmp(xml_name(xrl), "rule-list") != 0)
+            continue;
+        xr = NULL;
+        while ((xr = xml_child_each(xrl, xr, CX_ELMNT)) != NULL){
+            if (strcmp(xml_name(xr), "rule") != 0)
+                continue;
+            rule = &rs->rs_rules[rs->rs_nrules];
+            rule->nr_index = rs->rs_nrules++;
+            rule->nr_name = xml_find_body(xr, "name");
+            rule->nr_module = xml_find_body(xr, "module-name");
+            rule->nr_rpc = xml_find_body(xr, "rpc-name");
+            rule->nr_notification = xml_find_body(xr, "notification-name");
+            rule->nr_access = nacm_access_bits(xml_find_body(xr, "access-operations"));
+            if ((body = xml_find_body(xr, "action")) != NULL){
+                if (strcmp(body, "permit") == 0)
+                    rule->nr_action = NACM_ACTION_PERMIT;
+                else if (strcmp(body, "deny") == 0)
+                    rule->nr_action = NACM_ACTION_DENY;
+            }
+            if ((x = xml_find_type(xr, NULL, "path", CX_ELMNT)) == NULL)
+                continue;
+            rule->nr_haspath = 1;
+            if ((body = xml_body(x)) == NULL)
+                continue;
+            if ((rule->nr_path = strdup(clixon_trim2(body, " \t\n"))) == NULL){
+                clixon_err(OE_UNIX, errno, "strdup");
+                goto done;
+            }
+            if (yspec == NULL)
+                continue;
+            /* See https://github.com/clicon/clixon/issues/129: paths are not translated
+             * to canonical namespace context, but used as given (instance-id)
+             * If not resolved, the rule does not match any node
+             */
+            if ((ret = clixon_instance_id_parse(yspec, &rule->nr_cplist, NULL, "%s", rule->nr_path)) < 0)
+                goto done;
+            if (ret == 0)
+                continue;
+            if (nacm_rule_cpvec(rule) < 0)
+                goto done;
+        }
+    }
+    /* Users and their groups */
+    if ((rs->rs_users = clicon_hash_init()) == NULL)
+        goto done;
+    if ((groups = cvec_new(0)) == NULL){
+        clixon_err(OE_UNIX, errno, "cvec_new");
+        goto done;
+    }
+    if ((xgroups = xml_find_type(xnacm, NULL, "groups", CX_ELMNT)) != NULL){
+        xg = NULL;
+        while ((xg = xml_child_each(xgroups, xg, CX_ELMNT)) != NULL){
+            if (strcmp(xml_name(xg), "group") != 0 ||
+                (gname = xml_find_body(xg, "name")) == NULL)
+                continue;
+            xu = NULL;
+            while ((xu = xml_child_each(xg, xu, CX_ELMNT)) != NULL){
+                if (strcmp(xml_name(xu), "user-name") != 0 || (body = xml_body(xu)) == NULL)
+                    continue;
+                if (cvec_add_string(groups, body, gname) < 0){
+                    clixon_err(OE_UNIX, errno, "cvec_add_string");
+                    goto done;
+                }
+                if (nacm_user_get(rs, body) != NULL)
+                    continue;
+                if ((nu = calloc(1, sizeof(*nu))) == NULL){
+                    clixon_err(OE_UNIX, errno, "calloc");
+                    goto done;
+                }
+                if (clicon_hash_add(rs->rs_users, body, &nu, sizeof(nu)) == NULL){
+                    free(nu);
+                    goto done;
+                }
+            }
+        }
+    }
+    cv = NULL;
+    while ((cv = cvec_each(groups, cv)) != NULL){
+        nu = nacm_user_get(rs, cv_name_get(cv));
+        if (nu->nu_rules == NULL && nacm_user_rules(rs, nu, cv_name_get(cv), groups) < 0)
+            goto done;
+    }
+    clixon_debug(CLIXON_DBG_NACM, "%d rules, %d users", rs->rs_nrules, cvec_len(groups));
+ ok:
+    rs->rs_owner = owner;
+    retval = rs;
+    rs = NULL;
+ done:
+    if (groups)
+        cvec_free(groups);
+    if (rs)
+        nacm_ruleset_free(rs);
+    return retval;
+}
+
+/*! Find ruleset in use compiled from NACM tree and take a reference
+ *
+ * @param[in]  xnacm  NACM XML tree
+ * @retval     rs     Ruleset, release with nacm_ruleset_unref
+ * @retval     NULL   Not found
+ */
+static nacm_ruleset *
+nacm_ruleset_find(cxobj *xnacm)
+{
+    nacm_ruleset *rs;
+    nacm_ruleset *found = NULL;
+
+    if (xnacm == NULL)
+        return NULL;
+    pthread_mutex_lock(&_nacm_mutex);
+    if ((rs = _nacm_rulesets) != NULL)
+        do {
+            if (rs->rs_xnacm == xnacm){
+                rs->rs_refcnt++;
+                found = rs;
+                break;
+            }
+            rs = NEXTQ(nacm_ruleset *, rs);
+        } while (rs && rs != _nacm_rulesets);
+    pthread_mutex_unlock(&_nacm_mutex);
+    return found;
+}
+
+/*! Release a reference to a ruleset, free it when not used
+ *
+ * @param[in]  rs    Ruleset
+ * @retval     0     OK
+ * @retval    -1     Error
+ */
+static int
+nacm_ruleset_unref(nacm_ruleset *rs)
+{
+    int unused = 0;
+
+    pthread_mutex_lock(&_nacm_mutex);
+    if (--rs->rs_refcnt == 0){
+        if (rs->rs_registered)
+            DELQ(rs, _nacm_rulesets, nacm_ruleset *);
+        unused++;
+    }
+    pthread_mutex_unlock(&_nacm_mutex);
+    if (unused)
+        return nacm_ruleset_free(rs);
+    return 0;
+}
+
+/*! Get ruleset of NACM tree, compile a temporary ruleset if the tree is not in use
+ *
+ * @param[in]  yspec  YANG spec, or NULL if rule paths are not used
+ * @param[in]  xnacm  NACM XML tree
+ * @retval     rs     Ruleset, release with nacm_ruleset_unref
+ * @retval     NULL   Error
+ */
+static nacm_ruleset *
+nacm_ruleset_get(yang_stmt *yspec,
+                 cxobj     *xnacm)
+{
+    nacm_ruleset *rs;
+
+    if ((rs = nacm_ruleset_find(xnacm)) != NULL)
+        return rs;
+    return nacm_ruleset_compile(yspec, xnacm, 0);
+}
+
+/*! Get ruleset of the current NACM config, compile if NACM config has changed
+ *
+ * In internal mode, the nacm subtree is read from running only if running has changed
+ * since last time, and the ruleset is only compiled if the nacm subtree has changed.
+ * In external mode, the ruleset is compiled when a new external NACM tree is set.
+ * @param[in]  h     Clixon handle
+ * @param[in]  mode  CLICON_NACM_MODE: internal or external
+ * @param[out] rsp   Current ruleset (no reference taken)
+ * @retval     0     OK
+ * @retval    -1     Error
+ * @see clicon_nacm_ext_set
+ */
+static int
+nacm_ruleset_current(clixon_handle  h,
+                     char          *mode,
+                     nacm_ruleset **rsp)
+{
+    int              retval = -1;
+    enum nacm_source src;
+    uint64_t         gen;
+    nacm_ruleset    *rs0;
+    nacm_ruleset    *rs;
+    cxobj           *x;
+    cxobj           *xnacm0 = NULL;
+    cxobj           *xnacm = NULL;
+    cvec            *nsc = NULL;
+
+    if (strcmp(mode, "external")==0){
+        src = NACM_SRC_EXTERNAL;
+        gen = (uint64_t)clicon_data_int_get(h, "nacm-ext-generation");
+    }
+    else if (strcmp(mode, "internal")==0){
+        src = NACM_SRC_INTERNAL;
+        gen = xmldb_generation(h, "running");
+    }
+    else{
+        clixon_err(OE_XML, 0, "Invalid NACM mode: %s", mode);
+        goto done;
+    }
+    rs0 = _nacm_current;
+    if (rs0 && rs0->rs_source == src && gen != 0 && rs0->rs_gen == gen){
+        *rsp = rs0;
+        goto ok;
+    }
+    if (src == NACM_SRC_EXTERNAL){
+        if ((x = clicon_nacm_ext(h)))
+            if ((xnacm0 = xml_dup(x)) == NULL)
+                goto done;
+    }
+    else if (xmldb_get0(h, "running", YB_MODULE, NULL, "nacm", 1, 0, &xnacm0, NULL, NULL) < 0)
+        goto done;
+    if ((nsc = xml_nsctx_init(NULL, NACM_NS)) == NULL)
+        goto done;
+    if (xnacm0 && (xnacm = xpath_first(xnacm0, nsc, "nacm")) != NULL){
+        if (xml_rootchild_node(xnacm0, xnacm) < 0)
+            goto done;
+        xnacm0 = NULL;
+    }
+    /* Same NACM config, eg running changed elsewhere */
+    if (rs0 && rs0->rs_source == src &&
+        ((xnacm == NULL && rs0->rs_xnacm == NULL) ||
+         (xnacm && rs0->rs_xnacm && xml_tree_equal(rs0->rs_xnacm, xnacm) == 0))){
+        rs0->rs_gen = gen;
+        *rsp = rs0;
+        goto ok;
+    }
+    if ((rs = nacm_ruleset_compile(clicon_dbspec_yang(h), xnacm, 1)) == NULL)
+        goto done;
+    xnacm = NULL; /* Owned by ruleset */
+    rs->rs_source = src;
+    rs->rs_gen = gen;
+    pthread_mutex_lock(&_nacm_mutex);
+    ADDQ(rs, _nacm_rulesets);
+    rs->rs_registered = 1;
+    _nacm_current = rs;
+    pthread_mutex_unlock(&_nacm_mutex);
+    /* Old ruleset is freed when released by requests still holding it */
+    if (rs0 && nacm_ruleset_unref(rs0) < 0)
+        goto done;
+    *rsp = rs;
+ ok:
+    retval = 0;
+ done:
+    if (nsc)
+        xml_nsctx_free(nsc);
+    if (xnacm0)
+        xml_free(xnacm0);
+    else if (xnacm)
+        xml_free(xnacm);
+    return retval;
+}
+
 /*! Match nacm single rule. Either match with access or deny. Or not match.
  *
  * @param[in]  rpc    rpc name
  * @param[in]  module Yang module name
- * @param[in]  xrule  NACM rule XML tree
- * @param[out] cbret  Cligen buffer result. Set to an error msg if retval=0.
- * @retval     2      No matching rule Goto step 10
- * @retval     1      Matching rule AND Access
- * @retval     0      Matching rule AND Not access and cbret set
- * @retval    -1      Error
+ * @param[in]  rule   Compiled NACM rule
+ * @retval     1      Matching rule
+ * @retval     0      No matching rule
  * @see RFC8341 3.4.4.  Incoming RPC Message Validation
- 7.(cont) A rule matches if all of the following criteria are met: 
+ 7.(cont) A rule matches if all of the following criteria are met:
         *  The rule's "module-name" leaf is "*" or equals the name of
            the YANG module where the protocol operation is defined.
 
@@ -130,42 +681,31 @@ match_access(char *access_operations,
            has the special value "*".
  */
 static int
-nacm_rule_rpc(char         *rpc,
-              char         *module,
-              cxobj        *xrule)
+nacm_rule_rpc(char             *rpc,
+              char             *module,
+              struct nacm_rule *rule)
 {
-    int    retval = -1;
-    char  *module_rule; /* rule module name */
-    char  *rpc_rule;
-    char  *access_operations;
-
     /*  7a) The rule's "module-name" leaf is "*" or equals the name of
         the YANG module where the protocol operation is defined. */
-    if ((module_rule = xml_find_body(xrule, "module-name")) == NULL)
-        goto nomatch;
-    if (strcmp(module_rule,"*") && strcmp(module_rule,module))
-        goto nomatch;
+    if (rule->nr_module == NULL)
+        return 0;
+    if (strcmp(rule->nr_module, "*") && strcmp(rule->nr_module, module))
+        return 0;
     /*  7b) Either (1) the rule does not have a "rule-type" defined or
         (2) the "rule-type" is "protocol-operation" and the
         "rpc-name" is "*" or equals the name of the requested
         protocol operation. */
-    if ((rpc_rule = xml_find_body(xrule, "rpc-name")) == NULL){
-        if (xml_find_body(xrule, "path") || xml_find_body(xrule, "notification-name"))
-            goto nomatch;
+    if (rule->nr_rpc == NULL){
+        if (rule->nr_path || rule->nr_notification)
+            return 0;
     }
-    if (rpc_rule && (strcmp(rpc_rule, "*") && strcmp(rpc_rule, rpc)))
-        goto nomatch;
+    else if (strcmp(rule->nr_rpc, "*") && strcmp(rule->nr_rpc, rpc))
+        return 0;
     /* 7c) The rule's "access-operations" leaf has the "exec" bit set or
         has the special value "*". */
-    access_operations = xml_find_body(xrule, "access-operations");
-    if (!match_access(access_operations, "exec", NULL))
-        goto nomatch;
-    retval = 1;
- done:
-    return retval;
- nomatch:
-    retval = 0;
-    goto done;
+    if ((rule->nr_access & NACM_OP_EXEC) == 0)
+        return 0;
+    return 1;
 }
 
 /*! Process nacm incoming RPC message validation steps
@@ -189,24 +729,14 @@ nacm_rpc(char         *rpc,
          cxobj        *xnacm,
          cbuf         *cbret)
 {
-    int     retval = -1;
-    cxobj  *xrule;
-    cxobj **gvec = NULL; /* groups */
-    size_t  glen;
-    cxobj  *rlist;
-    cxobj **rlistvec = NULL; /* rule-list */
-    size_t  rlistlen;
-    cxobj **rvec = NULL; /* rules */
-    size_t  rlen;
-    int     i, j;
-    char   *exec_default = NULL;
-    char   *gname;
-    char   *action;
-    int     match= 0;
-    cvec   *nsc = NULL;
+    int               retval = -1;
+    nacm_ruleset     *rs = NULL;
+    struct nacm_user *nu;
+    struct nacm_rule *rule = NULL;
+    int               i;
+    int               match= 0;
 
-    /* Create namespace context for with nacm namespace as default */
-    if ((nsc = xml_nsctx_init(NULL, NACM_NS)) == NULL)
+    if ((rs = nacm_ruleset_get(NULL, xnacm)) == NULL)
         goto done;
     /* 3.   If the requested operation is the NETCONF <close-session>
        protocol operation, then the protocol operation is permitted.
@@ -220,60 +750,31 @@ nacm_rpc(char         *rpc,
        transport layer.)               */
     if (username == NULL)
         goto step10;
-
-    /* User's group */
-    if (xpath_vec(xnacm, nsc, "groups/group[user-name='%s']", &gvec, &glen, username) < 0)
-        goto done;
     /* 5. If no groups are found, continue with step 10. */
-    if (glen == 0)
+    if ((nu = nacm_user_get(rs, username)) == NULL)
         goto step10;
     /* 6. Process all rule-list entries, in the order they appear in the
         configuration.  If a rule-list's "group" leaf-list does not
         match any of the user's groups, proceed to the next rule-list
-        entry. */
-    if (xpath_vec(xnacm, nsc, "rule-list", &rlistvec, &rlistlen) < 0)
-        goto done;
-    for (i=0; i<rlistlen; i++){
-        rlist = rlistvec[i];
-        /* Loop through user's group to find match in this rule-list */
-        for (j=0; j<glen; j++){
-            gname = xml_find_body(gvec[j], "name");
-            if (xpath_first(rlist, nsc, ".[group='%s']", gname)!=NULL)
-                break; /* found */
-        }
-        if (j==glen) /* not found */
-            continue;
-        /* 7. For each rule-list entry found, process all rules, in order,
+        entry.
+       7. For each rule-list entry found, process all rules, in order,
            until a rule that matches the requested access operation is
            found.
-        */
-        if (xpath_vec(rlist, nsc, "rule", &rvec, &rlen) < 0)
-            goto done;
-        for (j=0; j<rlen; j++){
-            xrule = rvec[j];
-            if ((match = nacm_rule_rpc(rpc, module, xrule)) < 0)
-                goto done;
-            if (match)
-                break;
-        }
-        if (match)
+       The rules of the user's rule-lists are in order in the ruleset
+    */
+    for (i=0; i<nu->nu_len; i++){
+        rule = nu->nu_rules[i];
+        if ((match = nacm_rule_rpc(rpc, module, rule)) != 0)
             break;
-        if (rvec){
-            free(rvec);
-            rvec=NULL;
-        }
     }
     if (match){
-        if ((action = xml_find_body(xrule, "action")) == NULL)
-            goto step10;
-        if (strcmp(action, "deny")==0){
+        if (rule->nr_action == NACM_ACTION_DENY){
             if (netconf_access_denied(cbret, "application", "access denied") < 0)
                 goto done;
             goto deny;
         }
-        else if (strcmp(action, "permit")==0)
+        else if (rule->nr_action == NACM_ACTION_PERMIT)
             goto permit;
-
     }
  step10:
     /*   10.  If the requested protocol operation is defined in a YANG module
@@ -290,8 +791,7 @@ nacm_rpc(char         *rpc,
     }
     /*   12.  If the "exec-default" leaf is set to "permit", then permit the
          protocol operation; otherwise, deny the request. */
-    exec_default = xml_find_body(xnacm, "exec-default");
-    if (exec_default ==NULL || strcmp(exec_default, "permit")==0)
+    if (rs->rs_exec_default == NULL || strcmp(rs->rs_exec_default, "permit")==0)
         goto permit;
     if (netconf_access_denied(cbret, "application", "default deny") < 0)
         goto done;
@@ -300,14 +800,8 @@ nacm_rpc(char         *rpc,
     retval = 1;
  done:
     clixon_debug(CLIXON_DBG_NACM, "retval:%d (0:deny 1:permit)", retval);
-    if (nsc)
-        xml_nsctx_free(nsc);
-    if (gvec)
-        free(gvec);
-    if (rlistvec)
-        free(rlistvec);
-    if (rvec)
-        free(rvec);
+    if (rs)
+        nacm_ruleset_unref(rs);
     return retval;
  deny: /* Here, cbret must contain a netconf error msg */
     assert(cbuf_len(cbret));
@@ -317,9 +811,9 @@ nacm_rpc(char         *rpc,
 
 /* Local struct for keeping preparation/compiled data in NACM data path code */
 struct prepvec{
-    qelem_t       pv_q;
-    cxobj        *pv_xrule;
-    clixon_xvec  *pv_xpathvec;
+    qelem_t           pv_q;
+    struct nacm_rule *pv_rule;
+    clixon_xvec      *pv_xpathvec;
 };
 typedef struct prepvec prepvec;
 
@@ -340,8 +834,8 @@ prepvec_free(prepvec *pv_list)
 }
 
 prepvec *
-prepvec_add(prepvec  **pv_listp,
-            cxobj     *xrule)
+prepvec_add(prepvec         **pv_listp,
+            struct nacm_rule *rule)
 {
     prepvec *pv;
 
@@ -351,7 +845,7 @@ prepvec_add(prepvec  **pv_listp,
     }
     memset(pv, 0, sizeof(*pv));
     ADDQ(pv, *pv_listp);
-    pv->pv_xrule = xrule;
+    pv->pv_rule = rule;
     if ((pv->pv_xpathvec = clixon_xvec_new()) == NULL)
         return NULL;
     return pv;
@@ -363,302 +857,463 @@ prepvec_add(prepvec  **pv_listp,
  * These rules match:
  *  - user/group
  *  - have read access-op, etc
- * Also make instance-id lookups on top object for each rule. Assume at most one result
- * @param[in] h      Clixon handle
- * @retval    0      OK
- * @retval   -1      Error
+ * Also make instance-id lookups on top object for each rule, using the pre-parsed paths
+ * of the ruleset.
+ * @param[in]  xt       XML root tree
+ * @param[in]  access   NACM access
+ * @param[in]  nu       Rules of user, or NULL if user is not in any group
+ * @param[in]  yspec    YANG spec
+ * @param[out] pv_listp Rules and nodes matching their paths, free with prepvec_free
+ * @retval     0        OK
+ * @retval    -1        Error
  */
 static int
-nacm_datanode_prepare(clixon_handle     h,
-                      cxobj            *xt,
+nacm_datanode_prepare(cxobj            *xt,
                       enum nacm_access  access,
-                      cxobj           **gvec,
-                      size_t            glen,
-                      cxobj           **rlistvec,
-                      size_t            rlistlen,
-                      cvec             *nsc,
+                      struct nacm_user *nu,
+                      yang_stmt        *yspec,
                       prepvec         **pv_listp)
 {
-    int        retval = -1;
-    cxobj     *rlist;
-    int        i;
-    int        j;
-    int        k;
-    char      *gname;
-    cxobj    **rvec = NULL; /* rules */
-    size_t     rlen;
-    cxobj     *xrule;
-    cxobj     *pathobj;
-    char      *access_operations;
-    char      *path0;         /* Non-canonical path */
-    char      *path=NULL;     /* Canonical path */
-    cvec      *nsc0 = NULL;   /* Non-canonical namespace context */
-    yang_stmt *yspec;
-    cxobj   **xvec = NULL;
-    int       xlen = 0;
-    int       ret;
-    prepvec *pv;
+    int               retval = -1;
+    struct nacm_rule *rule;
+    int               bit;
+    int               i;
+    clixon_xvec      *xv = NULL;
+    prepvec          *pv;
+    int               ret;
 
-    yspec = clicon_dbspec_yang(h);
-    for (i=0; i<rlistlen; i++){         /* Loop through rule list */
-        rlist = rlistvec[i];
-        /* Loop through user's group to find match in this rule-list */
-        for (j=0; j<glen; j++){
-            gname = xml_find_body(gvec[j], "name");
-            if (xpath_first(rlist, nsc, ".[group='%s']", gname)!=NULL)
-                break; /* found */
+    switch (access){
+    case NACM_READ:
+        /* 6c) For a "read" access operation, the rule's "access-operations"
+           leaf has the "read" bit set or has the special value "*" */
+        bit = NACM_OP_READ;
+        break;
+    case NACM_CREATE:
+        /* 6d) For a "create" access operation, the rule's "access-operations"
+           leaf has the "create" bit set or has the special value "*". */
+        bit = NACM_OP_CREATE;
+        break;
+    case NACM_DELETE:
+        /* 6e) For a "delete" access operation, the rule's "access-operations"
+           leaf has the "delete" bit set or has the  special value "*". */
+        bit = NACM_OP_DELETE;
+        break;
+    case NACM_UPDATE:
+        /* 6f) For an "update" access operation, the rule's "access-operations"
+           leaf has the "update" bit set or has the special value "*". */
+        bit = NACM_OP_UPDATE;
+        break;
+    default:
+        clixon_err(OE_XML, EINVAL, "Access %d unupported (shouldnt happen)", access);
+        goto done;
+        break;
+    }
+    if (nu == NULL)
+        goto ok;
+    /* 6. For each rule-list entry found, process all rules, in order,
+       until a rule that matches the requested access operation is
+       found. (see 6 sub rules in nacm_rule_datanode
+    */
+    for (i=0; i<nu->nu_len; i++){ /* Loop through rules */
+        rule = nu->nu_rules[i];
+        if ((rule->nr_access & bit) == 0)
+            continue;
+        /*  6b) Either (1) the rule does not have a "rule-type" defined or
+            (2) the "rule-type" is "data-node" and the "path" matches the
+            requested data node, action node, or notification node. */
+        if (!rule->nr_haspath){
+            if (rule->nr_rpc || rule->nr_notification)
+                continue;
+            /* Here a new rule is found, add it */
+            if (prepvec_add(pv_listp, rule) == NULL)
+                goto done;
+            continue;
         }
-        if (j==glen) /* not found */
+        if (rule->nr_cplist == NULL) /* Path not resolved to YANG */
             continue;
-        /* 6. For each rule-list entry found, process all rules, in order,
-           until a rule that matches the requested access operation is
-           found. (see 6 sub rules in nacm_rule_datanode
-        */
-        if (xpath_vec(rlist, nsc, "rule", &rvec, &rlen) < 0)
+        if ((ret = clixon_path_search(xt, yspec, rule->nr_cplist, &xv)) < 0)
             goto done;
-        for (j=0; j<rlen; j++){ /* Loop through rules */
-            xrule = rvec[j];
-            /* 6c) For a "read" access operation, the rule's "access-operations"
-               leaf has the "read" bit set or has the special value "*" */
-            access_operations = xml_find_body(xrule, "access-operations");
-            switch (access){
-            case NACM_READ:
-                /* 6c) For a "read" access operation, the rule's "access-operations"
-                   leaf has the "read" bit set or has the special value "*" */
-                if (!match_access(access_operations, "read", NULL))
-                    continue;
-                break;
-            case NACM_CREATE:
-                /* 6d) For a "create" access operation, the rule's "access-operations"
-                   leaf has the "create" bit set or has the special value "*". */
-                if (!match_access(access_operations, "create", "write"))
-                    continue;
-                break;
-            case NACM_DELETE:
-                /* 6e) For a "delete" access operation, the rule's "access-operations" 
-                   leaf has the "delete" bit set or has the  special value "*". */
-                if (!match_access(access_operations, "delete", "write"))
-                    continue;
-                break;
-            case NACM_UPDATE:
-                /* 6f) For an "update" access operation, the rule's "access-operations"
-                   leaf has the "update" bit set or has the special value "*". */ 
-                if (!match_access(access_operations, "update", "write"))
-                    continue;
-                break;
-            default:
-                clixon_err(OE_XML, EINVAL, "Access %d unupported (shouldnt happen)", access);
-                goto done;
-                break;
-            }
-            /*  6b) Either (1) the rule does not have a "rule-type" defined or
-                (2) the "rule-type" is "data-node" and the "path" matches the
-                requested data node, action node, or notification node. */    
-            if ((pathobj = xml_find_type(xrule, NULL, "path", CX_ELMNT)) == NULL){
-                if (xml_find_body(xrule, "rpc-name") || xml_find_body(xrule, "notification-name"))
-                    continue;
-                /* Here a new xrule is found, add it */
-                if (prepvec_add(pv_listp, xrule) == NULL)
-                    goto done;
-            }
-            else{
-                path0 = clixon_trim2(xml_body(pathobj), " \t\n");
-                /* Get canonical namespace context for nacm paths */
-                if ((path = strdup(path0)) == NULL){
-                    clixon_err(OE_UNIX, errno, "strdup");
-                    goto done;
-                }
-#if 0
-                /* See https://github.com/clicon/clixon/issues/129:
-                 * If this is enabled, you are back to the problem of JSON encodings
-                 */
-                /* Create namespace context for with nacm namespace as default */
-                if (xml_nsctx_node(pathobj, &nsc0) < 0)
-                    goto done;
-                /* instance-id requires canonical paths */
-                if (xpath2canonical(path0, nsc0, yspec, &path, NULL) < 0)
-                    goto done;
-#endif
-                if ((ret = clixon_xml_find_instance_id(xt, yspec, &xvec, &xlen, "%s", path)) < 0)
-                    goto done;
-                if (ret == 0)
-                    continue;
-                /* Here a new xrule is found, add it */
-                if ((pv = prepvec_add(pv_listp, xrule)) == NULL)
-                    goto done;
-                for (k=0; k<xlen; k++){
-                    if (clixon_xvec_append(pv->pv_xpathvec, xvec[k]) < 0)
-                        goto done;
-                }
-                if (xvec){
-                    free(xvec);
-                    xvec = NULL;
-                }
-                if (nsc0){
-                    cvec_free(nsc0);
-                    nsc0 = NULL;
-                }
-                if (path){
-                    free(path);
-                    path = NULL;
-                }
+        if (ret == 0)
+            continue;
+        /* Here a new rule is found, add it */
+        if ((pv = prepvec_add(pv_listp, rule)) == NULL)
+            goto done;
+        if (xv){
+            clixon_xvec_free(pv->pv_xpathvec);
+            pv->pv_xpathvec = xv;
+            xv = NULL;
+        }
+    }
+ ok:
+    retval = 0;
+ done:
+    if (xv)
+        clixon_xvec_free(xv);
+    return retval;
+}
+
+/*---------------------------------------------------------------
+ * Data node path matching
+ * Rule paths are matched one step per tree level while a tree is traversed, instead of
+ * being searched in the tree for every access.
+ */
+
+/* Path state of a rule in a node: number of path steps matched by the node and its
+ * ancestors. Equal to nr_cplen if the node or an ancestor is the node of the path.
+ * Always nr_cplen (0) for rules without path.
+ */
+#define NACM_PATH_DEAD -1   /* The path does not lead to the node */
+
+/* Data node rules of a user for one access in one tree traversal.
+ * The path state of rules and the children matching the next keyed path step are
+ * stored per tree level of the traversal, level 0 is the top of the tree.
+ */
+struct nacm_filter{
+    yang_stmt         *nf_yspec;    /* YANG spec */
+    int                nf_write;    /* Write rules, see nacm_filter_match */
+    int                nf_nrules;   /* Length of nf_rules */
+    struct nacm_rule **nf_rules;    /* Rules of user in order */
+    int                nf_levels;   /* Allocated tree levels in nf_state and nf_xvec */
+    int               *nf_state;    /* Path state per level and rule */
+    clixon_xvec      **nf_xvec;     /* Children matching keyed path step per level and rule */
+};
+
+#define NF_STATE(nf, l) (&(nf)->nf_state[(l)*(nf)->nf_nrules])
+#define NF_XVEC(nf, l)  (&(nf)->nf_xvec[(l)*(nf)->nf_nrules])
+
+/*! Ensure state of a tree level is allocated
+ *
+ * @param[in]  nf     Filter
+ * @param[in]  level  Tree level
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+static int
+nacm_filter_level(struct nacm_filter *nf,
+                  int                 level)
+{
+    int           n;
+    int          *state;
+    clixon_xvec **xvec;
+
+    if (level < nf->nf_levels || nf->nf_nrules == 0)
+        return 0;
+    n = level + 16;
+    if ((state = realloc(nf->nf_state, n*nf->nf_nrules*sizeof(*state))) == NULL){
+        clixon_err(OE_UNIX, errno, "realloc");
+        return -1;
+    }
+    nf->nf_state = state;
+    if ((xvec = realloc(nf->nf_xvec, n*nf->nf_nrules*sizeof(*xvec))) == NULL){
+        clixon_err(OE_UNIX, errno, "realloc");
+        return -1;
+    }
+    memset(&xvec[nf->nf_levels*nf->nf_nrules], 0,
+           (n-nf->nf_levels)*nf->nf_nrules*sizeof(*xvec));
+    nf->nf_xvec = xvec;
+    nf->nf_levels = n;
+    return 0;
+}
+
+/*! Initialize filter with data node rules of a user for an access
+ *
+ * @param[out] nf     Filter, zeroed by caller, free with nacm_filter_free
+ * @param[in]  yspec  YANG spec
+ * @param[in]  nu     Rules of user, or NULL if user is not in any group
+ * @param[in]  bit    Access operation as NACM_OP_* bit
+ * @retval     0      OK
+ * @retval    -1      Error
+ * @see nacm_datanode_prepare
+ */
+static int
+nacm_filter_init(struct nacm_filter *nf,
+                 yang_stmt          *yspec,
+                 struct nacm_user   *nu,
+                 int                 bit)
+{
+    struct nacm_rule *rule;
+    int               i;
+
+    nf->nf_yspec = yspec;
+    nf->nf_write = (bit != NACM_OP_READ);
+    if (nu != NULL && nu->nu_len){
+        if ((nf->nf_rules = calloc(nu->nu_len, sizeof(*nf->nf_rules))) == NULL){
+            clixon_err(OE_UNIX, errno, "calloc");
+            return -1;
+        }
+        for (i=0; i<nu->nu_len; i++){
+            rule = nu->nu_rules[i];
+            if ((rule->nr_access & bit) == 0 || rule->nr_module == NULL)
+                continue;
+            if (rule->nr_haspath ? rule->nr_cpvec == NULL :
+                (rule->nr_rpc || rule->nr_notification))
+                continue;
+            nf->nf_rules[nf->nf_nrules++] = rule;
+        }
+    }
+    if (nacm_filter_level(nf, 0) < 0)
+        return -1;
+    for (i=0; i<nf->nf_nrules; i++)
+        NF_STATE(nf, 0)[i] = 0;
+    return 0;
+}
+
+/*! Free filter state
+ *
+ * @param[in]  nf     Filter
+ */
+static void
+nacm_filter_free(struct nacm_filter *nf)
+{
+    int i;
+
+    for (i=0; i<nf->nf_levels*nf->nf_nrules; i++)
+        if (nf->nf_xvec[i])
+            clixon_xvec_free(nf->nf_xvec[i]);
+    if (nf->nf_xvec)
+        free(nf->nf_xvec);
+    if (nf->nf_state)
+        free(nf->nf_state);
+    if (nf->nf_rules)
+        free(nf->nf_rules);
+}
+
+/*! Find children of a node matching the next keyed path step of each rule
+ *
+ * Must be called for a node before its children are matched
+ * @param[in]  nf     Filter
+ * @param[in]  level  Tree level of x
+ * @param[in]  x      Node, with path state set at level
+ * @retval     0      OK
+ * @retval    -1      Error
+ * @see clixon_path_search
+ */
+static int
+nacm_filter_enter(struct nacm_filter *nf,
+                  int                 level,
+                  cxobj              *x)
+{
+    struct nacm_rule *rule;
+    clixon_path      *cp;
+    clixon_xvec     **xvp;
+    yang_stmt        *yc;
+    cg_var           *cv;
+    int               s;
+    int               i;
+
+    for (i=0; i<nf->nf_nrules; i++){
+        rule = nf->nf_rules[i];
+        xvp = &NF_XVEC(nf, level)[i];
+        if (*xvp){
+            clixon_xvec_free(*xvp);
+            *xvp = NULL;
+        }
+        s = NF_STATE(nf, level)[i];
+        if (s == NACM_PATH_DEAD || s == rule->nr_cplen)
+            continue;
+        cp = rule->nr_cpvec[s];
+        if (cp->cp_cvk == NULL)
+            continue;
+        if ((*xvp = clixon_xvec_new()) == NULL)
+            return -1;
+        yc = cp->cp_yang;
+        if ((yang_keyword_get(yc) == Y_LIST || yang_keyword_get(yc) == Y_LEAF_LIST) &&
+            cvec_len(cp->cp_cvk) == 1 && (cv = cvec_i(cp->cp_cvk, 0)) &&
+            cv_type_get(cv) == CGV_UINT32){
+            if (clixon_xml_find_pos(x, yc, cv_uint32_get(cv), *xvp) < 0)
+                return -1;
+        }
+        else if (clixon_xml_find_index(x, yang_parent_get(yc),
+                                       yang_find_mynamespace(yc), yang_argument_get(yc),
+                                       cp->cp_cvk, *xvp) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+/*! Compute path state of a rule in a child node
+ *
+ * @param[in]  nf     Filter
+ * @param[in]  level  Tree level of parent
+ * @param[in]  i      Rule index
+ * @param[in]  xc     Child node
+ * @retval     state  Path state of rule in xc
+ */
+static int
+nacm_filter_step(struct nacm_filter *nf,
+                 int                 level,
+                 int                 i,
+                 cxobj              *xc)
+{
+    struct nacm_rule *rule = nf->nf_rules[i];
+    clixon_xvec      *xv;
+    int               s;
+    int               k;
+
+    s = NF_STATE(nf, level)[i];
+    if (s == NACM_PATH_DEAD || s == rule->nr_cplen)
+        return s;
+    if (xml_spec(xc) != rule->nr_cpvec[s]->cp_yang)
+        return NACM_PATH_DEAD;
+    if ((xv = NF_XVEC(nf, level)[i]) == NULL) /* No keys */
+        return s + 1;
+    for (k=0; k<clixon_xvec_len(xv); k++)
+        if (clixon_xvec_i(xv, k) == xc)
+            return s + 1;
+    return NACM_PATH_DEAD;
+}
+
+/*! Set path state of a child node at the next tree level
+ *
+ * @param[in]  nf     Filter
+ * @param[in]  level  Tree level of parent
+ * @param[in]  xc     Child node
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+static int
+nacm_filter_down(struct nacm_filter *nf,
+                 int                 level,
+                 cxobj              *xc)
+{
+    int i;
+
+    if (nacm_filter_level(nf, level+1) < 0)
+        return -1;
+    for (i=0; i<nf->nf_nrules; i++)
+        NF_STATE(nf, level+1)[i] = nacm_filter_step(nf, level, i, xc);
+    return 0;
+}
+
+/*! Get first rule matching a child node
+ *
+ * RFC 8341 3.4.5 6a) and 6b): the rule's module-name is "*" or equals the module of the
+ * node, and the rule has no path or the path matches the node or an ancestor.
+ * Read rules do not match nodes without YANG. Write rules match nodes without module.
+ * @param[in]  nf     Filter
+ * @param[in]  level  Tree level of parent
+ * @param[in]  xc     Child node
+ * @param[out] rulep  First matching rule, or NULL
+ * @retval     0      OK
+ * @retval    -1      Error
+ * @see nacm_data_read_xrule_xml
+ */
+static int
+nacm_filter_match(struct nacm_filter *nf,
+                  int                 level,
+                  cxobj              *xc,
+                  struct nacm_rule  **rulep)
+{
+    struct nacm_rule *rule;
+    yang_stmt        *ymod = NULL;
+    int               modset = 0;
+    int               i;
+
+    *rulep = NULL;
+    if (!nf->nf_write && xml_spec(xc) == NULL)
+        return 0;
+    for (i=0; i<nf->nf_nrules; i++){
+        rule = nf->nf_rules[i];
+        if (nacm_filter_step(nf, level, i, xc) != rule->nr_cplen)
+            continue;
+        if (strcmp(rule->nr_module, "*") != 0){
+            if (!modset){
+                if (ys_module_by_xml(nf->nf_yspec, xc, &ymod) < 0)
+                    return -1;
+                modset++;
             }
+            if (ymod == NULL ? !nf->nf_write : strcmp(yang_argument_get(ymod), rule->nr_module) != 0)
+                continue;
         }
-        if (rvec){
-            free(rvec);
-            rvec=NULL;
-        }
+        *rulep = rule;
+        break;
     }
-    retval = 0;
- done:
-    if (xvec)
-        free(xvec);
-    if (path)
-        free(path);
-    if (nsc0)
-        cvec_free(nsc0);
-    return retval;
+    return 0;
 }
 
-/*---------------------------------------------------------------
- * Datanode write
- */
-
-/*! Match specific rule to specific requested node
+/*! Check if any rule with an action may match a node or its descendants
  *
- * @param[in]  xn       XML node (requested node)
- * @param[in]  xrule    NACM rule
- * @param[in]  xp       Xpath match
- * @param[in]  yspec    YANG spec
- * @retval  2  OK and rule matches permit
- * @retval  1  OK and rule matches deny
- * @retval  0  OK and rule does not match
- * @retval -1  Error
+ * @param[in]  nf     Filter
+ * @param[in]  level  Tree level of node, with path state set
+ * @param[in]  action Rule action
+ * @retval     1      A rule with the action may match
+ * @retval     0      No rule with the action matches
  */
 static int
-nacm_data_write_xrule_xml(cxobj       *xn,
-                          cxobj       *xrule,
-                          clixon_xvec *xpathvec,
-                          yang_stmt   *yspec)
+nacm_filter_may(struct nacm_filter *nf,
+                int                 level,
+                enum nacm_action    action)
 {
-    int        retval = -1;
-    yang_stmt *ymod;
-    char      *module_pattern; /* rule module name */
-    char      *action;
-    cxobj     *xp;
-    int        i;
+    int i;
 
-    if ((module_pattern = xml_find_body(xrule, "module-name")) == NULL)
-        goto nomatch;
-    /* 6a) The rule's "module-name" leaf is "*" or equals the name of
-     * the YANG module where the requested data node is defined. 
-     */
-    if (strcmp(module_pattern, "*") != 0){
-        if (ys_module_by_xml(yspec, xn, &ymod) < 0)
-            goto done;
-        /* ymod is NULL (xn is "config") Can this breach the NACM rule? */
-        if (ymod && strcmp(yang_argument_get(ymod), module_pattern) != 0)
-            goto nomatch;
-    }
-    action = xml_find_body(xrule, "action"); /* mandatory */
-    /*  6b) Either (1) the rule does not have a "rule-type" defined or
-        (2) the "rule-type" is "data-node" and the "path" matches the
-        Requested data node, action node, or notification node. */    
-    if (xml_find_type(xrule, NULL, "path", CX_ELMNT) == NULL){
-        if (strcmp(action, "deny")==0)
-            goto deny;
-        goto permit;
-    }
-    for (i=0; i<clixon_xvec_len(xpathvec); i++){
-        xp = clixon_xvec_i(xpathvec, i);
-        /* Check if ancestor is xp (for every xpathvec?) */
-        if (xn == xp || xml_isancestor(xn, xp)){
-            if (strcmp(action, "deny")==0)
-                goto deny;
-            goto permit;
-        }
-    }
-    goto nomatch;
- permit:
-    retval = 2;       /* rule match and permit */
- done:
-    return retval;
- nomatch :  /* rule does not match */
-    retval = 0;
-    goto done;
- deny:      /* rule match and deny */
-    retval = 1;
-    goto done;
+    for (i=0; i<nf->nf_nrules; i++)
+        if (nf->nf_rules[i]->nr_action == action &&
+            NF_STATE(nf, level)[i] != NACM_PATH_DEAD)
+            return 1;
+    return 0;
 }
 
+/*---------------------------------------------------------------
+ * Datanode write
+ */
+
 /*! Recursive check for NACM write rules among all XML nodes
  *
- * @param[in]  h         Clixon handle
- * @param[in]  xn        XML node (requested node)
- * @param[in]  rulevec   Precomputed rules that apply to this user group
- * @param[in]  xpathvec  Precomputed xpath results that apply to this XML tree
+ * A subtree is accepted without being traversed if no rule may deny any node in it, and
+ * either write-default is permit, or the rule permitting the node matches all modules.
+ * @param[in]  nf        Filter with write rules of user
+ * @param[in]  xn        XML node (requested node), with path state set at level
+ * @param[in]  level     Tree level of xn
+ * @param[in]  rule      First rule matching xn, or NULL
  * @param[in]  defpermit 0 if default deny, 1 is default permit
- * @param[in]  yspec     YANG spec
  * @param[out] cbret     Error message if retval = 0
  * @retval     1         OK and accept
  * @retval     0         Deny and cbret set
  * @retval    -1         Error
- * XXX differentiate between nomatch: default. or match deny, match accept 
- * nomatch: check write-default rules, next v
- * accept:  Hunky dory
- * deny:    Send error message
  */
 static int
-nacm_datanode_write_recurse(clixon_handle h,
-                            cxobj        *xn,
-                            prepvec      *pv_list,
-                            int           defpermit,
-                            yang_stmt    *yspec,
-                            cbuf         *cbret)
+nacm_datanode_write_recurse(struct nacm_filter *nf,
+                            cxobj              *xn,
+                            int                 level,
+                            struct nacm_rule   *rule,
+                            int                 defpermit,
+                            cbuf               *cbret)
 {
-    int       retval = -1;
-    cxobj   *x;
-    int      ret = 0;
-    prepvec *pv;
+    int               retval = -1;
+    cxobj            *x;
+    struct nacm_rule *rc;
+    int               ret;
 
-    pv = pv_list;
-    if (pv){
-        do {
-            /* return values: -1:Error /0:no match /1: deny /2: permit
-             */
-            if ((ret = nacm_data_write_xrule_xml(xn, pv->pv_xrule, pv->pv_xpathvec, yspec)) < 0)
-                goto done;
-            switch(ret){
-            case 0: /* No match, continue with next rule */
-                break;
-            case 1: /* Match and deny: break all traversal and send error back to client */
-                if (netconf_access_denied(cbret, "application", "access denied") < 0)
-                    goto done;
-                goto deny;
-                break;
-            case 2: /* Match and permit: break rule processing but continue recursion */
-                break;
-            }
-            if (ret == 2)
-                break;
-            pv = NEXTQ(prepvec *, pv);
-        } while (pv && pv != pv_list);
+    if (rule != NULL && rule->nr_action == NACM_ACTION_DENY){
+        /* Match and deny: break all traversal and send error back to client */
+        if (netconf_access_denied(cbret, "application", "access denied") < 0)
+            goto done;
+        goto deny;
     }
     /* If no rule match, check default rule: if deny then break traversal and send error */
-    if (ret == 0 && !defpermit){
+    if (rule == NULL && !defpermit){
         if (netconf_access_denied(cbret, "application", "default deny") < 0)
             goto done;
         goto deny;
     }
-    /* If node should be purged, dont recurse and defer removal to caller */
+    /* Short-circuit subtree that no rule may deny */
+    if (!nacm_filter_may(nf, level, NACM_ACTION_DENY) &&
+        (defpermit || (rule && strcmp(rule->nr_module, "*") == 0)))
+        goto accept;
+    if (nacm_filter_enter(nf, level, xn) < 0)
+        goto done;
     x = NULL;   /* Recursively check XML */
     while ((x = xml_child_each(xn, x, CX_ELMNT)) != NULL) {
-        if ((ret = nacm_datanode_write_recurse(h, x, pv_list,
-                                               defpermit, yspec, cbret)) < 0)
+        if (nacm_filter_match(nf, level, x, &rc) < 0)
+            goto done;
+        if (nacm_filter_down(nf, level, x) < 0)
+            goto done;
+        if ((ret = nacm_datanode_write_recurse(nf, x, level+1, rc, defpermit, cbret)) < 0)
             goto done;
         if (ret == 0)
             goto deny;
     }
+ accept:
     retval = 1; /* accept */
  done:
     return retval;
@@ -671,6 +1326,8 @@ nacm_datanode_write_recurse(clixon_handle h,
  *
  * The operations of NACM are: create, read, update, delete, exec
  *  where write is short-hand for create+delete+update
+ * Rule paths are matched level by level from the top of xt down to xreq and its
+ * descendants, see nacm_filter_step.
  * @param[in]  h        Clixon handle
  * @param[in]  xreq     XML requestor node (part of xt) for delete it is existing, for others it is new
  * @param[in]  xt       XML request root tree with "config" label at top.
@@ -694,24 +1351,26 @@ nacm_datanode_write(clixon_handle    h,
                     cxobj           *xnacm,
                     cbuf            *cbret)
 {
-    int             retval = -1;
-    cxobj         **gvec = NULL; /* groups */
-    size_t          glen;
-    cxobj         **rlistvec = NULL; /* rule-list */
-    size_t          rlistlen;
-    cxobj         **rvec = NULL; /* rules */
-    char           *write_default = NULL;
-    cvec           *nsc = NULL;
-    int             ret;
-    prepvec        *pv_list = NULL;
+    int                retval = -1;
+    char              *write_default = NULL;
+    int                ret;
+    nacm_ruleset      *rs = NULL;
+    struct nacm_user  *nu;
+    struct nacm_filter nf = {0,};
+    struct nacm_rule  *rule = NULL;
+    cxobj            **xanc = NULL;
+    cxobj             *x;
+    int                bit;
+    int                nanc = 0;
+    int                level;
+    int                i;
 
-    /* Create namespace context for with nacm namespace as default */
-    if ((nsc = xml_nsctx_init(NULL, NACM_NS)) == NULL)
-        goto done;
     if (xnacm == NULL)
         goto permit;
+    if ((rs = nacm_ruleset_get(clicon_dbspec_yang(h), xnacm)) == NULL)
+        goto done;
     /* write-default (create, update, or delete) has default deny so should never be NULL */
-    if ((write_default = xml_find_body(xnacm, "write-default")) == NULL){
+    if ((write_default = rs->rs_write_default) == NULL){
         clixon_err(OE_XML, EINVAL, "No nacm write-default rule");
         goto done;
     }
@@ -722,26 +1381,61 @@ nacm_datanode_write(clixon_handle    h,
        transport layer.)               */
     if (username == NULL)
         goto step9;
-    /* User's group */
-    if (xpath_vec(xnacm, nsc, "groups/group[user-name='%s']", &gvec, &glen, username) < 0)
-        goto done;
     /* 4. If no groups are found, continue with step 9. */
-    if (glen == 0)
+    if ((nu = nacm_user_get(rs, username)) == NULL)
         goto step9;
     /* 5. Process all rule-list entries, in the order they appear in the
         configuration.  If a rule-list's "group" leaf-list does not
         match any of the user's groups, proceed to the next rule-list
-        entry. */
-    if (xpath_vec(xnacm, nsc, "rule-list", &rlistvec, &rlistlen) < 0)
-        goto done;
-    /* First run through rules and cache rules as well as lookup objects in xt. 
+        entry. 
      */
-    if (nacm_datanode_prepare(h, xt, access, gvec, glen, rlistvec, rlistlen, nsc, &pv_list) < 0)
+    switch (access){
+    case NACM_CREATE:
+        bit = NACM_OP_CREATE;
+        break;
+    case NACM_DELETE:
+        bit = NACM_OP_DELETE;
+        break;
+    case NACM_UPDATE:
+        bit = NACM_OP_UPDATE;
+        break;
+    default:
+        clixon_err(OE_XML, EINVAL, "Access %d unupported (shouldnt happen)", access);
         goto done;
-    /* Then recursivelyy traverse all requested nodes */
-    if ((ret = nacm_datanode_write_recurse(h, xreq, pv_list,
+        break;
+    }
+    if (nacm_filter_init(&nf, clicon_dbspec_yang(h), nu, bit) < 0)
+        goto done;
+    /* Path state of ancestors of xreq from top of xt */
+    for (x = xreq; x != xt && (x = xml_parent(x)) != NULL; )
+        nanc++;
+    if (nanc && (xanc = calloc(nanc, sizeof(*xanc))) == NULL){
+        clixon_err(OE_UNIX, errno, "calloc");
+        goto done;
+    }
+    i = nanc;
+    for (x = xreq; i > 0; i--)
+        xanc[i-1] = x = xml_parent(x);
+    level = 0;
+    if (xreq == xt){ /* Top of tree, only rules without path match */
+        if (nacm_filter_match(&nf, 0, xt, &rule) < 0)
+            goto done;
+    }
+    else {
+        for (i=1; i<=nanc; i++){
+            if (nacm_filter_enter(&nf, level, xanc[i-1]) < 0)
+                goto done;
+            x = (i < nanc) ? xanc[i] : xreq;
+            if (i == nanc && nacm_filter_match(&nf, level, x, &rule) < 0)
+                goto done;
+            if (nacm_filter_down(&nf, level, x) < 0)
+                goto done;
+            level++;
+        }
+    }
+    /* Then recursively traverse all requested nodes */
+    if ((ret = nacm_datanode_write_recurse(&nf, xreq, level, rule,
                                            strcmp(write_default, "deny"),
-                                           clicon_dbspec_yang(h),
                                            cbret)) < 0)
         goto done;
     if (ret == 0) /* deny */
@@ -771,16 +1465,11 @@ nacm_datanode_write(clixon_handle    h,
     retval = 1;
  done:
     clixon_debug(CLIXON_DBG_NACM, "retval:%d (0:deny 1:permit)", retval);
-    if (pv_list)
-        prepvec_free(pv_list);
-    if (nsc)
-        xml_nsctx_free(nsc);
-    if (gvec)
-        free(gvec);
-    if (rlistvec)
-        free(rlistvec);
-    if (rvec)
-        free(rvec);
+    nacm_filter_free(&nf);
+    if (xanc)
+        free(xanc);
+    if (rs)
+        nacm_ruleset_unref(rs);
     return retval;
  deny: /* Here, cbret must contain a netconf error msg */
     assert(cbuf_len(cbret));
@@ -794,25 +1483,22 @@ nacm_datanode_write(clixon_handle    h,
 
 /*! Perform NACM action: mark if permit, del if deny
  *
- * @param[in] xrule    NACM rule
+ * @param[in] rule     NACM rule
  * @param[in] xn       XML node (requested node)
  * @retval    0        OK
  * @retval   -1        Error
 
  */
 static int
-nacm_data_read_action(cxobj *xrule,
-                      cxobj *xn)
+nacm_data_read_action(struct nacm_rule *rule,
+                      cxobj            *xn)
 {
     int   retval = -1;
-    char *action;
 
-    if ((action = xml_find_body(xrule, "action")) != NULL){
-        if (strcmp(action, "deny")==0)
-            xml_flag_set(xn, XML_FLAG_DEL);
-        else if (strcmp(action, "permit")==0)
-            xml_flag_set(xn, XML_FLAG_MARK);
-    }
+    if (rule->nr_action == NACM_ACTION_DENY)
+        xml_flag_set(xn, XML_FLAG_DEL);
+    else if (rule->nr_action == NACM_ACTION_PERMIT)
+        xml_flag_set(xn, XML_FLAG_MARK);
     retval = 0;
     //done:
     return retval;
@@ -821,7 +1507,8 @@ nacm_data_read_action(cxobj *xrule,
 /*! Match specific rule to specific requested node
  *
  * @param[in]  xn       XML node (requested node)
- * @param[in]  xrule    NACM rule
+ * @param[in]  rule     NACM rule
+ * @param[in]  xpathvec Nodes matching the path of the rule
  * @param[in]  yspec    YANG spec
  * @retval     1        OK and rule matches
  * @retval     0        OK and rule does not match
@@ -833,10 +1520,10 @@ nacm_data_read_action(cxobj *xrule,
  *     mark all permit rules and ancestors, remove everything else
  */
 static int
-nacm_data_read_xrule_xml(cxobj        *xn,
-                         cxobj        *xrule,
-                         clixon_xvec  *xpathvec,
-                         yang_stmt    *yspec)
+nacm_data_read_xrule_xml(cxobj            *xn,
+                         struct nacm_rule *rule,
+                         clixon_xvec      *xpathvec,
+                         yang_stmt        *yspec)
 {
     int        retval = -1;
     yang_stmt *ymod;
@@ -844,7 +1531,7 @@ nacm_data_read_xrule_xml(cxobj        *xn,
     cxobj     *xp;
     int        i;
 
-    if ((module_pattern = xml_find_body(xrule, "module-name")) == NULL)
+    if ((module_pattern = rule->nr_module) == NULL)
         goto nomatch;
     /* 6a) The rule's "module-name" leaf is "*" or equals the name of
      * the YANG module where the requested data node is defined. 
@@ -858,8 +1545,8 @@ nacm_data_read_xrule_xml(cxobj        *xn,
     /*  6b) Either (1) the rule does not have a "rule-type" defined or
         (2) the "rule-type" is "data-node" and the "path" matches the
         requested data node, action node, or notification node. */    
-    if (xml_find_type(xrule, NULL, "path", CX_ELMNT) == NULL){
-        if (nacm_data_read_action(xrule, xn) < 0)
+    if (!rule->nr_haspath){
+        if (nacm_data_read_action(rule, xn) < 0)
             goto done;
         goto match;
     }
@@ -867,7 +1554,7 @@ nacm_data_read_xrule_xml(cxobj        *xn,
         xp = clixon_xvec_i(xpathvec, i);
         /* Check if ancestor is xp (for every xpathvec?) */
         if (xn == xp || xml_isancestor(xn, xp)){
-            if (nacm_data_read_action(xrule, xn) < 0)
+            if (nacm_data_read_action(rule, xn) < 0)
                 goto done;
             goto match;
         }
@@ -883,7 +1570,6 @@ nacm_data_read_xrule_xml(cxobj        *xn,
 
 /*! Recursive check for NACM read rules among all XML nodes
  *
- * @param[in]  h        Clixon handle
  * @param[in]  xn       XML node (requested node)
  * @param[in]  pv_list  Precomputed rules + paths that apply to this user group
  * @param[in]  yspec    YANG spec
@@ -891,8 +1577,7 @@ nacm_data_read_xrule_xml(cxobj        *xn,
  * @retval    -1        Error
  */
 static int
-nacm_datanode_read_recurse(clixon_handle h,
-                           cxobj        *xn,
+nacm_datanode_read_recurse(cxobj        *xn,
                            prepvec      *pv_list,
                            yang_stmt    *yspec)
 {
@@ -907,7 +1592,7 @@ nacm_datanode_read_recurse(clixon_handle h,
         if (pv){
             do {
                 if ((ret = nacm_data_read_xrule_xml(xn,
-                                                    pv->pv_xrule,
+                                                    pv->pv_rule,
                                                     pv->pv_xpathvec,
                                                     yspec)) < 0)
                     goto done;
@@ -930,7 +1615,7 @@ nacm_datanode_read_recurse(clixon_handle h,
         x = NULL;       /* Recursively check XML */
         xprev = NULL;
         while ((x = xml_child_each(xn, x, CX_ELMNT)) != NULL) {
-            if (nacm_datanode_read_recurse(h, x, pv_list, yspec) < 0)
+            if (nacm_datanode_read_recurse(x, pv_list, yspec) < 0)
                 goto done;
             /* check for delayed remove */
             if (xml_flag(x, XML_FLAG_DEL)){
@@ -948,7 +1633,7 @@ nacm_datanode_read_recurse(clixon_handle h,
 /*! Make nacm datanode and module rule read access validation
  *
  * Just purge nodes that fail validation (dont send netconf error message)
- * @param[in]  h        Clixon handle
+ * @param[in]  yspec    Yang spec
  * @param[in]  xt       XML root tree with "config" label 
  * @param[in]  xrvec    Vector of requested nodes (sub-part of xt)
  * @param[in]  xrlen    Length of requsted node vector
@@ -990,12 +1675,13 @@ nacm_datanode_read_recurse(clixon_handle h,
  * 7. If remaining nodes, goto 1
  * 8(B) If default rule is deny, recursively remove all subtrees that are not marked
  *
+ * @note Does not access the clixon handle, may be called from a backend worker thread
  * @see RFC8341 3.4.5.  Data Node Access Validation
  * @see nacm_datanode_write
  * @see nacm_rpc
  */
 int
-nacm_datanode_read(clixon_handle h,
+nacm_datanode_read(yang_stmt    *yspec,
                    cxobj        *xt,
                    cxobj       **xrvec,
                    size_t        xrlen,
@@ -1003,17 +1689,12 @@ nacm_datanode_read(clixon_handle h,
                    cxobj        *xnacm)
 {
     int             retval = -1;
-    cxobj         **gvec = NULL; /* groups */
-    size_t          glen;
-    cxobj         **rlistvec = NULL; /* rule-list */
-    size_t          rlistlen;
     int             i;
     char           *read_default = NULL;
-    cvec           *nsc = NULL;
     prepvec        *pv_list = NULL;
+    nacm_ruleset   *rs = NULL;
 
-    /* Create namespace context for with nacm namespace as default */
-    if ((nsc = xml_nsctx_init(NULL, NACM_NS)) == NULL)
+    if ((rs = nacm_ruleset_get(yspec, xnacm)) == NULL)
         goto done;
     /* 3.   Check all the "group" entries to see if any of them contain a
        "user-name" entry that equals the username for the session
@@ -1022,29 +1703,24 @@ nacm_datanode_read(clixon_handle h,
        transport layer.)               */
     if (username == NULL)
         goto step9;
-    /* User's group */
-    if (xpath_vec(xnacm, nsc, "groups/group[user-name='%s']", &gvec, &glen, username) < 0)
-        goto done;
-    /* 4. If no groups are found (glen=0), continue and check read-default 
+    /* 4. If no groups are found (no user rules), continue and check read-default 
           in step 11. */
     /* 5. Process all rule-list entries, in the order they appear in the
         configuration.  If a rule-list's "group" leaf-list does not
         match any of the user's groups, proceed to the next rule-list
         entry. */
-    if (xpath_vec(xnacm, nsc, "rule-list", &rlistvec, &rlistlen) < 0)
-        goto done;
     /* read-default has default permit so should never be NULL */
-    if ((read_default = xml_find_body(xnacm, "read-default")) == NULL){
+    if ((read_default = rs->rs_read_default) == NULL){
         clixon_err(OE_XML, EINVAL, "No nacm read-default rule");
         goto done;
     }
     /* First run through rules and cache rules as well as lookup objects in xt. 
      * DANGER: objects could be stale if they are removed?
      */
-    if (nacm_datanode_prepare(h, xt, NACM_READ, gvec, glen, rlistvec, rlistlen, nsc, &pv_list) < 0)
+    if (nacm_datanode_prepare(xt, NACM_READ, nacm_user_get(rs, username), yspec, &pv_list) < 0)
         goto done;
     /* Then recursivelyy traverse all nodes */
-    if (nacm_datanode_read_recurse(h, xt, pv_list, clicon_dbspec_yang(h)) < 0)
+    if (nacm_datanode_read_recurse(xt, pv_list, yspec) < 0)
         goto done;
 #if 1
     /* Step 8(B) above:
@@ -1077,12 +1753,257 @@ nacm_datanode_read(clixon_handle h,
     clixon_debug(CLIXON_DBG_NACM, "retval:%d", retval);
     if (pv_list)
         prepvec_free(pv_list);
-    if (nsc)
-        xml_nsctx_free(nsc);
-    if (gvec)
-        free(gvec);
-    if (rlistvec)
-        free(rlistvec);
+    if (rs)
+        nacm_ruleset_unref(rs);
+    return retval;
+}
+
+/*---------------------------------------------------------------
+ * Datanode read fused with copy from datastore cache
+ */
+
+/* Source node being copied. Its copy is made when the first readable node in its
+ * subtree is found, or directly if the node itself is readable.
+ */
+struct nacm_rcopy{
+    cxobj             *rc_x0;       /* Source node */
+    cxobj             *rc_x1;       /* Copy, or NULL if not yet made */
+    struct nacm_rcopy *rc_up;       /* Parent */
+    int                rc_level;    /* Tree level of rc_x0 */
+};
+
+/*! Copy an element with its attributes and body but without element children
+ *
+ * @param[in]  x0     Source node
+ * @param[in]  x1p    Parent of copy
+ * @param[out] x1     Copy
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+static int
+nacm_rcopy_one(cxobj  *x0,
+               cxobj  *x1p,
+               cxobj **x1)
+{
+    cxobj *x;
+    cxobj *xc;
+    int    inext;
+
+    if ((*x1 = xml_new(xml_name(x0), x1p, CX_ELMNT)) == NULL)
+        return -1;
+    if (xml_copy_one(x0, *x1) < 0)
+        return -1;
+    inext = 0;
+    while ((x = xml_child_iter(x0, &inext, -1)) != NULL) {
+        if (xml_type(x) == CX_ELMNT)
+            continue;
+        if ((xc = xml_new(xml_name(x), *x1, xml_type(x))) == NULL)
+            return -1;
+        if (xml_copy_one(x, xc) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+/*! Make copy of a source node and its ancestors, if not already made
+ *
+ * Keys of list entries are copied with the entry, unless denied
+ * @param[in]  nf     Filter with read rules of user
+ * @param[in]  rc     Source node
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+static int
+nacm_rcopy_make(struct nacm_filter *nf,
+                struct nacm_rcopy  *rc)
+{
+    yang_stmt        *y;
+    cvec             *cvk;
+    cg_var           *cvi;
+    cxobj            *xk;
+    cxobj            *x1k;
+    struct nacm_rule *rule;
+
+    if (rc->rc_x1 != NULL)
+        return 0;
+    if (nacm_rcopy_make(nf, rc->rc_up) < 0)
+        return -1;
+    if (nacm_rcopy_one(rc->rc_x0, rc->rc_up->rc_x1, &rc->rc_x1) < 0)
+        return -1;
+    if ((y = xml_spec(rc->rc_x0)) == NULL || yang_keyword_get(y) != Y_LIST)
+        return 0;
+    cvk = yang_cvec_get(y); /* Use Y_LIST cache, see ys_populate_list() */
+    cvi = NULL;
+    while ((cvi = cvec_each(cvk, cvi)) != NULL) {
+        if ((xk = xml_find_type(rc->rc_x0, NULL, cv_string_get(cvi), CX_ELMNT)) == NULL)
+            continue;
+        if (nacm_filter_match(nf, rc->rc_level, xk, &rule) < 0)
+            return -1;
+        if (rule && rule->nr_action == NACM_ACTION_DENY)
+            continue;
+        if ((x1k = xml_new(xml_name(xk), rc->rc_x1, CX_ELMNT)) == NULL)
+            return -1;
+        if (xml_copy(xk, x1k) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+/*! Copy readable children of a source node
+ *
+ * A child is selected if it or an ancestor is marked with XML_FLAG_MARK, if it is
+ * marked with XML_FLAG_CHANGE, or if it is a key of a selected list entry.
+ * A denied child is not copied and its subtree is not visited.
+ * A permitted child is copied, and its subtree is readable except denied nodes.
+ * Other children are copied if readable by default, otherwise they are only visited to
+ * find permitted descendants, if any rule may permit them.
+ * @param[in]  nf     Filter with read rules of user
+ * @param[in]  rc     Source node
+ * @param[in]  sel    Source node or an ancestor is selected
+ * @param[in]  kept   Source node is readable
+ * @retval     0      OK
+ * @retval    -1      Error
+ * @see xml_copy_marked
+ */
+static int
+nacm_rcopy_recurse(struct nacm_filter *nf,
+                   struct nacm_rcopy  *rc,
+                   int                 sel,
+                   int                 kept)
+{
+    int               retval = -1;
+    struct nacm_rcopy rcc;
+    cxobj            *x0 = rc->rc_x0;
+    cxobj            *xc;
+    cxobj            *x1c;
+    yang_stmt        *y0;
+    int               level = rc->rc_level;
+    int               inext;
+    int               islist;
+    int               iskey;
+    int               csel;
+    int               ckept;
+    struct nacm_rule *rule;
+    enum nacm_action  action;
+
+    y0 = xml_spec(x0);
+    islist = y0 && yang_keyword_get(y0) == Y_LIST;
+    if (nacm_filter_enter(nf, level, x0) < 0)
+        goto done;
+    inext = 0;
+    while ((xc = xml_child_iter(x0, &inext, CX_ELMNT)) != NULL) {
+        csel = sel || xml_flag(xc, XML_FLAG_MARK);
+        iskey = 0;
+        if (islist && (iskey = yang_key_match(y0, xml_name(xc), NULL)) < 0)
+            goto done;
+        if (!csel && !xml_flag(xc, XML_FLAG_CHANGE)){
+            if (!iskey)
+                continue;
+            csel = 1;
+        }
+        if (nacm_filter_match(nf, level, xc, &rule) < 0)
+            goto done;
+        action = rule ? rule->nr_action : NACM_ACTION_NONE;
+        if (action == NACM_ACTION_DENY)
+            continue;
+        if (!kept && iskey){ /* Keys are copied with the entry, see nacm_rcopy_make */
+            if (action == NACM_ACTION_PERMIT && nacm_rcopy_make(nf, rc) < 0)
+                goto done;
+            continue;
+        }
+        ckept = kept || action == NACM_ACTION_PERMIT;
+        if (nacm_filter_down(nf, level, xc) < 0)
+            goto done;
+        rcc.rc_x0 = xc;
+        rcc.rc_x1 = NULL;
+        rcc.rc_up = rc;
+        rcc.rc_level = level + 1;
+        if (!ckept){
+            /* Not readable, skip subtree unless a rule may permit a descendant */
+            if (nacm_filter_may(nf, level+1, NACM_ACTION_PERMIT) &&
+                nacm_rcopy_recurse(nf, &rcc, csel, 0) < 0)
+                goto done;
+            continue;
+        }
+        if (nacm_rcopy_make(nf, rc) < 0)
+            goto done;
+        if (!nacm_filter_may(nf, level+1, NACM_ACTION_DENY)){
+            /* No rule may deny a descendant, copy subtree as is */
+            if ((x1c = xml_new(xml_name(xc), rc->rc_x1, CX_ELMNT)) == NULL)
+                goto done;
+            if (csel){
+                if (xml_copy(xc, x1c) < 0)
+                    goto done;
+            }
+            else if (xml_copy_marked(xc, x1c) < 0)
+                goto done;
+            continue;
+        }
+        if (nacm_rcopy_one(xc, rc->rc_x1, &rcc.rc_x1) < 0)
+            goto done;
+        if (nacm_rcopy_recurse(nf, &rcc, csel, 1) < 0)
+            goto done;
+    }
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Copy marked nodes from a datastore tree, omitting nodes the user may not read
+ *
+ * Same result as copying the marked nodes with xml_copy_marked and then calling
+ * nacm_datanode_read on the copy, but denied subtrees are never copied, and subtrees
+ * that no rule may permit (with read-default deny) are not visited.
+ * Rule paths are matched one step per tree level instead of being searched in the tree.
+ * @param[in]  h        Clixon handle
+ * @param[in]  x0t      Source tree with nodes marked with XML_FLAG_MARK and their
+ *                      ancestors with XML_FLAG_CHANGE. Not modified.
+ * @param[in]  x1t      Top of copy
+ * @param[in]  username User name, if NULL nothing is copied
+ * @param[in]  xnacm    NACM xml tree
+ * @retval     0        OK
+ * @retval    -1        Error
+ * @see nacm_datanode_read
+ * @see xmldb_get_nacm
+ */
+int
+nacm_datanode_read_copy(clixon_handle h,
+                        cxobj        *x0t,
+                        cxobj        *x1t,
+                        char         *username,
+                        cxobj        *xnacm)
+{
+    int                retval = -1;
+    nacm_ruleset      *rs = NULL;
+    yang_stmt         *yspec;
+    struct nacm_filter nf = {0,};
+    struct nacm_rcopy  rc = {0,};
+    int                permit;
+
+    yspec = clicon_dbspec_yang(h);
+    if ((rs = nacm_ruleset_get(yspec, xnacm)) == NULL)
+        goto done;
+    /* read-default has default permit so should never be NULL */
+    if (rs->rs_read_default == NULL){
+        clixon_err(OE_XML, EINVAL, "No nacm read-default rule");
+        goto done;
+    }
+    permit = strcmp(rs->rs_read_default, "deny") != 0;
+    if (username == NULL)
+        goto ok;
+    if (nacm_filter_init(&nf, yspec, nacm_user_get(rs, username), NACM_OP_READ) < 0)
+        goto done;
+    rc.rc_x0 = x0t;
+    rc.rc_x1 = x1t;
+    if (nacm_rcopy_recurse(&nf, &rc, xml_flag(x0t, XML_FLAG_MARK), permit) < 0)
+        goto done;
+ ok:
+    retval = 0;
+ done:
+    clixon_debug(CLIXON_DBG_NACM, "retval:%d", retval);
+    nacm_filter_free(&nf);
+    if (rs)
+        nacm_ruleset_unref(rs);
     return retval;
 }
 
@@ -1097,13 +2018,14 @@ nacm_datanode_read(clixon_handle h,
  * If retval=0 continue with next NACM step, eg rpc, module, 
  * etc. If retval = 1 access is OK and skip next NACM step.
  * @param[in]  h        Clixon handle
- * @param[in]  xnacm    NACM XML tree, root should be "nacm"
+ * @param[in]  rs       NACM ruleset
+ * @param[in]  peername Peer username if any
  * @param[in]  username User name of requestor
  * @retval     1        OK permitted. You do not need to do next NACM step
  * @retval     0        OK but not validated. Need to do NACM step using xnacm
  * @retval    -1        Error
  * @code
- *   if ((ret = nacm_access_check(h, mode, xnacm, peername, username)) < 0)
+ *   if ((ret = nacm_access_check(h, rs, peername, username)) < 0)
  *     err;
  *   if (ret == 0){
  *      // Next step NACM processing
@@ -1114,32 +2036,24 @@ nacm_datanode_read(clixon_handle h,
  */
 static int
 nacm_access_check(clixon_handle h,
-                  cxobj        *xnacm,
+                  nacm_ruleset *rs,
                   char         *peername,
                   char         *username)
 {
-    int     retval = -1;
-    char   *enabled;
-    cxobj  *x;
-    cvec  *nsc = NULL;
+    int    retval = -1;
     char  *recovery_user;
 #ifdef WITH_RESTCONF
     char  *wwwuser;
 #endif
 
     clixon_debug(CLIXON_DBG_NACM, "");
-    if ((nsc = xml_nsctx_init(NULL, NACM_NS)) == NULL)
-        goto done;
     /* Do initial nacm processing common to all access validation in
      * RFC8341 3.4 */
     /* 1.   If the "enable-nacm" leaf is set to "false", then the protocol
      * operation is permitted. 
      * note option CLICON_NACM_DISABLED_ON_EMPTY
     */
-    if ((x = xpath_first(xnacm, nsc, "enable-nacm")) == NULL)
-        goto permit;
-    enabled = xml_body(x);
-    if (strcmp(enabled, "true") != 0)
+    if (!rs->rs_enabled)
         goto permit;
     recovery_user=clicon_nacm_recovery_user(h);
     /* 2.   If the requesting session is identified as a recovery session,
@@ -1178,8 +2092,6 @@ nacm_access_check(clixon_handle h,
     }
     retval = 0; /* not permitted yet. continue with next NACM step */
  done:
-    if (nsc)
-        xml_nsctx_free(nsc);
     clixon_debug(CLIXON_DBG_NACM, "retval:%d (0:deny 1:permit)", retval);
     return retval;
  permit:
@@ -1192,9 +2104,11 @@ nacm_access_check(clixon_handle h,
  * Initial NACM steps and common to all NACM access validation.
  * If retval=0 continue with next NACM step, eg rpc, module, 
  * etc. If retval = 1 access is OK and skip next NACM step.
+ * The NACM config is compiled into a ruleset which is kept until the NACM config changes.
  * @param[in]  h        Clixon handle
+ * @param[in]  peername Peer username if any
  * @param[in]  username User name of requestor
- * @param[out] xncam    NACM XML tree, set if retval=0. Free after use
+ * @param[out] xncam    NACM XML tree, set if retval=0. Release with nacm_tree_release
  * @retval     1        OK permitted. You do not need to do next NACM step.
  * @retval     0        OK but not validated. Need to do NACM step using xnacm
  * @retval    -1        Error
@@ -1204,7 +2118,7 @@ nacm_access_check(clixon_handle h,
  *     err;
  *   if (ret == 0){
  *      // Next step NACM processing
- *      xml_free(xnacm);
+ *      nacm_tree_release(xnacm);
  *   }
  * @endcode
  * @see RFC8341 3.4 Access Control Enforcement Procedures
@@ -1215,12 +2129,9 @@ nacm_access_pre(clixon_handle  h,
                 char          *username,
                 cxobj        **xnacmp)
 {
-    int    retval = -1;
-    char  *mode;
-    cxobj *x;
-    cxobj *xnacm0 = NULL;
-    cxobj *xnacm = NULL;
-    cvec  *nsc = NULL;
+    int           retval = -1;
+    char         *mode;
+    nacm_ruleset *rs = NULL;
 
     /* Check clixon option: disabled, external tree or internal */
     mode = clicon_option_str(h, "CLICON_NACM_MODE");
@@ -1228,50 +2139,82 @@ nacm_access_pre(clixon_handle  h,
         goto permit;
     else if (strcmp(mode, "disabled")==0)
         goto permit;
-    else if (strcmp(mode, "external")==0){
-        if ((x = clicon_nacm_ext(h)))
-            if ((xnacm0 = xml_dup(x)) == NULL)
-                goto done;
-    }
-    else if (strcmp(mode, "internal")==0){
-        if (xmldb_get0(h, "running", YB_MODULE, nsc, "nacm", 1, 0, &xnacm0, NULL, NULL) < 0)
-            goto done;
-    }
-    else{
-        clixon_err(OE_XML, 0, "Invalid NACM mode: %s", mode);
-        goto done;
-    }
-    if ((nsc = xml_nsctx_init(NULL, NACM_NS)) == NULL)
+    if (nacm_ruleset_current(h, mode, &rs) < 0)
         goto done;
     /* If config does not exist then the operation is permitted(?) */
-    if (xnacm0 == NULL)
+    if (rs->rs_xnacm == NULL)
         goto permit;
-    /* If config does not exist then the operation is permitted(?) */
-    if ((xnacm = xpath_first(xnacm0, nsc, "nacm")) == NULL)
-        goto permit;
-    if (xml_rootchild_node(xnacm0, xnacm) < 0)
-        goto done;
-    xnacm0 = NULL;
     /* Initial NACM steps and common to all NACM access validation. */
-    if ((retval = nacm_access_check(h, xnacm, peername, username)) < 0)
+    if ((retval = nacm_access_check(h, rs, peername, username)) < 0)
         goto done;
-    if (retval == 0){ /* if retval == 0 then return an xml nacm tree */
-        *xnacmp = xnacm;
-        xnacm = NULL;
+    if (retval == 0){ /* if retval == 0 then return the xml nacm tree of the ruleset */
+        pthread_mutex_lock(&_nacm_mutex);
+        rs->rs_refcnt++;
+        pthread_mutex_unlock(&_nacm_mutex);
+        *xnacmp = rs->rs_xnacm;
     }
  done:
-    if (nsc)
-        xml_nsctx_free(nsc);
-    if (xnacm0)
-        xml_free(xnacm0);
-    else if (xnacm)
-        xml_free(xnacm);
     return retval;
  permit:
     retval = 1;
     goto done;
 }
 
+/*! Take another reference to a NACM tree, eg to use it in another thread
+ *
+ * The tree and its compiled ruleset are kept also if the NACM config changes.
+ * A tree that is not from nacm_access_pre is copied.
+ * @param[in]  xnacm  NACM XML tree, from nacm_access_pre
+ * @retval     xnacm  NACM XML tree, release with nacm_tree_release
+ * @retval     NULL   Error
+ */
+cxobj *
+nacm_tree_hold(cxobj *xnacm)
+{
+    if (nacm_ruleset_find(xnacm) != NULL)
+        return xnacm;
+    return xml_dup(xnacm);
+}
+
+/*! Release NACM tree from nacm_access_pre or nacm_tree_hold
+ *
+ * @param[in]  xnacm  NACM XML tree
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+int
+nacm_tree_release(cxobj *xnacm)
+{
+    nacm_ruleset *rs;
+
+    if (xnacm == NULL)
+        return 0;
+    if ((rs = nacm_ruleset_find(xnacm)) == NULL){
+        xml_free(xnacm);
+        return 0;
+    }
+    /* Release both the reference of find and of the caller */
+    if (nacm_ruleset_unref(rs) < 0)
+        return -1;
+    return nacm_ruleset_unref(rs);
+}
+
+/*! Free compiled NACM config on exit
+ *
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+int
+nacm_exit(void)
+{
+    nacm_ruleset *rs;
+
+    if ((rs = _nacm_current) == NULL)
+        return 0;
+    _nacm_current = NULL;
+    return nacm_ruleset_unref(rs);
+}
+
 /*! Verify nacm user with  peer uid credentials
  *
  * @param[in]  h         Clixon handle
@@ -141,24 +141,51 @@ netconf_input_msg2(unsigned char      **bufp,
                    int                 *eom)
 {
     int       retval = -1;
-    int       i;
+    size_t    i;
+    size_t    n;
     int       ret;
     int       found = 0;
     size_t    len;
+    char     *buf;
+    char     *p;
     char      ch;
 
     clixon_debug(CLIXON_DBG_DEFAULT | CLIXON_DBG_DETAIL, "");
     len = *lenp;
-    for (i=0; i<len; i++){
-        if ((ch = (*bufp)[i]) == 0)
-            continue; /* Skip NULL chars (eg from terminals) */
-        if (framing_type == NETCONF_SSH_CHUNKED){
+    buf = (char*)*bufp;
+    if (framing_type != NETCONF_SSH_CHUNKED){
+        i = detect_endtag_buf("]]>]]>", buf, len, cbmsg, frame_state, &found);
+        if (found){
+            *frame_state = 0;
+            /* OK, we have an xml string from a client */
+            /* Remove trailer */
+            *(((char*)cbuf_get(cbmsg)) + cbuf_len(cbmsg) - strlen("]]>]]>")) = '\0';
+        }
+    }
+    else{
+        for (i=0; i<len; ){
+            /* Copy chunk-data in blocks */
+            if (*frame_state == 4 && *frame_size > 0){
+                n = len - i;
+                if (n > *frame_size)
+                    n = *frame_size;
+                if ((p = memchr(buf + i, '\0', n)) != NULL)
+                    n = p - (buf + i);
+                if (n > 0){
+                    cbuf_append_buf(cbmsg, buf + i, n);
+                    *frame_size -= n;
+                    i += n;
+                    continue;
+                }
+            }
+            if ((ch = buf[i++]) == 0)
+                continue; /* Skip NULL chars (eg from terminals) */
             /* Track chunked framing defined in RFC6242 */
             if ((ret = netconf_input_chunked_framing(ch, frame_state, frame_size)) < 0)
                 goto done;
             switch (ret){
             case 1: /* chunk-data */
-                cprintf(cbmsg, "%c", ch);
+                cbuf_append(cbmsg, ch);
                 break;
             case 2: /* end-of-data */
                 /* Somewhat complex error-handling:
@@ -169,22 +196,10 @@ netconf_input_msg2(unsigned char      **bufp,
             default:
                 break;
             }
-        }
-        else{
-            cprintf(cbmsg, "%c", ch);
-            if (detect_endtag("]]>]]>", ch, frame_state)){
-                *frame_state = 0;
-                /* OK, we have an xml string from a client */
-                /* Remove trailer */
-                *(((char*)cbuf_get(cbmsg)) + cbuf_len(cbmsg) - strlen("]]>]]>")) = '\0';
-                found++;
-            }
-        }
-        if (found){
-            i++;
-            break;
-        }
-    } /* for */
+            if (found)
+                break;
+        } /* for */
+    }
     *bufp += i;
     *lenp -= i;
     *eom = found;
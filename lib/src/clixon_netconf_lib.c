@@ -51,6 +51,7 @@
 #include <stdint.h>
 #include <syslog.h>
 #include <sys/param.h>
+#include <sys/uio.h>
 
 /* cligen */
 #include <cligen/cligen.h>
@@ -77,6 +78,17 @@
 #include "clixon_yang_parse_lib.h"
 #include "clixon_plugin.h"
 #include "clixon_netconf_input.h"
+#include "clixon_proto.h"
+
+/* Flush threshold of netconf_output_xml, each flush is one chunk in chunked framing */
+#define NETCONF_OUTPUT_BUFLEN 65536
+
+/* Argument to netconf output sink */
+struct netconf_sink {
+    int                  ns_s;       /* Output socket */
+    netconf_framing_type ns_framing; /* Netconf framing */
+    char                *ns_msg;     /* Only for debug */
+};
 
 /* Mapping between RFC6243 withdefaults strings <--> ints
  */
@@ -2173,6 +2185,99 @@ netconf_output(int   s,
     return retval;
 }
             
+/*! Output sink writing buffered XML to a netconf socket with framing
+ *
+ * In chunked framing each flush is sent as one chunk, in EOM framing the data is
+ * sent as-is. The end-of-message marker is added on the last call.
+ * @param[in,out] cb    Buffered XML, reset after writing
+ * @param[in]     last  Set if last call, add end-of-message
+ * @param[in]     arg   struct netconf_sink
+ * @retval        0     OK
+ * @retval       -1     Error
+ * @see netconf_output_xml
+ */
+static int
+netconf_output_sink(cbuf *cb,
+                    int   last,
+                    void *arg)
+{
+    int                  retval = -1;
+    struct netconf_sink *ns = (struct netconf_sink *)arg;
+    struct iovec         iov[3];
+    int                  i = 0;
+    char                 hdr[32];
+    size_t               len;
+
+    len = cbuf_len(cb);
+    clixon_debug(CLIXON_DBG_MSG, "Send ext %s: %s", ns->ns_msg, cbuf_get(cb));
+    if (len && ns->ns_framing == NETCONF_SSH_CHUNKED){
+        iov[i].iov_base = hdr;
+        iov[i++].iov_len = snprintf(hdr, sizeof(hdr), "\n#%zu\n", len);
+    }
+    iov[i].iov_base = cbuf_get(cb);
+    iov[i++].iov_len = len;
+    if (last){
+        switch (ns->ns_framing){
+        case NETCONF_SSH_EOM:
+            iov[i].iov_base = "]]>]]>";     /* RFC4742 end-of-message marker */
+            break;
+        case NETCONF_SSH_CHUNKED:
+            iov[i].iov_base = "\n##\n";   /* RFC6242 chunked-end */
+            break;
+        }
+        iov[i].iov_len = strlen(iov[i].iov_base);
+        i++;
+    }
+    if (clixon_writev(ns->ns_s, iov, i) < 0){
+        if (errno == EPIPE)
+            clixon_debug(CLIXON_DBG_DEFAULT, "write err SIGPIPE");
+        else
+            clixon_log(NULL, LOG_ERR, "%s: write: %s", __FUNCTION__, strerror(errno));
+        goto done;
+    }
+    cbuf_reset(cb);
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Serialize XML tree and send it with framing on a netconf socket, in bounded pieces
+ *
+ * Instead of serializing the whole tree into a buffer, framing it (which copies it)
+ * and writing it, the tree is written in pieces of at most NETCONF_OUTPUT_BUFLEN
+ * (approximately) as it is serialized.
+ * @param[in]   s       Socket
+ * @param[in]   framing Framing type, ie EOM(1.0) or chunked (1.1)
+ * @param[in]   xn      XML tree to send
+ * @param[in]   msg     Only for debug
+ * @retval      0       OK
+ * @retval     -1       Error
+ * @see netconf_output_encap  and netconf_output for the buffered variant
+ */
+int
+netconf_output_xml(int                  s,
+                   netconf_framing_type framing,
+                   cxobj               *xn,
+                   char                *msg)
+{
+    int                 retval = -1;
+    cbuf               *cb = NULL;
+    struct netconf_sink ns = {s, framing, msg};
+
+    if ((cb = cbuf_new()) == NULL){
+        clixon_err(OE_XML, errno, "cbuf_new");
+        goto done;
+    }
+    if (clixon_xml2sink(cb, xn, 0, 0, NULL, -1, 0, 0,
+                        NETCONF_OUTPUT_BUFLEN, netconf_output_sink, &ns) < 0)
+        goto done;
+    retval = 0;
+ done:
+    if (cb)
+        cbuf_free(cb);
+    return retval;
+}
+
 /*! Encapsulate and send outgoing netconf packet as cbuf on socket
  *
  * @param[in]   framing Framing type, ie EOM(1.0) or chunked (1.1)
@@ -66,6 +66,7 @@
 #include "clixon_options.h"
 #include "clixon_data.h"
 #include "clixon_datastore.h"
+#include "clixon_latency.h"
 #include "clixon_netconf_monitoring.h"
 
 static int
@@ -220,10 +221,15 @@ netconf_monitoring_statistics(clixon_handle h,
         cprintf(cb, "<out-rpc-errors>%u</out-rpc-errors>", cv_uint32_get(cv));
     if ((cv = cvec_find(cvv, "out-notifications")) != NULL)
         cprintf(cb, "<out-notifications>%u</out-notifications>", cv_uint32_get(cv));
+    /* Clixon extension: latency histograms */
+    cprintf(cb, "<latency xmlns=\"%s\">", CLIXON_LIB_NS);
+    if (clixon_latency_print(cb, NULL) < 0)
+        goto done;
+    cprintf(cb, "</latency>");
     cprintf(cb, "</statistics>");
  ok:
     retval = 0;
-    // done:
+ done:
     return retval;
 }
 
@@ -117,6 +117,24 @@ static const map_str2int nacm_credentials_map[] = {
     {NULL,        -1}
 };
 
+/* Mapping between backend output queue policy string <--> constants,
+ * see clixon-config.yang type output_queue_policy */
+static const map_str2int output_queue_policy_map[] = {
+    {"block",      OQ_BLOCK},
+    {"drop",       OQ_DROP},
+    {"disconnect", OQ_DISCONNECT},
+    {NULL,         -1}
+};
+
+/* Mapping between stream subscription queue policy string <--> constants,
+ * see clixon-config.yang type stream_queue_policy */
+static const map_str2int stream_queue_policy_map[] = {
+    {"drop-oldest", SQ_DROP_OLDEST},
+    {"drop-newest", SQ_DROP_NEWEST},
+    {"terminate",   SQ_TERMINATE},
+    {NULL,          -1}
+};
+
 /* Mapping between regular expression type string <--> constants, 
  * see clixon-config.yang type regexp_mode */
 static const map_str2int yang_regexp_map[] = {
@@ -988,6 +1006,38 @@ clicon_nacm_credentials(clixon_handle h)
     return clicon_str2int(nacm_credentials_map, mode);
 }
 
+/*! What to do when the output queue of a backend client is above its high-water mark
+ *
+ * @param[in] h       Clixon handle
+ * @retval    policy  Output queue policy
+ * @see clixon-config@<date>.yang CLICON_BACKEND_OUTPUT_QUEUE_POLICY
+ */
+enum output_queue_policy_t
+clicon_backend_output_queue_policy(clixon_handle h)
+{
+    char *str;
+
+    if ((str = clicon_option_str(h, "CLICON_BACKEND_OUTPUT_QUEUE_POLICY")) == NULL)
+        return OQ_BLOCK;
+    return clicon_str2int(output_queue_policy_map, str);
+}
+
+/*! What to do when the event queue of a stream subscription is full
+ *
+ * @param[in] h       Clixon handle
+ * @retval    policy  Stream queue policy
+ * @see clixon-config@<date>.yang CLICON_STREAM_QUEUE_POLICY
+ */
+enum stream_queue_policy_t
+clicon_stream_queue_policy(clixon_handle h)
+{
+    char *str;
+
+    if ((str = clicon_option_str(h, "CLICON_STREAM_QUEUE_POLICY")) == NULL)
+        return SQ_DROP_OLDEST;
+    return clicon_str2int(stream_queue_policy_map, str);
+}
+
 /*! Which Yang regexp/pattern engine to use
  *
  * @param[in] h     Clixon handle
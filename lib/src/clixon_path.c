@@ -1603,8 +1603,9 @@ instance_id_resolve(clixon_path *cplist,
  * @retval     1        OK with found xml nodes in xvec (if any)
  * @retval     0        Fail  fail: eg no yang 
  * @retval    -1        Error
+ * @see clixon_instance_id_parse  for creating cplist
  */
-static int
+int
 clixon_path_search(cxobj        *xt,
                    yang_stmt    *yt,
                    clixon_path  *cplist,
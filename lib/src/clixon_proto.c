@@ -42,6 +42,9 @@
 #include "clixon_config.h" /* generated by config & autoconf */
 #endif
 
+#ifdef HAVE_MEMFD_CREATE /* memfd_create and file seals */
+#define _GNU_SOURCE
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
@@ -52,11 +55,14 @@
 #include <syslog.h>
 #include <signal.h>
 #include <ctype.h>
+#include <poll.h>
 #include <sys/types.h>
 #include <sys/time.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/param.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
 #include <netinet/in.h>
 #include <sys/un.h>
 #include <arpa/inet.h>
@@ -77,9 +83,34 @@
 #include "clixon_sig.h"
 #include "clixon_netconf_lib.h"
 #include "clixon_xml_io.h"
+#include "clixon_xml_bin.h"
 #include "clixon_options.h"
 #include "clixon_proto.h"
 
+/*
+ * Constants
+ */
+/* Initial input buffer size of buffered message reader */
+#define CLICON_MSG_READER_BUFSIZ 65536
+
+/* Body of message whose real body is in shared memory passed as descriptor:
+ * magic, body length (network order) and NUL, see clicon_msg_send_shm */
+#define CLICON_MSG_SHM_MAGIC     "\002SHM"
+#define CLICON_MSG_SHM_MAGIC_LEN 4
+#define CLICON_MSG_SHM_BODY_LEN  (CLICON_MSG_SHM_MAGIC_LEN + sizeof(uint32_t) + 1)
+
+/*! Received message with reference count
+ *
+ * The body is either in the heap message, or in a mapped read-only shared memory segment
+ * in which case the heap message is the small descriptor message
+ */
+struct clicon_msg_buf {
+    int                mb_refcount; /* Freed when it reaches zero */
+    struct clicon_msg *mb_msg;      /* Message as received on socket */
+    char              *mb_map;      /* Mapped body in shared memory, or NULL */
+    size_t             mb_maplen;   /* Length of mapping */
+};
+
 static int _atomicio_sig = 0;
 
 /*! Formats (showas) derived from XML
@@ -102,6 +133,37 @@ static struct formatvec _FORMATS[] = {
     {NULL,   -1}
 };
 
+/*! Check if message body is a shared memory descriptor message
+ *
+ * @param[in]  body  Message body
+ * @param[in]  len   Length of body including terminating NUL
+ * @retval     1     Yes, body is magic, length and NUL, see clicon_msg_send_shm
+ * @retval     0     No
+ */
+static int
+msg_body_shm(const char *body,
+             size_t      len)
+{
+    return len == CLICON_MSG_SHM_BODY_LEN &&
+        memcmp(body, CLICON_MSG_SHM_MAGIC, CLICON_MSG_SHM_MAGIC_LEN) == 0;
+}
+
+/*! Message body for debug printing, binary bodies are not printed
+ *
+ * @param[in]  body  Message body
+ * @param[in]  len   Length of body including terminating NUL
+ * @retval     str   Body or placeholder
+ * @see clixon_bin_detect
+ */
+static const char *
+msg_body_str(const char *body,
+             size_t      len)
+{
+    if (msg_body_shm(body, len))
+        return "<shared memory>";
+    return clixon_bin_detect(body)?"<binary>":body;
+}
+
 /*! Translate from numeric format to string representation
  *
  * @param[in]  showas   Format value (see enum format_enum)
@@ -303,6 +365,148 @@ atomicio(ssize_t (*fn) (int, void *, size_t),
     return (pos);
 }
 
+/*! Read from socket as read() and keep a descriptor passed with SCM_RIGHTS, if any
+ *
+ * The first descriptor received is kept in fdp if it is -1, any further descriptors
+ * are closed.
+ * @param[in]     s    Socket
+ * @param[out]    buf  Buffer to read to
+ * @param[in]     len  Length of buffer
+ * @param[in,out] fdp  Received descriptor, or -1. Close after use
+ * @retval        n    Number of bytes read, 0 on eof
+ * @retval       -1    Error with errno set
+ */
+static ssize_t
+msg_recv_fd(int    s,
+            void  *buf,
+            size_t len,
+            int   *fdp)
+{
+    struct msghdr   mh = {0,};
+    struct iovec    iov;
+    struct cmsghdr *cm;
+    union {
+        struct cmsghdr cm;
+        char           buf[CMSG_SPACE(sizeof(int))];
+    }               ctrl;
+    ssize_t         n;
+    int            *fdv;
+    int             i;
+
+    iov.iov_base = buf;
+    iov.iov_len = len;
+    mh.msg_iov = &iov;
+    mh.msg_iovlen = 1;
+    mh.msg_control = &ctrl;
+    mh.msg_controllen = sizeof(ctrl);
+    if ((n = recvmsg(s, &mh, 0)) < 0)
+        return n;
+    for (cm = CMSG_FIRSTHDR(&mh); cm != NULL; cm = CMSG_NXTHDR(&mh, cm)){
+        if (cm->cmsg_level != SOL_SOCKET || cm->cmsg_type != SCM_RIGHTS)
+            continue;
+        fdv = (int*)CMSG_DATA(cm);
+        for (i=0; i<(cm->cmsg_len - CMSG_LEN(0))/sizeof(int); i++){
+            if (*fdp == -1)
+                *fdp = fdv[i];
+            else
+                close(fdv[i]);
+        }
+    }
+    return n;
+}
+
+/*! Ensure all data is read from socket and keep a descriptor passed with SCM_RIGHTS
+ *
+ * As atomicio with read, using msg_recv_fd
+ * @param[in]     s    Socket
+ * @param[out]    s0   Buffer to read to
+ * @param[in]     n    Number of bytes to read, loop until done
+ * @param[in,out] fdp  Received descriptor, or -1. Close after use
+ * @see atomicio
+ */
+static ssize_t
+atomicio_recv_fd(int    s,
+                 void  *s0,
+                 size_t n,
+                 int   *fdp)
+{
+    char   *buf = s0;
+    ssize_t res;
+    ssize_t pos = 0;
+
+    while (n > pos) {
+        _atomicio_sig = 0;
+        res = msg_recv_fd(s, buf + pos, n - pos, fdp);
+        switch (res) {
+        case -1:
+            if (errno == EINTR){
+                if (_atomicio_sig == 0)
+                    continue;
+            }
+            else if (errno == EAGAIN)
+                continue;
+            else if (errno == ECONNRESET || errno == EPIPE || errno == EBADF) /* Client shutdown */
+                res = 0;
+        case 0: /* fall thru */
+            return res;
+        default:
+            pos += res;
+        }
+    }
+    return pos;
+}
+
+/*! Ensure all of data in an io vector is written, using as few syscalls as possible
+ *
+ * Gather-write variant of atomicio for write: partial writes advance the vector
+ * If fd is non-blocking and not writable, wait for it with poll instead of retrying.
+ * @param[in]     fd      File descriptor, eg socket
+ * @param[in,out] iov     IO vector, is modified on partial writes
+ * @param[in]     iovcnt  Number of elements in iov
+ * @retval        0       OK, all data written
+ * @retval       -1       Error, errno set
+ * @see atomicio
+ */
+int
+clixon_writev(int           fd,
+              struct iovec *iov,
+              int           iovcnt)
+{
+    ssize_t       n;
+    struct pollfd pfd;
+
+    while (iovcnt > 0){
+        if (iov->iov_len == 0){
+            iov++;
+            iovcnt--;
+            continue;
+        }
+        if ((n = writev(fd, iov, iovcnt)) < 0){
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK){
+                pfd.fd = fd;
+                pfd.events = POLLOUT;
+                pfd.revents = 0;
+                if (poll(&pfd, 1, -1) < 0 && errno != EINTR)
+                    return -1;
+                continue;
+            }
+            return -1;
+        }
+        while (iovcnt > 0 && n >= iov->iov_len){
+            n -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0){
+            iov->iov_base = (char*)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+    return 0;
+}
+
 /*! Log message as hex on debug.
  *
  * @param[in]  dbglevel Debug level
@@ -368,9 +572,11 @@ clicon_msg_send(int                s,
 
     clixon_debug(CLIXON_DBG_MSG | CLIXON_DBG_DETAIL, "send msg len=%d", ntohl(msg->op_len));
     if (descr)
-        clixon_debug(CLIXON_DBG_MSG, "Send [%s]: %s", descr, msg->op_body);
+        clixon_debug(CLIXON_DBG_MSG, "Send [%s]: %s", descr,
+                     msg_body_str(msg->op_body, ntohl(msg->op_len) - sizeof(*msg)));
     else{
-        clixon_debug(CLIXON_DBG_MSG, "Send: %s", msg->op_body);
+        clixon_debug(CLIXON_DBG_MSG, "Send: %s",
+                     msg_body_str(msg->op_body, ntohl(msg->op_len) - sizeof(*msg)));
     }
     msg_hex(CLIXON_DBG_MSG | CLIXON_DBG_DETAIL2, (char*)msg,  ntohl(msg->op_len), __FUNCTION__);
     if (atomicio((ssize_t (*)(int, void *, size_t))write,
@@ -386,33 +592,25 @@ clicon_msg_send(int                s,
     return retval;
 }
 
-/*! Receive a Clixon message using IPC message struct
- *
- * XXX: timeout? and signals?
- * There is rudimentary code for turning on signals and handling them 
- * so that they can be interrupted by ^C. But the problem is that this
- * is a library routine and such things should be set up in the cli 
- * application for example: a daemon calling this function will want another 
- * behaviour.
- * Now, ^C will interrupt the whole process, and this may not be what you want.
+/*! Receive a Clixon message and a descriptor passed with it, if any
  *
  * @param[in]   s     Socket (unix or inet) to communicate with backend
  * @param[in]   descr Description of peer for logging
- * @param[in]   intr  If set, make a ^C cause an error   
+ * @param[in]   intr  If set, make a ^C cause an error
  * @param[out]  msg   Clixon msg data reply structure. Free with free()
+ * @param[out]  fdp   Descriptor passed with message, or -1. Close after use
  * @param[out]  eof   Set if eof encountered
  * @retval      0     OK
  * @retval     -1     Error
- * @note: Caller must ensure that s is closed if eof is set after call.
- * @note: intr parameter used in eg CLI where receive should be interruptable
- * @see clicon_msg_rcv1 using plain NETCONF
+ * @see clicon_msg_rcv
  */
-int
-clicon_msg_rcv(int                 s,
-               const char         *descr,
-               int                 intr,
-               struct clicon_msg **msg,
-               int                *eof)
+static int
+msg_rcv(int                 s,
+        const char         *descr,
+        int                 intr,
+        struct clicon_msg **msg,
+        int                *fdp,
+        int                *eof)
 {
     int               retval = -1;
     struct clicon_msg hdr;
@@ -420,18 +618,29 @@ clicon_msg_rcv(int                 s,
     ssize_t           len2;
     uint32_t          mlen;
     sigset_t          oldsigset;
-    struct sigaction  oldsigaction[32] = {{{0,},},};
+    sigset_t          sigset;
+    struct sigaction  sa = {{0,},};
+    struct sigaction  oldsa;
 
     clixon_debug(CLIXON_DBG_MSG | CLIXON_DBG_DETAIL, "");
     *eof = 0;
+    *fdp = -1;
     if (intr){
-        if (clixon_signal_save(&oldsigset, oldsigaction) < 0)
+        /* Only SIGINT is changed, so only SIGINT is saved and restored */
+        sa.sa_handler = atomicio_sig_handler;
+        sigemptyset(&sa.sa_mask);
+        if (sigaction(SIGINT, &sa, &oldsa) < 0){
+            clixon_err(OE_UNIX, errno, "sigaction");
+            intr = 0;
             goto done;
-        set_signal(SIGINT, SIG_IGN, NULL);
-        clicon_signal_unblock(SIGINT);
-        set_signal_flags(SIGINT, 0, atomicio_sig_handler, NULL);
+        }
+        sigemptyset(&sigset);
+        sigaddset(&sigset, SIGINT);
+        sigprocmask(SIG_UNBLOCK, &sigset, &oldsigset);
     }
-    if ((hlen = atomicio(read, s, &hdr, sizeof(hdr))) < 0){
+    /* A descriptor is passed with the first byte of a message */
+    hlen = atomicio_recv_fd(s, &hdr, sizeof(hdr), fdp);
+    if (hlen < 0){
         if (intr && _atomicio_sig)
             ;
         else
@@ -479,20 +688,448 @@ clicon_msg_rcv(int                 s,
         goto ok;
     }
     if (descr)
-        clixon_debug(CLIXON_DBG_MSG, "Recv [%s]: %s", descr, (*msg)->op_body);
+        clixon_debug(CLIXON_DBG_MSG, "Recv [%s]: %s", descr, msg_body_str((*msg)->op_body, len2));
     else
-        clixon_debug(CLIXON_DBG_MSG, "Recv: %s", (*msg)->op_body);
+        clixon_debug(CLIXON_DBG_MSG, "Recv: %s", msg_body_str((*msg)->op_body, len2));
  ok:
     retval = 0;
  done:
     clixon_debug(CLIXON_DBG_MSG | CLIXON_DBG_DETAIL, "retval:%d", retval);
     if (intr){
-        if (clixon_signal_restore(&oldsigset, oldsigaction) < 0)
+        sigaction(SIGINT, &oldsa, NULL);
+        sigprocmask(SIG_SETMASK, &oldsigset, NULL);
+    }
+    return retval;
+}
+
+/*! Map body of message in shared memory read-only
+ *
+ * The segment must be sealed against shrinking and writing so that the sender cannot
+ * change or truncate it under the mapping
+ * @param[in]  fd   Shared memory descriptor
+ * @param[in]  msg  Descriptor message, see clicon_msg_send_shm
+ * @param[in]  mb   Message buffer, mapping is added
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+static int
+msg_shm_map(int                fd,
+            struct clicon_msg *msg,
+            clicon_msg_buf    *mb)
+{
+    uint32_t    len;
+    struct stat st;
+    char       *p;
+#ifdef F_GET_SEALS
+    int         seals;
+#endif
+
+    memcpy(&len, msg->op_body + CLICON_MSG_SHM_MAGIC_LEN, sizeof(len));
+    len = ntohl(len);
+    if (fstat(fd, &st) < 0){
+        clixon_err(OE_UNIX, errno, "fstat");
+        return -1;
+    }
+    if (len == 0 || st.st_size != len){
+        clixon_err(OE_PROTO, 0, "Shared memory size %lld, expected %u", (long long)st.st_size, len);
+        return -1;
+    }
+#ifdef F_GET_SEALS
+    if ((seals = fcntl(fd, F_GET_SEALS)) < 0 ||
+        (seals & (F_SEAL_SHRINK|F_SEAL_WRITE)) != (F_SEAL_SHRINK|F_SEAL_WRITE)){
+        clixon_err(OE_PROTO, 0, "Shared memory not sealed");
+        return -1;
+    }
+#endif
+    if ((p = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED){
+        clixon_err(OE_UNIX, errno, "mmap");
+        return -1;
+    }
+    if (p[len-1] != '\0'){
+        munmap(p, len);
+        clixon_err(OE_PROTO, 0, "body not NULL terminated");
+        return -1;
+    }
+    mb->mb_map = p;
+    mb->mb_maplen = len;
+    return 0;
+}
+
+/*! Receive a Clixon message, where the body may be in shared memory
+ *
+ * If the peer passed the body as a shared memory descriptor, it is mapped read-only and
+ * not copied. The descriptor is closed, the mapping keeps the segment until the last
+ * reference is released.
+ * @param[in]   s     Socket (unix or inet) to communicate with backend
+ * @param[in]   descr Description of peer for logging
+ * @param[in]   intr  If set, make a ^C cause an error
+ * @param[out]  mb    Message buffer, or NULL on eof. Free with clicon_msg_buf_unref
+ * @param[out]  eof   Set if eof encountered
+ * @retval      0     OK
+ * @retval     -1     Error
+ * @code
+ *   if (clicon_msg_rcv_buf(s, NULL, 0, &mb, &eof) < 0)
+ *      err;
+ *   if (!eof){
+ *      body = clicon_msg_buf_body(mb);
+ *      ...
+ *      clicon_msg_buf_unref(mb);
+ *   }
+ * @endcode
+ * @see clicon_msg_send_shm
+ * @see clicon_msg_rcv  Body always in heap
+ */
+int
+clicon_msg_rcv_buf(int              s,
+                   const char      *descr,
+                   int              intr,
+                   clicon_msg_buf **mb,
+                   int             *eof)
+{
+    int                retval = -1;
+    struct clicon_msg *msg = NULL;
+    clicon_msg_buf    *mb1 = NULL;
+    int                fd = -1;
+
+    *mb = NULL;
+    if (msg_rcv(s, descr, intr, &msg, &fd, eof) < 0)
+        goto done;
+    if (*eof || msg == NULL)
+        goto ok;
+    if ((mb1 = malloc(sizeof(*mb1))) == NULL){
+        clixon_err(OE_UNIX, errno, "malloc");
+        goto done;
+    }
+    memset(mb1, 0, sizeof(*mb1));
+    mb1->mb_refcount = 1;
+    mb1->mb_msg = msg;
+    msg = NULL;
+    if (msg_body_shm(mb1->mb_msg->op_body,
+                     ntohl(mb1->mb_msg->op_len) - sizeof(struct clicon_msg))){
+        if (fd == -1){
+            clixon_err(OE_PROTO, 0, "Shared memory message without descriptor");
             goto done;
+        }
+        if (msg_shm_map(fd, mb1->mb_msg, mb1) < 0)
+            goto done;
+        clixon_debug(CLIXON_DBG_MSG | CLIXON_DBG_DETAIL, "shared memory len=%zu", mb1->mb_maplen);
     }
+    *mb = mb1;
+    mb1 = NULL;
+ ok:
+    retval = 0;
+ done:
+    if (fd != -1)
+        close(fd);
+    if (msg)
+        free(msg);
+    if (mb1)
+        clicon_msg_buf_unref(mb1);
     return retval;
 }
 
+/*! Add a reference to a received message
+ *
+ * @param[in]  mb   Message buffer
+ * @retval     mb   Same message buffer, release with clicon_msg_buf_unref
+ */
+clicon_msg_buf *
+clicon_msg_buf_ref(clicon_msg_buf *mb)
+{
+    mb->mb_refcount++;
+    return mb;
+}
+
+/*! Release a reference to a received message, free it and unmap its body when last
+ *
+ * @param[in]  mb   Message buffer
+ */
+void
+clicon_msg_buf_unref(clicon_msg_buf *mb)
+{
+    if (--mb->mb_refcount > 0)
+        return;
+    if (mb->mb_map)
+        munmap(mb->mb_map, mb->mb_maplen);
+    if (mb->mb_msg)
+        free(mb->mb_msg);
+    free(mb);
+}
+
+/*! Body of received message, NUL-terminated XML string or binary
+ *
+ * @param[in]  mb   Message buffer
+ * @retval     body Body, valid as long as there is a reference to mb. Do not modify
+ * @see clixon_bin_detect
+ */
+char *
+clicon_msg_buf_body(clicon_msg_buf *mb)
+{
+    return mb->mb_map ? mb->mb_map : mb->mb_msg->op_body;
+}
+
+/*! Length of body of received message including terminating NUL
+ *
+ * @param[in]  mb   Message buffer
+ * @retval     len  Length of body
+ */
+size_t
+clicon_msg_buf_len(clicon_msg_buf *mb)
+{
+    return mb->mb_map ? mb->mb_maplen : ntohl(mb->mb_msg->op_len) - sizeof(struct clicon_msg);
+}
+
+/*! Receive a Clixon message using IPC message struct
+ *
+ * XXX: timeout? and signals?
+ * There is rudimentary code for turning on signals and handling them 
+ * so that they can be interrupted by ^C. But the problem is that this
+ * is a library routine and such things should be set up in the cli 
+ * application for example: a daemon calling this function will want another 
+ * behaviour.
+ * Now, ^C will interrupt the whole process, and this may not be what you want.
+ *
+ * @param[in]   s     Socket (unix or inet) to communicate with backend
+ * @param[in]   descr Description of peer for logging
+ * @param[in]   intr  If set, make a ^C cause an error   
+ * @param[out]  msg   Clixon msg data reply structure. Free with free()
+ * @param[out]  eof   Set if eof encountered
+ * @retval      0     OK
+ * @retval     -1     Error
+ * @note: Caller must ensure that s is closed if eof is set after call.
+ * @note: intr parameter used in eg CLI where receive should be interruptable
+ * @note: A body in shared memory is copied to the returned message
+ * @see clicon_msg_rcv1 using plain NETCONF
+ * @see clicon_msg_rcv_buf which does not copy a body in shared memory
+ */
+int
+clicon_msg_rcv(int                 s,
+               const char         *descr,
+               int                 intr,
+               struct clicon_msg **msg,
+               int                *eof)
+{
+    int             retval = -1;
+    clicon_msg_buf *mb = NULL;
+    size_t          len;
+
+    if (clicon_msg_rcv_buf(s, descr, intr, &mb, eof) < 0)
+        goto done;
+    if (mb == NULL)
+        goto ok;
+    if (mb->mb_map){
+        len = mb->mb_maplen;
+        if ((*msg = malloc(sizeof(struct clicon_msg) + len)) == NULL){
+            clixon_err(OE_UNIX, errno, "malloc");
+            goto done;
+        }
+        (*msg)->op_len = htonl(sizeof(struct clicon_msg) + len);
+        (*msg)->op_id = mb->mb_msg->op_id;
+        memcpy((*msg)->op_body, mb->mb_map, len);
+    }
+    else{
+        *msg = mb->mb_msg;
+        mb->mb_msg = NULL;
+    }
+ ok:
+    retval = 0;
+ done:
+    if (mb)
+        clicon_msg_buf_unref(mb);
+    return retval;
+}
+
+/*! Buffered reader of internal IPC messages
+ *
+ * Read as much as is available in one read, and parse zero, one or several messages
+ * from the buffer. A message is copied to a message buffer that is reused for next message.
+ */
+struct clicon_msg_reader {
+    char              *mr_buf;    /* Input buffer */
+    size_t             mr_size;   /* Allocated size of mr_buf */
+    size_t             mr_start;  /* Start of unparsed data in mr_buf */
+    size_t             mr_end;    /* End of read data in mr_buf */
+    struct clicon_msg *mr_msg;    /* Last returned message, reused */
+    size_t             mr_msgsize; /* Allocated size of mr_msg */
+};
+
+/*! Create buffered message reader
+ *
+ * @retval  mr    Message reader, free with clicon_msg_reader_free
+ * @retval  NULL  Error
+ * @see clicon_msg_reader_free
+ */
+clicon_msg_reader *
+clicon_msg_reader_new(void)
+{
+    clicon_msg_reader *mr;
+
+    if ((mr = malloc(sizeof(*mr))) == NULL){
+        clixon_err(OE_UNIX, errno, "malloc");
+        return NULL;
+    }
+    memset(mr, 0, sizeof(*mr));
+    return mr;
+}
+
+/*! Free buffered message reader
+ *
+ * @param[in]  mr  Message reader
+ */
+void
+clicon_msg_reader_free(clicon_msg_reader *mr)
+{
+    if (mr->mr_buf)
+        free(mr->mr_buf);
+    if (mr->mr_msg)
+        free(mr->mr_msg);
+    free(mr);
+}
+
+/*! Read available data from socket into reader buffer, one read syscall
+ *
+ * The buffer is grown so that it fits at least the message being read
+ * @param[in]   mr   Message reader
+ * @param[in]   s    Socket, typically non-blocking
+ * @param[out]  eof  Set if eof encountered
+ * @retval      1    Data read (or eof)
+ * @retval      0    No data available (non-blocking socket)
+ * @retval     -1    Error
+ * @see clicon_msg_reader_next to get messages
+ */
+int
+clicon_msg_reader_read(clicon_msg_reader *mr,
+                       int                s,
+                       int               *eof)
+{
+    struct clicon_msg hdr;
+    size_t            need;
+    size_t            avail;
+    size_t            size;
+    char             *buf;
+    ssize_t           len;
+
+    *eof = 0;
+    if (mr->mr_start == mr->mr_end)
+        mr->mr_start = mr->mr_end = 0;
+    avail = mr->mr_end - mr->mr_start;
+    need = avail + BUFSIZ;
+    if (avail >= sizeof(hdr)){ /* Fit whole message being read */
+        memcpy(&hdr, mr->mr_buf + mr->mr_start, sizeof(hdr));
+        if (ntohl(hdr.op_len) > need)
+            need = ntohl(hdr.op_len);
+    }
+    if (mr->mr_size - mr->mr_start < need && mr->mr_start > 0){
+        memmove(mr->mr_buf, mr->mr_buf + mr->mr_start, avail);
+        mr->mr_start = 0;
+        mr->mr_end = avail;
+    }
+    if (mr->mr_size < need){
+        size = mr->mr_size ? mr->mr_size : CLICON_MSG_READER_BUFSIZ;
+        while (size < need)
+            size *= 2;
+        if ((buf = realloc(mr->mr_buf, size)) == NULL){
+            clixon_err(OE_UNIX, errno, "realloc");
+            return -1;
+        }
+        mr->mr_buf = buf;
+        mr->mr_size = size;
+    }
+    while ((len = read(s, mr->mr_buf + mr->mr_end, mr->mr_size - mr->mr_end)) < 0){
+        if (errno == EINTR)
+            continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return 0;
+        if (errno == ECONNRESET || errno == EPIPE || errno == EBADF){ /* Client shutdown */
+            len = 0;
+            break;
+        }
+        clixon_err(OE_UNIX, errno, "read");
+        return -1;
+    }
+    if (len == 0)
+        *eof = 1;
+    else{
+        msg_hex(CLIXON_DBG_MSG | CLIXON_DBG_DETAIL2, mr->mr_buf + mr->mr_end, len, __FUNCTION__);
+        mr->mr_end += len;
+    }
+    return 1;
+}
+
+/*! Get next complete message from reader buffer, if any
+ *
+ * @param[in]   mr     Message reader
+ * @param[in]   descr  Description of peer for logging
+ * @param[out]  msg    Message, owned by reader and valid until next call. Do not free.
+ * @retval      1      OK, message returned
+ * @retval      0      No complete message in buffer, read more
+ * @retval     -1     Error, eg malformed message, the session should be closed
+ * @see clicon_msg_reader_read
+ */
+int
+clicon_msg_reader_next(clicon_msg_reader  *mr,
+                       const char         *descr,
+                       struct clicon_msg **msg)
+{
+    struct clicon_msg  hdr;
+    struct clicon_msg *m;
+    uint32_t           mlen;
+    size_t             size;
+
+    if (mr->mr_end - mr->mr_start < sizeof(hdr))
+        return 0;
+    memcpy(&hdr, mr->mr_buf + mr->mr_start, sizeof(hdr));
+    mlen = ntohl(hdr.op_len);
+    if (mlen <= sizeof(hdr)){
+        clixon_err(OE_PROTO, 0, "op_len:%u too short", mlen);
+        return -1;
+    }
+    if (mr->mr_end - mr->mr_start < mlen)
+        return 0;
+    if (mr->mr_buf[mr->mr_start + mlen - 1] != '\0'){
+        clixon_err(OE_PROTO, 0, "body not NULL terminated");
+        return -1;
+    }
+    if (mr->mr_msgsize < mlen){
+        size = mr->mr_msgsize ? mr->mr_msgsize : BUFSIZ;
+        while (size < mlen)
+            size *= 2;
+        if ((m = realloc(mr->mr_msg, size)) == NULL){
+            clixon_err(OE_UNIX, errno, "realloc");
+            return -1;
+        }
+        mr->mr_msg = m;
+        mr->mr_msgsize = size;
+    }
+    memcpy(mr->mr_msg, mr->mr_buf + mr->mr_start, mlen);
+    mr->mr_start += mlen;
+    clixon_debug(CLIXON_DBG_MSG | CLIXON_DBG_DETAIL, "rcv msg len=%u", mlen);
+    if (descr)
+        clixon_debug(CLIXON_DBG_MSG, "Recv [%s]: %s", descr,
+                     msg_body_str(mr->mr_msg->op_body, mlen - sizeof(hdr)));
+    else
+        clixon_debug(CLIXON_DBG_MSG, "Recv: %s", msg_body_str(mr->mr_msg->op_body, mlen - sizeof(hdr)));
+    *msg = mr->mr_msg;
+    return 1;
+}
+
+/*! Check if reader has a complete message buffered, ie next will not need a read
+ *
+ * @param[in]   mr     Message reader
+ * @retval      1      Yes, complete message in buffer
+ * @retval      0      No
+ */
+int
+clicon_msg_reader_pending(clicon_msg_reader *mr)
+{
+    struct clicon_msg hdr;
+
+    if (mr->mr_end - mr->mr_start < sizeof(hdr))
+        return 0;
+    memcpy(&hdr, mr->mr_buf + mr->mr_start, sizeof(hdr));
+    return mr->mr_end - mr->mr_start >= ntohl(hdr.op_len);
+}
+
 /*! Receive a message using plain NETCONF
  *
  * @param[in]   s      socket (unix or inet) to communicate with backend
@@ -513,9 +1150,9 @@ clicon_msg_rcv1(int         s,
 {
     int           retval = -1;
     unsigned char buf[BUFSIZ];
-    int           i;
     int           len;
     int           xml_state = 0;
+    int           found;
     int           poll;
 
     clixon_debug(CLIXON_DBG_MSG | CLIXON_DBG_DETAIL, "");
@@ -535,18 +1172,12 @@ clicon_msg_rcv1(int         s,
            close(s);
            goto ok;
        }
-       for (i=0; i<len; i++){
-           if (buf[i] == 0)
-               continue; /* Skip NULL chars (eg from terminals) */
-           cprintf(cb, "%c", buf[i]);
-           if (detect_endtag("]]>]]>",
-                             buf[i],
-                             &xml_state)) {
-               /* OK, we have an xml string from a client */
-               /* Remove trailer */
-               *(((char*)cbuf_get(cb)) + cbuf_len(cb) - strlen("]]>]]>")) = '\0';
-               goto ok;
-           }
+       detect_endtag_buf("]]>]]>", (char*)buf, len, cb, &xml_state, &found);
+       if (found){
+           /* OK, we have an xml string from a client */
+           /* Remove trailer */
+           *(((char*)cbuf_get(cb)) + cbuf_len(cb) - strlen("]]>]]>")) = '\0';
+           goto ok;
        }
        /* poll==1 if more, poll==0 if none */
        if ((poll = clixon_event_poll(s)) < 0)
@@ -696,11 +1327,12 @@ clicon_rpc_connect_inet(clixon_handle      h,
  * @param[in]  sock   Socket / file descriptor
  * @param[in]  descr  Description of peer for logging
  * @param[in]  msg    Clixon msg data structure. It has fixed header and variable body.
- * @param[out] xret   Returned data as netconf xml tree.
+ * @param[out] ret    Returned message body, XML string or binary, see clixon_bin_detect
  * @param[out] eof    Set if eof encountered
  * @retval     0      OK (check eof)
  * @retval    -1      Error
  * @see clicon_rpc1 using plain NETCONF XML
+ * @see clicon_rpc_buf which does not copy the reply body
  */
 int
 clicon_rpc(int                sock,
@@ -709,29 +1341,60 @@ clicon_rpc(int                sock,
            char             **ret,
            int               *eof)
 {
-    int                retval = -1;
-    struct clicon_msg *reply = NULL;
-    char              *data = NULL;
+    int             retval = -1;
+    clicon_msg_buf *mb = NULL;
+    size_t          len;
 
-    clixon_debug(CLIXON_DBG_MSG | CLIXON_DBG_DETAIL, "");
-    if (clicon_msg_send(sock, descr, msg) < 0)
+    if (clicon_rpc_buf(sock, descr, msg, &mb, eof) < 0)
         goto done;
-    if (clicon_msg_rcv(sock, descr, 0, &reply, eof) < 0)
-        goto done;
-    if (*eof)
+    if (*eof || mb == NULL)
         goto ok;
-    data = reply->op_body; /* assume string */
-    if (ret && data)
-        if ((*ret = strdup(data)) == NULL){
-            clixon_err(OE_UNIX, errno, "strdup");
+    if (ret){
+        /* Copy whole body since a binary body may contain NUL characters */
+        len = clicon_msg_buf_len(mb);
+        if ((*ret = malloc(len)) == NULL){
+            clixon_err(OE_UNIX, errno, "malloc");
             goto done;
         }
+        memcpy(*ret, clicon_msg_buf_body(mb), len);
+    }
  ok:
     retval = 0;
+  done:
+    if (mb)
+        clicon_msg_buf_unref(mb);
+    return retval;
+}
+
+/*! Send a clicon_msg message and wait for result without copying the reply
+ *
+ * @param[in]  sock   Socket / file descriptor
+ * @param[in]  descr  Description of peer for logging
+ * @param[in]  msg    Clixon msg data structure. It has fixed header and variable body.
+ * @param[out] mb     Reply, body possibly in shared memory. Free with clicon_msg_buf_unref
+ * @param[out] eof    Set if eof encountered, then mb is NULL
+ * @retval     0      OK (check eof)
+ * @retval    -1      Error
+ * @see clicon_rpc
+ */
+int
+clicon_rpc_buf(int                sock,
+               const char        *descr,
+               struct clicon_msg *msg,
+               clicon_msg_buf   **mb,
+               int               *eof)
+{
+    int retval = -1;
+
+    clixon_debug(CLIXON_DBG_MSG | CLIXON_DBG_DETAIL, "");
+    *mb = NULL;
+    if (clicon_msg_send(sock, descr, msg) < 0)
+        goto done;
+    if (clicon_msg_rcv_buf(sock, descr, 0, mb, eof) < 0)
+        goto done;
+    retval = 0;
   done:
     clixon_debug(CLIXON_DBG_MSG | CLIXON_DBG_DETAIL, "retval:%d", retval);
-    if (reply)
-        free(reply);
     return retval;
 }
 
@@ -787,25 +1450,173 @@ send_msg_reply(int         s,
                uint32_t    datalen)
 {
     int                retval = -1;
-    struct clicon_msg *reply = NULL;
-    uint32_t           len;
+    struct clicon_msg  hdr = {0,};
+    struct iovec       iov[2];
+    int                e;
 
-    len = sizeof(*reply) + datalen;
-    if ((reply = (struct clicon_msg *)malloc(len)) == NULL)
-        goto done;
-    memset(reply, 0, len);
-    reply->op_len = htonl(len);
-    if (datalen > 0)
-      memcpy(reply->op_body, data, datalen);
-    if (clicon_msg_send(s, descr, reply) < 0)
+    /* Write header and data in one syscall without copying data into a new message */
+    hdr.op_len = htonl(sizeof(hdr) + datalen);
+    iov[0].iov_base = &hdr;
+    iov[0].iov_len = sizeof(hdr);
+    iov[1].iov_base = data;
+    iov[1].iov_len = datalen;
+    clixon_debug(CLIXON_DBG_MSG | CLIXON_DBG_DETAIL, "send msg len=%zu", sizeof(hdr) + datalen);
+    if (descr)
+        clixon_debug(CLIXON_DBG_MSG, "Send [%s]: %s", descr, datalen?msg_body_str(data, datalen):"");
+    else
+        clixon_debug(CLIXON_DBG_MSG, "Send: %s", datalen?msg_body_str(data, datalen):"");
+    if (clixon_writev(s, iov, 2) < 0){
+        e = errno;
+        if (e == ECONNRESET || e == EPIPE || e == EBADF) /* Client shutdown, as atomicio */
+            goto ok;
+        clixon_err(OE_CFG, e, "writev");
+        clixon_log(NULL, LOG_WARNING, "%s: write: %s len:%u", __FUNCTION__,
+                   strerror(e), datalen);
         goto done;
+    }
+ ok:
     retval = 0;
   done:
-    if (reply)
-        free(reply);
     return retval;
 }
 
+/*! Append a clicon_msg with data to a buffer, to be written later
+ *
+ * Same message as send_msg_reply but for writers on non-blocking sockets that queue
+ * output.
+ * @param[in]  cb       Buffer, message is appended
+ * @param[in]  data     Message data as byte-string
+ * @param[in]  datalen  Length of data
+ * @retval     0        OK
+ * @retval    -1        Error
+ * @see send_msg_reply
+ */
+int
+clicon_msg_append(cbuf       *cb,
+                  const char *data,
+                  uint32_t    datalen)
+{
+    struct clicon_msg hdr = {0,};
+
+    hdr.op_len = htonl(sizeof(hdr) + datalen);
+    if (cbuf_append_buf(cb, &hdr, sizeof(hdr)) < 0 ||
+        cbuf_append_buf(cb, (void*)data, datalen) < 0){
+        clixon_err(OE_UNIX, errno, "cbuf_append_buf");
+        return -1;
+    }
+    return 0;
+}
+
+/*! Send a reply to a local client in a sealed shared memory segment
+ *
+ * The data is written to an anonymous memory file (memfd) that is sealed against
+ * modification, and the descriptor is passed with SCM_RIGHTS on the UNIX socket together
+ * with a small message containing the length. The descriptor is closed here, the segment
+ * is released by the kernel when the client has unmapped it.
+ * Used for large replies instead of copying the data through the socket.
+ * @param[in]  s        UNIX socket to client, may be non-blocking
+ * @param[in]  descr    Description of peer for logging
+ * @param[in]  data     Message data including terminating NUL
+ * @param[in]  datalen  Length of data
+ * @param[in]  cb       If the descriptor message is partially written, the rest is appended
+ *                      here, to be written later
+ * @retval     1        OK, descriptor sent
+ * @retval     0        Not sent: shared memory not supported or socket would block. Send as
+ *                      normal message
+ * @retval    -1        Error
+ * @see clicon_msg_rcv_buf  Where the segment is mapped
+ */
+int
+clicon_msg_send_shm(int         s,
+                    const char *descr,
+                    const char *data,
+                    uint32_t    datalen,
+                    cbuf       *cb)
+{
+#ifdef HAVE_MEMFD_CREATE
+    int                retval = -1;
+    int                fd = -1;
+    struct clicon_msg  hdr = {0,};
+    char               buf[sizeof(struct clicon_msg) + CLICON_MSG_SHM_BODY_LEN];
+    uint32_t           len;
+    struct msghdr      mh = {0,};
+    struct iovec       iov;
+    struct cmsghdr    *cm;
+    union {
+        struct cmsghdr cm;
+        char           buf[CMSG_SPACE(sizeof(int))];
+    }                  ctrl;
+    ssize_t            n;
+
+    if (datalen == 0)
+        goto notsent;
+    if ((fd = memfd_create("clixon-reply", MFD_CLOEXEC | MFD_ALLOW_SEALING)) < 0){
+        /* Eg out of descriptors, send through socket instead */
+        clixon_log(NULL, LOG_WARNING, "%s: memfd_create: %s", __FUNCTION__, strerror(errno));
+        goto notsent;
+    }
+    if (atomicio((ssize_t (*)(int, void *, size_t))write, fd, (void*)data, datalen) != datalen){
+        clixon_err(OE_UNIX, errno, "write");
+        goto done;
+    }
+    if (fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) < 0){
+        clixon_err(OE_UNIX, errno, "fcntl F_ADD_SEALS");
+        goto done;
+    }
+    /* Descriptor message: header, magic, length, NUL */
+    hdr.op_len = htonl(sizeof(buf));
+    memcpy(buf, &hdr, sizeof(hdr));
+    memcpy(buf + sizeof(hdr), CLICON_MSG_SHM_MAGIC, CLICON_MSG_SHM_MAGIC_LEN);
+    len = htonl(datalen);
+    memcpy(buf + sizeof(hdr) + CLICON_MSG_SHM_MAGIC_LEN, &len, sizeof(len));
+    buf[sizeof(buf)-1] = '\0';
+    iov.iov_base = buf;
+    iov.iov_len = sizeof(buf);
+    mh.msg_iov = &iov;
+    mh.msg_iovlen = 1;
+    memset(&ctrl, 0, sizeof(ctrl));
+    mh.msg_control = &ctrl;
+    mh.msg_controllen = sizeof(ctrl);
+    cm = CMSG_FIRSTHDR(&mh);
+    cm->cmsg_level = SOL_SOCKET;
+    cm->cmsg_type = SCM_RIGHTS;
+    cm->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cm), &fd, sizeof(int));
+    clixon_debug(CLIXON_DBG_MSG | CLIXON_DBG_DETAIL, "send shared memory len=%u", datalen);
+    if (descr)
+        clixon_debug(CLIXON_DBG_MSG, "Send [%s]: %s", descr, msg_body_str(data, datalen));
+    else
+        clixon_debug(CLIXON_DBG_MSG, "Send: %s", msg_body_str(data, datalen));
+    while ((n = sendmsg(s, &mh, MSG_NOSIGNAL)) < 0){
+        if (errno == EINTR)
+            continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            goto notsent;
+        if (errno == ECONNRESET || errno == EPIPE || errno == EBADF) /* Client shutdown */
+            goto ok;
+        clixon_err(OE_UNIX, errno, "sendmsg");
+        goto done;
+    }
+    /* Descriptor is passed with first byte, the rest is written as normal data */
+    if (n < sizeof(buf) &&
+        cbuf_append_buf(cb, buf + n, sizeof(buf) - n) < 0){
+        clixon_err(OE_UNIX, errno, "cbuf_append_buf");
+        goto done;
+    }
+ ok:
+    retval = 1;
+ done:
+    if (fd != -1)
+        close(fd);
+    return retval;
+ notsent:
+    retval = 0;
+    goto done;
+#else /* HAVE_MEMFD_CREATE */
+    return 0;
+#endif /* HAVE_MEMFD_CREATE */
+}
+
 /*! Send a clicon_msg NOTIFY message asynchronously to client
  *
  * @param[in]  s       Socket to communicate with client
@@ -907,6 +1718,59 @@ detect_endtag(char *tag,
     return retval;
 }
 
+/*! Look for a text pattern in an input buffer, and append the input to a cbuf
+ *
+ * Same as calling detect_endtag and appending for each char, but input is scanned with
+ * memchr for the first char of the pattern, and appended in blocks.
+ * NULL chars are skipped (eg from terminals).
+ * @param[in]     tag     What to look for
+ * @param[in]     buf     Input buffer
+ * @param[in]     len     Length of input buffer
+ * @param[in,out] cb      Input up to and including the pattern is appended
+ * @param[in,out] state   A state integer holding how far we have parsed, see detect_endtag
+ * @param[out]    found   Set to 1 if pattern is found, otherwise 0
+ * @retval        n       Number of chars consumed from buf, less than len if found
+ * @see detect_endtag
+ */
+size_t
+detect_endtag_buf(char       *tag,
+                  const char *buf,
+                  size_t      len,
+                  cbuf       *cb,
+                  int        *state,
+                  int        *found)
+{
+    size_t      i = 0;
+    size_t      n;
+    const char *p;
+    char        ch;
+
+    *found = 0;
+    while (i < len){
+        if (*state == 0){
+            /* Append run of chars that cannot start the pattern */
+            n = len - i;
+            if ((p = memchr(buf + i, tag[0], n)) != NULL)
+                n = p - (buf + i);
+            if ((p = memchr(buf + i, '\0', n)) != NULL)
+                n = p - (buf + i);
+            if (n > 0){
+                cbuf_append_buf(cb, (void*)(buf + i), n);
+                i += n;
+                continue;
+            }
+        }
+        if ((ch = buf[i++]) == 0)
+            continue; /* Skip NULL chars (eg from terminals) */
+        cbuf_append(cb, ch);
+        if (detect_endtag(tag, ch, state)){
+            *found = 1;
+            break;
+        }
+    }
+    return i;
+}
+
 /*! Given family, addr str, port, return sockaddr and length
  *
  * @param[in]  addrtype  Address family: inet:ipv4-address or inet:ipv6-address
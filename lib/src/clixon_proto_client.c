@@ -82,12 +82,82 @@
 #include "clixon_xml_sort.h"
 #include "clixon_netconf_lib.h"
 #include "clixon_xml_io.h"
+#include "clixon_xml_bin.h"
 #include "clixon_proto_client.h"
 
 #define PERSIST_ID_XML_FMT "<persist-id>%s</persist-id>"
 #define PERSIST_XML_FMT "<persist>%s</persist>"
 #define TIMEOUT_XML_FMT "<confirm-timeout>%u</confirm-timeout>"
 
+/*! Parse reply from backend, XML or binary
+ *
+ * A binary reply is decoded into a tree bound to yang, see CLICON_IPC_BINARY.
+ * An XML reply is not bound here since the rpc name is needed to bind it.
+ * @param[in]  h     Clixon handle
+ * @param[in]  data  Reply message body
+ * @param[out] xret  XML tree with reply. Free with xml_free
+ * @retval     0     OK
+ * @retval    -1     Error
+ */
+static int
+rpc_reply_parse(clixon_handle h,
+                char         *data,
+                cxobj       **xret)
+{
+    int    retval = -1;
+    cxobj *xt = NULL;
+    cxobj *xerr = NULL;
+    int    ret;
+
+    if (!clixon_bin_detect(data)){
+        if (clixon_xml_parse_string(data, YB_NONE, NULL, xret, NULL) < 0)
+            goto done;
+        goto ok;
+    }
+    if ((ret = clixon_bin_parse(h, data, clicon_dbspec_yang(h), &xt, &xerr)) < 0)
+        goto done;
+    if (ret == 0){ /* Replace reply with error */
+        if (clixon_netconf_internal_error(xerr,
+                                          ". Internal error, backend returned invalid XML.",
+                                          NULL) < 0)
+            goto done;
+        xml_free(xt);
+        if ((xt = xml_new(XML_TOP_SYMBOL, NULL, CX_ELMNT)) == NULL)
+            goto done;
+        if (xml_addsub(xt, xerr) < 0)
+            goto done;
+        xerr = NULL;
+    }
+    *xret = xt;
+    xt = NULL;
+ ok:
+    retval = 0;
+ done:
+    if (xt)
+        xml_free(xt);
+    if (xerr)
+        xml_free(xerr);
+    return retval;
+}
+
+/*! Check if data of a reply is already bound to yang, ie decoded from binary
+ *
+ * @param[in]  xd    Data node of reply
+ * @retval     1     All children bound, or no children
+ * @retval     0     Not bound
+ */
+static int
+rpc_reply_bound(cxobj *xd)
+{
+    cxobj *xc;
+    int    inext = 0;
+
+    while ((xc = xml_child_iter(xd, &inext, CX_ELMNT)) != NULL)
+        if (xml_spec(xc) == NULL)
+            return 0;
+    return 1;
+}
+
 /*! Connect to internal netconf socket
  *
  * @param[in]  h     Clixon handle
@@ -138,12 +208,374 @@ clicon_rpc_connect(clixon_handle h,
     return retval;
 }
 
+/*! Pending asynchronous rpc, replies are matched on message-id
+ *
+ * @see clicon_rpc_msg_async
+ */
+struct rpc_async {
+    qelem_t              ra_qelem;   /* List header */
+    uint32_t             ra_id;      /* Request id returned to caller */
+    char                *ra_msgid;   /* Message-id of rpc, echoed in reply */
+    clicon_rpc_async_cb *ra_fn;      /* Reply callback */
+    void                *ra_arg;     /* Callback argument */
+};
+
+/* Name of handle data for list of pending asynchronous rpcs */
+#define RPC_ASYNC_DATA "rpc-async"
+
+/* Last request id of asynchronous rpcs */
+static uint32_t _rpc_async_id = 0;
+
+/*! Get list of pending asynchronous rpcs
+ *
+ * @param[in]  h    Clixon handle
+ * @retval     ra   First pending rpc, or NULL if none
+ */
+static struct rpc_async *
+rpc_async_list(clixon_handle h)
+{
+    struct rpc_async *ra = NULL;
+
+    if (clicon_ptr_get(h, RPC_ASYNC_DATA, (void**)&ra) < 0)
+        return NULL;
+    return ra;
+}
+
+/*! Free pending asynchronous rpc
+ */
+static void
+rpc_async_free(struct rpc_async *ra)
+{
+    if (ra->ra_msgid)
+        free(ra->ra_msgid);
+    free(ra);
+}
+
+/*! Number of pending asynchronous rpcs, ie sent but not yet replied
+ *
+ * @param[in]  h    Clixon handle
+ * @retval     nr   Number of pending rpcs
+ */
+int
+clicon_rpc_async_pending(clixon_handle h)
+{
+    struct rpc_async *ralist;
+    struct rpc_async *ra;
+    int               nr = 0;
+
+    if ((ra = ralist = rpc_async_list(h)) != NULL){
+        do {
+            nr++;
+            ra = NEXTQ(struct rpc_async *, ra);
+        } while (ra != ralist);
+    }
+    return nr;
+}
+
+/*! Drop all pending asynchronous rpcs, eg on socket close
+ *
+ * Callbacks are called with xret = NULL so that they can release their arguments
+ * @param[in]  h    Clixon handle
+ */
+static void
+rpc_async_flush(clixon_handle h)
+{
+    struct rpc_async *ralist;
+    struct rpc_async *ra;
+
+    ralist = rpc_async_list(h);
+    clicon_ptr_del(h, RPC_ASYNC_DATA);
+    while ((ra = ralist) != NULL){
+        DELQ(ra, ralist, struct rpc_async *);
+        if (ra->ra_fn)
+            (*ra->ra_fn)(h, ra->ra_id, NULL, ra->ra_arg);
+        rpc_async_free(ra);
+    }
+}
+
+/*! Find pending asynchronous rpc given the message-id of a reply
+ *
+ * A reply without message-id is a reply to a request the backend could not parse, eg
+ * a malformed message. Since the backend replies to the messages of a session in order,
+ * it belongs to the oldest pending rpc.
+ * @param[in]  ralist  List of pending rpcs
+ * @param[in]  xret    Reply as XML tree
+ * @retval     ra      Pending rpc
+ * @retval     NULL    Not found
+ */
+static struct rpc_async *
+rpc_async_find(struct rpc_async *ralist,
+               cxobj            *xret)
+{
+    struct rpc_async *ra;
+    cxobj            *xreply;
+    cxobj            *xa;
+    char             *msgid = NULL;
+
+    if ((xreply = xml_find_type(xret, NULL, "rpc-reply", CX_ELMNT)) != NULL &&
+        (xa = xml_find_type(xreply, NULL, "message-id", CX_ATTR)) != NULL &&
+        xml_prefix(xa) == NULL)
+        msgid = xml_value(xa);
+    if (msgid == NULL)
+        return ralist;
+    if ((ra = ralist) != NULL){
+        do {
+            if (strcmp(ra->ra_msgid, msgid) == 0)
+                return ra;
+            ra = NEXTQ(struct rpc_async *, ra);
+        } while (ra != ralist);
+    }
+    return NULL;
+}
+
+/*! Read one reply from the backend and call the callback of its pending rpc
+ *
+ * The reply is matched with its rpc on message-id, which the backend echoes in replies.
+ * @param[in]  s    Socket to backend
+ * @param[in]  arg  Clixon handle
+ * @retval     0    OK
+ * @retval    -1    Error, or backend closed the socket
+ * @see clicon_rpc_msg_async
+ */
+static int
+rpc_async_input(int   s,
+                void *arg)
+{
+    int                retval = -1;
+    clixon_handle      h = (clixon_handle)arg;
+    struct rpc_async  *ralist;
+    struct rpc_async  *ra = NULL;
+    clicon_msg_buf    *reply = NULL;
+    cxobj             *xret = NULL;
+    int                eof = 0;
+
+    if ((ralist = rpc_async_list(h)) == NULL){
+        clixon_err(OE_PROTO, 0, "Reply from backend but no pending rpc");
+        goto done;
+    }
+    if (clicon_msg_rcv_buf(s, clicon_sock_str(h), 0, &reply, &eof) < 0)
+        goto closed;
+    if (eof){
+        clixon_err(OE_PROTO, ESHUTDOWN, "Unexpected close of CLICON_SOCK. Clixon backend daemon may have crashed.");
+        goto closed;
+    }
+    if (rpc_reply_parse(h, clicon_msg_buf_body(reply), &xret) < 0)
+        goto done;
+    if ((ra = rpc_async_find(ralist, xret)) == NULL){
+        clixon_err(OE_PROTO, 0, "Reply from backend with unknown message-id");
+        goto done;
+    }
+    DELQ(ra, ralist, struct rpc_async *);
+    if (ralist == NULL){
+        clicon_ptr_del(h, RPC_ASYNC_DATA);
+        clixon_event_unreg_fd(s, rpc_async_input);
+    }
+    else if (clicon_ptr_set(h, RPC_ASYNC_DATA, ralist) < 0)
+        goto done;
+    clixon_debug(CLIXON_DBG_MSG | CLIXON_DBG_DETAIL, "id:%u message-id:%s", ra->ra_id, ra->ra_msgid);
+    if (ra->ra_fn && (*ra->ra_fn)(h, ra->ra_id, xret, ra->ra_arg) < 0)
+        goto done;
+    retval = 0;
+ done:
+    if (ra)
+        rpc_async_free(ra);
+    if (reply)
+        clicon_msg_buf_unref(reply);
+    if (xret)
+        xml_free(xret);
+    return retval;
+ closed:
+    clixon_event_unreg_fd(s, rpc_async_input);
+    close(s);
+    clicon_client_socket_set(h, -1);
+    rpc_async_flush(h);
+    goto done;
+}
+
+/*! Send internal netconf rpc with given message-id to backend without waiting for reply
+ *
+ * @param[in]  h     Clixon handle
+ * @param[in]  msg   Encoded message
+ * @param[in]  msgid Message-id of rpc in msg
+ * @param[in]  fn    Reply callback
+ * @param[in]  arg   Argument to callback
+ * @param[out] idp   Request id (if not NULL)
+ * @retval     0     OK
+ * @retval    -1     Error
+ * @see clicon_rpc_msg_async
+ */
+static int
+rpc_msg_async(clixon_handle        h,
+              struct clicon_msg   *msg,
+              char                *msgid,
+              clicon_rpc_async_cb *fn,
+              void                *arg,
+              uint32_t            *idp)
+{
+    int               retval = -1;
+    int               s;
+    struct rpc_async *ralist;
+    struct rpc_async *ra = NULL;
+
+    if ((ralist = rpc_async_list(h)) != NULL){
+        ra = ralist;
+        do {
+            if (strcmp(ra->ra_msgid, msgid) == 0){
+                clixon_err(OE_PROTO, EEXIST, "Asynchronous rpc with message-id %s already pending", msgid);
+                goto done;
+            }
+            ra = NEXTQ(struct rpc_async *, ra);
+        } while (ra != ralist);
+        ra = NULL;
+    }
+    if ((s = clicon_client_socket_get(h)) < 0){
+        if (clicon_rpc_connect(h, &s) < 0)
+            goto done;
+        clicon_client_socket_set(h, s);
+    }
+    if ((ra = malloc(sizeof(*ra))) == NULL){
+        clixon_err(OE_UNIX, errno, "malloc");
+        goto done;
+    }
+    memset(ra, 0, sizeof(*ra));
+    if ((ra->ra_msgid = strdup(msgid)) == NULL){
+        clixon_err(OE_UNIX, errno, "strdup");
+        goto done;
+    }
+    if (++_rpc_async_id == 0)
+        _rpc_async_id++;
+    ra->ra_id = _rpc_async_id;
+    ra->ra_fn = fn;
+    ra->ra_arg = arg;
+    if (clicon_msg_send(s, clicon_sock_str(h), msg) < 0){
+        clixon_event_unreg_fd(s, rpc_async_input);
+        close(s);
+        clicon_client_socket_set(h, -1);
+        rpc_async_flush(h);
+        goto done;
+    }
+    if (ralist == NULL){
+        if (clixon_event_reg_fd(s, rpc_async_input, h, "backend rpc reply") < 0)
+            goto done;
+    }
+    ADDQ(ra, ralist);
+    if (clicon_ptr_set(h, RPC_ASYNC_DATA, ralist) < 0)
+        goto done;
+    if (idp)
+        *idp = ra->ra_id;
+    ra = NULL;
+    retval = 0;
+ done:
+    if (ra)
+        rpc_async_free(ra);
+    return retval;
+}
+
+/*! Send internal netconf rpc to backend without waiting for the reply
+ *
+ * Several rpcs may be outstanding on the same (cached) backend socket. Each rpc must have
+ * a unique message-id, which the backend echoes in the reply, and which is used to
+ * match the reply with its callback. The callback is called either from the event loop
+ * where the socket is registered, or from clicon_rpc_async_wait().
+ * @param[in]  h     Clixon handle
+ * @param[in]  msg   Encoded message with message-id attribute. Deallocate with free
+ * @param[in]  fn    Callback called with reply as xml tree (freed by caller), or with
+ *                   NULL if the socket was closed before the reply arrived
+ * @param[in]  arg   Argument to callback
+ * @param[out] idp   Request id, also given to callback (if not NULL)
+ * @retval     0     OK
+ * @retval    -1     Error
+ * @code
+ *   for (i=0; i<n; i++)
+ *      if (clicon_rpc_msg_async(h, msg[i], reply_cb, NULL, NULL) < 0)
+ *         err;
+ *   if (clicon_rpc_async_wait(h, 0) < 0)
+ *      err;
+ * @endcode
+ * @note A synchronous rpc on the same handle first waits for all pending replies
+ * @see clicon_rpc_netconf_async  Adds message-id if not present
+ * @see clicon_rpc_msg  Synchronous variant
+ */
+int
+clicon_rpc_msg_async(clixon_handle        h,
+                     struct clicon_msg   *msg,
+                     clicon_rpc_async_cb *fn,
+                     void                *arg,
+                     uint32_t            *idp)
+{
+    int    retval = -1;
+    cxobj *xt = NULL;
+    cxobj *xrpc;
+    cxobj *xa;
+
+    if (clixon_xml_parse_string(msg->op_body, YB_NONE, NULL, &xt, NULL) < 0)
+        goto done;
+    if ((xrpc = xml_child_i_type(xt, 0, CX_ELMNT)) == NULL ||
+        (xa = xml_find_type(xrpc, NULL, "message-id", CX_ATTR)) == NULL ||
+        xml_prefix(xa) != NULL){
+        clixon_err(OE_PROTO, EINVAL, "Asynchronous rpc without message-id");
+        goto done;
+    }
+    if (rpc_msg_async(h, msg, xml_value(xa), fn, arg, idp) < 0)
+        goto done;
+    retval = 0;
+ done:
+    if (xt)
+        xml_free(xt);
+    return retval;
+}
+
+/*! Read replies of pending asynchronous rpcs from the backend
+ *
+ * Used by clients that do not run the event loop, and before synchronous rpcs
+ * @param[in]  h     Clixon handle
+ * @param[in]  id    Wait until reply of this request is handled, or 0 for all pending
+ * @retval     0     OK
+ * @retval    -1     Error
+ * @see clicon_rpc_msg_async
+ */
+int
+clicon_rpc_async_wait(clixon_handle h,
+                      uint32_t      id)
+{
+    int               retval = -1;
+    struct rpc_async *ralist;
+    struct rpc_async *ra;
+    int               s;
+    int               found;
+
+    while ((ralist = rpc_async_list(h)) != NULL){
+        if (id != 0){
+            found = 0;
+            ra = ralist;
+            do {
+                if (ra->ra_id == id){
+                    found++;
+                    break;
+                }
+                ra = NEXTQ(struct rpc_async *, ra);
+            } while (ra != ralist);
+            if (!found)
+                break;
+        }
+        if ((s = clicon_client_socket_get(h)) < 0){
+            rpc_async_flush(h);
+            break;
+        }
+        if (rpc_async_input(s, h) < 0)
+            goto done;
+    }
+    retval = 0;
+ done:
+    return retval;
+}
+
 /*! Connect to backend or use cached socket and send RPC
  *
  * @param[in]  h        Clixon handle
  * @param[in]  msg      Encoded message
  * @param[in]  cache    Use cached (client) socket, otherwise generate new socket
- * @param[out] retdate  Returned data as string
+ * @param[out] mb       Returned message, body possibly in shared memory
  * @param[out] eof      Set if eof encountered
  * @param[out] sp       Returned socket
  * @retval     0        OK
@@ -153,7 +585,7 @@ static int
 clicon_rpc_msg_once(clixon_handle      h,
                     struct clicon_msg *msg,
                     int                cache,
-                    char             **retdata,
+                    clicon_msg_buf   **mb,
                     int               *eof,
                     int               *sp)
 {
@@ -161,6 +593,10 @@ clicon_rpc_msg_once(clixon_handle      h,
     int s;
 
     if (cache){
+        /* Replies to pending asynchronous rpcs come first on the cached socket */
+        if (rpc_async_list(h) != NULL &&
+            clicon_rpc_async_wait(h, 0) < 0)
+            goto done;
         if ((s = clicon_client_socket_get(h)) < 0){
             if (clicon_rpc_connect(h, &s) < 0)
                 goto done;
@@ -169,7 +605,7 @@ clicon_rpc_msg_once(clixon_handle      h,
     }
     else if (clicon_rpc_connect(h, &s) < 0)
         goto done;
-    if (clicon_rpc(s, clicon_sock_str(h), msg, retdata, eof) < 0){
+    if (clicon_rpc_buf(s, clicon_sock_str(h), msg, mb, eof) < 0){
         /* 2. check socket shutdown AFTER rpc */
         close(s);
         s = -1;
@@ -200,18 +636,18 @@ clicon_rpc_msg(clixon_handle      h,
                struct clicon_msg *msg,
                cxobj            **xret0)
 {
-    int     retval = -1;
-    char   *retdata = NULL;
-    cxobj  *xret = NULL;
-    int     s = -1;
-    int     eof = 0;
+    int             retval = -1;
+    clicon_msg_buf *mb = NULL;
+    cxobj          *xret = NULL;
+    int             s = -1;
+    int             eof = 0;
 
     clixon_debug(CLIXON_DBG_DEFAULT | CLIXON_DBG_DETAIL, "");
 #ifdef RPC_USERNAME_ASSERT
     assert(strstr(msg->op_body, "username")!=NULL); /* XXX */
 #endif
     /* Create a socket and connect to it, either UNIX, IPv4 or IPv6 per config options */
-    if (clicon_rpc_msg_once(h, msg, 1, &retdata, &eof, &s) < 0)
+    if (clicon_rpc_msg_once(h, msg, 1, &mb, &eof, &s) < 0)
         goto done;
     if (eof){
         /* 2. check socket shutdown AFTER rpc */
@@ -220,7 +656,7 @@ clicon_rpc_msg(clixon_handle      h,
         clicon_client_socket_set(h, -1);
 #ifdef PROTO_RESTART_RECONNECT
         if (!clixon_exit_get()) { /* May be part of termination */
-            if (clicon_rpc_msg_once(h, msg, 1, &retdata, &eof, NULL) < 0)
+            if (clicon_rpc_msg_once(h, msg, 1, &mb, &eof, NULL) < 0)
                 goto done;
             if (eof){
                 close(s);
@@ -240,11 +676,12 @@ clicon_rpc_msg(clixon_handle      h,
 #endif
     }
 
-    if (retdata){
+    if (mb){
         /* Cannot populate xret here because need to know RPC name (eg "lock") in order to associate yang
-         * to reply.
+         * to reply. Unless it is binary, which is bound as it is decoded
+         * The body is parsed where it is received, in shared memory for large replies
          */
-        if (clixon_xml_parse_string(retdata, YB_NONE, NULL, &xret, NULL) < 0)
+        if (rpc_reply_parse(h, clicon_msg_buf_body(mb), &xret) < 0)
             goto done;
     }
     if (xret0){
@@ -254,8 +691,8 @@ clicon_rpc_msg(clixon_handle      h,
     retval = 0;
  done:
     clixon_debug(CLIXON_DBG_DEFAULT | CLIXON_DBG_DETAIL, "retval:%d", retval);
-    if (retdata)
-        free(retdata);
+    if (mb)
+        clicon_msg_buf_unref(mb);
     if (xret)
         xml_free(xret);
     return retval;
@@ -278,11 +715,12 @@ clicon_rpc_msg_persistent(clixon_handle      h,
                           cxobj            **xret0,
                           int               *sock0)
 {
-    int     retval = -1;
-    char   *retdata = NULL;
-    cxobj  *xret = NULL;
-    int     s = -1;
-    int     eof = 0;
+    int             retval = -1;
+    clicon_msg_buf *mb = NULL;
+    char           *retdata = NULL;
+    cxobj          *xret = NULL;
+    int             s = -1;
+    int             eof = 0;
 
     if (sock0 == NULL){
         clixon_err(OE_NETCONF, EINVAL, "Missing socket pointer");
@@ -293,7 +731,7 @@ clicon_rpc_msg_persistent(clixon_handle      h,
 #endif
     clixon_debug(CLIXON_DBG_DEFAULT, "request:%s", msg->op_body);
     /* Create a socket and connect to it, either UNIX, IPv4 or IPv6 per config options */
-    if (clicon_rpc_msg_once(h, msg, 0, &retdata, &eof, &s) < 0)
+    if (clicon_rpc_msg_once(h, msg, 0, &mb, &eof, &s) < 0)
         goto done;
     if (eof){
         /* 2. check socket shutdown AFTER rpc */
@@ -306,6 +744,8 @@ clicon_rpc_msg_persistent(clixon_handle      h,
         clixon_err(OE_PROTO, ESHUTDOWN, "Unexpected close of CLICON_SOCK. Clixon backend daemon may have crashed.");
         goto done;
     }
+    if (mb)
+        retdata = clicon_msg_buf_body(mb);
     clixon_debug(CLIXON_DBG_DEFAULT, "retdata:%s", retdata);
 
     if (retdata){
@@ -326,8 +766,8 @@ clicon_rpc_msg_persistent(clixon_handle      h,
  done:
     if (s >= 0)
         close(s);
-    if (retdata)
-        free(retdata);
+    if (mb)
+        clicon_msg_buf_unref(mb);
     if (xret)
         xml_free(xret);
     return retval;
@@ -409,6 +849,70 @@ clicon_rpc_netconf(clixon_handle  h,
     return retval;
 }
 
+/*! Generic xml netconf clicon rpc without waiting for the reply
+ *
+ * @param[in]  h       clicon handle
+ * @param[in]  xmlstr  XML netconf tree as string. A message-id is added if not present
+ * @param[in]  fn      Reply callback
+ * @param[in]  arg     Argument to callback
+ * @param[out] idp     Request id (if not NULL)
+ * @retval     0       OK
+ * @retval    -1       Error
+ * @see clicon_rpc_msg_async
+ */
+int
+clicon_rpc_netconf_async(clixon_handle        h,
+                         char                *xmlstr,
+                         clicon_rpc_async_cb *fn,
+                         void                *arg,
+                         uint32_t            *idp)
+{
+    int                retval = -1;
+    uint32_t           session_id;
+    struct clicon_msg *msg = NULL;
+    cxobj             *xt = NULL;
+    cxobj             *xrpc;
+    cxobj             *xa;
+    cbuf              *cb = NULL;
+    char               msgid[16];
+
+    if (session_id_check(h, &session_id) < 0)
+        goto done;
+    if (clixon_xml_parse_string(xmlstr, YB_NONE, NULL, &xt, NULL) < 0)
+        goto done;
+    if ((xrpc = xml_child_i_type(xt, 0, CX_ELMNT)) == NULL){
+        clixon_err(OE_NETCONF, EINVAL, "Missing rpc");
+        goto done;
+    }
+    if ((xa = xml_find_type(xrpc, NULL, "message-id", CX_ATTR)) == NULL ||
+        xml_prefix(xa) != NULL){
+        snprintf(msgid, sizeof(msgid), "%d", netconf_message_id_next(h));
+        if ((xa = xml_new("message-id", xrpc, CX_ATTR)) == NULL)
+            goto done;
+        if (xml_value_set(xa, msgid) < 0)
+            goto done;
+    }
+    if ((cb = cbuf_new()) == NULL){
+        clixon_err(OE_XML, errno, "cbuf_new");
+        goto done;
+    }
+    if (clixon_xml2cbuf(cb, xrpc, 0, 0, NULL, -1, 0) < 0)
+        goto done;
+    if ((msg = clicon_msg_encode(session_id, "%s", cbuf_get(cb))) == NULL)
+        goto done;
+    if (rpc_msg_async(h, msg, xml_value(xa), fn, arg, idp) < 0)
+        goto done;
+    retval = 0;
+ done:
+    if (cb)
+        cbuf_free(cb);
+    if (xt)
+        xml_free(xt);
+    if (msg)
+        free(msg);
+    return retval;
+}
+
 /*! Generic xml netconf clicon rpc
  *
  * Want to go over to use netconf directly between client and server,...
@@ -578,7 +1082,9 @@ clicon_rpc_get_config(clixon_handle h,
     else{
         if (xml_bind_special(xd, yspec, "/nc:get-config/output/data") < 0)
             goto done;
-        if ((ret = xml_bind_yang(h, xd, YB_MODULE, yspec, &xerr)) < 0)
+        if (rpc_reply_bound(xd))
+            ret = 1;
+        else if ((ret = xml_bind_yang(h, xd, YB_MODULE, yspec, &xerr)) < 0)
             goto done;
         if (ret == 0){
             if (clixon_netconf_internal_error(xerr,
@@ -1078,7 +1584,7 @@ clicon_rpc_get2(clixon_handle   h,
     else{
         if (xml_bind_special(xd, yspec, "/nc:get/output/data") < 0)
             goto done;
-        if (bind){
+        if (bind && !rpc_reply_bound(xd)){
             if ((ret = xml_bind_yang(h, xd, YB_MODULE, yspec, &xerr)) < 0)
                 goto done;
             if (ret == 0){
@@ -1248,7 +1754,9 @@ clicon_rpc_get_pageable_list(clixon_handle   h,
     else{
         if (xml_bind_special(xd, yspec, "/nc:get/output/data") < 0)
             goto done;
-        if ((ret = xml_bind_yang(h, xd, YB_MODULE, yspec, &xerr)) < 0)
+        if (rpc_reply_bound(xd))
+            ret = 1;
+        else if ((ret = xml_bind_yang(h, xd, YB_MODULE, yspec, &xerr)) < 0)
             goto done;
         if (ret == 0){
             if (clixon_netconf_internal_error(xerr,
@@ -1846,6 +2354,7 @@ clicon_hello_req(clixon_handle h,
     int                clixon_lib = 0;
     char              *ns = NULL;
     char              *prefix = NULL;
+    yang_stmt         *yspec;
 
     if ((cb = cbuf_new()) == NULL){
         clixon_err(OE_XML, errno, "cbuf_new");
@@ -1874,8 +2383,18 @@ clicon_hello_req(clixon_handle h,
     if (clixon_lib)
         cprintf(cb, " xmlns:%s=\"%s\"", CLIXON_LIB_PREFIX, CLIXON_LIB_NS);
     cprintf(cb, ">");
-    cprintf(cb, "<capabilities><capability>%s</capability></capabilities>",
+    cprintf(cb, "<capabilities><capability>%s</capability>",
             NETCONF_BASE_CAPABILITY_1_1);
+    /* Announce modules for binary encoded replies */
+    if (clicon_option_bool(h, "CLICON_IPC_BINARY") &&
+        (yspec = clicon_dbspec_yang(h)) != NULL &&
+        clixon_bin_capabilities(cb, yspec) < 0)
+        goto done;
+    /* Accept large replies in shared memory, local UNIX socket only */
+    if (clicon_option_int(h, "CLICON_IPC_SHM_THRESHOLD") > 0 &&
+        clicon_sock_family(h) == AF_UNIX)
+        cprintf(cb, "<capability>%s</capability>", CLIXON_IPC_SHM_CAPABILITY);
+    cprintf(cb, "</capabilities>");
     cprintf(cb, "</hello>");
 
     if ((msg = clicon_msg_encode(0, "%s", cbuf_get(cb))) == NULL)
@@ -37,7 +37,10 @@
  * The stream implementation has three parts:
  * 1) Base stream handling: stream_find/register/delete_all/get_xml
  * 2) Stream subscription handling (stream_ss_add/delete/timeout, stream_notify, etc
+ *    An event is serialized once per encoding and shared by all subscribers, see stream_event
  * 3) Stream replay: stream_replay/_add
+ *    Events are serialized into a log of segments with a ring of time index entries,
+ *    optionally also written to segment files in CLICON_STREAM_REPLAY_DIR
  * 4) nginx/nchan publish code (use --enable-publish config option)
  *
  *
@@ -61,10 +64,16 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <inttypes.h>
 #include <syslog.h>
+#include <dirent.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/time.h>
+#include <sys/param.h>
 
 /* cligen */
 #include <cligen/cligen.h>
@@ -74,6 +83,7 @@
 #include "clixon_string.h"
 #include "clixon_hash.h"
 #include "clixon_handle.h"
+#include "clixon_file.h"
 #include "clixon_yang.h"
 #include "clixon_xml.h"
 #include "clixon_err.h"
@@ -82,15 +92,34 @@
 #include "clixon_event.h"
 #include "clixon_netconf_lib.h"
 #include "clixon_xml_io.h"
+#include "clixon_json.h"
+#include "clixon_proto.h"
 #include "clixon_options.h"
 #include "clixon_data.h"
 #include "clixon_xpath_ctx.h"
 #include "clixon_xpath.h"
 #include "clixon_stream.h"
+#include "clixon_latency.h"
+#include "clixon_probe.h"
 
 /* Go through and timeout subscription timers [s] */
 #define STREAM_TIMER_TIMEOUT_S 5
 
+/* Size of replay log segment, a larger event gets a segment of its own */
+#define STREAM_REPLAY_SEG_SIZE (64*1024)
+
+/* Notification event shared by all subscribers */
+struct stream_event{
+    int    se_refcnt;                /* Reference count */
+    cxobj *se_xml;                   /* Event as XML, or NULL if not yet parsed */
+    cbuf  *se_enc[STREAM_ENC_NR];    /* Event per encoding, or NULL if not yet serialized */
+};
+
+static int stream_replay_load(event_stream_t *es);
+static void stream_replay_evict(event_stream_t *es, struct timeval *now);
+static void stream_replay_free(event_stream_t *es);
+static stream_event *stream_event_new(cxobj *xml, const char *str, size_t len);
+
 /*! Find an event notification stream given name
  *
  * @param[in]  h    Clixon handle
@@ -134,6 +163,7 @@ stream_add(clixon_handle   h,
 {
     int             retval = -1;
     event_stream_t *es;
+    char           *dir;
 
     if ((es = stream_find(h, name)) != NULL)
         goto ok;
@@ -150,9 +180,24 @@ stream_add(clixon_handle   h,
         clixon_err(OE_XML, errno, "strdup");
         goto done;
     }
+    if ((es->es_filter_index = clicon_hash_init()) == NULL)
+        goto done;
     es->es_replay_enabled = replay_enabled;
     if (retention)
         es->es_retention = *retention;
+    if (replay_enabled){
+        if (clicon_option_exists(h, "CLICON_STREAM_REPLAY_MAX"))
+            es->es_replay_max = clicon_option_int(h, "CLICON_STREAM_REPLAY_MAX");
+        if ((dir = clicon_option_str(h, "CLICON_STREAM_REPLAY_DIR")) != NULL){
+            if ((es->es_replay_dir = malloc(strlen(dir) + strlen(name) + 2)) == NULL){
+                clixon_err(OE_UNIX, errno, "malloc");
+                goto done;
+            }
+            sprintf(es->es_replay_dir, "%s/%s", dir, name);
+            if (stream_replay_load(es) < 0)
+                goto done;
+        }
+    }
     clicon_stream_append(h, es);
  ok:
     retval = 0;
@@ -171,7 +216,6 @@ stream_delete_all(clixon_handle h,
                   int           force)
 {
     int                   retval = -1;
-    struct stream_replay *r;
     struct stream_subscription *ss;
     event_stream_t       *es;
     event_stream_t       *head = clicon_stream(h);
@@ -187,12 +231,9 @@ stream_delete_all(clixon_handle h,
             if (stream_ss_rm(h, es, ss, force) < 0)
                 goto done;
         }
-        while ((r = es->es_replay) != NULL){
-            DELQ(r, es->es_replay, struct stream_replay *);
-            if (r->r_xml)
-                xml_free(r->r_xml);
-            free(r);
-        }
+        if (es->es_filter_index)
+            clicon_hash_free(es->es_filter_index);
+        stream_replay_free(es);
         free(es);
     }
     retval = 0;
@@ -202,20 +243,26 @@ stream_delete_all(clixon_handle h,
 
 /*! Return stream definition state in XML supporting RFC 8040 and RFC5277
  *
- * @param[in]  h      Clixon handle
- * @param[in]  access If set, include access/location
- * @param[out] cb     Output buffer containing XML on exit
- * @retval     0      OK
- * @retval    -1      Error
+ * Subscription state is only included for subscriptions of the requesting user,
+ * the subscriptions of other users are not visible.
+ * @param[in]  h        Clixon handle
+ * @param[in]  access   If set, include access/location
+ * @param[in]  username User of request, or NULL
+ * @param[out] cb       Output buffer containing XML on exit
+ * @retval     0        OK
+ * @retval    -1        Error
+ * @see stream_ss_add_user
  */
 int
 stream_get_xml(clixon_handle h,
                int           access,
+               char         *username,
                cbuf         *cb)
 {
     event_stream_t *es = NULL;
     char           *url_prefix;
     char           *stream_path;
+    struct stream_subscription *ss;
 
     cprintf(cb, "<streams>");
     if ((es = clicon_stream(h)) != NULL){
@@ -226,6 +273,19 @@ stream_get_xml(clixon_handle h,
                 cprintf(cb, "<description>%s</description>", es->es_description);
             cprintf(cb, "<replay-support>%s</replay-support>",
                     es->es_replay_enabled?"true":"false");
+            /* Subscription state is not in RFC 8040 stream */
+            if (!access && (ss = es->es_subscription) != NULL)
+                do {
+                    if (!ss->ss_terminated &&
+                        clicon_strcmp(ss->ss_username, username) == 0){
+                        cprintf(cb, "<subscription>");
+                        cprintf(cb, "<id>%u</id>", ss->ss_id);
+                        cprintf(cb, "<queue>%d</queue>", ss->ss_qlen);
+                        cprintf(cb, "<drops>%u</drops>", ss->ss_drops);
+                        cprintf(cb, "</subscription>");
+                    }
+                    ss = NEXTQ(struct stream_subscription *, ss);
+                } while (ss && ss != es->es_subscription);
             if (access){
                 cprintf(cb, "<access>");
                 cprintf(cb, "<encoding>xml</encoding>");
@@ -260,12 +320,9 @@ stream_timer_setup(int   fd,
     struct timeval               now;
     struct timeval               t;
     struct timeval               t1 = {STREAM_TIMER_TIMEOUT_S, 0};
-    struct timeval               tret;
     event_stream_t              *es;
     struct stream_subscription  *ss;
     struct stream_subscription  *ss1;
-    struct stream_replay        *r;
-    struct stream_replay        *r1;
 
     clixon_debug(CLIXON_DBG_STREAM, "");
     /* Go thru callbacks and see if any have timed out, if so remove them 
@@ -293,22 +350,7 @@ stream_timer_setup(int   fd,
                         ss = NEXTQ(struct stream_subscription *, ss);
                 } while (ss && ss != es->es_subscription);
   /* 2) Go throughreplay buffer and remove entries with passed retention time */
-            if (timerisset(&es->es_retention) &&
-                (r = es->es_replay) != NULL){
-                timersub(&now, &es->es_retention, &tret);
-                do {
-                    if (timercmp(&r->r_tv, &tret, <)){
-                        r1 = NEXTQ(struct stream_replay *, r);
-                        DELQ(r, es->es_replay, struct stream_replay *);
-                        if (r->r_xml)
-                            xml_free(r->r_xml);
-                        free(r);
-                        r = r1;
-                    }
-                    else
-                        r = NEXTQ(struct stream_replay *, r);
-                } while (r && r!=es->es_replay);
-            }
+            stream_replay_evict(es, &now);
             es = NEXTQ(struct event_stream *, es);
         } while (es && es != clicon_stream(h));
     }
@@ -324,26 +366,293 @@ stream_timer_setup(int   fd,
     return retval;
 }
 
-/*! Add an event notification callback to a stream given a callback function
+/*! Get the event element name required by a subscription filter
+ *
+ * A filter is evaluated on the notification, its first location step selects
+ * the event element after eventTime. If the step is a name test, the filter
+ * cannot match events with another element name.
+ * Only the local name is used, prefixes are checked when evaluating the filter.
+ * @param[in]  xt    Parsed filter xpath
+ * @retval     name  Event element name
+ * @retval     NULL  Filter may match any event, eg wildcard, descendant or union
+ */
+static char *
+stream_filter_name(xpath_tree *xt)
+{
+    /* Skip expression levels without operator */
+    while (xt != NULL && xt->xs_c1 == NULL &&
+           (xt->xs_type == XP_EXP || xt->xs_type == XP_AND ||
+            xt->xs_type == XP_RELEX || xt->xs_type == XP_ADD ||
+            xt->xs_type == XP_UNION || xt->xs_type == XP_PATHEXPR))
+        xt = xt->xs_c0;
+    if (xt == NULL || xt->xs_type != XP_LOCPATH)
+        return NULL;
+    xt = xt->xs_c0;
+    /* The notification is the root of the event */
+    if (xt != NULL && xt->xs_type == XP_ABSPATH){
+        if (xt->xs_int != A_ROOT)
+            return NULL;
+        xt = xt->xs_c0;
+    }
+    /* First step is leftmost in relative location path */
+    while (xt != NULL && xt->xs_type == XP_RELLOCPATH && xt->xs_c1 != NULL)
+        xt = xt->xs_c0;
+    if (xt == NULL || xt->xs_type != XP_RELLOCPATH)
+        return NULL;
+    xt = xt->xs_c0;
+    if (xt == NULL || xt->xs_type != XP_STEP || xt->xs_int != A_CHILD)
+        return NULL;
+    xt = xt->xs_c0;
+    if (xt == NULL || xt->xs_type != XP_NODE ||
+        xt->xs_s1 == NULL || strcmp(xt->xs_s1, "*") == 0)
+        return NULL;
+    return xt->xs_s1;
+}
+
+/*! Get queue of filters of a stream requiring an event element name
+ *
+ * @param[in]  es    Stream
+ * @param[in]  name  Event element name, or NULL for filters matching any event
+ * @param[in]  add   If set, add empty queue if not found
+ * @retval     headp Pointer to head of queue
+ * @retval     NULL  Not found, or error if add is set
+ */
+static struct stream_filter **
+stream_filter_queue(event_stream_t *es,
+                    const char     *name,
+                    int             add)
+{
+    struct stream_filter **headp;
+    struct stream_filter  *sf = NULL;
+
+    if (name == NULL)
+        return &es->es_filters;
+    if ((headp = clicon_hash_value(es->es_filter_index, name, NULL)) == NULL && add){
+        if (clicon_hash_add(es->es_filter_index, name, &sf, sizeof(sf)) == NULL)
+            return NULL;
+        headp = clicon_hash_value(es->es_filter_index, name, NULL);
+    }
+    return headp;
+}
+
+/*! Add subscription to the filter group of its xpath, create group if not found
+ *
+ * Subscriptions with structurally equal xpaths, and equal period and user, share a
+ * filter group which is parsed once. The group is indexed on the event element name the xpath requires.
+ * @param[in]  es    Stream
+ * @param[in]  ss    Subscription
+ * @param[in]  xpath Filter xpath, or NULL
+ * @retval     0     OK
+ * @retval    -1     Error
+ * @see stream_filter_rm
+ */
+static int
+stream_filter_add(event_stream_t             *es,
+                  struct stream_subscription *ss,
+                  const char                 *xpath)
+{
+    int                          retval = -1;
+    xpath_tree                  *xt = NULL;
+    struct stream_filter       **headp;
+    struct stream_filter        *sf;
+    struct stream_filter        *sfnew = NULL;
+    struct stream_subscription **vec;
+    char                        *name = NULL;
+    int                          ret;
+
+    if (xpath && strlen(xpath) && xpath_parse(xpath, &xt) < 0)
+        goto done;
+    if (xt)
+        name = stream_filter_name(xt);
+    if ((headp = stream_filter_queue(es, name, 1)) == NULL)
+        goto done;
+    if ((sf = *headp) != NULL)
+        do {
+            if (sf->sf_period == ss->ss_period &&
+                clicon_strcmp(sf->sf_username, ss->ss_username) == 0){
+                if (xt == NULL && sf->sf_tree == NULL)
+                    goto found;
+                if (xt != NULL && sf->sf_tree != NULL){
+                    if ((ret = xpath_tree_eq(sf->sf_tree, xt, NULL, NULL)) < 0)
+                        goto done;
+                    if (ret == 1)
+                        goto found;
+                }
+            }
+            sf = NEXTQ(struct stream_filter *, sf);
+        } while (sf != *headp);
+    if ((sfnew = malloc(sizeof(*sfnew))) == NULL){
+        clixon_err(OE_UNIX, errno, "malloc");
+        goto done;
+    }
+    memset(sfnew, 0, sizeof(*sfnew));
+    if (xt && (sfnew->sf_xpath = strdup(xpath)) == NULL){
+        clixon_err(OE_UNIX, errno, "strdup");
+        goto done;
+    }
+    if (name && (sfnew->sf_name = strdup(name)) == NULL){
+        clixon_err(OE_UNIX, errno, "strdup");
+        goto done;
+    }
+    if (ss->ss_username && (sfnew->sf_username = strdup(ss->ss_username)) == NULL){
+        clixon_err(OE_UNIX, errno, "strdup");
+        goto done;
+    }
+    sfnew->sf_tree = xt;
+    sfnew->sf_period = ss->ss_period;
+    xt = NULL;
+    sf = sfnew;
+    sfnew = NULL;
+    ADDQ(sf, *headp);
+ found:
+    if ((vec = realloc(sf->sf_vec, (sf->sf_len+1)*sizeof(*vec))) == NULL){
+        clixon_err(OE_UNIX, errno, "realloc");
+        goto done;
+    }
+    sf->sf_vec = vec;
+    sf->sf_vec[sf->sf_len++] = ss;
+    ss->ss_filter = sf;
+    retval = 0;
+ done:
+    if (sfnew){
+        if (sfnew->sf_xpath)
+            free(sfnew->sf_xpath);
+        if (sfnew->sf_name)
+            free(sfnew->sf_name);
+        if (sfnew->sf_username)
+            free(sfnew->sf_username);
+        free(sfnew);
+    }
+    if (xt)
+        xpath_tree_free(xt);
+    return retval;
+}
+
+/*! Remove subscription from its filter group, free group if empty
+ *
+ * @param[in]  es    Stream
+ * @param[in]  ss    Subscription
+ * @see stream_filter_add
+ */
+static void
+stream_filter_rm(event_stream_t             *es,
+                 struct stream_subscription *ss)
+{
+    struct stream_filter  *sf;
+    struct stream_filter **headp;
+    int                    i;
+
+    if ((sf = ss->ss_filter) == NULL)
+        return;
+    ss->ss_filter = NULL;
+    for (i = 0; i < sf->sf_len; i++)
+        if (sf->sf_vec[i] == ss)
+            break;
+    if (i < sf->sf_len){
+        memmove(&sf->sf_vec[i], &sf->sf_vec[i+1], (sf->sf_len-i-1)*sizeof(*sf->sf_vec));
+        sf->sf_len--;
+    }
+    if (sf->sf_len)
+        return;
+    if ((headp = stream_filter_queue(es, sf->sf_name, 0)) != NULL){
+        DELQ(sf, *headp, struct stream_filter *);
+        if (*headp == NULL && sf->sf_name)
+            clicon_hash_del(es->es_filter_index, sf->sf_name);
+    }
+    if (sf->sf_tree)
+        xpath_tree_free(sf->sf_tree);
+    if (sf->sf_xpath)
+        free(sf->sf_xpath);
+    if (sf->sf_name)
+        free(sf->sf_name);
+    if (sf->sf_username)
+        free(sf->sf_username);
+    if (sf->sf_vec)
+        free(sf->sf_vec);
+    if (sf->sf_pending)
+        stream_event_free(sf->sf_pending);
+    free(sf);
+}
+
+/*! Get all filter groups of a stream
+ *
+ * @param[in]  es    Stream
+ * @param[out] vecp  Vector of filter groups, free with free()
+ * @param[out] lenp  Length of vector
+ * @retval     0     OK
+ * @retval    -1     Error
+ */
+static int
+stream_filter_vec(event_stream_t         *es,
+                  struct stream_filter ***vecp,
+                  int                    *lenp)
+{
+    int                    retval = -1;
+    struct stream_filter **vec = NULL;
+    struct stream_filter **vec1;
+    int                    len = 0;
+    struct stream_filter **headp;
+    struct stream_filter  *sf;
+    char                 **keys = NULL;
+    size_t                 nkeys = 0;
+    size_t                 i;
+
+    if (clicon_hash_keys(es->es_filter_index, &keys, &nkeys) < 0)
+        goto done;
+    for (i = 0; i <= nkeys; i++){
+        /* Filters matching any event, then filters of each event element name */
+        if ((headp = stream_filter_queue(es, i<nkeys?keys[i]:NULL, 0)) == NULL ||
+            (sf = *headp) == NULL)
+            continue;
+        do {
+            if ((vec1 = realloc(vec, (len+1)*sizeof(*vec))) == NULL){
+                clixon_err(OE_UNIX, errno, "realloc");
+                goto done;
+            }
+            vec = vec1;
+            vec[len++] = sf;
+            sf = NEXTQ(struct stream_filter *, sf);
+        } while (sf != *headp);
+    }
+    *vecp = vec;
+    *lenp = len;
+    vec = NULL;
+    retval = 0;
+ done:
+    if (vec)
+        free(vec);
+    if (keys)
+        free(keys);
+    return retval;
+}
+
+/*! Add subscription to a stream
  *
  * @param[in]  h        Clixon handle
  * @param[in]  stream   Name of stream
  * @param[in]  xpath    Filter selector - xpath
  * @param[in]  startime If set, Make a replay
  * @param[in]  stoptime If set, dont continue past this time
+ * @param[in]  period   Period in centiseconds of periodic subscription, or 0
+ * @param[in]  username NACM user of subscription, or NULL
  * @param[in]  fn       Callback when event occurs
  * @param[in]  arg      Argument to use with callback. Also handle when deleting
- * @retval     0        OK
- * @retval    -1        Error, ie no such stream 
+ * @retval     ss       Subscription
+ * @retval     NULL     Error, ie no such stream
+ * @see stream_ss_add
+ * @see stream_ss_add_user
+ * @see stream_ss_add_periodic
  */
-struct stream_subscription *
-stream_ss_add(clixon_handle     h,
-              char             *stream,
-              char             *xpath,
-              struct timeval   *starttime,
-              struct timeval   *stoptime,
-              stream_fn_t       fn,
-              void             *arg)
+static struct stream_subscription *
+stream_ss_add1(clixon_handle     h,
+               char             *stream,
+               char             *xpath,
+               struct timeval   *starttime,
+               struct timeval   *stoptime,
+               uint32_t          period,
+               char             *username,
+               stream_fn_t       fn,
+               void             *arg)
 {
     event_stream_t             *es;
     struct stream_subscription *ss = NULL;
@@ -370,16 +679,239 @@ stream_ss_add(clixon_handle     h,
         clixon_err(OE_CFG, errno, "strdup");
         goto done;
     }
+    if (username && (ss->ss_username = strdup(username)) == NULL){
+        clixon_err(OE_CFG, errno, "strdup");
+        goto done;
+    }
     ss->ss_fn     = fn;
     ss->ss_arg    = arg;
+    ss->ss_id     = es->es_ss_id++;
+    ss->ss_period = period;
+    if ((ss->ss_qmax = clicon_option_int(h, "CLICON_STREAM_QUEUE_MAX")) < 0)
+        ss->ss_qmax = 0;
+    if (stream_filter_add(es, ss, xpath) < 0)
+        goto done;
     ADDQ(ss, es->es_subscription);
     return ss;
   done:
-    if (ss)
+    if (ss){
+        if (ss->ss_stream)
+            free(ss->ss_stream);
+        if (ss->ss_xpath)
+            free(ss->ss_xpath);
+        if (ss->ss_username)
+            free(ss->ss_username);
         free(ss);
+    }
     return NULL;
 }
 
+/*! Add an event notification callback to a stream given a callback function
+ *
+ * @param[in]  h        Clixon handle
+ * @param[in]  stream   Name of stream
+ * @param[in]  xpath    Filter selector - xpath
+ * @param[in]  startime If set, Make a replay
+ * @param[in]  stoptime If set, dont continue past this time
+ * @param[in]  fn       Callback when event occurs
+ * @param[in]  arg      Argument to use with callback. Also handle when deleting
+ * @retval     ss       Subscription
+ * @retval     NULL     Error, ie no such stream 
+ */
+struct stream_subscription *
+stream_ss_add(clixon_handle     h,
+              char             *stream,
+              char             *xpath,
+              struct timeval   *starttime,
+              struct timeval   *stoptime,
+              stream_fn_t       fn,
+              void             *arg)
+{
+    return stream_ss_add1(h, stream, xpath, starttime, stoptime, 0, NULL, fn, arg);
+}
+
+/*! Add a subscription to a stream whose events are computed per user
+ *
+ * Subscriptions with equal filter and user are in the same filter group, so that
+ * events computed with stream_notify_prepare can be access controlled for the user.
+ * The peer credentials of the subscriber are not known when events are computed, a
+ * recovery session is access controlled as any other session.
+ * @param[in]  h        Clixon handle
+ * @param[in]  stream   Name of stream
+ * @param[in]  xpath    Filter selector - xpath
+ * @param[in]  username NACM user of subscription, or NULL
+ * @param[in]  startime If set, Make a replay
+ * @param[in]  stoptime If set, dont continue past this time
+ * @param[in]  fn       Callback when event occurs
+ * @param[in]  arg      Argument to use with callback. Also handle when deleting
+ * @retval     ss       Subscription
+ * @retval     NULL     Error, ie no such stream
+ */
+struct stream_subscription *
+stream_ss_add_user(clixon_handle     h,
+                   char             *stream,
+                   char             *xpath,
+                   char             *username,
+                   struct timeval   *starttime,
+                   struct timeval   *stoptime,
+                   stream_fn_t       fn,
+                   void             *arg)
+{
+    return stream_ss_add1(h, stream, xpath, starttime, stoptime, 0, username, fn, arg);
+}
+
+/*! Add a periodic subscription to a stream
+ *
+ * Subscriptions with equal filter, period and user are in the same filter group, its
+ * events are computed once per period with stream_notify_prepare
+ * @param[in]  h        Clixon handle
+ * @param[in]  stream   Name of stream
+ * @param[in]  xpath    Filter selector - xpath
+ * @param[in]  period   Period in centiseconds
+ * @param[in]  username NACM user of subscription, or NULL
+ * @param[in]  fn       Callback when event occurs
+ * @param[in]  arg      Argument to use with callback. Also handle when deleting
+ * @retval     ss       Subscription
+ * @retval     NULL     Error, ie no such stream
+ */
+struct stream_subscription *
+stream_ss_add_periodic(clixon_handle h,
+                       char         *stream,
+                       char         *xpath,
+                       uint32_t      period,
+                       char         *username,
+                       stream_fn_t   fn,
+                       void         *arg)
+{
+    return stream_ss_add1(h, stream, xpath, NULL, NULL, period, username, fn, arg);
+}
+
+/*! Free events queued for a subscription
+ *
+ * @param[in]  ss   Subscription
+ */
+static void
+stream_ss_flush(struct stream_subscription *ss)
+{
+    while (ss->ss_qlen){
+        stream_event_free(ss->ss_queue[ss->ss_qhead]);
+        ss->ss_qhead = (ss->ss_qhead + 1) % ss->ss_qmax;
+        ss->ss_qlen--;
+    }
+    ss->ss_qhead = 0;
+}
+
+/*! Terminate subscription since its queue is full
+ *
+ * A subscription-terminated notification is sent to the subscriber, which is
+ * not busy-checked. The subscription gets no more events and is removed on the
+ * next event of the stream, see stream_notify1.
+ * @param[in]  h    Clixon handle
+ * @param[in]  es   Stream
+ * @param[in]  ss   Subscription
+ * @retval     0    OK
+ * @retval    -1    Error
+ * @see CLICON_STREAM_QUEUE_POLICY
+ */
+static int
+stream_ss_terminate(clixon_handle               h,
+                    event_stream_t             *es,
+                    struct stream_subscription *ss)
+{
+    int             retval = -1;
+    cbuf           *cb = NULL;
+    char            timestr[28];
+    struct timeval  tv;
+    stream_event   *se = NULL;
+
+    clixon_log(h, LOG_WARNING, "Stream %s subscription %u queue full, terminate",
+               es->es_name, ss->ss_id);
+    stream_ss_flush(ss);
+    ss->ss_terminated = 1;
+    if ((cb = cbuf_new()) == NULL){
+        clixon_err(OE_UNIX, errno, "cbuf_new");
+        goto done;
+    }
+    gettimeofday(&tv, NULL);
+    if (time2str(&tv, timestr, sizeof(timestr)) < 0){
+        clixon_err(OE_UNIX, errno, "time2str");
+        goto done;
+    }
+    cprintf(cb, "<notification xmlns=\"%s\"><eventTime>%s</eventTime>",
+            NETCONF_NOTIFICATION_NAMESPACE, timestr);
+    cprintf(cb, "<subscription-terminated xmlns=\"%s\">", CLIXON_LIB_NS);
+    cprintf(cb, "<stream>%s</stream><id>%u</id><reason>queue-full</reason>",
+            es->es_name, ss->ss_id);
+    cprintf(cb, "</subscription-terminated></notification>");
+    if ((se = stream_event_new(NULL, cbuf_get(cb), cbuf_len(cb))) == NULL)
+        goto done;
+    if ((*ss->ss_fn)(h, 0, se, ss->ss_arg) < 0)
+        goto done;
+    retval = 0;
+ done:
+    if (se)
+        stream_event_free(se);
+    if (cb)
+        cbuf_free(cb);
+    return retval;
+}
+
+/*! Pass event to subscriber, or queue it if the subscriber is busy
+ *
+ * If the queue is full, CLICON_STREAM_QUEUE_POLICY applies.
+ * @param[in]  h    Clixon handle
+ * @param[in]  es   Stream
+ * @param[in]  ss   Subscription
+ * @param[in]  se   Event
+ * @retval     1    OK, event passed or queued
+ * @retval     0    Event dropped
+ * @retval    -1    Error
+ * @see stream_ss_resume  Pass queued events
+ */
+static int
+stream_ss_push(clixon_handle               h,
+               event_stream_t             *es,
+               struct stream_subscription *ss,
+               stream_event               *se)
+{
+    int ret;
+
+    if (ss->ss_terminated)
+        return 0;
+    if (!ss->ss_busy){
+        if ((ret = (*ss->ss_fn)(h, 0, se, ss->ss_arg)) < 0)
+            return -1;
+        if (ret == 1 && ss->ss_qmax)
+            ss->ss_busy = 1;
+        return 1;
+    }
+    if (ss->ss_queue == NULL &&
+        (ss->ss_queue = calloc(ss->ss_qmax, sizeof(*ss->ss_queue))) == NULL){
+        clixon_err(OE_UNIX, errno, "calloc");
+        return -1;
+    }
+    if (ss->ss_qlen == ss->ss_qmax){
+        ss->ss_drops++;
+        switch (clicon_stream_queue_policy(h)){
+        case SQ_DROP_NEWEST:
+            return 0;
+        case SQ_TERMINATE:
+            if (stream_ss_terminate(h, es, ss) < 0)
+                return -1;
+            return 0;
+        case SQ_DROP_OLDEST:
+        default:
+            stream_event_free(ss->ss_queue[ss->ss_qhead]);
+            ss->ss_qhead = (ss->ss_qhead + 1) % ss->ss_qmax;
+            ss->ss_qlen--;
+            break;
+        }
+    }
+    ss->ss_queue[(ss->ss_qhead + ss->ss_qlen) % ss->ss_qmax] = stream_event_ref(se);
+    ss->ss_qlen++;
+    return 1;
+}
+
 /*! Delete event stream subscription to a stream given a callback and arg
  *
  * @param[in]  h      Clixon handle
@@ -397,13 +929,21 @@ stream_ss_rm(clixon_handle                h,
 {
     clixon_debug(CLIXON_DBG_STREAM, "");
     DELQ(ss, es->es_subscription, struct stream_subscription *);
-    /* Remove from upper layers - close socket etc. */
-    (*ss->ss_fn)(h, 1, NULL, ss->ss_arg);
+    stream_filter_rm(es, ss);
+    stream_ss_flush(ss);
+    /* Remove from upper layers - close socket etc. 
+     * A terminated subscriber has already got subscription-terminated */
+    if (!ss->ss_terminated)
+        (*ss->ss_fn)(h, 1, NULL, ss->ss_arg);
     if (force){
+        if (ss->ss_queue)
+            free(ss->ss_queue);
         if (ss->ss_stream)
             free(ss->ss_stream);
         if (ss->ss_xpath)
             free(ss->ss_xpath);
+        if (ss->ss_username)
+            free(ss->ss_username);
         free(ss);
     }
     clixon_debug(CLIXON_DBG_STREAM, "retval: 0");
@@ -443,56 +983,349 @@ stream_ss_find(event_stream_t   *es,
  * @retval   -1       Error
  * @see stream_ss_delete  For single stream
  */
-int
-stream_ss_delete_all(clixon_handle     h,
-                     stream_fn_t       fn,
-                     void             *arg)
+int
+stream_ss_delete_all(clixon_handle     h,
+                     stream_fn_t       fn,
+                     void             *arg)
+{
+    int                          retval = -1;
+    event_stream_t              *es;
+    struct stream_subscription  *ss;
+
+    if ((es = clicon_stream(h)) != NULL){
+        do {
+            if ((ss = stream_ss_find(es, fn, arg)) != NULL){
+                if (stream_ss_rm(h, es, ss, 1) < 0)
+                    goto done;
+            }
+            es = NEXTQ(struct event_stream *, es);
+        } while (es && es != clicon_stream(h));
+    }
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Delete a single stream
+ *
+ * @param[in] h      Clixon handle
+ * @retval    0      OK
+ * @retval   -1      Error
+
+ * @see stream_ss_delete_all (merge with this?)
+ */
+int
+stream_ss_delete(clixon_handle     h,
+                 char             *name,
+                 stream_fn_t       fn,
+                 void             *arg)
+{
+    int                          retval = -1;
+    event_stream_t              *es;
+    struct stream_subscription  *ss;
+
+    if ((es = clicon_stream(h)) != NULL){
+        do {
+            if (strcmp(name, es->es_name)==0)
+                if ((ss = stream_ss_find(es, fn, arg)) != NULL){
+                    if (stream_ss_rm(h, es, ss, 0) < 0)
+                        goto done;
+                }
+            es = NEXTQ(struct event_stream *, es);
+        } while (es && es != clicon_stream(h));
+    }
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Subscriber is no longer busy, pass queued events of its subscriptions
+ *
+ * Events are passed until the queues are empty, or the subscriber is busy again.
+ * @param[in] h       Clixon handle
+ * @param[in] fn      Stream callback
+ * @param[in] arg     Argument - typically unique client handle
+ * @retval    0       OK
+ * @retval   -1       Error
+ * @see stream_fn_t  Callback returns 1 if subscriber is busy
+ */
+int
+stream_ss_resume(clixon_handle     h,
+                 stream_fn_t       fn,
+                 void             *arg)
+{
+    int                          retval = -1;
+    event_stream_t              *es;
+    struct stream_subscription  *ss;
+    stream_event                *se;
+    int                          ret;
+
+    if ((es = clicon_stream(h)) != NULL){
+        do {
+            if ((ss = es->es_subscription) != NULL)
+                do {
+                    if (fn == ss->ss_fn && arg == ss->ss_arg && ss->ss_busy){
+                        ss->ss_busy = 0;
+                        while (ss->ss_qlen && !ss->ss_busy && !ss->ss_terminated){
+                            se = ss->ss_queue[ss->ss_qhead];
+                            ss->ss_qhead = (ss->ss_qhead + 1) % ss->ss_qmax;
+                            ss->ss_qlen--;
+                            ret = (*fn)(h, 0, se, arg);
+                            stream_event_free(se);
+                            if (ret < 0)
+                                goto done;
+                            if (ret == 1)
+                                ss->ss_busy = 1;
+                        }
+                    }
+                    ss = NEXTQ(struct stream_subscription *, ss);
+                } while (ss && ss != es->es_subscription);
+            es = NEXTQ(struct event_stream *, es);
+        } while (es && es != clicon_stream(h));
+    }
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Create notification event
+ *
+ * @param[in]  xml  Event as XML, consumed. Or NULL
+ * @param[in]  str  Event as XML string, copied. Or NULL
+ * @param[in]  len  Length of str
+ * @retval     se   Event with reference count 1, free with stream_event_free
+ * @retval     NULL Error
+ */
+static stream_event *
+stream_event_new(cxobj      *xml,
+                 const char *str,
+                 size_t      len)
+{
+    stream_event *se;
+
+    if ((se = malloc(sizeof(*se))) == NULL){
+        clixon_err(OE_UNIX, errno, "malloc");
+        return NULL;
+    }
+    memset(se, 0, sizeof(*se));
+    se->se_refcnt = 1;
+    if (str){
+        if ((se->se_enc[STREAM_ENC_XML] = cbuf_new_alloc(len + 1)) == NULL){
+            clixon_err(OE_UNIX, errno, "cbuf_new_alloc");
+            free(se);
+            return NULL;
+        }
+        cbuf_append_buf(se->se_enc[STREAM_ENC_XML], (void*)str, len);
+    }
+    se->se_xml = xml;
+    return se;
+}
+
+/*! Add reference to notification event
+ *
+ * @param[in]  se   Event
+ * @retval     se   Same event
+ */
+stream_event *
+stream_event_ref(stream_event *se)
+{
+    se->se_refcnt++;
+    return se;
+}
+
+/*! Remove reference to notification event, free when last reference is removed
+ *
+ * @param[in]  se   Event
+ * @retval     0    OK
+ */
+int
+stream_event_free(stream_event *se)
+{
+    int i;
+
+    if (se == NULL || --se->se_refcnt > 0)
+        return 0;
+    if (se->se_xml)
+        xml_free(se->se_xml);
+    for (i=0; i<STREAM_ENC_NR; i++)
+        if (se->se_enc[i])
+            cbuf_free(se->se_enc[i]);
+    free(se);
+    return 0;
+}
+
+/*! Get notification event as XML
+ *
+ * Parsed from the serialized event if needed, eg for a replayed event
+ * @param[in]  se   Event
+ * @retval     xml  Event as XML, owned by the event
+ * @retval     NULL Error
+ */
+cxobj *
+stream_event_xml(stream_event *se)
+{
+    cxobj *xt = NULL;
+
+    if (se->se_xml == NULL){
+        if (clixon_xml_parse_string(cbuf_get(se->se_enc[STREAM_ENC_XML]), YB_NONE, NULL, &xt, NULL) < 0)
+            goto done;
+        if (xml_rootchild(xt, 0, &xt) < 0)
+            goto done;
+        se->se_xml = xt;
+        xt = NULL;
+    }
+ done:
+    if (xt)
+        xml_free(xt);
+    return se->se_xml;
+}
+
+/*! Get serialized notification event, serialize on first use of the encoding
+ *
+ * @param[in]  se    Event
+ * @param[in]  enc   Encoding
+ * @param[out] datap Serialized event, owned by the event
+ * @param[out] lenp  Length of serialized event
+ * @retval     0     OK
+ * @retval    -1     Error
+ * @code
+ *   if (stream_event_encode(se, STREAM_ENC_MSG, &data, &len) < 0)
+ *      err;
+ *   write(s, data, len);
+ * @endcode
+ */
+int
+stream_event_encode(stream_event        *se,
+                    enum stream_encoding enc,
+                    char               **datap,
+                    size_t              *lenp)
+{
+    int    retval = -1;
+    cbuf  *cb = NULL;
+    cxobj *xml;
+    char  *str;
+    size_t len;
+
+    if (se->se_enc[enc] == NULL){
+        if ((cb = cbuf_new()) == NULL){
+            clixon_err(OE_UNIX, errno, "cbuf_new");
+            goto done;
+        }
+        switch (enc){
+        case STREAM_ENC_XML:
+        case STREAM_ENC_JSON:
+            if ((xml = stream_event_xml(se)) == NULL)
+                goto done;
+            if (enc == STREAM_ENC_XML){
+                if (clixon_xml2cbuf(cb, xml, 0, 0, NULL, -1, 0) < 0)
+                    goto done;
+            }
+            else if (clixon_json2cbuf(cb, xml, 0, 0, 0) < 0)
+                goto done;
+            break;
+        case STREAM_ENC_MSG:
+            if (stream_event_encode(se, STREAM_ENC_XML, &str, &len) < 0)
+                goto done;
+            if (clicon_msg_append(cb, str, len+1) < 0)
+                goto done;
+            break;
+        default:
+            clixon_err(OE_UNIX, EINVAL, "Unknown encoding %d", enc);
+            goto done;
+        }
+        se->se_enc[enc] = cb;
+        cb = NULL;
+    }
+    *datap = cbuf_get(se->se_enc[enc]);
+    *lenp = cbuf_len(se->se_enc[enc]);
+    retval = 0;
+ done:
+    if (cb)
+        cbuf_free(cb);
+    return retval;
+}
+
+/*! Evaluate filter on event and notify its subscriptions if it matches
+ *
+ * An event that cannot be parsed as XML is logged and skipped
+ * @param[in]  h       Clixon handle
+ * @param[in]  es      Stream
+ * @param[in]  sf      Filter group
+ * @param[in]  se      Notification event
+ * @param[out] nsubs   Incremented with number of subscriptions notified
+ * @retval     0       OK
+ * @retval    -1       Error
+ */
+static int
+stream_filter_notify(clixon_handle         h,
+                     event_stream_t       *es,
+                     struct stream_filter *sf,
+                     stream_event         *se,
+                     int                  *nsubs)
 {
-    int                          retval = -1;
-    event_stream_t              *es;
-    struct stream_subscription  *ss;
-
-    if ((es = clicon_stream(h)) != NULL){
-        do {
-            if ((ss = stream_ss_find(es, fn, arg)) != NULL){
-                if (stream_ss_rm(h, es, ss, 1) < 0)
-                    goto done;
-            }
-            es = NEXTQ(struct event_stream *, es);
-        } while (es && es != clicon_stream(h));
+    int                         retval = -1;
+    xp_ctx                     *xr = NULL;
+    struct stream_subscription *ss;
+    int                         i;
+    int                         ret;
+    cxobj                      *xe;
+
+    if (sf->sf_tree != NULL){
+        if ((xe = stream_event_xml(se)) == NULL){
+            clixon_log(h, LOG_WARNING, "%s: stream %s: event skipped: %s",
+                       __FUNCTION__, es->es_name, clixon_err_reason());
+            clixon_err_reset();
+            goto ok;
+        }
+        if (xpath_tree_eval(xe, NULL, sf->sf_tree, 0, &xr) < 0)
+            goto done;
+        if (xr == NULL || xr->xc_type != XT_NODESET || xr->xc_size == 0)
+            goto ok;
+    }
+    for (i = 0; i < sf->sf_len; i++){
+        ss = sf->sf_vec[i];
+        if ((ret = stream_ss_push(h, es, ss, se)) < 0)
+            goto done;
+        if (ret == 1)
+            (*nsubs)++;
     }
+ ok:
     retval = 0;
  done:
+    if (xr)
+        ctx_free(xr);
     return retval;
 }
 
-/*! Delete a single stream
+/*! Remove subscriptions of a stream whose stoptime has passed, or that are terminated
  *
- * @param[in] h      Clixon handle
- * @retval    0      OK
- * @retval   -1      Error
-
- * @see stream_ss_delete_all (merge with this?)
+ * @param[in]  h       Clixon handle
+ * @param[in]  es      Stream
+ * @param[in]  tv      Timestamp
+ * @retval     0       OK
+ * @retval    -1       Error
  */
-int
-stream_ss_delete(clixon_handle     h,
-                 char             *name,
-                 stream_fn_t       fn,
-                 void             *arg)
+static int
+stream_ss_expire(clixon_handle   h,
+                 event_stream_t *es,
+                 struct timeval *tv)
 {
-    int                          retval = -1;
-    event_stream_t              *es;
-    struct stream_subscription  *ss;
-
-    if ((es = clicon_stream(h)) != NULL){
-        do {
-            if (strcmp(name, es->es_name)==0)
-                if ((ss = stream_ss_find(es, fn, arg)) != NULL){
-                    if (stream_ss_rm(h, es, ss, 0) < 0)
-                        goto done;
-                }
-            es = NEXTQ(struct event_stream *, es);
-        } while (es && es != clicon_stream(h));
+    int                         retval = -1;
+    struct stream_subscription *ss;
+    struct stream_subscription *ss1;
+
+    ss = es->es_subscription;
+    while (ss != NULL){
+        if ((ss1 = NEXTQ(struct stream_subscription *, ss)) == es->es_subscription)
+            ss1 = NULL; /* last */
+        if (ss->ss_terminated ||
+            (timerisset(&ss->ss_stoptime) && /* stoptime has passed */
+             timercmp(&ss->ss_stoptime, tv, <))){
+            /* Signal to remove stream for upper levels */
+            if (stream_ss_rm(h, es, ss, 1) < 0)
+                goto done;
+        }
+        ss = ss1;
     }
     retval = 0;
  done:
@@ -501,10 +1334,12 @@ stream_ss_delete(clixon_handle     h,
 
 /*! Stream notify event and distribute to all registered callbacks
  *
+ * Each filter group is evaluated once per event. Only filter groups indexed on
+ * the event element name, or not indexed, are evaluated.
  * @param[in]  h       Clixon handle
  * @param[in]  stream  Name of event stream. CLICON is predefined as LOG stream
  * @param[in]  tv      Timestamp. Dont notify if subscription has stoptime<tv
- * @param[in]  event   Notification as xml tree
+ * @param[in]  se      Notification event
  * @retval     0       OK
  * @retval    -1       Error
  * @see stream_notify
@@ -514,33 +1349,49 @@ static int
 stream_notify1(clixon_handle   h,
                event_stream_t *es,
                struct timeval *tv,
-               cxobj          *xevent)
+               stream_event   *se)
 {
     int                         retval = -1;
-    struct stream_subscription *ss;
+    struct stream_filter      **headp;
+    struct stream_filter       *sf;
+    struct stream_filter       *sf1;
+    cxobj                      *xev;
+    cxobj                      *x;
+    int                         nsubs = 0;
+    uint64_t                    t0;
 
     clixon_debug(CLIXON_DBG_STREAM, "");
-    /* Go thru all subscriptions and find matches */
-    if ((ss = es->es_subscription) != NULL)
+    t0 = clixon_latency_now();
+    if (stream_ss_expire(h, es, tv) < 0)
+        goto done;
+    /* Filters matching any event */
+    if ((sf = es->es_filters) != NULL)
         do {
-            if (timerisset(&ss->ss_stoptime) && /* stoptime has passed */
-                timercmp(&ss->ss_stoptime, tv, <)){
-                struct stream_subscription *ss1;
-                ss1 = NEXTQ(struct stream_subscription *, ss);
-                /* Signal to remove stream for upper levels */
-                if (stream_ss_rm(h, es, ss, 1) < 0)
-                    goto done;
-                ss = ss1;
-            }
-            else{  /* xpath match */
-                if (ss->ss_xpath == NULL ||
-                    strlen(ss->ss_xpath)==0 ||
-                    xpath_first(xevent, NULL, "%s", ss->ss_xpath) != NULL)
-                    if ((*ss->ss_fn)(h, 0, xevent, ss->ss_arg) < 0)
-                        goto done;
-                ss = NEXTQ(struct stream_subscription *, ss);
-            }
-        } while (es->es_subscription && ss != es->es_subscription);
+            sf1 = NEXTQ(struct stream_filter *, sf);
+            if (stream_filter_notify(h, es, sf, se, &nsubs) < 0)
+                goto done;
+            sf = sf1;
+        } while (es->es_filters && sf != es->es_filters);
+    /* Filters requiring the name of an event element */
+    xev = stream_event_xml(se);
+    x = NULL;
+    while ((x = xml_child_each(xev, x, CX_ELMNT)) != NULL){
+        if (strcmp(xml_name(x), "eventTime") == 0)
+            continue;
+        /* Skip if same name as earlier element */
+        if (xml_find_type(xev, NULL, xml_name(x), CX_ELMNT) != x)
+            continue;
+        if ((headp = stream_filter_queue(es, xml_name(x), 0)) == NULL ||
+            (sf = *headp) == NULL)
+            continue;
+        do {
+            sf1 = NEXTQ(struct stream_filter *, sf);
+            if (stream_filter_notify(h, es, sf, se, &nsubs) < 0)
+                goto done;
+            sf = sf1;
+        } while (*headp && sf != *headp);
+    }
+    CLIXON_PROBE3(notify__fanout, es->es_name, nsubs, clixon_latency_now() - t0);
     retval = 0;
   done:
     return retval;
@@ -574,6 +1425,7 @@ stream_notify(clixon_handle h,
     char            timestr[28];
     struct timeval  tv;
     event_stream_t *es;
+    stream_event   *se = NULL;
 
     clixon_debug(CLIXON_DBG_STREAM, "");
     if ((es = stream_find(h, stream)) == NULL)
@@ -609,16 +1461,19 @@ stream_notify(clixon_handle h,
         goto done;
     if (xml_rootchild(xev, 0, &xev) < 0)
         goto done;
-    if (stream_notify1(h, es, &tv, xev) < 0)
+    if ((se = stream_event_new(xev, NULL, 0)) == NULL)
+        goto done;
+    xev = NULL;
+    if (stream_notify1(h, es, &tv, se) < 0)
+        goto done;
+    if (es->es_replay_enabled &&
+        stream_replay_add(es, &tv, se) < 0)
         goto done;
-    if (es->es_replay_enabled){
-        if (stream_replay_add(es, &tv, xev) < 0)
-            goto done;
-        xev = NULL; /* xml stored in replay_add and should not be freed */
-    }
  ok:
     retval = 0;
   done:
+    if (se)
+        stream_event_free(se);
     if (cb)
         cbuf_free(cb);
     if (xev)
@@ -628,6 +1483,143 @@ stream_notify(clixon_handle h,
     return retval;
 }
 
+/*! Prepare an event for each filter group of a stream, computed by a callback
+ *
+ * The events are sent with stream_notify_pending. Use this when an event depends on
+ * the filter of the subscription, and is computed from data that may be gone when
+ * the event can be sent, eg a commit where the events are sent when the
+ * datastore has been updated.
+ * Events are not added to the replay buffer of the stream.
+ * @param[in]  h       Clixon handle
+ * @param[in]  stream  Name of event stream
+ * @param[in]  fn      Callback computing the event of a filter group
+ * @param[in]  arg     Argument to fn
+ * @retval     0       OK
+ * @retval    -1       Error
+ * @code
+ *  if (stream_notify_prepare(h, "ON-CHANGE", fn, arg) < 0)
+ *    err;
+ *  ...
+ *  if (stream_notify_pending(h, "ON-CHANGE", 1) < 0)
+ *    err;
+ * @endcode
+ */
+int
+stream_notify_prepare(clixon_handle        h,
+                      char                *stream,
+                      stream_prepare_fn_t *fn,
+                      void                *arg)
+{
+    int                    retval = -1;
+    event_stream_t        *es;
+    struct stream_filter **vec = NULL;
+    struct stream_filter  *sf;
+    int                    len = 0;
+    int                    i;
+    cxobj                 *xev = NULL;
+    cxobj                 *xn = NULL;
+    struct timeval         tv;
+    char                   timestr[28];
+
+    clixon_debug(CLIXON_DBG_STREAM, "");
+    if ((es = stream_find(h, stream)) == NULL ||
+        es->es_subscription == NULL)
+        goto ok;
+    gettimeofday(&tv, NULL);
+    if (time2str(&tv, timestr, sizeof(timestr)) < 0){
+        clixon_err(OE_UNIX, errno, "time2str");
+        goto done;
+    }
+    if (stream_filter_vec(es, &vec, &len) < 0)
+        goto done;
+    for (i = 0; i < len; i++){
+        sf = vec[i];
+        if (fn(h, sf, arg, &xev) < 0)
+            goto done;
+        if (xev == NULL)
+            continue;
+        /* From RFC5277 */
+        if (clixon_xml_parse_va(YB_NONE, NULL, &xn, NULL,
+                                "<notification xmlns=\"%s\"><eventTime>%s</eventTime></notification>",
+                                NETCONF_NOTIFICATION_NAMESPACE, timestr) < 0)
+            goto done;
+        if (xml_rootchild(xn, 0, &xn) < 0)
+            goto done;
+        if (xml_addsub(xn, xev) < 0)
+            goto done;
+        xev = NULL;
+        if (sf->sf_pending)
+            stream_event_free(sf->sf_pending);
+        if ((sf->sf_pending = stream_event_new(xn, NULL, 0)) == NULL)
+            goto done;
+        xn = NULL;
+    }
+ ok:
+    retval = 0;
+ done:
+    if (xn)
+        xml_free(xn);
+    if (xev)
+        xml_free(xev);
+    if (vec)
+        free(vec);
+    return retval;
+}
+
+/*! Send or discard events of a stream prepared by stream_notify_prepare
+ *
+ * @param[in]  h       Clixon handle
+ * @param[in]  stream  Name of event stream
+ * @param[in]  send    If set send events to subscriptions of filter groups, else discard
+ * @retval     0       OK
+ * @retval    -1       Error
+ * @see stream_notify_prepare
+ */
+int
+stream_notify_pending(clixon_handle h,
+                      char         *stream,
+                      int           send)
+{
+    int                    retval = -1;
+    event_stream_t        *es;
+    struct stream_filter **vec = NULL;
+    struct stream_filter  *sf;
+    stream_event          *se;
+    int                    len = 0;
+    int                    i;
+    int                    j;
+    struct timeval         tv;
+
+    clixon_debug(CLIXON_DBG_STREAM, "");
+    if ((es = stream_find(h, stream)) == NULL)
+        goto ok;
+    if (send){
+        gettimeofday(&tv, NULL);
+        if (stream_ss_expire(h, es, &tv) < 0)
+            goto done;
+    }
+    if (stream_filter_vec(es, &vec, &len) < 0)
+        goto done;
+    for (i = 0; i < len; i++){
+        sf = vec[i];
+        if ((se = sf->sf_pending) == NULL)
+            continue;
+        sf->sf_pending = NULL;
+        for (j = 0; send && j < sf->sf_len; j++)
+            if (stream_ss_push(h, es, sf->sf_vec[j], se) < 0){
+                stream_event_free(se);
+                goto done;
+            }
+        stream_event_free(se);
+    }
+ ok:
+    retval = 0;
+ done:
+    if (vec)
+        free(vec);
+    return retval;
+}
+
 /*! Backward compatible function
  *
  * @param[in]  h       Clixon handle
@@ -651,6 +1643,7 @@ stream_notify_xml(clixon_handle h,
     char       timestr[28];
     struct timeval tv;
     event_stream_t *es;
+    stream_event   *se = NULL;
 
     clixon_debug(CLIXON_DBG_STREAM, "");
     if ((es = stream_find(h, stream)) == NULL)
@@ -679,16 +1672,19 @@ stream_notify_xml(clixon_handle h,
         goto done;
     if (xml_addsub(xev, xml2) < 0)
         goto done;
-    if (stream_notify1(h, es, &tv, xev) < 0)
+    if ((se = stream_event_new(xev, NULL, 0)) == NULL)
+        goto done;
+    xev = NULL;
+    if (stream_notify1(h, es, &tv, se) < 0)
+        goto done;
+    if (es->es_replay_enabled &&
+        stream_replay_add(es, &tv, se) < 0)
         goto done;
-    if (es->es_replay_enabled){
-        if (stream_replay_add(es, &tv, xev) < 0)
-            goto done;
-        xev = NULL; /* xml stored in replay_add and should not be freed */
-    }
  ok:
     retval = 0;
   done:
+    if (se)
+        stream_event_free(se);
     if (cb)
         cbuf_free(cb);
     if (xev)
@@ -724,6 +1720,7 @@ stream_notify_xml(clixon_handle h,
          zones.
          
  * Assume no future sample timestamps.
+ * The first event to replay is found with binary search in the time index.
  */
 static int
 stream_replay_notify(clixon_handle               h,
@@ -732,62 +1729,433 @@ stream_replay_notify(clixon_handle               h,
 {
     int                   retval = -1;
     struct stream_replay *r;
+    stream_event         *se = NULL;
+    size_t                lo;
+    size_t                hi;
+    size_t                mid;
+    size_t                i;
 
     /* If <startTime> is not present, this is not a replay */
     if (!timerisset(&ss->ss_starttime))
         goto ok;
     if (!es->es_replay_enabled)
         goto ok;
-    /* Get replay linked list */
-    if ((r = es->es_replay) == NULL)
-        goto ok;
-    /* First loop to skip until start */
-    do {
-        if (timercmp(&r->r_tv, &ss->ss_starttime, >=))
-            break;
-        r = NEXTQ(struct stream_replay *, r);
-    } while (r && r!=es->es_replay);
-    if (r == NULL)
-        goto ok; /* No samples to replay */
+    /* Skip until start: first entry not before starttime */
+    lo = 0;
+    hi = es->es_replay_len;
+    while (lo < hi){
+        mid = lo + (hi - lo)/2;
+        r = &es->es_replay[(es->es_replay_head + mid) % es->es_replay_size];
+        if (timercmp(&r->r_tv, &ss->ss_starttime, <))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
     /* Then notify until stop */
-    do {
+    for (i = lo; i < es->es_replay_len; i++){
+        r = &es->es_replay[(es->es_replay_head + i) % es->es_replay_size];
         if (timerisset(&ss->ss_stoptime) &&
             timercmp(&r->r_tv, &ss->ss_stoptime, >))
             break;
-        if ((*ss->ss_fn)(h, 0, r->r_xml, ss->ss_arg) < 0)
+        if ((se = stream_event_new(NULL, r->r_str, r->r_len)) == NULL)
+            goto done;
+        if ((*ss->ss_fn)(h, 0, se, ss->ss_arg) < 0)
             goto done;
-        r = NEXTQ(struct stream_replay *, r);
-    } while (r && r!=es->es_replay);
+        stream_event_free(se);
+        se = NULL;
+    }
  ok:
     retval = 0;
  done:
+    if (se)
+        stream_event_free(se);
+    return retval;
+}
+
+/*! Get file name of replay segment
+ *
+ * @param[in]  es   Stream
+ * @param[in]  seq  Sequence number of segment
+ * @param[out] path File name, at least MAXPATHLEN
+ */
+static void
+stream_replay_seg_path(event_stream_t *es,
+                       uint64_t        seq,
+                       char           *path)
+{
+    snprintf(path, MAXPATHLEN, "%s/%020" PRIu64 ".replay", es->es_replay_dir, seq);
+}
+
+/*! Create new replay segment last in the log
+ *
+ * If the stream has a replay directory, the segment file is created
+ * @param[in]  es   Stream
+ * @param[in]  size Size of segment buffer
+ * @param[out] segp New segment
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+static int
+stream_replay_seg_new(event_stream_t            *es,
+                      size_t                     size,
+                      struct stream_replay_seg **segp)
+{
+    int                       retval = -1;
+    struct stream_replay_seg *seg;
+    char                      path[MAXPATHLEN];
+
+    if ((seg = malloc(sizeof(*seg))) == NULL){
+        clixon_err(OE_UNIX, errno, "malloc");
+        goto done;
+    }
+    memset(seg, 0, sizeof(*seg));
+    seg->rs_fd = -1;
+    seg->rs_seq = es->es_replay_seq++;
+    seg->rs_size = size;
+    if ((seg->rs_buf = malloc(size)) == NULL){
+        clixon_err(OE_UNIX, errno, "malloc");
+        free(seg);
+        goto done;
+    }
+    if (es->es_replay_dir){
+        stream_replay_seg_path(es, seg->rs_seq, path);
+        if ((seg->rs_fd = open(path, O_WRONLY|O_CREAT|O_TRUNC|O_APPEND, S_IRUSR|S_IWUSR)) < 0){
+            clixon_err(OE_UNIX, errno, "open(%s)", path);
+            free(seg->rs_buf);
+            free(seg);
+            goto done;
+        }
+    }
+    ADDQ(seg, es->es_replay_segs);
+    *segp = seg;
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Free replay segment
+ *
+ * @param[in]  es    Stream
+ * @param[in]  seg   Segment
+ * @param[in]  purge Also remove segment file
+ */
+static void
+stream_replay_seg_free(event_stream_t           *es,
+                       struct stream_replay_seg *seg,
+                       int                       purge)
+{
+    char path[MAXPATHLEN];
+
+    DELQ(seg, es->es_replay_segs, struct stream_replay_seg *);
+    if (seg->rs_fd != -1)
+        close(seg->rs_fd);
+    if (purge && es->es_replay_dir){
+        stream_replay_seg_path(es, seg->rs_seq, path);
+        unlink(path);
+    }
+    if (seg->rs_buf)
+        free(seg->rs_buf);
+    free(seg);
+}
+
+/*! Append entry to replay time index ring
+ *
+ * @param[in]  es   Stream
+ * @param[in]  tv   Timestamp
+ * @param[in]  str  Serialized event in segment
+ * @param[in]  len  Length of str
+ * @param[in]  seg  Segment of event
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+static int
+stream_replay_push(event_stream_t           *es,
+                   struct timeval           *tv,
+                   char                     *str,
+                   size_t                    len,
+                   struct stream_replay_seg *seg)
+{
+    struct stream_replay *ring;
+    struct stream_replay *r;
+    size_t                size;
+    size_t                i;
+
+    if (es->es_replay_len == es->es_replay_size){ /* Full: double and unwrap */
+        size = es->es_replay_size ? 2*es->es_replay_size : 64;
+        if ((ring = malloc(size*sizeof(*ring))) == NULL){
+            clixon_err(OE_UNIX, errno, "malloc");
+            return -1;
+        }
+        for (i = 0; i < es->es_replay_len; i++)
+            ring[i] = es->es_replay[(es->es_replay_head + i) % es->es_replay_size];
+        if (es->es_replay)
+            free(es->es_replay);
+        es->es_replay = ring;
+        es->es_replay_size = size;
+        es->es_replay_head = 0;
+    }
+    r = &es->es_replay[(es->es_replay_head + es->es_replay_len) % es->es_replay_size];
+    r->r_tv = *tv;
+    r->r_str = str;
+    r->r_len = len;
+    r->r_seg = seg;
+    es->es_replay_len++;
+    es->es_replay_bytes += len;
+    seg->rs_live++;
+    return 0;
+}
+
+/*! Remove oldest replay event
+ *
+ * A segment is freed, and its file removed, when its last event is removed, unless it is
+ * the last segment that events are appended to.
+ * @param[in]  es   Stream with at least one replay event
+ */
+static void
+stream_replay_pop(event_stream_t *es)
+{
+    struct stream_replay     *r;
+    struct stream_replay_seg *seg;
+
+    r = &es->es_replay[es->es_replay_head];
+    seg = r->r_seg;
+    es->es_replay_head = (es->es_replay_head + 1) % es->es_replay_size;
+    es->es_replay_len--;
+    es->es_replay_bytes -= r->r_len;
+    if (--seg->rs_live == 0 &&
+        seg != PREVQ(struct stream_replay_seg *, es->es_replay_segs))
+        stream_replay_seg_free(es, seg, 1);
+}
+
+/*! Remove replay events older than retention time, or above the replay size limit
+ *
+ * @param[in]  es   Stream
+ * @param[in]  now  Current time
+ */
+static void
+stream_replay_evict(event_stream_t *es,
+                    struct timeval *now)
+{
+    struct timeval tret;
+
+    if (timerisset(&es->es_retention)){
+        timersub(now, &es->es_retention, &tret);
+        while (es->es_replay_len &&
+               timercmp(&es->es_replay[es->es_replay_head].r_tv, &tret, <))
+            stream_replay_pop(es);
+    }
+    if (es->es_replay_max)
+        while (es->es_replay_len && es->es_replay_bytes > es->es_replay_max)
+            stream_replay_pop(es);
+}
+
+/*! Free replay log and time index of stream, segment files are kept
+ *
+ * @param[in]  es   Stream
+ */
+static void
+stream_replay_free(event_stream_t *es)
+{
+    struct stream_replay_seg *seg;
+
+    while ((seg = es->es_replay_segs) != NULL)
+        stream_replay_seg_free(es, seg, 0);
+    if (es->es_replay)
+        free(es->es_replay);
+    es->es_replay = NULL;
+    es->es_replay_size = es->es_replay_head = es->es_replay_len = 0;
+    es->es_replay_bytes = 0;
+    if (es->es_replay_dir)
+        free(es->es_replay_dir);
+    es->es_replay_dir = NULL;
+}
+
+/*! Read replay segment file and add its events to the time index
+ *
+ * A truncated last record, eg from a crash while writing, is ignored
+ * @param[in]  es   Stream
+ * @param[in]  seq  Sequence number of segment
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+static int
+stream_replay_seg_load(event_stream_t *es,
+                       uint64_t        seq)
+{
+    int                       retval = -1;
+    struct stream_replay_seg *seg = NULL;
+    char                      path[MAXPATHLEN];
+    struct stat               st;
+    struct timeval            tv;
+    int                       fd = -1;
+    ssize_t                   n;
+    size_t                    len;
+    long                      sec;
+    long                      usec;
+    char                     *p;
+    char                     *nl;
+
+    stream_replay_seg_path(es, seq, path);
+    if ((fd = open(path, O_RDONLY)) < 0 || fstat(fd, &st) < 0){
+        clixon_err(OE_UNIX, errno, "open(%s)", path);
+        goto done;
+    }
+    if ((seg = malloc(sizeof(*seg))) == NULL){
+        clixon_err(OE_UNIX, errno, "malloc");
+        goto done;
+    }
+    memset(seg, 0, sizeof(*seg));
+    seg->rs_fd = -1;
+    seg->rs_seq = seq;
+    seg->rs_size = st.st_size;
+    if ((seg->rs_buf = malloc(seg->rs_size + 1)) == NULL){
+        clixon_err(OE_UNIX, errno, "malloc");
+        goto done;
+    }
+    while (seg->rs_len < seg->rs_size){
+        if ((n = read(fd, seg->rs_buf + seg->rs_len, seg->rs_size - seg->rs_len)) < 0){
+            clixon_err(OE_UNIX, errno, "read(%s)", path);
+            goto done;
+        }
+        if (n == 0)
+            break;
+        seg->rs_len += n;
+    }
+    ADDQ(seg, es->es_replay_segs);
+    p = seg->rs_buf;
+    while (p < seg->rs_buf + seg->rs_len){
+        if ((nl = memchr(p, '\n', seg->rs_buf + seg->rs_len - p)) == NULL)
+            break;
+        if (sscanf(p, "%ld %ld %zu", &sec, &usec, &len) != 3)
+            break;
+        if (len >= (size_t)(seg->rs_buf + seg->rs_len - nl - 1) || nl[1+len] != '\0')
+            break;
+        tv.tv_sec = sec;
+        tv.tv_usec = usec;
+        if (stream_replay_push(es, &tv, nl+1, len, seg) < 0)
+            goto done;
+        p = nl + 1 + len + 1;
+    }
+    seg = NULL;
+    retval = 0;
+ done:
+    if (seg){
+        if (seg->rs_buf)
+            free(seg->rs_buf);
+        free(seg);
+    }
+    if (fd != -1)
+        close(fd);
+    return retval;
+}
+
+/*! Load replay log of stream from segment files of an earlier run
+ *
+ * The stream replay directory is created if it does not exist.
+ * Events older than retention time are removed.
+ * @param[in]  es   Stream with replay directory
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+static int
+stream_replay_load(event_stream_t *es)
+{
+    int                       retval = -1;
+    struct dirent            *dp = NULL;
+    struct stream_replay_seg *seg;
+    struct timeval            now;
+    uint64_t                  seq;
+    int                       ndp;
+    int                       i;
+
+    if (mkdir(es->es_replay_dir, S_IRWXU) < 0 && errno != EEXIST){
+        clixon_err(OE_UNIX, errno, "mkdir(%s)", es->es_replay_dir);
+        goto done;
+    }
+    /* Zero-padded sequence numbers, ie sorted oldest first */
+    if ((ndp = clicon_file_dirent(es->es_replay_dir, &dp, "^[0-9]+\\.replay$", S_IFREG)) < 0)
+        goto done;
+    for (i = 0; i < ndp; i++){
+        seq = strtoull(dp[i].d_name, NULL, 10);
+        if (stream_replay_seg_load(es, seq) < 0)
+            goto done;
+        seg = PREVQ(struct stream_replay_seg *, es->es_replay_segs);
+        if (seg->rs_live == 0)
+            stream_replay_seg_free(es, seg, 1);
+        es->es_replay_seq = seq + 1;
+    }
+    gettimeofday(&now, NULL);
+    stream_replay_evict(es, &now);
+    clixon_debug(CLIXON_DBG_STREAM, "%s: %zu replay events", es->es_name, es->es_replay_len);
+    retval = 0;
+ done:
+    if (dp)
+        free(dp);
     return retval;
 }
 
 /*! Add replay sample to stream with timestamp
  *
+ * The XML encoding of the event is appended to the last segment of the replay log, and to
+ * its file if the stream has a replay directory.
+ * A record is the header "<sec> <usec> <len>\n" followed by the event and a null byte.
+ * Events older than retention time, or above the replay size limit, are removed.
  * @param[in] es   Stream
- * @param[in] tv   Timestamp
- * @param[in] xv   XML
+ * @param[in] tv   Timestamp, not before earlier samples
+ * @param[in] se   Event
  * @retval    0    OK
  * @retval   -1    Error
  */
 int
 stream_replay_add(event_stream_t *es,
                   struct timeval *tv,
-                  cxobj          *xv)
+                  stream_event   *se)
 {
-    int                   retval = -1;
-    struct stream_replay *new;
-
-    if ((new = malloc(sizeof *new)) == NULL){
-        clixon_err(OE_UNIX, errno, "malloc");
+    int                       retval = -1;
+    char                     *str;
+    struct stream_replay_seg *seg;
+    struct stream_replay_seg *seg0;
+    char                      hdr[64];
+    size_t                    hlen;
+    size_t                    len;
+    size_t                    reclen;
+    char                     *rec;
+
+    if (stream_event_encode(se, STREAM_ENC_XML, &str, &len) < 0)
+        goto done;
+    hlen = snprintf(hdr, sizeof(hdr), "%ld %06ld %zu\n",
+                    (long)tv->tv_sec, (long)tv->tv_usec, len);
+    reclen = hlen + len + 1;
+    seg = PREVQ(struct stream_replay_seg *, es->es_replay_segs);
+    if (seg == NULL ||
+        seg->rs_size - seg->rs_len < reclen ||
+        (es->es_replay_dir && seg->rs_fd == -1)){
+        seg0 = seg;
+        if (stream_replay_seg_new(es, reclen > STREAM_REPLAY_SEG_SIZE ? reclen : STREAM_REPLAY_SEG_SIZE,
+                                  &seg) < 0)
+            goto done;
+        if (seg0){ /* Previous segment is complete */
+            if (seg0->rs_fd != -1){
+                close(seg0->rs_fd);
+                seg0->rs_fd = -1;
+            }
+            if (seg0->rs_live == 0)
+                stream_replay_seg_free(es, seg0, 1);
+        }
+    }
+    rec = seg->rs_buf + seg->rs_len;
+    memcpy(rec, hdr, hlen);
+    memcpy(rec + hlen, str, len);
+    rec[hlen + len] = '\0';
+    if (seg->rs_fd != -1 &&
+        write(seg->rs_fd, rec, reclen) != (ssize_t)reclen){
+        clixon_err(OE_UNIX, errno, "write replay segment");
         goto done;
     }
-    memset(new, 0, (sizeof *new));
-    new->r_tv = *tv;
-    new->r_xml = xv;
-    ADDQ(new, es->es_replay);
+    seg->rs_len += reclen;
+    if (stream_replay_push(es, tv, rec + hlen, len, seg) < 0)
+        goto done;
+    stream_replay_evict(es, tv);
     retval = 0;
  done:
     return retval;
@@ -986,7 +2354,7 @@ url_post(char *url,
  * Push via curl_post to publish stream event
  * @param[in]  h     Clixon handle
  * @param[in]  op    Operation: 0 OK, 1 Close
- * @param[in]  event Event as XML
+ * @param[in]  se    Event, serialized as XML
  * @param[in]  arg   Extra argument provided in stream_ss_add
  * @retval     0     OK
  * @retval    -1     Error
@@ -995,15 +2363,16 @@ url_post(char *url,
 static int
 stream_publish_cb(clixon_handle h,
                   int           op,
-                  cxobj        *event,
+                  stream_event *se,
                   void         *arg)
 {
-    int   retval = -1;
-    cbuf *u = NULL; /* stream pub (push) url */
-    cbuf *d = NULL; /* (XML) data to push */
-    char *pub_prefix;
-    char *result = NULL;
-    char *stream = (char*)arg;
+    int    retval = -1;
+    cbuf  *u = NULL; /* stream pub (push) url */
+    char  *data;     /* (XML) data to push, owned by event */
+    size_t len;
+    char  *pub_prefix;
+    char  *result = NULL;
+    char  *stream = (char*)arg;
 
     clixon_debug(CLIXON_DBG_STREAM, "");
     if (op != 0)
@@ -1018,15 +2387,11 @@ stream_publish_cb(clixon_handle h,
         goto done;
     }
     cprintf(u, "%s/%s", pub_prefix, stream);
-    /* Create XML data as string */
-    if ((d = cbuf_new()) == NULL){
-        clixon_err(OE_XML, errno, "cbuf_new");
-        goto done;
-    }
-    if (clixon_xml2cbuf(d, event, 0, 0, NULL, -1, 0) < 0)
+    /* XML data as string, serialized once for all subscriptions */
+    if (stream_event_encode(se, STREAM_ENC_XML, &data, &len) < 0)
         goto done;
     if (url_post(cbuf_get(u),     /* url+stream */
-                 cbuf_get(d),     /* postfields */
+                 data,            /* postfields */
                  &result) < 0)    /* result as xml */
         goto done;
     if (result)
@@ -1036,8 +2401,6 @@ stream_publish_cb(clixon_handle h,
  done:
     if (u)
         cbuf_free(u);
-    if (d)
-        cbuf_free(d);
     if (result)
         free(result);
     return retval;
@@ -393,6 +393,85 @@ uri_percent_decode(char  *enc,
     return retval;
 }
 
+/*! Append a run of characters to a cbuf or a string buffer
+ *
+ * @param[in]  cb   CLIgen buf, or NULL
+ * @param[in]  esc  Output string buffer if cb is NULL, or NULL to only count length
+ * @param[in]  j    Current length of output
+ * @param[in]  s    Characters to append
+ * @param[in]  n    Number of characters
+ * @retval     j    New length of output
+ */
+static inline size_t
+xml_chardata_put(cbuf       *cb,
+                 char       *esc,
+                 size_t      j,
+                 const char *s,
+                 size_t      n)
+{
+    if (n == 0)
+        ;
+    else if (cb)
+        cbuf_append_buf(cb, (void*)s, n);
+    else if (esc)
+        memcpy(&esc[j], s, n);
+    return j + n;
+}
+
+/*! Escape characters according to XML definition into a cbuf or string, or compute length
+ *
+ * Runs of characters not needing escape are found with strcspn(), which is vectorized in
+ * common libc implementations, and copied as blocks. CDATA sections are copied verbatim.
+ * @param[in]  cb   CLIgen buf to append to, or NULL
+ * @param[in]  esc  Output string buffer if cb is NULL, or NULL to only compute length
+ * @param[in]  str  Not-encoded input string
+ * @retval     len  Length of encoded string, not including trailing \0
+ * @see xml_chardata_encode
+ */
+static size_t
+xml_chardata_escape(cbuf       *cb,
+                    char       *esc,
+                    const char *str)
+{
+    const char *s = str;
+    const char *e;
+    const char *rep;
+    size_t      j = 0;
+    size_t      n;
+
+    while (1){
+        n = strcspn(s, "&<>");
+        j = xml_chardata_put(cb, esc, j, s, n);
+        s += n;
+        switch (*s){
+        case '\0':
+            return j;
+        case '&':
+            rep = "&amp;";
+            break;
+        case '>':
+            rep = "&gt;";
+            break;
+        default: /* '<' */
+            if (strncmp(s, "<![CDATA[", strlen("<![CDATA[")) == 0){
+                /* Copy CDATA section including trailing ]]> without encoding */
+                if ((e = strstr(s+1, "]]>")) != NULL)
+                    n = e - s + strlen("]]>");
+                else
+                    n = strlen(s);
+                j = xml_chardata_put(cb, esc, j, s, n);
+                s += n;
+                continue;
+            }
+            rep = "&lt;";
+            break;
+        }
+        j = xml_chardata_put(cb, esc, j, rep, strlen(rep));
+        s++;
+    }
+    return j;
+}
+
 /*! Encode escape characters according to XML definition
  *
  * @param[out]  encp   Encoded malloced output string
@@ -427,12 +506,8 @@ xml_chardata_encode(char      **escp,
     char   *str = NULL;  /* Expanded format string w stdarg */
     int     fmtlen;
     char   *esc = NULL;
-    int     l;
-    int     len;
-    int     i, j;
-    int     cdata; /* when set, skip encoding */
+    size_t  len;
     va_list args;
-    size_t  slen;
 
     /* Two steps: (1) read in the complete format string */
     va_start(args, fmt); /* dryrun */
@@ -442,106 +517,38 @@ xml_chardata_encode(char      **escp,
         clixon_err(OE_UNIX, errno, "malloc");
         goto done;
     }
-    memset(str, 0, fmtlen);
     va_start(args, fmt); /* real */
     fmtlen = vsnprintf(str, fmtlen, fmt, args) + 1;
     va_end(args);
     /* Now str is the combined fmt + ... */
 
-    /* Step (2) encode and expand str --> enc */
-    /* First compute length (do nothing) */
-    len = 0; cdata = 0;
-    slen = strlen(str);
-    for (i=0; i<slen; i++){
-        if (cdata){
-            if (strncmp(&str[i], "]]>", strlen("]]>")) == 0)
-                cdata = 0;
-            len++;
-        }
-        else
-            switch (str[i]){
-            case '&':
-                len += strlen("&amp;");
-                break;
-            case '<':
-                if (strncmp(&str[i], "<![CDATA[", strlen("<![CDATA[")) == 0){
-                    len++;
-                    cdata++;
-                }
-                else
-                    len += strlen("&lt;");
-                break;
-            case '>':
-                len += strlen("&gt;");
-                break;
-            default:
-                len++;
-            }
+    /* Step (2) encode and expand str --> enc
+     * If nothing needs encoding, return str itself */
+    if (str[strcspn(str, "&<>")] == '\0'){
+        *escp = str;
+        str = NULL;
+        retval = 0;
+        goto done;
     }
-    len++; /* trailing \0 */
-    /* We know length, allocate encoding buffer  */
-    if ((esc = malloc(len)) == NULL){
+    /* First compute length, then encode into allocated buffer */
+    len = xml_chardata_escape(NULL, NULL, str);
+    if ((esc = malloc(len+1)) == NULL){
         clixon_err(OE_UNIX, errno, "malloc");
         goto done;
     }
-    memset(esc, 0, len);
-
-    /* Same code again, but now actually encode into output buffer */
-    j = 0; cdata = 0;
-    slen = strlen(str);
-    for (i=0; i<slen; i++){
-        if (cdata){
-            if (strncmp(&str[i], "]]>", strlen("]]>")) == 0){
-                cdata = 0;
-                esc[j++] = str[i++];
-                esc[j++] = str[i++];
-            }
-            esc[j++] = str[i];
-        }
-        else
-        switch (str[i]){
-        case '&':
-            if ((l=snprintf(&esc[j], 6, "&amp;")) < 0){
-                clixon_err(OE_UNIX, errno, "snprintf");
-                goto done;
-            }
-            j += l;
-            break;
-        case '<':
-            if (strncmp(&str[i], "<![CDATA[", strlen("<![CDATA[")) == 0){
-                esc[j++] = str[i];
-                cdata++;
-                break;
-            }
-            if ((l=snprintf(&esc[j], 5, "&lt;")) < 0){
-                clixon_err(OE_UNIX, errno, "snprintf");
-                goto done;
-            }
-            j += l;
-            break;
-        case '>':
-            if ((l=snprintf(&esc[j], 5, "&gt;")) < 0){
-                clixon_err(OE_UNIX, errno, "snprintf");
-                goto done;
-            }
-            j += l;
-            break;
-        default:
-            esc[j++] = str[i];
-        }
-    }
+    xml_chardata_escape(NULL, esc, str);
+    esc[len] = '\0';
     *escp = esc;
     retval = 0;
  done:
     if (str)
         free(str);
-    if (retval < 0 && esc)
-        free(esc);
     return retval;
 }
 
 /*! Escape characters according to XML definition and append to cbuf
  *
+ * Encodes directly into cb without intermediate buffers
  * @param[in]   cb     CLIgen buf
  * @param[in]   str    Not-encoded input string
  * @retdata     0      OK
@@ -551,49 +558,8 @@ int
 xml_chardata_cbuf_append(cbuf *cb,
                          char *str)
 {
-    int  retval = -1;
-    int  i;
-    int  cdata; /* when set, skip encoding */
-    size_t len;
-
-    /* The orignal of this code is in xml_chardata_encode */
-    /* Step: encode and expand str --> enc */
-    /* Same code again, but now actually encode into output buffer */
-    cdata = 0;
-
-    len = strlen(str);
-    for (i=0; i<len; i++){
-        if (cdata){
-            if (strncmp(&str[i], "]]>", strlen("]]>")) == 0){
-                cdata = 0;
-                cbuf_append(cb, str[i++]);
-                cbuf_append(cb, str[i++]);
-            }
-            cbuf_append(cb, str[i]);
-        }
-        else
-        switch (str[i]){
-        case '&':
-            cbuf_append_str(cb, "&amp;");
-            break;
-        case '<':
-            if (strncmp(&str[i], "<![CDATA[", strlen("<![CDATA[")) == 0){
-                cbuf_append(cb, str[i]);
-                cdata++;
-                break;
-            }
-            cbuf_append_str(cb, "&lt;");
-            break;
-        case '>':
-            cbuf_append_str(cb, "&gt;");
-            break;
-        default:
-            cbuf_append(cb, str[i]);
-        }
-    }
-    retval = 0;
-    // done:
-    return retval;
+    xml_chardata_escape(cb, NULL, str);
+    return 0;
 }
 
 /*! xml decode &...; 
@@ -688,6 +654,8 @@ xml_chardata_decode(char      **decp,
     size_t  slen;
     int     i;
     int     j;
+    size_t  n;
+    char   *amp;
     char    ch;
     int     ret;
 
@@ -706,29 +674,34 @@ xml_chardata_decode(char      **decp,
     /* Now str is the combined fmt + ... */
 
     /* Step (2) decode str --> dec 
-     * First allocate decoded string, encoded is always >= larger */
+     * First allocate decoded string, encoded is always >= larger
+     * Copy runs between '&' as blocks */
     slen = strlen(str);
     if ((dec = malloc(slen+1)) == NULL){
         clixon_err(OE_UNIX, errno, "malloc");
         goto done;
     }
     j = 0;
-    memset(dec, 0, slen+1);
-    for (i=0; i<slen; i++){
-        ch = str[i];
-        switch (ch){
-        case '&':
-            if ((ret = xml_chardata_decode_ampersand(&str[i+1], &ch, &i)) < 0)
-                goto done;
-            if (ret == 0)
-                dec[j++] = str[i];
-            else
-                dec[j++] = ch;
+    i = 0;
+    while (i < slen){
+        if ((amp = strchr(&str[i], '&')) == NULL)
+            n = slen - i;
+        else
+            n = amp - &str[i];
+        memcpy(&dec[j], &str[i], n);
+        j += n;
+        i += n;
+        if (amp == NULL)
             break;
-        default:
-            dec[j++] = str[i];
-        }
+        if ((ret = xml_chardata_decode_ampersand(&str[i+1], &ch, &i)) < 0)
+            goto done;
+        if (ret == 0)
+            dec[j++] = '&';
+        else
+            dec[j++] = ch;
+        i++;
     }
+    dec[j] = '\0';
     *decp = dec;
     retval = 0;
  done:
@@ -373,6 +373,7 @@ xml_yang_validate_rpc(clixon_handle h,
                       int           expanddefault,
                       cxobj       **xret)
 {
+    int        inext = 0;
     int        retval = -1;
     cxobj     *xn;       /* rpc name */
     char      *rpcprefix;
@@ -394,7 +395,7 @@ xml_yang_validate_rpc(clixon_handle h,
     }
     xn = NULL;
     /* xn is name of rpc, ie <rcp><xn/></rpc> */
-    while ((xn = xml_child_each(xrpc, xn, CX_ELMNT)) != NULL) {
+    while ((xn = xml_child_iter(xrpc, &inext, CX_ELMNT)) != NULL) {
         if (xml_spec(xn) == NULL){
             if (xret && netconf_unknown_element_xml(xret, "application", xml_name(xn), NULL) < 0)
                 goto done;
@@ -427,6 +428,7 @@ xml_yang_validate_rpc_reply(clixon_handle h,
                             cxobj        *xrpc,
                             cxobj       **xret)
 {
+    int        inext = 0;
     int        retval = -1;
     yang_stmt *yn=NULL;  /* rpc name */
     cxobj     *xn;       /* rpc name */
@@ -451,7 +453,7 @@ xml_yang_validate_rpc_reply(clixon_handle h,
     }
     xn = NULL;
     /* xn is name of rpc, ie <rcp><xn/></rpc> */
-    while ((xn = xml_child_each(xrpc, xn, CX_ELMNT)) != NULL) {
+    while ((xn = xml_child_iter(xrpc, &inext, CX_ELMNT)) != NULL) {
         /* OK and rpc-error are not explicit in ietf-netconf.yang.  Why are they hardcoded ? */
         if (strcmp(xml_name(xn), "ok") == 0 || strcmp(xml_name(xn), "rpc-error") == 0){
             continue;
@@ -506,13 +508,14 @@ check_choice(cxobj     *xp,
              yang_stmt *yt,
              cxobj    **xret)
 {
+    int        inext = 0;
     int        retval = -1;
     cxobj     *x;
     yang_stmt *y;
     yang_stmt *yp;
 
     x = NULL; /* Find a child with same yang spec */
-    while ((x = xml_child_each(xp, x, CX_ELMNT)) != NULL) {
+    while ((x = xml_child_iter(xp, &inext, CX_ELMNT)) != NULL) {
         if (x == xt)
             continue;
         y = xml_spec(x);
@@ -654,6 +657,7 @@ check_list_key(cxobj     *xt,
                cxobj    **xret)
 
 {
+    int        inext;
     int        retval = -1;
     yang_stmt *yc;
     cvec      *cvk = NULL; /* vector of index keys */
@@ -664,8 +668,8 @@ check_list_key(cxobj     *xt,
         clixon_err(OE_YANG, EINVAL, "yt is not a config true list node");
         goto done;
     }
-    yc = NULL;
-    while ((yc = yn_each(yt, yc)) != NULL) {
+    inext = 0;
+    while ((yc = yn_iter(yt, &inext)) != NULL) {
         if (yang_keyword_get(yc) != Y_KEY)
             continue;
         /* Check if a list does not have mandatory key leafs */
@@ -715,13 +719,14 @@ choice_mandatory_check(cxobj     *xt,
                        yang_stmt *ycase,
                        cxobj    **xret)
 {
+    int        inext = 0;
     int        retval = -1;
     yang_stmt *yc = NULL;
     cbuf      *cb = NULL;
     int        fail = 0;
     int        ret;
 
-    while ((yc = yn_each(ycase, yc)) != NULL) {
+    while ((yc = yn_iter(ycase, &inext)) != NULL) {
         if ((ret = yang_xml_mandatory(xt, yc)) < 0)
             goto done;
         if (ret == 1){
@@ -817,7 +822,8 @@ check_mandatory_case(cxobj     *xt,
                      yang_stmt *yc,
                      cxobj    **xret)
 {
-    int retval = 0;
+    int        inext;
+    int        retval = 0;
     cxobj     *x;
     yang_stmt *y;
     yang_stmt *ym;
@@ -826,8 +832,8 @@ check_mandatory_case(cxobj     *xt,
     int        ret;
 
     ycase = NULL;
-    x = NULL;
-    while ((x = xml_child_each(xt, x, CX_ELMNT)) != NULL) {
+    inext = 0;
+    while ((x = xml_child_iter(xt, &inext, CX_ELMNT)) != NULL) {
         if ((y = xml_spec(x)) != NULL &&
             yang_ancestor_child(y, yc, &ym, &ycnew) != 0 &&
             yang_keyword_get(ycnew) == Y_CASE){
@@ -892,6 +898,8 @@ check_mandatory(cxobj     *xt,
                 cxobj    **xret)
 
 {
+    int        inext;
+    int        inext1;
     int        retval = -1;
     cxobj     *x;
     yang_stmt *y;
@@ -910,13 +918,13 @@ check_mandatory(cxobj     *xt,
         if (ret == 0)
             goto fail;
     }
-    yc = NULL;
-    while ((yc = yn_each(yt, yc)) != NULL) {
+    inext = 0;
+    while ((yc = yn_iter(yt, &inext)) != NULL) {
         /* Choice is more complex because of choice/case structure and possibly hierarchical */
         if (yang_keyword_get(yc) == Y_CHOICE){
             if (yang_xml_mandatory(xt, yc)){
-                x = NULL;
-                while ((x = xml_child_each(xt, x, CX_ELMNT)) != NULL) {
+                inext1 = 0;
+                while ((x = xml_child_iter(xt, &inext1, CX_ELMNT)) != NULL) {
                     if ((y = xml_spec(x)) != NULL &&
                         (yp = yang_choice(y)) != NULL &&
                         yp == yc){
@@ -949,8 +957,8 @@ check_mandatory(cxobj     *xt,
             if (yang_config(yc)==0)
                  break;
             /* Find a child with the mandatory yang */
-            x = NULL;
-            while ((x = xml_child_each(xt, x, CX_ELMNT)) != NULL) {
+            inext1 = 0;
+            while ((x = xml_child_iter(xt, &inext1, CX_ELMNT)) != NULL) {
                 if ((y = xml_spec(x)) != NULL
                     && y==yc)
                     break; /* got it */
@@ -1006,6 +1014,7 @@ xml_yang_validate_add(clixon_handle h,
                       cxobj        *xt,
                       cxobj       **xret)
 {
+    int          inext;
     int          retval = -1;
     cg_var      *cv = NULL;
     char        *reason = NULL;
@@ -1076,8 +1085,8 @@ xml_yang_validate_add(clixon_handle h,
             break;
         }
     }
-    x = NULL;
-    while ((x = xml_child_each(xt, x, CX_ELMNT)) != NULL) {
+    inext = 0;
+    while ((x = xml_child_iter(xt, &inext, CX_ELMNT)) != NULL) {
         if ((ret = xml_yang_validate_add(h, x, xret)) < 0)
             goto done;
         if (ret == 0)
@@ -1107,6 +1116,7 @@ int
 xml_yang_validate_list_key_only(cxobj        *xt,
                                 cxobj       **xret)
 {
+    int        inext;
     int        retval = -1;
     yang_stmt *yt;   /* yang spec of xt going in */
     int        ret;
@@ -1122,8 +1132,8 @@ xml_yang_validate_list_key_only(cxobj        *xt,
         if (ret == 0)
             goto fail;
     }
-    x = NULL;
-    while ((x = xml_child_each(xt, x, CX_ELMNT)) != NULL) {
+    inext = 0;
+    while ((x = xml_child_iter(xt, &inext, CX_ELMNT)) != NULL) {
         if ((ret = xml_yang_validate_list_key_only(x, xret)) < 0)
             goto done;
         if (ret == 0)
@@ -1144,6 +1154,7 @@ xml_yang_validate_leaf_union(clixon_handle h,
                              yang_stmt    *yrestype,
                              cxobj       **xret)
 {
+    int        inext = 0;
     int        retval = -1;
     int        ret;
     yang_stmt *ytsub = NULL;
@@ -1152,7 +1163,7 @@ xml_yang_validate_leaf_union(clixon_handle h,
     char      *restype;
 
     /* Enough that one is valid, eg returns 1,otherwise fail */
-    while ((ytsub = yn_each(yrestype, ytsub)) != NULL){
+    while ((ytsub = yn_iter(yrestype, &inext)) != NULL){
         if (yang_keyword_get(ytsub) != Y_TYPE)
             continue;
         /* Resolve the sub-union type to a resolved type */
@@ -1223,6 +1234,7 @@ xml_yang_validate_all(clixon_handle h,
                       cxobj        *xt,
                       cxobj       **xret)
 {
+    int        inext;
     int        retval = -1;
     yang_stmt *yt;  /* yang node associated with xt */
     yang_stmt *yc;  /* yang child */
@@ -1333,8 +1345,8 @@ xml_yang_validate_all(clixon_handle h,
         }
         /* must sub-node RFC 7950 Sec 7.5.3. Can be several. 
          * XXX. use yang path instead? */
-        yc = NULL;
-        while ((yc = yn_each(yt, yc)) != NULL) {
+        inext = 0;
+        while ((yc = yn_iter(yt, &inext)) != NULL) {
             if (yang_keyword_get(yc) != Y_MUST)
                 continue;
             if (!saw_node)
@@ -1373,8 +1385,8 @@ xml_yang_validate_all(clixon_handle h,
             }
         }
     }
-    x = NULL;
-    while ((x = xml_child_each(xt, x, CX_ELMNT)) != NULL) {
+    inext = 0;
+    while ((x = xml_child_iter(xt, &inext, CX_ELMNT)) != NULL) {
         if ((ret = xml_yang_validate_all(h, x, xret)) < 0)
             goto done;
         if (ret == 0)
@@ -1414,11 +1426,12 @@ xml_yang_validate_all_top(clixon_handle h,
                           cxobj        *xt,
                           cxobj       **xret)
 {
+    int    inext;
     int    ret;
     cxobj *x;
 
-    x = NULL;
-    while ((x = xml_child_each(xt, x, CX_ELMNT)) != NULL) {
+    inext = 0;
+    while ((x = xml_child_iter(xt, &inext, CX_ELMNT)) != NULL) {
         if ((ret = xml_yang_validate_all(h, x, xret)) < 1)
             return ret;
     }
@@ -188,7 +188,8 @@ check_insert_duplicate(char **vec,
 
 /*! Given a list with unique constraint, detect duplicates
  *
- * @param[in]  x     The first element in the list (on return the last)
+ * @param[in]  x     The first element in the list
+ * @param[in]  inext Index of the sibling after x in xt, see xml_child_iter
  * @param[in]  xt    The parent of x (a list)
  * @param[in]  y     Its yang spec (Y_LIST)
  * @param[in]  yu    A yang unique (Y_UNIQUE) for unique schema node ids or (Y_LIST) for list keys
@@ -212,6 +213,7 @@ check_insert_duplicate(char **vec,
  */
 static int
 check_unique_list_direct(cxobj     *x,
+                         int        inext,
                          cxobj     *xt,
                          yang_stmt *y,
                          yang_stmt *yu,
@@ -275,7 +277,7 @@ check_unique_list_direct(cxobj     *x,
                 goto fail;
             }
         }
-        x = xml_child_each(xt, x, CX_ELMNT);
+        x = xml_child_iter(xt, &inext, CX_ELMNT);
         i++;
     } while (x && y == xml_spec(x));  /* stop if list ends, others may follow */
  ok:
@@ -292,7 +294,8 @@ check_unique_list_direct(cxobj     *x,
 
 /*! Given a list with unique constraint, detect duplicates
  *
- * @param[in]  x     The first element in the list (on return the last)
+ * @param[in]  x     The first element in the list
+ * @param[in]  inext Index of the sibling after x in xt, see xml_child_iter
  * @param[in]  xt    The parent of x (a list)
  * @param[in]  y     Its yang spec (Y_LIST)
  * @param[in]  yu    A yang unique (Y_UNIQUE) for unique schema node ids or (Y_LIST) for list keys
@@ -316,6 +319,7 @@ check_unique_list_direct(cxobj     *x,
  */
 static int
 check_unique_list(cxobj     *x,
+                  int        inext,
                   cxobj     *xt,
                   yang_stmt *y,
                   yang_stmt *yu,
@@ -335,7 +339,7 @@ check_unique_list(cxobj     *x,
     /* Check if multiple direct children */
     cvk = yang_cvec_get(yu);
     if (cvec_len(cvk) > 1){
-        retval = check_unique_list_direct(x, xt, y, yu, xret);
+        retval = check_unique_list_direct(x, inext, xt, y, yu, xret);
         goto done;
     }
     cvi = cvec_i(cvk, 0);
@@ -345,7 +349,7 @@ check_unique_list(cxobj     *x,
     }
     /* Check if direct schmeanode-id , ie not xpath */
     if (index(xpath0, '/') == NULL){
-        retval = check_unique_list_direct(x, xt, y, yu, xret);
+        retval = check_unique_list_direct(x, inext, xt, y, yu, xret);
         goto done;
     }
     /* Here proper xpath with at least one slash (can there be a descendant schemanodeid w/o slash?) */
@@ -365,7 +369,7 @@ check_unique_list(cxobj     *x,
                 goto done;
             goto fail;
         }
-        x = xml_child_each(xt, x, CX_ELMNT);
+        x = xml_child_iter(xt, &inext, CX_ELMNT);
     } while (x && y == xml_spec(x));  /* stop if list ends, others may follow */
     // ok:
     /* It would be possible to cache vec here as an optimization */
@@ -448,6 +452,7 @@ check_empty_list_minmax(cxobj     *xt,
                         yang_stmt *ye,
                         cxobj    **xret)
 {
+    int        inext;
     int        retval = -1;
     int        ret;
     yang_stmt *yprev = NULL;
@@ -455,8 +460,8 @@ check_empty_list_minmax(cxobj     *xt,
     if (yang_config(ye) == 1){
         if(yang_keyword_get(ye) == Y_CONTAINER &&
            yang_find(ye, Y_PRESENCE, NULL) == NULL){
-            yprev = NULL;
-            while ((yprev = yn_each(ye, yprev)) != NULL) {
+            inext = 0;
+            while ((yprev = yn_iter(ye, &inext)) != NULL) {
                 if ((ret = check_empty_list_minmax(xt, yprev, xret)) < 0)
                     goto done;
                 if (ret == 0)
@@ -480,12 +485,25 @@ check_empty_list_minmax(cxobj     *xt,
     goto done;
 }
 
+/*! First element of a list: check list keys and unique constraints of the list
+ *
+ * @param[in]  x      The first element in the list
+ * @param[in]  inext0 Index of the sibling after x in xt, see xml_child_iter
+ * @param[in]  xt     The parent of x
+ * @param[in]  y      Yang spec of x (Y_LIST)
+ * @param[out] xret   Error XML tree. Free with xml_free after use
+ * @retval     1      Validation OK
+ * @retval     0      Validation failed (xret set)
+ * @retval    -1      Error
+ */
 static int
 xml_yang_minmax_newlist(cxobj     *x,
+                        int        inext0,
                         cxobj     *xt,
                         yang_stmt *y,
                         cxobj    **xret)
 {
+    int        inext;
     int        retval = -1;
     yang_stmt *yu;
     int        ret;
@@ -493,14 +511,14 @@ xml_yang_minmax_newlist(cxobj     *x,
     /* Here new (first element) of lists only
      * First check unique keys direct children
      */
-    if ((ret = check_unique_list_direct(x, xt, y, y, xret)) < 0)
+    if ((ret = check_unique_list_direct(x, inext0, xt, y, y, xret)) < 0)
         goto done;
     if (ret == 0)
         goto fail;
     /* Check if there is a unique constraint on the list
      */
-    yu = NULL;
-    while ((yu = yn_each(y, yu)) != NULL) {
+    inext = 0;
+    while ((yu = yn_iter(y, &inext)) != NULL) {
         if (yang_keyword_get(yu) != Y_UNIQUE)
             continue;
         /* Here is a list w unique constraints identified by:
@@ -510,7 +528,7 @@ xml_yang_minmax_newlist(cxobj     *x,
          * 1) multiple direct children (no prefixes), eg "a b"
          * 2) single xpath with canonical prefixes, eg "/ex:a/ex:b"
          */
-        if ((ret = check_unique_list(x, xt, y, yu, xret)) < 0)
+        if ((ret = check_unique_list(x, inext0, xt, y, yu, xret)) < 0)
             goto done;
         if (ret == 0)
             goto fail;
@@ -652,6 +670,8 @@ xml_yang_minmax_recurse(cxobj  *xt,
                         int     recurse,
                         cxobj **xret)
 {
+    int           inext;
+    int           inext1;
     int           retval = -1;
     cxobj        *x = NULL;
     yang_stmt    *y;
@@ -663,7 +683,8 @@ xml_yang_minmax_recurse(cxobj  *xt,
     yang_stmt    *yt;
 
     yt = xml_spec(xt); /* If yt == NULL, then no gap-analysis is done */
-    while ((x = xml_child_each(xt, x, CX_ELMNT)) != NULL){
+    inext = 0;
+    while ((x = xml_child_iter(xt, &inext, CX_ELMNT)) != NULL){
         if ((y = xml_spec(x)) == NULL)
             continue;
         keyw = yang_keyword_get(y);
@@ -688,7 +709,7 @@ xml_yang_minmax_recurse(cxobj  *xt,
             /* new list check */
             if (ret &&
                 keyw == Y_LIST)
-                if ((ret = xml_yang_minmax_newlist(x, xt, y, xret)) < 0)
+                if ((ret = xml_yang_minmax_newlist(x, inext, xt, y, xret)) < 0)
                     goto done;
             if (ret == 0)
                 goto fail;
@@ -719,7 +740,8 @@ xml_yang_minmax_recurse(cxobj  *xt,
             if (recurse && keyw == Y_CONTAINER &&
                 yang_find(y, Y_PRESENCE, NULL) == NULL){
                 yang_stmt *yc = NULL;
-                while ((yc = yn_each(y, yc)) != NULL) {
+                inext1 = 0;
+                while ((yc = yn_iter(y, &inext1)) != NULL) {
                     if ((ret = xml_yang_minmax_recurse(x, recurse, xret)) < 0)
                         goto done;
                     if (ret == 0)
@@ -312,6 +312,7 @@ xml_stats(cxobj    *xt,
           uint64_t *nrp,
           size_t   *szp)
 {
+    int    inext;
     int    retval = -1;
     size_t sz = 0;
     cxobj *xc;
@@ -324,8 +325,8 @@ xml_stats(cxobj    *xt,
     xml_stats_one(xt, &sz);
     if (szp)
         *szp += sz;
-    xc = NULL;
-    while ((xc = xml_child_each(xt, xc, -1)) != NULL) {
+    inext = 0;
+    while ((xc = xml_child_iter(xt, &inext, -1)) != NULL) {
         sz=0;
         xml_stats(xc, nrp, &sz);
         if (szp)
@@ -783,12 +784,13 @@ int
 xml_child_nr_notype(cxobj          *xn,
                     enum cxobj_type type)
 {
+    int    inext = 0;
     cxobj *x = NULL;
     int    nr = 0;
 
     if (!is_element(xn))
         return 0;
-    while ((x = xml_child_each(xn, x, -1)) != NULL) {
+    while ((x = xml_child_iter(xn, &inext, -1)) != NULL) {
         if (xml_type(x) != type)
             nr++;
     }
@@ -807,12 +809,13 @@ int
 xml_child_nr_type(cxobj          *xn,
                   enum cxobj_type type)
 {
+    int    inext = 0;
     cxobj *x = NULL;
     int    len = 0;
 
     if (!is_element(xn))
         return 0;
-    while ((x = xml_child_each(xn, x, type)) != NULL)
+    while ((x = xml_child_iter(xn, &inext, type)) != NULL)
         len++;
     return len;
 }
@@ -853,12 +856,13 @@ xml_child_i_type(cxobj          *xn,
                  int             i,
                  enum cxobj_type type)
 {
+    int    inext = 0;
     cxobj *x = NULL;
     int    it = 0;
 
     if (!is_element(xn))
         return NULL;
-    while ((x = xml_child_each(xn, x, type)) != NULL) {
+    while ((x = xml_child_iter(xn, &inext, type)) != NULL) {
         if (x->x_type == type && (i == it++))
             return x;
     }
@@ -896,12 +900,13 @@ int
 xml_child_order(cxobj *xp,
                 cxobj *xc)
 {
+    int    inext = 0;
     cxobj *x = NULL;
     int    i = 0;
 
     if (!is_element(xp))
         return -1;
-    while ((x = xml_child_each(xp, x, -1)) != NULL) {
+    while ((x = xml_child_iter(xp, &inext, -1)) != NULL) {
         if (x == xc)
             return i;
         i++;
@@ -940,6 +945,7 @@ xml_child_order(cxobj *xp,
  *      xprev = x;
  *   }
  * @endcode
+ * @see xml_child_iter  external cursor, use in read-only and threaded code
  * @see xml_child_index_each
  * @see xml_child_each_attr  hardcoded for sorted list and attributes
  */
@@ -970,6 +976,48 @@ xml_child_each(cxobj           *xparent,
     return xn;
 }
 
+/*! Iterator over xml children objects using an external cursor
+ *
+ * Unlike xml_child_each, the iteration state is kept by the caller and not in the
+ * child nodes, so the same parent may be iterated in nested loops, recursively or by
+ * several threads at once, as long as the child vector is not changed meanwhile.
+ * @param[in]     xparent xml tree node whose children should be iterated
+ * @param[in,out] inext   Index of next child to check, set to 0 on init
+ * @param[in]     type    matching type or -1 for any
+ * @retval        xn      Next XML node
+ * @retval        NULL    End of list
+ * @code
+ *   cxobj *x;
+ *   int    inext = 0;
+ *   while ((x = xml_child_iter(x_top, &inext, -1)) != NULL) {
+ *     ...
+ *   }
+ * @endcode
+ * If you remove the returned node from the parent, decrement inext before the next call.
+ * @see xml_child_each
+ */
+cxobj *
+xml_child_iter(cxobj           *xparent,
+               int             *inext,
+               enum cxobj_type  type)
+{
+    cxobj *xn;
+
+    if (xparent == NULL)
+        return NULL;
+    if (!is_element(xparent))
+        return NULL;
+    while (*inext < xparent->x_childvec_len){
+        xn = xparent->x_childvec[(*inext)++];
+        if (xn == NULL)
+            continue;
+        if (type != CX_ERROR && xml_type(xn) != type)
+            continue;
+        return xn;
+    }
+    return NULL;
+}
+
 /*! Same as xml_child_each but hard-coded for attributes
  *
  * Assumes attributes are first in list, which they are if they are sorted, but there are
@@ -1194,7 +1242,7 @@ xml_new(char           *name,
             return NULL;
         x->_x_i = xml_child_nr(xp)-1;
     }
-    _stats_xml_nr++;
+    __sync_fetch_and_add(&_stats_xml_nr, 1); /* May be called from worker threads */
     return x;
 }
 
@@ -1316,6 +1364,7 @@ cxobj *
 xml_find(cxobj *xp,
          char  *name)
 {
+    int    inext = 0;
     cxobj *x = NULL;
 
     if (xp == NULL || name == NULL) {
@@ -1323,7 +1372,7 @@ xml_find(cxobj *xp,
     }
     if (!is_element(xp))
         return NULL;
-    while ((x = xml_child_each(xp, x, -1)) != NULL)
+    while ((x = xml_child_iter(xp, &inext, -1)) != NULL)
         if (strcmp(name, xml_name(x)) == 0)
             break; /* x is set */
     return x;
@@ -1533,6 +1582,7 @@ xml_child_rm(cxobj *xp,
 int
 xml_rm(cxobj *xc)
 {
+    int    inext = 0;
     int    retval = -1;
     cxobj *xp;
     cxobj *x;
@@ -1542,7 +1592,7 @@ xml_rm(cxobj *xc)
         goto ok;
     /* Find child in parent XXX: search? */
     x = NULL; i = 0;
-    while ((x = xml_child_each(xp, x, -1)) != NULL) {
+    while ((x = xml_child_iter(xp, &inext, -1)) != NULL) {
         if (x == xc)
             break;
         i++;
@@ -1656,6 +1706,7 @@ int
 xml_rootchild_node(cxobj  *xp,
                    cxobj  *xc)
 {
+    int    inext = 0;
     int    retval = -1;
     cxobj *x;
     int    i;
@@ -1667,7 +1718,7 @@ xml_rootchild_node(cxobj  *xp,
         goto done;
     }
     x = NULL; i = 0;
-    while ((x = xml_child_each(xp, x, -1)) != NULL) {
+    while ((x = xml_child_iter(xp, &inext, -1)) != NULL) {
         if (x == xc)
             break;
         i++;
@@ -1696,12 +1747,13 @@ xml_rootchild_node(cxobj  *xp,
 int
 xml_enumerate_children(cxobj *xp)
 {
+    int    inext = 0;
     cxobj *x = NULL;
     int    i = 0;
 
     if (!is_element(xp))
         return 0;
-    while ((x = xml_child_each(xp, x, -1)) != NULL)
+    while ((x = xml_child_iter(xp, &inext, -1)) != NULL)
         x->_x_i = i++;
     return 0;
 }
@@ -1711,11 +1763,12 @@ xml_enumerate_children(cxobj *xp)
 int
 xml_enumerate_reset(cxobj *xp)
 {
+    int    inext = 0;
     cxobj *x = NULL;
 
     if (!is_element(xp))
         return 0;
-    while ((x = xml_child_each(xp, x, -1)) != NULL)
+    while ((x = xml_child_iter(xp, &inext, -1)) != NULL)
         x->_x_i = 0;
     return 0;
 }
@@ -1749,11 +1802,12 @@ xml_enumerate_get(cxobj *x)
 char *
 xml_body(cxobj *xn)
 {
+    int    inext = 0;
     cxobj *xb = NULL;
 
     if (!is_element(xn))
         return NULL;
-    while ((xb = xml_child_each(xn, xb, CX_BODY)) != NULL)
+    while ((xb = xml_child_iter(xn, &inext, CX_BODY)) != NULL)
         return xml_value(xb);
     return NULL;
 }
@@ -1768,11 +1822,12 @@ xml_body(cxobj *xn)
 cxobj *
 xml_body_get(cxobj *xt)
 {
+    int    inext = 0;
     cxobj *xb = NULL;
 
     if (!is_element(xt))
         return NULL;
-    while ((xb = xml_child_each(xt, xb, CX_BODY)) != NULL)
+    while ((xb = xml_child_iter(xt, &inext, CX_BODY)) != NULL)
         return xb;
     return NULL;
 }
@@ -1828,13 +1883,14 @@ xml_find_type(cxobj          *xt,
               const char     *name,
               enum cxobj_type type)
 {
+    int    inext = 0;
     cxobj *x = NULL;
     int    pmatch;  /* prefix match */
     char  *xprefix; /* xprefix */
 
     if (!is_element(xt))
         return NULL;
-    while ((x = xml_child_each(xt, x, type)) != NULL) {
+    while ((x = xml_child_iter(xt, &inext, type)) != NULL) {
         if (prefix){
             xprefix = xml_prefix(x);
             pmatch = xprefix ? strcmp(prefix,xprefix)==0 : 0;
@@ -1866,11 +1922,12 @@ char *
 xml_find_value(cxobj      *xt,
                const char *name)
 {
+    int    inext = 0;
     cxobj *x = NULL;
 
     if (!is_element(xt))
         return NULL;
-    while ((x = xml_child_each(xt, x, -1)) != NULL)
+    while ((x = xml_child_iter(xt, &inext, -1)) != NULL)
         if (strcmp(name, xml_name(x)) == 0)
             return xml_value(x);
     return NULL;
@@ -1892,11 +1949,12 @@ char *
 xml_find_body(cxobj      *xt,
               const char *name)
 {
+    int    inext = 0;
     cxobj *x=NULL;
 
     if (!is_element(xt))
         return NULL;
-    while ((x = xml_child_each(xt, x, -1)) != NULL)
+    while ((x = xml_child_iter(xt, &inext, -1)) != NULL)
         if (strcmp(name, xml_name(x)) == 0)
             return xml_body(x);
     return NULL;
@@ -1921,12 +1979,13 @@ xml_find_body_obj(cxobj      *xt,
                   const char *name,
                   char       *val)
 {
+    int    inext = 0;
     cxobj *x = NULL;
     char  *bstr;
 
     if (!is_element(xt))
         return NULL;
-    while ((x = xml_child_each(xt, x, CX_ELMNT)) != NULL) {
+    while ((x = xml_child_iter(xt, &inext, CX_ELMNT)) != NULL) {
         if (strcmp(name, xml_name(x)))
             continue;
         if ((bstr = xml_body(x)) == NULL)
@@ -1982,7 +2041,7 @@ xml_free(cxobj *x)
         break;
     }
     free(x);
-    _stats_xml_nr--;
+    __sync_fetch_and_sub(&_stats_xml_nr, 1);
     return 0;
 }
 
@@ -2051,14 +2110,15 @@ int
 xml_copy(cxobj *x0,
          cxobj *x1)
 {
+    int    inext;
     int    retval = -1;
     cxobj *x;
     cxobj *xcopy;
 
     if (xml_copy_one(x0, x1) <0)
         goto done;
-    x = NULL;
-    while ((x = xml_child_each(x0, x, -1)) != NULL) {
+    inext = 0;
+    while ((x = xml_child_iter(x0, &inext, -1)) != NULL) {
         if ((xcopy = xml_new(xml_name(x), x1, xml_type(x))) == NULL)
             goto done;
         if (xml_copy(x, xcopy) < 0) /* recursion */
@@ -2202,14 +2262,15 @@ xml_apply(cxobj          *xn,
           xml_applyfn_t   fn,
           void           *arg)
 {
+    int        inext;
     int        retval = -1;
     cxobj     *x;
     int        ret;
 
     if (!is_element(xn))
         return 0;
-    x = NULL;
-    while ((x = xml_child_each(xn, x, type)) != NULL) {
+    inext = 0;
+    while ((x = xml_child_iter(xn, &inext, type)) != NULL) {
         if ((ret = fn(x, arg)) < 0)
             goto done;
         if (ret == 2)
@@ -0,0 +1,959 @@
+/*
+ *
+  ***** BEGIN LICENSE BLOCK *****
+
+  Copyright (C) 2024 Olof Hagsand
+
+  This file is part of CLIXON.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Alternatively, the contents of this file may be used under the terms of
+  the GNU General Public License Version 3 or later (the "GPL"),
+  in which case the provisions of the GPL are applicable instead
+  of those above. If you wish to allow use of your version of this file only
+  under the terms of the GPL, and not to allow others to
+  use your version of this file under the terms of Apache License version 2, indicate
+  your decision by deleting the provisions above and replace them with the
+  notice and other provisions required by the GPL. If you do not delete
+  the provisions above, a recipient may use your version of this file under
+  the terms of any one of the Apache License version 2 or the GPL.
+
+  ***** END LICENSE BLOCK *****
+  * Binary encoding of YANG-bound XML trees on the internal IPC socket
+  *
+  * Used instead of XML for get and get-config replies if negotiated in the internal hello,
+  * see CLICON_IPC_BINARY.
+  * The client announces a hash of each of its YANG modules with the index of the module in
+  * its yang spec. The backend keeps a vector of its own modules with equal hash, indexed by the
+  * client index, see clixon_bin_capability_parse.
+  * An element bound to a node in such a module is encoded as a schema-node id: the child
+  * indexes in the YANG tree from the yang node of its parent, or from the module. The
+  * decoder follows the indexes in its own yang spec and creates a bound element without
+  * name lookup. Other elements are encoded by name.
+  *
+  * Message body:
+  *   <magic 4 bytes> <length 4 bytes, network order, including header> <node>* END
+  * Node:
+  *   ELMNT_ID   <n> <index>*n <prefix> <node>* END
+  *   ELMNT_MOD  <module> <n> <index>*n <prefix> <node>* END
+  *   ELMNT      <name> <prefix> <node>* END       Not bound
+  *   ELMNT_BIND <name> <prefix> <node>* END       Subtree bound by decoder
+  *   BODY       <value>
+  *   ATTR       <name> <prefix> <value>
+  * Numbers are unsigned LEB128 varints. Strings are length+1 followed by the string including
+  * its NUL terminator, so that decoded strings can be used in place. Length 0 is NULL.
+  */
+
+#ifdef HAVE_CONFIG_H
+#include "clixon_config.h" /* generated by config & autoconf */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <errno.h>
+#include <arpa/inet.h>
+
+/* cligen */
+#include <cligen/cligen.h>
+
+/* clixon */
+#include "clixon_queue.h"
+#include "clixon_hash.h"
+#include "clixon_string.h"
+#include "clixon_handle.h"
+#include "clixon_yang.h"
+#include "clixon_xml.h"
+#include "clixon_err.h"
+#include "clixon_log.h"
+#include "clixon_debug.h"
+#include "clixon_yang_module.h"
+#include "clixon_xml_nsctx.h"
+#include "clixon_xml_bind.h"
+#include "clixon_netconf_lib.h"
+#include "clixon_xml_io.h"
+#include "clixon_xml_bin.h"
+
+/*
+ * Constants
+ */
+/* Start of binary message body, not valid as start of XML */
+#define BIN_MAGIC     "\001CBX"
+#define BIN_MAGIC_LEN 4
+
+/* Magic and length */
+#define BIN_HDRLEN    (BIN_MAGIC_LEN + 4)
+
+/* Max number of indexes in a schema-node id, ie choice/case nesting */
+#define BIN_CHAIN_MAX 32
+
+/* Name of variable with cached hash of a yang module, see clixon_bin_module_hash */
+#define BIN_HASH_CV   "bin-hash"
+
+/* Node tags */
+#define BIN_END        0 /* End of children */
+#define BIN_ELMNT_ID   1 /* Element: yang child indexes from yang node of parent */
+#define BIN_ELMNT_MOD  2 /* Element: module index and yang child indexes from module */
+#define BIN_ELMNT      3 /* Element by name, not bound */
+#define BIN_ELMNT_BIND 4 /* Element by name, bound in encoder, subtree bound by decoder */
+#define BIN_BODY       5
+#define BIN_ATTR       6
+
+/*
+ * Types
+ */
+/* Encoder state */
+struct bin_enc {
+    withdefaults_type be_wdef;   /* With-defaults */
+    yang_stmt       **be_ymods;  /* Modules with schema-node ids, indexed by client index */
+    int               be_nymods; /* Length of be_ymods */
+};
+
+/* Decoder state */
+struct bin_dec {
+    clixon_handle   bd_h;
+    yang_stmt      *bd_yspec;
+    const uint8_t  *bd_p;        /* Current position */
+    const uint8_t  *bd_end;      /* End of message */
+    cxobj         **bd_xerr;     /* Bind error, if bd_fail */
+    int             bd_fail;     /* Binding of an element failed */
+};
+
+/*! Compute hash of a yang statement and its sub-statements recursively (FNV-1a)
+ *
+ * @param[in]     ys    Yang statement
+ * @param[in,out] hash  Hash
+ */
+static void
+bin_yang_hash(yang_stmt *ys,
+              uint32_t  *hash)
+{
+    uint32_t h = *hash;
+    uint32_t v[2];
+    uint8_t *p;
+    char    *arg;
+    int      i;
+
+    v[0] = yang_keyword_get(ys);
+    v[1] = yang_len_get(ys);
+    p = (uint8_t*)v;
+    for (i=0; i<sizeof(v); i++)
+        h = (h ^ p[i]) * 16777619;
+    if ((arg = yang_argument_get(ys)) != NULL)
+        for (p=(uint8_t*)arg; *p; p++)
+            h = (h ^ *p) * 16777619;
+    h = (h ^ 0xff) * 16777619;
+    for (i=0; i<yang_len_get(ys); i++)
+        bin_yang_hash(yang_child_i(ys, i), &h);
+    *hash = h;
+}
+
+/*! Get hash of a yang module
+ *
+ * The schema-node ids of a module are the same in client and backend if the hash is equal.
+ * The hash covers keyword, argument and order of all statements in the module, after
+ * grouping, augment and deviation resolution.
+ * The hash is computed once and cached in the module, so that it is not computed for
+ * each client hello.
+ * @param[in]  ymod   Yang module
+ * @param[out] hash   Hash
+ * @retval     0      OK
+ * @retval    -1      Error
+ * @note Not thread-safe on first call for a module, and the yang spec must be complete
+ */
+int
+clixon_bin_module_hash(yang_stmt *ymod,
+                       uint32_t  *hash)
+{
+    cg_var  *cv;
+    uint32_t h;
+
+    if (ymod == NULL || yang_keyword_get(ymod) != Y_MODULE){
+        clixon_err(OE_YANG, EINVAL, "Expected yang module");
+        return -1;
+    }
+    if ((cv = cvec_find(yang_cvec_get(ymod), BIN_HASH_CV)) != NULL){
+        *hash = cv_uint32_get(cv);
+        return 0;
+    }
+    h = 2166136261;
+    bin_yang_hash(ymod, &h);
+    if ((cv = yang_cvec_add(ymod, CGV_UINT32, BIN_HASH_CV)) == NULL)
+        return -1;
+    cv_uint32_set(cv, h);
+    *hash = h;
+    return 0;
+}
+
+/*! Print internal hello capabilities for binary encoding of all modules in a yang spec
+ *
+ * @param[in]  cb     Cligen buffer, capability elements are appended
+ * @param[in]  yspec  Yang spec
+ * @retval     0      OK
+ * @retval    -1      Error
+ * @see clixon_bin_capability_parse
+ */
+int
+clixon_bin_capabilities(cbuf      *cb,
+                        yang_stmt *yspec)
+{
+    int        retval = -1;
+    yang_stmt *ymod;
+    yang_stmt *yrev;
+    uint32_t   hash;
+    int        i;
+
+    for (i=0; i<yang_len_get(yspec); i++){
+        ymod = yang_child_i(yspec, i);
+        if (yang_keyword_get(ymod) != Y_MODULE)
+            continue;
+        if (clixon_bin_module_hash(ymod, &hash) < 0)
+            goto done;
+        yrev = yang_find(ymod, Y_REVISION, NULL);
+        cprintf(cb, "<capability>%s?module=%s&amp;revision=%s&amp;hash=%08x&amp;index=%d</capability>",
+                CLIXON_IPC_BINARY_CAPABILITY,
+                yang_argument_get(ymod),
+                yrev?yang_argument_get(yrev):"",
+                hash, i);
+    }
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Parse an internal hello capability for binary encoding of a module
+ *
+ * If the module exists in yspec with the same hash, add it to the module vector at the
+ * index given by the client
+ * @param[in]     capability  Capability string
+ * @param[in]     yspec       Yang spec
+ * @param[in,out] ymods       Module vector indexed by client index. Free with free()
+ * @param[in,out] nymods      Length of module vector
+ * @retval        1           Module added
+ * @retval        0           Not a binary capability, or module not found or different
+ * @retval       -1           Error
+ * @see clixon_bin_capabilities
+ */
+int
+clixon_bin_capability_parse(char        *capability,
+                            yang_stmt   *yspec,
+                            yang_stmt ***ymods,
+                            int         *nymods)
+{
+    int         retval = -1;
+    size_t      len = strlen(CLIXON_IPC_BINARY_CAPABILITY);
+    cvec       *cvv = NULL;
+    cg_var     *cv;
+    char       *name = NULL;
+    char       *rev = NULL;
+    char       *hashstr = NULL;
+    char       *indexstr = NULL;
+    char       *reason = NULL;
+    uint32_t    hash0;
+    uint32_t    hash;
+    uint32_t    index;
+    yang_stmt  *ymod;
+    yang_stmt **yv;
+    int         ret;
+
+    if (strncmp(capability, CLIXON_IPC_BINARY_CAPABILITY, len) != 0 ||
+        capability[len] != '?')
+        goto fail;
+    if (uri_str2cvec(capability+len+1, '&', '=', 0, &cvv) < 0)
+        goto done;
+    if ((cv = cvec_find(cvv, "module")) != NULL)
+        name = cv_string_get(cv);
+    if ((cv = cvec_find(cvv, "revision")) != NULL)
+        rev = cv_string_get(cv);
+    if ((cv = cvec_find(cvv, "hash")) != NULL)
+        hashstr = cv_string_get(cv);
+    if ((cv = cvec_find(cvv, "index")) != NULL)
+        indexstr = cv_string_get(cv);
+    if (name == NULL || hashstr == NULL || indexstr == NULL)
+        goto fail;
+    if ((ret = parse_uint32(indexstr, &index, &reason)) < 0){
+        clixon_err(OE_XML, errno, "parse_uint32");
+        goto done;
+    }
+    if (ret == 0 || index > UINT16_MAX)
+        goto fail;
+    hash0 = strtoul(hashstr, NULL, 16);
+    if (rev && strlen(rev) == 0)
+        rev = NULL;
+    if ((ymod = yang_find_module_by_name_revision(yspec, name, rev)) == NULL)
+        goto fail;
+    if (clixon_bin_module_hash(ymod, &hash) < 0)
+        goto done;
+    if (hash != hash0){
+        clixon_debug(CLIXON_DBG_MSG | CLIXON_DBG_DETAIL, "module %s differs in client", name);
+        goto fail;
+    }
+    if (index >= *nymods){
+        if ((yv = realloc(*ymods, (index+1)*sizeof(yang_stmt*))) == NULL){
+            clixon_err(OE_UNIX, errno, "realloc");
+            goto done;
+        }
+        memset(&yv[*nymods], 0, (index+1-*nymods)*sizeof(yang_stmt*));
+        *ymods = yv;
+        *nymods = index+1;
+    }
+    (*ymods)[index] = ymod;
+    retval = 1;
+ done:
+    if (reason)
+        free(reason);
+    if (cvv)
+        cvec_free(cvv);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
+/*! Check if a message body is binary encoded
+ *
+ * @param[in]  buf   Message body
+ * @retval     1     Binary
+ * @retval     0     Not binary, eg XML
+ */
+int
+clixon_bin_detect(const char *buf)
+{
+    return buf != NULL && memcmp(buf, BIN_MAGIC, BIN_MAGIC_LEN) == 0;
+}
+
+/*! Append unsigned varint
+ */
+static int
+bin_varint(cbuf    *cb,
+           uint32_t v)
+{
+    uint8_t buf[5];
+    int     i = 0;
+
+    do {
+        buf[i] = v & 0x7f;
+        v >>= 7;
+        if (v)
+            buf[i] |= 0x80;
+        i++;
+    } while (v);
+    if (cbuf_append_buf(cb, buf, i) < 0){
+        clixon_err(OE_UNIX, errno, "cbuf_append_buf");
+        return -1;
+    }
+    return 0;
+}
+
+/*! Append string including NUL terminator, or NULL
+ */
+static int
+bin_str(cbuf       *cb,
+        const char *str)
+{
+    size_t len;
+
+    if (str == NULL)
+        return bin_varint(cb, 0);
+    len = strlen(str) + 1;
+    if (bin_varint(cb, len) < 0)
+        return -1;
+    if (cbuf_append_buf(cb, (void*)str, len) < 0){
+        clixon_err(OE_UNIX, errno, "cbuf_append_buf");
+        return -1;
+    }
+    return 0;
+}
+
+/*! Compute schema-node id of a yang node as child indexes from a parent yang node or module
+ *
+ * @param[in]  y      Yang node of element
+ * @param[in]  yp     Yang node of parent element as bound by decoder, or NULL
+ * @param[out] chain  Child indexes in reverse order, from y upwards
+ * @param[out] len    Number of indexes
+ * @param[out] ymod   Module, if not relative to yp
+ * @retval     2      Relative to yp
+ * @retval     1      Relative to ymod
+ * @retval     0      Not found, eg submodule or mounted yang
+ */
+static int
+bin_chain(yang_stmt  *y,
+          yang_stmt  *yp,
+          uint32_t   *chain,
+          int        *len,
+          yang_stmt **ymod)
+{
+    yang_stmt *yc = y;
+    yang_stmt *ys;
+    int        n = 0;
+    int        i;
+
+    while ((ys = yang_parent_get(yc)) != NULL && n < BIN_CHAIN_MAX){
+        for (i=0; i<yang_len_get(ys); i++)
+            if (yang_child_i(ys, i) == yc)
+                break;
+        if (i == yang_len_get(ys))
+            break;
+        chain[n++] = i;
+        if (ys == yp){
+            *len = n;
+            return 2;
+        }
+        if (yang_keyword_get(ys) == Y_MODULE){
+            *len = n;
+            *ymod = ys;
+            return 1;
+        }
+        yc = ys;
+    }
+    return 0;
+}
+
+/*! Encode XML node and its children
+ *
+ * Same output selection as xml2cbuf_recurse regarding depth and with-defaults
+ * @param[in]  cb      Cligen buffer
+ * @param[in]  x       XML node
+ * @param[in]  yp      Yang node of parent as bound by decoder, or NULL
+ * @param[in]  depth   Limit levels of child resources: -1 is all, 0 is none, 1 is node itself
+ * @param[in]  rebind  In subtree bound by decoder, encode by name
+ * @param[in]  wdns    Add with-defaults namespace declaration
+ * @param[in]  be      Encoder state
+ * @retval     0       OK
+ * @retval    -1       Error
+ */
+static int
+xml2bin_recurse(cbuf           *cb,
+                cxobj          *x,
+                yang_stmt      *yp,
+                int32_t         depth,
+                int             rebind,
+                int             wdns,
+                struct bin_enc *be)
+{
+    int        retval = -1;
+    int        inext;
+    cxobj     *xc;
+    yang_stmt *y;
+    yang_stmt *ydec = NULL;
+    yang_stmt *ymod = NULL;
+    uint32_t   chain[BIN_CHAIN_MAX];
+    int        len = 0;
+    int        mi = -1;
+    int        tag = 0;
+    int        bind = 0;
+    int        wdns1;
+    char      *ns;
+    int        ret;
+    int        i;
+
+    if (depth == 0)
+        goto ok;
+    switch (xml_type(x)){
+    case CX_BODY:
+        if (xml_value(x) == NULL) /* incomplete tree */
+            break;
+        if (bin_varint(cb, BIN_BODY) < 0 ||
+            bin_str(cb, xml_value(x)) < 0)
+            goto done;
+        break;
+    case CX_ATTR:
+        if (bin_varint(cb, BIN_ATTR) < 0 ||
+            bin_str(cb, xml_name(x)) < 0 ||
+            bin_str(cb, xml_prefix(x)) < 0 ||
+            bin_str(cb, xml_value(x)) < 0)
+            goto done;
+        break;
+    case CX_ELMNT:
+        if ((y = xml_spec(x)) != NULL){
+            /* with-defaults: if object should be encoded or not */
+            if ((ret = xml2output_wdef(x, be->be_wdef, &tag)) < 0)
+                goto done;
+            if (ret == 0)
+                goto ok;
+        }
+        ret = 0;
+        if (y != NULL && !rebind &&
+            strcmp(xml_name(x), yang_argument_get(y)) == 0 &&
+            (ret = bin_chain(y, yp, chain, &len, &ymod)) == 1){
+            for (mi=0; mi<be->be_nymods; mi++)
+                if (be->be_ymods[mi] == ymod)
+                    break;
+            if (mi == be->be_nymods)
+                ret = 0;
+        }
+        if (ret == 2){
+            if (bin_varint(cb, BIN_ELMNT_ID) < 0)
+                goto done;
+            ydec = y;
+        }
+        else if (ret == 1){
+            if (bin_varint(cb, BIN_ELMNT_MOD) < 0 ||
+                bin_varint(cb, mi) < 0)
+                goto done;
+            ydec = y;
+        }
+        else{
+            bind = (y != NULL && !rebind);
+            if (bin_varint(cb, bind?BIN_ELMNT_BIND:BIN_ELMNT) < 0 ||
+                bin_str(cb, xml_name(x)) < 0)
+                goto done;
+        }
+        if (ydec){
+            if (bin_varint(cb, len) < 0)
+                goto done;
+            for (i=len-1; i>=0; i--)
+                if (bin_varint(cb, chain[i]) < 0)
+                    goto done;
+        }
+        if (bin_str(cb, xml_prefix(x)) < 0)
+            goto done;
+        if (tag){ /* If default and WITHDEFAULTS_REPORT_ALL_TAGGED */
+            if (bin_varint(cb, BIN_ATTR) < 0 ||
+                bin_str(cb, "default") < 0 ||
+                bin_str(cb, IETF_NETCONF_WITH_DEFAULTS_ATTR_PREFIX) < 0 ||
+                bin_str(cb, "true") < 0)
+                goto done;
+        }
+        if (wdns){
+            if (bin_varint(cb, BIN_ATTR) < 0 ||
+                bin_str(cb, IETF_NETCONF_WITH_DEFAULTS_ATTR_PREFIX) < 0 ||
+                bin_str(cb, "xmlns") < 0 ||
+                bin_str(cb, IETF_NETCONF_WITH_DEFAULTS_ATTR_NAMESPACE) < 0)
+                goto done;
+        }
+        /* Attributes first */
+        inext = 0;
+        while ((xc = xml_child_iter(x, &inext, CX_ATTR)) != NULL)
+            if (xml2bin_recurse(cb, xc, ydec, -1, rebind || bind, 0, be) < 0)
+                goto done;
+        inext = 0;
+        while ((xc = xml_child_iter(x, &inext, -1)) != NULL){
+            if (xml_type(xc) == CX_ATTR)
+                continue;
+            wdns1 = 0;
+            /* If tagged withdefaults */
+            if (be->be_wdef == WITHDEFAULTS_REPORT_ALL_TAGGED &&
+                y == NULL &&
+                xml_spec(xc) != NULL){
+                ns = NULL;
+                if (xml2ns(xc, IETF_NETCONF_WITH_DEFAULTS_ATTR_PREFIX, &ns) < 0)
+                    goto done;
+                wdns1 = (ns == NULL);
+            }
+            if (xml2bin_recurse(cb, xc, ydec, depth-1, rebind || bind, wdns1, be) < 0)
+                goto done;
+        }
+        if (bin_varint(cb, BIN_END) < 0)
+            goto done;
+        break;
+    default:
+        break;
+    }
+ ok:
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Encode an XML tree as a binary message body
+ *
+ * The tree is encoded as a top-level node, ie it is decoded as a child of the top symbol.
+ * Depth and with-defaults select nodes as in clixon_xml2cbuf1
+ * @param[in,out] cb      Cligen buffer, message body is appended
+ * @param[in]     x       XML tree
+ * @param[in]     depth   Limit levels of child resources: -1 is all, 0 is none, 1 is node itself
+ * @param[in]     wdef    With-defaults parameter, default is WITHDEFAULTS_REPORT_ALL
+ * @param[in]     ymods   Modules with schema-node ids indexed by client index, may contain NULL
+ * @param[in]     nymods  Length of ymods
+ * @retval        0       OK
+ * @retval       -1       Error
+ * @see clixon_bin_parse
+ */
+int
+clixon_xml2bin(cbuf             *cb,
+               cxobj            *x,
+               int32_t           depth,
+               withdefaults_type wdef,
+               yang_stmt       **ymods,
+               int               nymods)
+{
+    int            retval = -1;
+    struct bin_enc be = {wdef, ymods, nymods};
+    size_t         off;
+    uint32_t       len = 0;
+
+    off = cbuf_len(cb);
+    if (cbuf_append_buf(cb, BIN_MAGIC, BIN_MAGIC_LEN) < 0 ||
+        cbuf_append_buf(cb, &len, sizeof(len)) < 0){
+        clixon_err(OE_UNIX, errno, "cbuf_append_buf");
+        goto done;
+    }
+    if (xml2bin_recurse(cb, x, NULL, depth, 0, 0, &be) < 0)
+        goto done;
+    if (bin_varint(cb, BIN_END) < 0)
+        goto done;
+    len = htonl(cbuf_len(cb) - off);
+    memcpy(cbuf_get(cb) + off + BIN_MAGIC_LEN, &len, sizeof(len));
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Decode unsigned varint
+ */
+static int
+bin_get_varint(struct bin_dec *bd,
+               uint32_t       *v)
+{
+    uint32_t val = 0;
+    int      shift = 0;
+    uint8_t  c;
+
+    do {
+        if (bd->bd_p >= bd->bd_end || shift > 28){
+            clixon_err(OE_XML, EBADMSG, "Malformed binary message");
+            return -1;
+        }
+        c = *bd->bd_p++;
+        val |= (uint32_t)(c & 0x7f) << shift;
+        shift += 7;
+    } while (c & 0x80);
+    *v = val;
+    return 0;
+}
+
+/*! Decode string in place, or NULL
+ */
+static int
+bin_get_str(struct bin_dec *bd,
+            char          **str)
+{
+    uint32_t len;
+
+    if (bin_get_varint(bd, &len) < 0)
+        return -1;
+    if (len == 0){
+        *str = NULL;
+        return 0;
+    }
+    if (len > bd->bd_end - bd->bd_p || bd->bd_p[len-1] != '\0'){
+        clixon_err(OE_XML, EBADMSG, "Malformed binary message");
+        return -1;
+    }
+    *str = (char*)bd->bd_p;
+    bd->bd_p += len;
+    return 0;
+}
+
+/*! Add an attribute to the top-level element of a binary message body
+ *
+ * The attribute is added after the existing attributes of the element, eg to echo the
+ * message-id of a request in a reply encoded by clixon_xml2bin
+ * @param[in,out] cb      Cligen buffer with binary message body at start
+ * @param[in]     name    Attribute name
+ * @param[in]     value   Attribute value
+ * @retval        1       OK, attribute added
+ * @retval        0       Top-level node is not an element encoded by name, not added
+ * @retval       -1       Error, including malformed message
+ * @see clixon_xml2bin
+ */
+int
+clixon_bin_attr_add(cbuf       *cb,
+                    const char *name,
+                    const char *value)
+{
+    int            retval = -1;
+    struct bin_dec bd = {0,};
+    uint32_t       len;
+    uint32_t       tag;
+    char          *str;
+    const uint8_t *p;
+    size_t         off;
+    char          *tail = NULL;
+    size_t         taillen;
+
+    if (cbuf_len(cb) < BIN_HDRLEN || !clixon_bin_detect(cbuf_get(cb))){
+        clixon_err(OE_XML, EBADMSG, "Not a binary message");
+        goto done;
+    }
+    memcpy(&len, cbuf_get(cb) + BIN_MAGIC_LEN, sizeof(len));
+    len = ntohl(len);
+    if (len < BIN_HDRLEN || len > cbuf_len(cb)){
+        clixon_err(OE_XML, EBADMSG, "Malformed binary message: length %u", len);
+        goto done;
+    }
+    bd.bd_p = (const uint8_t*)cbuf_get(cb) + BIN_HDRLEN;
+    bd.bd_end = (const uint8_t*)cbuf_get(cb) + len;
+    if (bin_get_varint(&bd, &tag) < 0)
+        goto done;
+    if (tag != BIN_ELMNT && tag != BIN_ELMNT_BIND)
+        goto skip;
+    if (bin_get_str(&bd, &str) < 0 ||  /* name */
+        bin_get_str(&bd, &str) < 0)    /* prefix */
+        goto done;
+    /* Skip existing attributes */
+    do {
+        p = bd.bd_p;
+        if (bin_get_varint(&bd, &tag) < 0)
+            goto done;
+        if (tag == BIN_ATTR &&
+            (bin_get_str(&bd, &str) < 0 ||
+             bin_get_str(&bd, &str) < 0 ||
+             bin_get_str(&bd, &str) < 0))
+            goto done;
+    } while (tag == BIN_ATTR);
+    off = p - (const uint8_t*)cbuf_get(cb);
+    taillen = cbuf_len(cb) - off;
+    if ((tail = malloc(taillen)) == NULL){
+        clixon_err(OE_UNIX, errno, "malloc");
+        goto done;
+    }
+    memcpy(tail, cbuf_get(cb) + off, taillen);
+    cbuf_trunc(cb, off);
+    if (bin_varint(cb, BIN_ATTR) < 0 ||
+        bin_str(cb, name) < 0 ||
+        bin_str(cb, NULL) < 0 ||
+        bin_str(cb, value) < 0)
+        goto done;
+    len += cbuf_len(cb) - off;
+    if (cbuf_append_buf(cb, tail, taillen) < 0){
+        clixon_err(OE_UNIX, errno, "cbuf_append_buf");
+        goto done;
+    }
+    len = htonl(len);
+    memcpy(cbuf_get(cb) + BIN_MAGIC_LEN, &len, sizeof(len));
+    retval = 1;
+ done:
+    if (tail)
+        free(tail);
+    return retval;
+ skip:
+    retval = 0;
+    goto done;
+}
+
+/*! Decode schema-node id as child indexes from a yang node
+ */
+static int
+bin_get_chain(struct bin_dec *bd,
+              yang_stmt      *y,
+              yang_stmt     **yp)
+{
+    uint32_t len;
+    uint32_t i;
+    uint32_t index;
+
+    if (bin_get_varint(bd, &len) < 0)
+        return -1;
+    if (y == NULL || len == 0 || len > BIN_CHAIN_MAX)
+        goto err;
+    for (i=0; i<len; i++){
+        if (bin_get_varint(bd, &index) < 0)
+            return -1;
+        if (index >= yang_len_get(y))
+            goto err;
+        y = yang_child_i(y, index);
+    }
+    *yp = y;
+    return 0;
+ err:
+    clixon_err(OE_XML, EBADMSG, "Malformed binary message: invalid schema-node id");
+    return -1;
+}
+
+/*! Decode nodes until end and add them as children of an XML node
+ *
+ * @param[in]  bd   Decoder state
+ * @param[in]  xp   XML parent
+ * @param[in]  yp   Yang node of parent, or NULL
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+static int
+bin_parse_children(struct bin_dec *bd,
+                   cxobj          *xp,
+                   yang_stmt      *yp)
+{
+    int        retval = -1;
+    uint32_t   tag;
+    uint32_t   mi;
+    cxobj     *x;
+    yang_stmt *y;
+    yang_stmt *ymod;
+    char      *name;
+    char      *prefix;
+    char      *value;
+    int        ret;
+
+    while (1){
+        if (bin_get_varint(bd, &tag) < 0)
+            goto done;
+        y = NULL;
+        switch (tag){
+        case BIN_END:
+            goto ok;
+            break;
+        case BIN_BODY:
+            if (bin_get_str(bd, &value) < 0)
+                goto done;
+            if ((x = xml_new("body", xp, CX_BODY)) == NULL)
+                goto done;
+            if (value && xml_value_set(x, value) < 0)
+                goto done;
+            break;
+        case BIN_ATTR:
+            if (bin_get_str(bd, &name) < 0 ||
+                bin_get_str(bd, &prefix) < 0 ||
+                bin_get_str(bd, &value) < 0)
+                goto done;
+            if (name == NULL){
+                clixon_err(OE_XML, EBADMSG, "Malformed binary message: no attribute name");
+                goto done;
+            }
+            if ((x = xml_new(name, xp, CX_ATTR)) == NULL)
+                goto done;
+            if (prefix && xml_prefix_set(x, prefix) < 0)
+                goto done;
+            if (value && xml_value_set(x, value) < 0)
+                goto done;
+            break;
+        case BIN_ELMNT_MOD:
+            if (bin_get_varint(bd, &mi) < 0)
+                goto done;
+            if (bd->bd_yspec == NULL ||
+                mi >= yang_len_get(bd->bd_yspec) ||
+                yang_keyword_get(ymod = yang_child_i(bd->bd_yspec, mi)) != Y_MODULE){
+                clixon_err(OE_XML, EBADMSG, "Malformed binary message: invalid module");
+                goto done;
+            }
+            if (bin_get_chain(bd, ymod, &y) < 0)
+                goto done;
+            /* fall thru */
+        case BIN_ELMNT_ID:
+            if (y == NULL && bin_get_chain(bd, yp, &y) < 0)
+                goto done;
+            if ((x = xml_new(yang_argument_get(y), xp, CX_ELMNT)) == NULL)
+                goto done;
+            xml_spec_set(x, y);
+            if (bin_get_str(bd, &prefix) < 0)
+                goto done;
+            if (prefix && xml_prefix_set(x, prefix) < 0)
+                goto done;
+            if (bin_parse_children(bd, x, y) < 0)
+                goto done;
+            break;
+        case BIN_ELMNT:
+        case BIN_ELMNT_BIND:
+            if (bin_get_str(bd, &name) < 0 ||
+                bin_get_str(bd, &prefix) < 0)
+                goto done;
+            if (name == NULL){
+                clixon_err(OE_XML, EBADMSG, "Malformed binary message: no element name");
+                goto done;
+            }
+            if ((x = xml_new(name, xp, CX_ELMNT)) == NULL)
+                goto done;
+            if (prefix && xml_prefix_set(x, prefix) < 0)
+                goto done;
+            if (bin_parse_children(bd, x, NULL) < 0)
+                goto done;
+            if (tag == BIN_ELMNT_BIND && bd->bd_yspec != NULL){
+                if ((ret = xml_bind_yang0(bd->bd_h, x, yp?YB_PARENT:YB_MODULE, bd->bd_yspec,
+                                          bd->bd_fail?NULL:bd->bd_xerr)) < 0)
+                    goto done;
+                if (ret == 0)
+                    bd->bd_fail = 1;
+            }
+            break;
+        default:
+            clixon_err(OE_XML, EBADMSG, "Malformed binary message: unknown tag %u", tag);
+            goto done;
+            break;
+        }
+    }
+ ok:
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Decode a binary message body into an XML tree bound to yang
+ *
+ * Elements encoded as schema-node ids are bound as they are created. Other elements that
+ * were bound in the encoder are bound with xml_bind_yang0.
+ * @param[in]     h      Clixon handle
+ * @param[in]     buf    Message body, see clixon_bin_detect
+ * @param[in]     yspec  Yang spec, same as announced in hello, or NULL
+ * @param[in,out] xt     Top of XML parse tree. If it is NULL, the top is created.
+ * @param[out]    xerr   Reason for failure (yang assignment not made) if retval = 0
+ * @retval        1      Parse OK and all yang assignment made
+ * @retval        0      Parse OK but yang assigment not made (or only partial) and xerr set
+ * @retval       -1      Error with clixon_err called. Includes malformed message
+ * @see clixon_xml2bin
+ * @see clixon_xml_parse_string  XML version
+ */
+int
+clixon_bin_parse(clixon_handle h,
+                 const char   *buf,
+                 yang_stmt    *yspec,
+                 cxobj       **xt,
+                 cxobj       **xerr)
+{
+    int            retval = -1;
+    struct bin_dec bd = {0,};
+    uint32_t       len;
+    cxobj         *xtop = NULL;
+
+    if (xt == NULL){
+        clixon_err(OE_XML, EINVAL, "xt is NULL");
+        goto done;
+    }
+    if (!clixon_bin_detect(buf)){
+        clixon_err(OE_XML, EBADMSG, "Not a binary message");
+        goto done;
+    }
+    memcpy(&len, buf + BIN_MAGIC_LEN, sizeof(len));
+    len = ntohl(len);
+    if (len < BIN_HDRLEN){
+        clixon_err(OE_XML, EBADMSG, "Malformed binary message: length %u", len);
+        goto done;
+    }
+    if (*xt == NULL){
+        if ((xtop = xml_new(XML_TOP_SYMBOL, NULL, CX_ELMNT)) == NULL)
+            goto done;
+        *xt = xtop;
+    }
+    bd.bd_h = h;
+    bd.bd_yspec = yspec;
+    bd.bd_p = (const uint8_t*)buf + BIN_HDRLEN;
+    bd.bd_end = (const uint8_t*)buf + len;
+    bd.bd_xerr = xerr;
+    if (bin_parse_children(&bd, *xt, xml_spec(*xt)) < 0)
+        goto done;
+    if (bd.bd_fail)
+        goto fail;
+    retval = 1;
+ done:
+    if (retval < 0 && xtop){
+        xml_free(xtop);
+        *xt = NULL;
+    }
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
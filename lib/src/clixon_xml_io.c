@@ -49,6 +49,7 @@
 #include <stdint.h>
 #include <inttypes.h>
 #include <unistd.h>
+#include <pthread.h>
 #include <errno.h>
 #include <string.h>
 #include <limits.h>
@@ -83,7 +84,42 @@
 /* Size of xml read buffer */
 #define BUFLEN 1024
 
+/* Parallel serialization: minimum number of children of a node to partition it */
+#define XML_PARALLEL_MIN_CHILDREN 64
+
+/*
+ * Types
+ */
+/* Output context of xml2cbuf_recurse for streaming and parallel serialization */
+struct xml_output {
+    size_t              xo_threshold; /* Streaming: flush when cbuf length exceeds this */
+    clixon_output_sink *xo_fn;        /* Streaming: sink callback, consumes and resets cbuf */
+    void               *xo_arg;       /* Streaming: sink callback argument */
+    cxobj              *xo_xpart;     /* Parallel: serialize children of this node in threads */
+    int                 xo_threads;   /* Parallel: number of threads */
+};
+
+/* Argument to a parallel serialization thread: a range of sibling nodes */
+struct xml_output_part {
+    pthread_t          xp_thread;
+    int                xp_started; /* Set if xp_thread is started and needs to be joined */
+    cxobj            **xp_vec;    /* Nodes to serialize in order */
+    int                xp_len;    /* Length of xp_vec */
+    int                xp_level;
+    int                xp_pretty;
+    char              *xp_prefix;
+    int32_t            xp_depth;
+    withdefaults_type  xp_wdef;
+    cbuf              *xp_cb;     /* Result */
+    int                xp_retval; /* 0 if OK, -1 on error */
+    int                xp_errcat; /* Error category if error in thread */
+    int                xp_errnr;  /* Error number if error in thread */
+    char              *xp_reason; /* Error reason if error in thread */
+};
+
 /* Forward */
+static int xml2cbuf_recurse(cbuf *cb, cxobj *x, int level, int pretty, char *prefix,
+                            int32_t depth, withdefaults_type wdef, struct xml_output *xo);
 static int xml_diff2cbuf(cbuf *cb, cxobj *x0, cxobj *x1, int level, int skiptop);
 
 /*------------------------------------------------------------------------
@@ -98,12 +134,14 @@ static int xml_diff2cbuf(cbuf *cb, cxobj *x0, cxobj *x1, int level, int skiptop)
  * @retval      1    Keep it
  * @retval      0    Remove it
  * @retval     -1    Error
+ * @see clixon_xml2bin  Same with-defaults rules in binary encoding
  */
-static int
+int
 xml2output_wdef(cxobj            *x,
                 withdefaults_type wdef,
                 int              *tag)
 {
+    int        inext;
     int        retval = -1;
     int        keep = 1;
     cg_var    *cv;
@@ -127,8 +165,8 @@ xml2output_wdef(cxobj            *x,
             if (yang_find(y, Y_PRESENCE, NULL) == NULL){
                 keep = 0;
                 /* Loop thru children */
-                xc = NULL;
-                while ((xc = xml_child_each(x, xc, CX_ELMNT)) != NULL) {
+                inext = 0;
+                while ((xc = xml_child_iter(x, &inext, CX_ELMNT)) != NULL) {
                     if ((ret = xml2output_wdef(xc, wdef, NULL)) < 0)
                         goto done;
                     if (ret == 1)
@@ -214,6 +252,7 @@ xml2file_recurse(FILE                *f,
                  int                  autocliext,
                  withdefaults_type    wdef)
 {
+    int           inext;
     int           retval = -1;
     char         *name;
     char         *namespace;
@@ -272,9 +311,9 @@ xml2file_recurse(FILE                *f,
             (*fn)(f, " wd:default=\"true\"");
         hasbody = 0;
         haselement = 0;
-        xc = NULL;
         /* print attributes only */
-        while ((xc = xml_child_each(x, xc, -1)) != NULL) {
+        inext = 0;
+        while ((xc = xml_child_iter(x, &inext, -1)) != NULL) {
             switch (xml_type(xc)){
             case CX_ATTR:
                 if (xml2file_recurse(f, xc, level+1, pretty, prefix, fn, autocliext, wdef) <0)
@@ -300,8 +339,8 @@ xml2file_recurse(FILE                *f,
             if (pretty && hasbody == 0){
                 (*fn)(f, "\n");
             }
-            xc = NULL;
-            while ((xc = xml_child_each(x, xc, -1)) != NULL) {
+            inext = 0;
+            while ((xc = xml_child_iter(x, &inext, -1)) != NULL) {
                 cxobj *xa = NULL;
                 char  *ns = NULL;
 
@@ -379,14 +418,15 @@ clixon_xml2file1(FILE                *f,
                  int                  autocliext,
                  withdefaults_type    wdef)
 {
+    int   inext;
     int   retval = 1;
     cxobj *xc;
 
     if (fn == NULL)
         fn = fprintf;
     if (skiptop){
-        xc = NULL;
-        while ((xc = xml_child_each(xn, xc, CX_ELMNT)) != NULL)
+        inext = 0;
+        while ((xc = xml_child_iter(xn, &inext, CX_ELMNT)) != NULL)
             if (xml2file_recurse(f, xc, level, pretty, prefix, fn, autocliext, wdef) < 0)
                 goto done;
     }
@@ -452,6 +492,7 @@ xml_dump1(FILE  *f,
           cxobj *x,
           int    indent)
 {
+    int    inext;
     cxobj *xc;
 
     if (xml_type(x) != CX_ELMNT)
@@ -470,8 +511,8 @@ xml_dump1(FILE  *f,
     if (xml_flag(x, XML_FLAG_MARK))
         fprintf(stderr, " mark");
     fprintf(stderr, "\n");
-    xc = NULL;
-    while ((xc = xml_child_each(x, xc, -1)) != NULL) {
+    inext = 0;
+    while ((xc = xml_child_iter(x, &inext, -1)) != NULL) {
         xml_dump1(f, xc, indent+1);
     }
     return 0;
@@ -490,6 +531,138 @@ xml_dump(FILE  *f,
     return xml_dump1(f, x, 0);
 }
 
+/*! Thread function of parallel serialization: serialize a range of siblings
+ *
+ * @param[in]  arg  struct xml_output_part
+ */
+static void *
+xml2cbuf_thread(void *arg)
+{
+    struct xml_output_part *xp = (struct xml_output_part *)arg;
+    int                     i;
+
+    xp->xp_retval = 0;
+    for (i=0; i<xp->xp_len; i++)
+        if (xml2cbuf_recurse(xp->xp_cb, xp->xp_vec[i], xp->xp_level, xp->xp_pretty,
+                             xp->xp_prefix, xp->xp_depth, xp->xp_wdef, NULL) < 0){
+            xp->xp_retval = -1;
+            /* Error state is per thread, save it for the calling thread */
+            xp->xp_errcat = clixon_err_category();
+            xp->xp_errnr = clixon_err_subnr();
+            xp->xp_reason = strdup(clixon_err_reason());
+            break;
+        }
+    return NULL;
+}
+
+/*! Serialize the children of a node in parallel threads and concatenate in order
+ *
+ * Children are split into contiguous ranges, one per thread. The first range is
+ * serialized by the calling thread directly into cb, the others into separate buffers
+ * which are appended to cb in order. The output is identical to sequential serialization.
+ * Each thread only traverses its own subtrees.
+ * @param[in,out] cb       Cligen buffer to write to
+ * @param[in]     x        Parent node, its children are serialized (not x itself)
+ * @param[in]     elements If set, only element children, otherwise all but attributes
+ * @param[in]     level    Indentation level of children
+ * @param[in]     pretty   Insert \n and spaces to make the xml more readable.
+ * @param[in]     prefix   Add string to beginning of each line (if pretty)
+ * @param[in]     depth    Depth of children
+ * @param[in]     wdef     With-defaults parameter, not WITHDEFAULTS_REPORT_ALL_TAGGED
+ * @param[in]     threads  Number of threads
+ * @retval        0        OK
+ * @retval       -1        Error
+ */
+static int
+xml2cbuf_parallel(cbuf             *cb,
+                  cxobj            *x,
+                  int               elements,
+                  int               level,
+                  int               pretty,
+                  char             *prefix,
+                  int32_t           depth,
+                  withdefaults_type wdef,
+                  int               threads)
+{
+    int                     retval = -1;
+    cxobj                 **vec = NULL;
+    int                     len = 0;
+    struct xml_output_part *parts = NULL;
+    struct xml_output_part *xp;
+    cxobj                  *xc;
+    int                     i;
+    int                     n;
+    int                     j;
+
+    if ((vec = calloc(xml_child_nr(x), sizeof(cxobj *))) == NULL){
+        clixon_err(OE_UNIX, errno, "calloc");
+        goto done;
+    }
+    for (i=0; i<xml_child_nr(x); i++){
+        xc = xml_child_i(x, i);
+        if (elements ? xml_type(xc) == CX_ELMNT : xml_type(xc) != CX_ATTR)
+            vec[len++] = xc;
+    }
+    if (threads > len)
+        threads = len;
+    if ((parts = calloc(threads, sizeof(*parts))) == NULL){
+        clixon_err(OE_UNIX, errno, "calloc");
+        goto done;
+    }
+    for (i=0, j=0; i<threads; i++){
+        xp = &parts[i];
+        n = len/threads + (i < len%threads ? 1 : 0);
+        xp->xp_vec = &vec[j];
+        xp->xp_len = n;
+        xp->xp_level = level;
+        xp->xp_pretty = pretty;
+        xp->xp_prefix = prefix;
+        xp->xp_depth = depth;
+        xp->xp_wdef = wdef;
+        xp->xp_retval = -1;
+        j += n;
+        if (i == 0){
+            xp->xp_cb = cb;
+            continue;
+        }
+        if ((xp->xp_cb = cbuf_new()) == NULL){
+            clixon_err(OE_UNIX, errno, "cbuf_new");
+            threads = i; /* Only parts before this are created */
+            goto done;
+        }
+        if (pthread_create(&xp->xp_thread, NULL, xml2cbuf_thread, xp) == 0)
+            xp->xp_started = 1;
+        else
+            xml2cbuf_thread(xp); /* Fallback: run in this thread */
+    }
+    xml2cbuf_thread(&parts[0]);
+    retval = 0;
+ done:
+    for (i=1; parts && i<threads; i++)
+        if (parts[i].xp_started)
+            pthread_join(parts[i].xp_thread, NULL);
+    for (i=0; parts && i<threads; i++){
+        xp = &parts[i];
+        if (xp->xp_retval < 0){
+            if (xp->xp_started && retval == 0)
+                clixon_err(xp->xp_errcat, xp->xp_errnr, "%s", xp->xp_reason?xp->xp_reason:"");
+            retval = -1;
+        }
+        if (xp->xp_reason)
+            free(xp->xp_reason);
+        if (i > 0 && xp->xp_cb){
+            if (retval == 0)
+                cbuf_append_buf(cb, cbuf_get(xp->xp_cb), cbuf_len(xp->xp_cb));
+            cbuf_free(xp->xp_cb);
+        }
+    }
+    if (parts)
+        free(parts);
+    if (vec)
+        free(vec);
+    return retval;
+}
+
 /*! Internal: print  XML tree structure to a cligen buffer and encode chars "<>&"
  *
  * @param[in,out] cb       Cligen buffer to write to
@@ -499,6 +672,7 @@ xml_dump(FILE  *f,
  * @param[in]     prefix   Add string to beginning of each line (if pretty)
  * @param[in]     depth    Limit levels of child resources: -1 is all, 0 is none, 1 is node itself
  * @param[in]     wdef     With-defaults parameter, default is WITHDEFAULTS_REPORT_ALL
+ * @param[in]     xo       Output context for streaming or parallel serialization, or NULL
  * @retval        0        OK
  * @retval       -1        Error
  * wdef changes the output as follows:
@@ -515,8 +689,10 @@ xml2cbuf_recurse(cbuf             *cb,
                  int               pretty,
                  char             *prefix,
                  int32_t           depth,
-                 withdefaults_type wdef)
+                 withdefaults_type wdef,
+                 struct xml_output *xo)
 {
+    int        inext;
     int        retval = -1;
     cxobj     *xc;
     char      *name;
@@ -575,12 +751,12 @@ xml2cbuf_recurse(cbuf             *cb,
             cbuf_append_str(cb, " wd:default=\"true\"");
         hasbody = 0;
         haselement = 0;
-        xc = NULL;
         /* print attributes only */
-        while ((xc = xml_child_each(x, xc, -1)) != NULL)
+        inext = 0;
+        while ((xc = xml_child_iter(x, &inext, -1)) != NULL)
             switch (xml_type(xc)){
             case CX_ATTR:
-                if (xml2cbuf_recurse(cb, xc, level+1, pretty, prefix, -1, wdef) < 0)
+                if (xml2cbuf_recurse(cb, xc, level+1, pretty, prefix, -1, wdef, NULL) < 0)
                     goto done;
                 break;
             case CX_BODY:
@@ -599,31 +775,41 @@ xml2cbuf_recurse(cbuf             *cb,
             cbuf_append_str(cb, ">");
             if (pretty && hasbody == 0)
                 cbuf_append_str(cb, "\n");
-            xc = NULL;
-            while ((xc = xml_child_each(x, xc, -1)) != NULL)
-                if (xml_type(xc) != CX_ATTR){
-                    cxobj *xa = NULL;
-                    char  *ns = NULL;
-
-                    /* If tagged withdefaults */
-                    if (wdef == WITHDEFAULTS_REPORT_ALL_TAGGED &&
-                        y == NULL &&
-                        xml_spec(xc) != NULL){
-                        if (xml2ns(xc, IETF_NETCONF_WITH_DEFAULTS_ATTR_PREFIX, &ns) < 0)
-                            goto done;
-                        if (ns == NULL){
-                            if (xmlns_set(xc, IETF_NETCONF_WITH_DEFAULTS_ATTR_PREFIX, IETF_NETCONF_WITH_DEFAULTS_ATTR_NAMESPACE) < 0)
+            if (xo && x == xo->xo_xpart){
+                if (xml2cbuf_parallel(cb, x, 0, level+1, pretty, prefix, depth-1, wdef, xo->xo_threads) < 0)
+                    goto done;
+            }
+            else{
+                inext = 0;
+                while ((xc = xml_child_iter(x, &inext, -1)) != NULL)
+                    if (xml_type(xc) != CX_ATTR){
+                        cxobj *xa = NULL;
+                        char  *ns = NULL;
+
+                        /* If tagged withdefaults */
+                        if (wdef == WITHDEFAULTS_REPORT_ALL_TAGGED &&
+                            y == NULL &&
+                            xml_spec(xc) != NULL){
+                            if (xml2ns(xc, IETF_NETCONF_WITH_DEFAULTS_ATTR_PREFIX, &ns) < 0)
                                 goto done;
-                            xa = xml_find_type(xc, IETF_NETCONF_WITH_DEFAULTS_ATTR_PREFIX, IETF_NETCONF_WITH_DEFAULTS_ATTR_NAMESPACE, CX_ATTR);
+                            if (ns == NULL){
+                                if (xmlns_set(xc, IETF_NETCONF_WITH_DEFAULTS_ATTR_PREFIX, IETF_NETCONF_WITH_DEFAULTS_ATTR_NAMESPACE) < 0)
+                                    goto done;
+                                xa = xml_find_type(xc, IETF_NETCONF_WITH_DEFAULTS_ATTR_PREFIX, IETF_NETCONF_WITH_DEFAULTS_ATTR_NAMESPACE, CX_ATTR);
+                            }
                         }
-                    }
-                    if (xml2cbuf_recurse(cb, xc, level+1, pretty, prefix, depth-1, wdef) < 0)
-                        goto done;
-                    if (xa){
-                        if (xml_purge(xa) < 0)
+                        if (xml2cbuf_recurse(cb, xc, level+1, pretty, prefix, depth-1, wdef, xo) < 0)
                             goto done;
+                        if (xa){
+                            if (xml_purge(xa) < 0)
+                                goto done;
+                        }
+                        if (xo && xo->xo_fn && cbuf_len(cb) >= xo->xo_threshold){
+                            if (xo->xo_fn(cb, 0, xo->xo_arg) < 0)
+                                goto done;
+                        }
                     }
-                }
+            }
             if (pretty && hasbody == 0){
                 if (prefix)
                     cprintf(cb, "%s", prefix);
@@ -682,17 +868,198 @@ clixon_xml2cbuf1(cbuf                *cb,
                  int                  skiptop,
                  withdefaults_type    wdef)
 {
+    int    inext;
     int    retval = -1;
     cxobj *xc;
 
     if (skiptop){
-        xc = NULL;
-        while ((xc = xml_child_each(xn, xc, CX_ELMNT)) != NULL)
-            if (xml2cbuf_recurse(cb, xc, level, pretty, prefix, depth, wdef) < 0)
+        inext = 0;
+        while ((xc = xml_child_iter(xn, &inext, CX_ELMNT)) != NULL)
+            if (xml2cbuf_recurse(cb, xc, level, pretty, prefix, depth, wdef, NULL) < 0)
                 goto done;
     }
     else {
-        if (xml2cbuf_recurse(cb, xn, level, pretty, prefix, depth, wdef) < 0)
+        if (xml2cbuf_recurse(cb, xn, level, pretty, prefix, depth, wdef, NULL) < 0)
+            goto done;
+    }
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Print an XML tree structure in pieces to an output sink and encode chars "<>&"
+ *
+ * The tree is serialized into cb as in clixon_xml2cbuf1, but whenever cb exceeds
+ * threshold bytes (at element boundaries) the sink is called to consume it. The sink
+ * is finally called with last set.
+ * The sink must reset cb, so that memory use is bounded by threshold plus the size
+ * of the largest single body, instead of the size of the whole tree.
+ * @param[in,out] cb        Cligen buffer used as output buffer, reused between flushes
+ * @param[in]     xn        Top-level xml object
+ * @param[in]     level     Indentation level for pretty
+ * @param[in]     pretty    Insert \n and spaces to make the xml more readable.
+ * @param[in]     prefix    Add string to beginning of each line (or NULL) (if pretty)
+ * @param[in]     depth     Limit levels of child resources: -1: all, 0: none, 1: node itself
+ * @param[in]     skiptop   0: Include top object 1: Skip top-object, only children,
+ * @param[in]     wdef      With-defaults parameter, default is WITHDEFAULTS_REPORT_ALL
+ * @param[in]     threshold Flush when cb length exceeds this
+ * @param[in]     fn        Output sink callback
+ * @param[in]     arg       Argument to output sink callback
+ * @retval        0         OK
+ * @retval       -1         Error
+ * @code
+ *   static int
+ *   sink(cbuf *cb, int last, void *arg)
+ *   {
+ *     fprintf(stdout, "%s", cbuf_get(cb));
+ *     cbuf_reset(cb);
+ *     return 0;
+ *   }
+ *   cbuf *cb = cbuf_new();
+ *   if (clixon_xml2sink(cb, xn, 0, 0, NULL, -1, 0, 0, 65536, sink, NULL) < 0)
+ *     goto err;
+ *   cbuf_free(cb);
+ * @endcode
+ * @see clixon_xml2cbuf1  Serialize whole tree to one buffer
+ * @see netconf_output_xml  Example of sink writing NETCONF framing
+ */
+int
+clixon_xml2sink(cbuf                *cb,
+                cxobj               *xn,
+                int                  level,
+                int                  pretty,
+                char                *prefix,
+                int32_t              depth,
+                int                  skiptop,
+                withdefaults_type    wdef,
+                size_t               threshold,
+                clixon_output_sink  *fn,
+                void                *arg)
+{
+    int               inext;
+    int               retval = -1;
+    cxobj            *xc;
+    struct xml_output xo = {threshold, fn, arg, NULL, 0};
+
+    if (fn == NULL){
+        clixon_err(OE_XML, EINVAL, "fn is NULL");
+        goto done;
+    }
+    if (skiptop){
+        inext = 0;
+        while ((xc = xml_child_iter(xn, &inext, CX_ELMNT)) != NULL){
+            if (xml2cbuf_recurse(cb, xc, level, pretty, prefix, depth, wdef, &xo) < 0)
+                goto done;
+            if (cbuf_len(cb) >= threshold){
+                if (fn(cb, 0, arg) < 0)
+                    goto done;
+            }
+        }
+    }
+    else {
+        if (xml2cbuf_recurse(cb, xn, level, pretty, prefix, depth, wdef, &xo) < 0)
+            goto done;
+    }
+    if (fn(cb, 1, arg) < 0)
+        goto done;
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Find node to partition for parallel serialization
+ *
+ * Return x if it has many element children, eg a list. Otherwise search the subtrees of
+ * its element children and return the node with most element children found, eg the
+ * largest of several lists. A subtree is not searched below a node with many children.
+ * @param[in]  x    XML tree
+ * @param[in]  min  Minimum number of element children
+ * @retval     xp   Node whose children should be serialized in parallel
+ * @retval     NULL No such node
+ */
+static cxobj *
+xml2cbuf_partition(cxobj *x,
+                   int    min)
+{
+    int    inext;
+    cxobj *xc;
+    cxobj *xp;
+    cxobj *xbest = NULL;
+    int    n;
+    int    nbest = 0;
+
+    if (xml_child_nr_type(x, CX_ELMNT) >= min)
+        return x;
+    inext = 0;
+    while ((xc = xml_child_iter(x, &inext, CX_ELMNT)) != NULL){
+        if ((xp = xml2cbuf_partition(xc, min)) == NULL)
+            continue;
+        if ((n = xml_child_nr_type(xp, CX_ELMNT)) > nbest){
+            xbest = xp;
+            nbest = n;
+        }
+    }
+    return xbest;
+}
+
+/*! Print an XML tree structure to a cligen buffer using parallel threads
+ *
+ * Same output as clixon_xml2cbuf1, byte by byte. The tree is partitioned at the node
+ * with most children, typically a top-level node or a list, and its children are
+ * serialized in threads into separate buffers which are concatenated in order.
+ * Falls back to sequential serialization if threads <= 1, if no node has enough
+ * children, or for with-defaults report-all-tagged which modifies the tree.
+ * The tree must not be modified by other threads during the call.
+ * @param[in,out] cb      Cligen buffer to write to
+ * @param[in]     xn      Top-level xml object
+ * @param[in]     level   Indentation level for pretty
+ * @param[in]     pretty  Insert \n and spaces to make the xml more readable.
+ * @param[in]     prefix  Add string to beginning of each line (or NULL) (if pretty)
+ * @param[in]     depth   Limit levels of child resources: -1: all, 0: none, 1: node itself
+ * @param[in]     skiptop 0: Include top object 1: Skip top-object, only children,
+ * @param[in]     wdef    With-defaults parameter, default is WITHDEFAULTS_REPORT_ALL
+ * @param[in]     threads Number of threads including the calling thread
+ * @retval        0       OK
+ * @retval       -1       Error
+ * @see clixon_xml2cbuf1  Sequential version
+ */
+int
+clixon_xml2cbuf_parallel(cbuf             *cb,
+                         cxobj            *xn,
+                         int               level,
+                         int               pretty,
+                         char             *prefix,
+                         int32_t           depth,
+                         int               skiptop,
+                         withdefaults_type wdef,
+                         int               threads)
+{
+    int               inext;
+    int               retval = -1;
+    cxobj            *xc;
+    struct xml_output xo = {0,};
+    int               min;
+
+    min = threads > XML_PARALLEL_MIN_CHILDREN ? threads : XML_PARALLEL_MIN_CHILDREN;
+    if (threads <= 1 ||
+        wdef == WITHDEFAULTS_REPORT_ALL_TAGGED ||
+        (xo.xo_xpart = xml2cbuf_partition(xn, min)) == NULL)
+        return clixon_xml2cbuf1(cb, xn, level, pretty, prefix, depth, skiptop, wdef);
+    xo.xo_threads = threads;
+    if (skiptop){
+        if (xo.xo_xpart == xn){ /* Partition top-level children directly */
+            if (xml2cbuf_parallel(cb, xn, 1, level, pretty, prefix, depth, wdef, threads) < 0)
+                goto done;
+        }
+        else{
+            inext = 0;
+            while ((xc = xml_child_iter(xn, &inext, CX_ELMNT)) != NULL)
+                if (xml2cbuf_recurse(cb, xc, level, pretty, prefix, depth, wdef, &xo) < 0)
+                    goto done;
+        }
+    }
+    else {
+        if (xml2cbuf_recurse(cb, xn, level, pretty, prefix, depth, wdef, &xo) < 0)
             goto done;
     }
     retval = 0;
@@ -745,6 +1112,7 @@ xmltree2cbuf(cbuf  *cb,
              cxobj *x,
              int    level)
 {
+    int    inext;
     cxobj *xc;
     int    i;
 
@@ -763,8 +1131,8 @@ xmltree2cbuf(cbuf  *cb,
     if (xml_child_nr(x))
         cprintf(cb, " {");
     cprintf(cb, "\n");
-    xc = NULL;
-    while ((xc = xml_child_each(x, xc, -1)) != NULL)
+    inext = 0;
+    while ((xc = xml_child_iter(x, &inext, -1)) != NULL)
         xmltree2cbuf(cb, xc, level+1);
     if (xml_child_nr(x)){
         for (i=0; i<level*PRETTYPRINT_INDENT; i++)
@@ -1205,6 +1573,8 @@ xml_diff_context(cbuf  *cb,
  * @param[in]  x1      Second XML tree
  * @param[in]  x0c     Start of sublist in first XML tree
  * @param[in]  x1c     Start of sublist in second XML tree
+ * @param[in]  i0      Iterator of x0 positioned after x0c, see xml_child_iter
+ * @param[in]  i1      Iterator of x1 positioned after x1c
  * @param[in]  yc      Yang of x0c/x1c
  * @param[in]  level   How many spaces to insert before each line
  * @param[in]  skiptop  0: Include top object 1: Skip top-object, only children,
@@ -1219,6 +1589,8 @@ xml_diff2cbuf_ordered_by_user(cbuf      *cb,
                               cxobj     *x1,
                               cxobj     *x0c,
                               cxobj     *x1c,
+                              int        i0,
+                              int        i1,
                               yang_stmt *yc,
                               int        level,
                               int        skiptop)
@@ -1226,17 +1598,22 @@ xml_diff2cbuf_ordered_by_user(cbuf      *cb,
     int    retval = 1;
     cxobj *xi;
     cxobj *xj;
+    int    inext0;
+    int    inext1;
 
     xj = x1c;
+    inext1 = i1;
     do {
         xml_flag_set(xj, XML_FLAG_ADD);
-    } while ((xj = xml_child_each(x1, xj, CX_ELMNT)) != NULL &&
+    } while ((xj = xml_child_iter(x1, &inext1, CX_ELMNT)) != NULL &&
              xml_spec(xj) == yc);
     /* If in both sets, unmark add/del */
     xi = x0c;
+    inext0 = i0;
     do {
         xml_flag_set(xi, XML_FLAG_DEL);
         xj = x1c;
+        inext1 = i1;
         do {
             if (xml_flag(xj, XML_FLAG_ADD) &&
                 xml_cmp(xi, xj, 0, 0, NULL) == 0){
@@ -1248,10 +1625,10 @@ xml_diff2cbuf_ordered_by_user(cbuf      *cb,
                 break;
             }
         }
-        while ((xj = xml_child_each(x1, xj, CX_ELMNT)) != NULL &&
+        while ((xj = xml_child_iter(x1, &inext1, CX_ELMNT)) != NULL &&
                xml_spec(xj) == yc);
     }
-    while ((xi = xml_child_each(x0, xi, CX_ELMNT)) != NULL &&
+    while ((xi = xml_child_iter(x0, &inext0, CX_ELMNT)) != NULL &&
            xml_spec(xi) == yc);
 
     retval = 0;
@@ -1290,6 +1667,8 @@ xml_diff2cbuf(cbuf  *cb,
     int        retval = -1;
     cxobj     *x0c = NULL; /* x0 child */
     cxobj     *x1c = NULL; /* x1 child */
+    int        i0;         /* x0 child iterator */
+    int        i1;         /* x1 child iterator */
     yang_stmt *y0;
     yang_stmt *yc0;
     yang_stmt *yc1;
@@ -1306,9 +1685,9 @@ xml_diff2cbuf(cbuf  *cb,
     level1 = level*PRETTYPRINT_INDENT;
     y0 = xml_spec(x0);
     /* Traverse x0 and x1 in lock-step */
-    x0c = x1c = NULL;
-    x0c = xml_child_each(x0, x0c, CX_ELMNT);
-    x1c = xml_child_each(x1, x1c, CX_ELMNT);
+    i0 = i1 = 0;
+    x0c = xml_child_iter(x0, &i0, CX_ELMNT);
+    x1c = xml_child_iter(x1, &i1, CX_ELMNT);
     for (;;){
         if (x0c == NULL && x1c == NULL)
             goto ok;
@@ -1321,7 +1700,7 @@ xml_diff2cbuf(cbuf  *cb,
             }
             if (clixon_xml2cbuf(cb, x1c, level+1, 1, "+", -1, 0) < 0)
                 goto done;
-            x1c = xml_child_each(x1, x1c, CX_ELMNT);
+            x1c = xml_child_iter(x1, &i1, CX_ELMNT);
             continue;
         }
         else if (x1c == NULL){
@@ -1332,7 +1711,7 @@ xml_diff2cbuf(cbuf  *cb,
             }
             if (clixon_xml2cbuf(cb, x0c, level+1, 1, "-", -1, 0) < 0)
                 goto done;
-            x0c = xml_child_each(x0, x0c, CX_ELMNT);
+            x0c = xml_child_iter(x0, &i0, CX_ELMNT);
             continue;
         }
         /* Both x0c and x1c exists, check if they are yang-equal. */
@@ -1340,7 +1719,7 @@ xml_diff2cbuf(cbuf  *cb,
         yc0 = xml_spec(x0c);
         yc1 = xml_spec(x1c);
         if (eq && yc0 && yc1 && yc0 == yc1 && yang_find(yc0, Y_ORDERED_BY, "user")){
-            if (xml_diff2cbuf_ordered_by_user(cb, x0, x1, x0c, x1c, yc0,
+            if (xml_diff2cbuf_ordered_by_user(cb, x0, x1, x0c, x1c, i0, i1, yc0,
                                               level, skiptop) < 0)
                 goto done;
             /* Add all in x0 marked as DELETE in x0vec
@@ -1359,7 +1738,7 @@ xml_diff2cbuf(cbuf  *cb,
                         goto done;
                 }
             }
-            while ((xi = xml_child_each(x0, xi, CX_ELMNT)) != NULL &&
+            while ((xi = xml_child_iter(x0, &i0, CX_ELMNT)) != NULL &&
                    xml_spec(xi) == yc0);
             x0c = xi;
 
@@ -1377,7 +1756,7 @@ xml_diff2cbuf(cbuf  *cb,
                         goto done;
                 }
             }
-            while ((xj = xml_child_each(x1, xj, CX_ELMNT)) != NULL &&
+            while ((xj = xml_child_iter(x1, &i1, CX_ELMNT)) != NULL &&
                    xml_spec(xj) == yc1);
             x1c = xj;
             continue;
@@ -1390,7 +1769,7 @@ xml_diff2cbuf(cbuf  *cb,
             }
             if (clixon_xml2cbuf(cb, x0c, level+1, 1, "-", -1, 0) < 0)
                 goto done;
-            x0c = xml_child_each(x0, x0c, CX_ELMNT);
+            x0c = xml_child_iter(x0, &i0, CX_ELMNT);
             continue;
         }
         else if (eq > 0){
@@ -1401,7 +1780,7 @@ xml_diff2cbuf(cbuf  *cb,
             }
             if (clixon_xml2cbuf(cb, x1c, level+1, 1, "+", -1, 0) < 0)
                 goto done;
-            x1c = xml_child_each(x1, x1c, CX_ELMNT);
+            x1c = xml_child_iter(x1, &i1, CX_ELMNT);
             continue;
         }
         else{ /* equal */
@@ -1463,8 +1842,8 @@ xml_diff2cbuf(cbuf  *cb,
                 goto done;
         }
         /* Get next */
-        x0c = xml_child_each(x0, x0c, CX_ELMNT);
-        x1c = xml_child_each(x1, x1c, CX_ELMNT);
+        x0c = xml_child_iter(x0, &i0, CX_ELMNT);
+        x1c = xml_child_iter(x1, &i1, CX_ELMNT);
     } /* for */
  ok:
     if (nr)
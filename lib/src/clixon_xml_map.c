@@ -142,6 +142,7 @@ xml2cvec(cxobj      *xt,
          yang_stmt  *yt,
          cvec      **cvv0)
 {
+    int               inext = 0;
     int               retval = -1;
     cvec             *cvv = NULL;
     cxobj            *xc;         /* xml iteration variable */
@@ -161,7 +162,7 @@ xml2cvec(cxobj      *xt,
     }
     xc = NULL;
     /* Go through all children of the xml tree */
-    while ((xc = xml_child_each(xt, xc, CX_ELMNT)) != NULL){
+    while ((xc = xml_child_iter(xt, &inext, CX_ELMNT)) != NULL){
         name = xml_name(xc);
         if ((ys = yang_find_datanode(yt, name)) == NULL){
             clixon_debug(CLIXON_DBG_ALWAYS, "yang sanity problem: %s in xml but not present in yang under %s",
@@ -291,6 +292,8 @@ cvec2xml_1(cvec   *cvv,
  * @param[in]  x1    Second XML tree
  * @param[in]  x0c   Start of sublist in first XML tree
  * @param[in]  x1c   Start of sublist in second XML tree
+ * @param[in]  i0    Iterator of x0 positioned after x0c, see xml_child_iter
+ * @param[in]  i1    Iterator of x1 positioned after x1c
  * @param[in]  yc    Yang of ordered-by user (leaf)list
  * @retval     0     Ok
  * @retval    -1     rror
@@ -300,6 +303,8 @@ xml_diff_ordered_by_user(cxobj     *x0,
                          cxobj     *x1,
                          cxobj     *x0c,
                          cxobj     *x1c,
+                         int        i0,
+                         int        i1,
                          yang_stmt *yc,
                          cxobj   ***x0vec,
                          int       *x0veclen,
@@ -313,17 +318,22 @@ xml_diff_ordered_by_user(cxobj     *x0,
     int    retval = -1;
     cxobj *xi;
     cxobj *xj;
+    int    inext0;
+    int    inext1;
 
     xj = x1c;
+    inext1 = i1;
     do {
         xml_flag_set(xj, XML_FLAG_ADD);
-    } while ((xj = xml_child_each(x1, xj, CX_ELMNT)) != NULL &&
+    } while ((xj = xml_child_iter(x1, &inext1, CX_ELMNT)) != NULL &&
              xml_spec(xj) == yc);
     /* If in both sets, unmark add/del */
     xi = x0c;
+    inext0 = i0;
     do {
         xml_flag_set(xi, XML_FLAG_DEL);
         xj = x1c;
+        inext1 = i1;
         do {
             if (xml_flag(xj, XML_FLAG_ADD) &&
                 xml_cmp(xi, xj, 0, 0, NULL) == 0){
@@ -338,10 +348,10 @@ xml_diff_ordered_by_user(cxobj     *x0,
                 break;
             }
         }
-        while ((xj = xml_child_each(x1, xj, CX_ELMNT)) != NULL &&
+        while ((xj = xml_child_iter(x1, &inext1, CX_ELMNT)) != NULL &&
                xml_spec(xj) == yc);
     }
-    while ((xi = xml_child_each(x0, xi, CX_ELMNT)) != NULL &&
+    while ((xi = xml_child_iter(x0, &inext0, CX_ELMNT)) != NULL &&
            xml_spec(xi) == yc);
     retval = 0;
  done:
@@ -391,6 +401,8 @@ xml_diff1(cxobj     *x0,
     int        retval = -1;
     cxobj     *x0c = NULL; /* x0 child */
     cxobj     *x1c = NULL; /* x1 child */
+    int        i0;         /* x0 child iterator */
+    int        i1;         /* x1 child iterator */
     yang_stmt *yc0;
     yang_stmt *yc1;
     char      *b0;
@@ -400,22 +412,22 @@ xml_diff1(cxobj     *x0,
     cxobj     *xj;
 
     /* Traverse x0 and x1 in lock-step */
-    x0c = x1c = NULL;
-    x0c = xml_child_each(x0, x0c, CX_ELMNT);
-    x1c = xml_child_each(x1, x1c, CX_ELMNT);
+    i0 = i1 = 0;
+    x0c = xml_child_iter(x0, &i0, CX_ELMNT);
+    x1c = xml_child_iter(x1, &i1, CX_ELMNT);
     for (;;){
         if (x0c == NULL && x1c == NULL)
             goto ok;
         else if (x0c == NULL){
             if (cxvec_append(x1c, x1vec, x1veclen) < 0)
                 goto done;
-            x1c = xml_child_each(x1, x1c, CX_ELMNT);
+            x1c = xml_child_iter(x1, &i1, CX_ELMNT);
             continue;
         }
         else if (x1c == NULL){
             if (cxvec_append(x0c, x0vec, x0veclen) < 0)
                 goto done;
-            x0c = xml_child_each(x0, x0c, CX_ELMNT);
+            x0c = xml_child_iter(x0, &i0, CX_ELMNT);
             continue;
         }
         /* Both x0c and x1c exists, check if they are yang-equal. */
@@ -424,7 +436,7 @@ xml_diff1(cxobj     *x0,
         yc1 = xml_spec(x1c);
         /* override ordered-by user with special look-ahead checks */
         if (eq && yc0 && yc1 && yc0 == yc1 && yang_find(yc0, Y_ORDERED_BY, "user")){
-            if (xml_diff_ordered_by_user(x0, x1, x0c, x1c, yc0,
+            if (xml_diff_ordered_by_user(x0, x1, x0c, x1c, i0, i1, yc0,
                                          x0vec, x0veclen, x1vec, x1veclen,
                                          changed_x0, changed_x1, changedlen) < 0)
                 goto done;
@@ -438,7 +450,7 @@ xml_diff1(cxobj     *x0,
                         goto done;
                 }
             }
-            while ((xi = xml_child_each(x0, xi, CX_ELMNT)) != NULL &&
+            while ((xi = xml_child_iter(x0, &i0, CX_ELMNT)) != NULL &&
                    xml_spec(xi) == yc0);
             x0c = xi;
 
@@ -449,7 +461,7 @@ xml_diff1(cxobj     *x0,
                     if (cxvec_append(xj, x1vec, x1veclen) < 0)
                         goto done;
             }
-            while ((xj = xml_child_each(x1, xj, CX_ELMNT)) != NULL &&
+            while ((xj = xml_child_iter(x1, &i1, CX_ELMNT)) != NULL &&
                    xml_spec(xj) == yc1);
             x1c = xj;
             continue;
@@ -457,13 +469,13 @@ xml_diff1(cxobj     *x0,
         else if (eq < 0){
             if (cxvec_append(x0c, x0vec, x0veclen) < 0)
                 goto done;
-            x0c = xml_child_each(x0, x0c, CX_ELMNT);
+            x0c = xml_child_iter(x0, &i0, CX_ELMNT);
             continue;
         }
         else if (eq > 0){
             if (cxvec_append(x1c, x1vec, x1veclen) < 0)
                 goto done;
-            x1c = xml_child_each(x1, x1c, CX_ELMNT);
+            x1c = xml_child_iter(x1, &i1, CX_ELMNT);
             continue;
         }
         else{ /* equal */
@@ -498,8 +510,8 @@ xml_diff1(cxobj     *x0,
                                changed_x0, changed_x1, changedlen)< 0)
                 goto done;
         }
-        x0c = xml_child_each(x0, x0c, CX_ELMNT);
-        x1c = xml_child_each(x1, x1c, CX_ELMNT);
+        x0c = xml_child_iter(x0, &i0, CX_ELMNT);
+        x1c = xml_child_iter(x1, &i1, CX_ELMNT);
     }
  ok:
     retval = 0;
@@ -583,12 +595,14 @@ xml_tree_equal(cxobj     *x0,
     char      *b1;
     cxobj     *x0c; /* x0 child */
     cxobj     *x1c; /* x1 child */
+    int        i0;  /* x0 child iterator */
+    int        i1;  /* x1 child iterator */
     int        extflag = 0;
 
     /* Traverse x0 and x1 in lock-step */
-    x0c = x1c = NULL;
-    x0c = xml_child_each(x0, x0c, CX_ELMNT);
-    x1c = xml_child_each(x1, x1c, CX_ELMNT);
+    i0 = i1 = 0;
+    x0c = xml_child_iter(x0, &i0, CX_ELMNT);
+    x1c = xml_child_iter(x1, &i1, CX_ELMNT);
     for (;;){
         if (x0c == NULL && x1c == NULL)
             goto ok;
@@ -649,8 +663,8 @@ xml_tree_equal(cxobj     *x0,
                         goto done;
                 }
         }
-        x0c = xml_child_each(x0, x0c, CX_ELMNT);
-        x1c = xml_child_each(x1, x1c, CX_ELMNT);
+        x0c = xml_child_iter(x0, &i0, CX_ELMNT);
+        x1c = xml_child_iter(x1, &i1, CX_ELMNT);
     }
  ok:
     retval = 0;
@@ -1490,6 +1504,7 @@ yang_valstr2enum(yang_stmt *ytype,
                  char      *valstr,
                  char     **enumstr)
 {
+    int        inext = 0;
     int        retval = -1;
     yang_stmt *yenum = NULL;
     yang_stmt *yval; 
@@ -1498,7 +1513,7 @@ yang_valstr2enum(yang_stmt *ytype,
         clixon_err(OE_UNIX, EINVAL, "str is NULL");
         goto done;
     }
-    while ((yenum = yn_each(ytype, yenum)) != NULL) {
+    while ((yenum = yn_iter(ytype, &inext)) != NULL) {
         if ((yval = yang_find(yenum, Y_VALUE, NULL)) == NULL)
             goto done;
         if (strcmp(yang_argument_get(yval), valstr) == 0)
@@ -1651,6 +1666,7 @@ int
 xml_copy_marked(cxobj *x0,
                 cxobj *x1)
 {
+    int        inext;
     int        retval = -1;
     int        mark;
     cxobj     *x;
@@ -1685,15 +1701,15 @@ xml_copy_marked(cxobj *x0,
      * node in list is marked
      */
     mark = 0;
-    x = NULL;
-    while ((x = xml_child_each(x0, x, CX_ELMNT)) != NULL) {
+    inext = 0;
+    while ((x = xml_child_iter(x0, &inext, CX_ELMNT)) != NULL) {
         if (xml_flag(x, XML_FLAG_MARK|XML_FLAG_CHANGE)){
             mark++;
             break;
         }
     }
-    x = NULL;
-    while ((x = xml_child_each(x0, x, CX_ELMNT)) != NULL) {
+    inext = 0;
+    while ((x = xml_child_iter(x0, &inext, CX_ELMNT)) != NULL) {
         name = xml_name(x);
         if (xml_flag(x, XML_FLAG_MARK)){
             /* (2) the complete subtree of that node is copied. */
@@ -1821,6 +1837,7 @@ int
 yang_xml_mandatory(cxobj     *xt,
                    yang_stmt *ys)
 {
+    int           inext;
     int           retval = -1;
     yang_stmt    *ym;
     cg_var       *cv;
@@ -1854,8 +1871,8 @@ yang_xml_mandatory(cxobj     *xt,
      *    least one mandatory node as a child. */
     else if (keyw == Y_CONTAINER &&
              yang_find(ys, Y_PRESENCE, NULL) == NULL){
-        yc = NULL;
-        while ((yc = yn_each(ys, yc)) != NULL) {
+        inext = 0;
+        while ((yc = yn_iter(ys, &inext)) != NULL) {
             if ((ret = yang_xml_mandatory(xs, yc)) < 0)
                 goto done;
             if (ret == 1)
@@ -1915,11 +1932,12 @@ xml_find_action(cxobj  *xn,
                 int     top,
                 cxobj **xap)
 {
+    int        inext = 0;
     int        retval = -1;
     cxobj     *xc = NULL;
     yang_stmt *yc;
 
-    while ((xc = xml_child_each(xn, xc, CX_ELMNT)) != NULL) {
+    while ((xc = xml_child_iter(xn, &inext, CX_ELMNT)) != NULL) {
         if ((yc = xml_spec(xc)) == NULL)
             continue;
         if (!top && yang_keyword_get(yc) == Y_ACTION){
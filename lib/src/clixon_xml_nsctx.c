@@ -335,6 +335,7 @@ xml_nsctx_yang(yang_stmt *yn,
     yang_stmt *ym;    /* yang imported module */
     yang_stmt *yns;   /* yang namespace */
     yang_stmt *y;
+    int        inext;
     char      *name;
     char      *namespace;
     char      *prefix;
@@ -371,8 +372,8 @@ xml_nsctx_yang(yang_stmt *yn,
 
     /* Iterate over module and register all import prefixes
      */
-    y = NULL;
-    while ((y = yn_each(ymod, y)) != NULL) {
+    inext = 0;
+    while ((y = yn_iter(ymod, &inext)) != NULL) {
         if (yang_keyword_get(y) == Y_IMPORT){
             if ((name = yang_argument_get(y)) == NULL)
                 continue; /* Just skip - shouldnt happen) */
@@ -420,6 +421,7 @@ xml_nsctx_yangspec(yang_stmt *yspec,
                    cvec     **ncp)
 {
     int        retval = -1;
+    int        inext;
     cvec      *nc = NULL;
     yang_stmt *ymod = NULL;
     yang_stmt *yprefix;
@@ -431,8 +433,8 @@ xml_nsctx_yangspec(yang_stmt *yspec,
         clixon_err(OE_XML, errno, "cvec_new");
         goto done;
     }
-    ymod = NULL;
-    while ((ymod = yn_each(yspec, ymod)) != NULL){
+    inext = 0;
+    while ((ymod = yn_iter(yspec, &inext)) != NULL){
         if (yang_keyword_get(ymod) != Y_MODULE)
             continue;
         if ((yprefix = yang_find(ymod, Y_PREFIX, NULL)) == NULL)
@@ -75,6 +75,7 @@
 #include <stdint.h>
 #include <syslog.h>
 #include <fcntl.h>
+#include <pthread.h>
 #include <math.h>  /* NaN */
 
 /* cligen */
@@ -98,6 +99,7 @@
 #include "clixon_xpath.h"
 #include "clixon_xpath_parse.h"
 #include "clixon_xpath_eval.h"
+#include "clixon_probe.h"
 
 /* Use apostrophe(') in xpath literals, eg a/[x='foo'], not double-quotes(")
  * If not set, use ": a/[x="foo"]
@@ -110,6 +112,9 @@
  * Variables
  */
 
+/* The XPath lexer and parser are not reentrant, serialize parsing between threads */
+static pthread_mutex_t xpath_parse_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 /* Mapping between xpath_tree node name string <--> int  
  * @see xpath_tree_int2str
  */
@@ -557,12 +562,15 @@ xpath_parse(const char  *xpath,
     int               retval = -1;
     clixon_xpath_yacc xpy = {0,};
     cbuf             *cb = NULL;    
+    int               locked = 0;
 
     clixon_debug(CLIXON_DBG_XPATH | CLIXON_DBG_DETAIL, "xpath %s", xpath);
     if (xpath == NULL){
         clixon_err(OE_XML, EINVAL, "XPath is NULL");
         goto done;
     }
+    pthread_mutex_lock(&xpath_parse_mutex);
+    locked++;
     xpy.xpy_parse_string = xpath;
     xpy.xpy_name = "xpath parser";
     xpy.xpy_linenum = 1;
@@ -593,6 +601,8 @@ xpath_parse(const char  *xpath,
     }
     retval = 0;
  done:
+    if (locked)
+        pthread_mutex_unlock(&xpath_parse_mutex);
     if (cb)
         cbuf_free(cb);
     if (xpy.xpy_top)
@@ -628,11 +638,45 @@ xpath_vec_ctx(cxobj      *xcur,
 {
     int         retval = -1;
     xpath_tree *xptree = NULL;
-    xp_ctx      xc = {0,};
     
     clixon_debug(CLIXON_DBG_XPATH | CLIXON_DBG_DETAIL, "%s", xpath);
+    CLIXON_PROBE1(xpath__eval__start, xpath);
     if (xpath_parse(xpath, &xptree) < 0)
         goto done;
+    if (xpath_tree_eval(xcur, nsc, xptree, localonly, xrp) < 0)
+        goto done;
+    retval = 0;
+ done:
+    CLIXON_PROBE2(xpath__eval__done, xpath, retval);
+    if (xptree)
+        xpath_tree_free(xptree);
+    return retval;
+}
+
+/*! Given XML tree and parsed xpath, eval it and return xpath context
+ *
+ * Same as xpath_vec_ctx but with an xpath parsed in advance, for xpaths that
+ * are evaluated many times
+ * @param[in]  xcur   XML-tree where to search
+ * @param[in]  nsc    External XML namespace context, or NULL
+ * @param[in]  xptree XPath parse-tree
+ * @param[in]  localonly Skip prefix and namespace tests (non-standard)
+ * @param[out] xrp    Return XPath context
+ * @retval     0      OK
+ * @retval    -1      Error
+ * @see xpath_parse  to create xptree
+ * @see xpath_vec_ctx
+ */
+int
+xpath_tree_eval(cxobj      *xcur,
+                cvec       *nsc,
+                xpath_tree *xptree,
+                int         localonly,
+                xp_ctx    **xrp)
+{
+    int    retval = -1;
+    xp_ctx xc = {0,};
+
     xc.xc_type = XT_NODESET;
     xc.xc_node = xcur;
     xc.xc_initial = xcur;
@@ -646,8 +690,6 @@ xpath_vec_ctx(cxobj      *xcur,
         free(xc.xc_nodeset);
         xc.xc_nodeset = NULL;
     }
-    if (xptree)
-        xpath_tree_free(xptree);
     return retval;
 }
 
@@ -275,13 +275,14 @@ nodetest_recursive(cxobj      *xn,
                    cxobj    ***vec0,
                    int        *vec0len)
 {
+    int     inext;
     int     retval = -1;
     cxobj  *xsub;
     cxobj **vec = *vec0;
     int     veclen = *vec0len;
 
-    xsub = NULL;
-    while ((xsub = xml_child_each(xn, xsub, node_type)) != NULL) {
+    inext = 0;
+    while ((xsub = xml_child_iter(xn, &inext, node_type)) != NULL) {
         if (nodetest_eval(xsub, nodetest, nsc, localonly) == 1){
             clixon_debug(CLIXON_DBG_XPATH | CLIXON_DBG_DETAIL, "%x %x", flags, xml_flag(xsub, flags));
             if (flags==0x0 || xml_flag(xsub, flags))
@@ -322,6 +323,7 @@ xp_eval_step(xp_ctx     *xc0,
              int         localonly,
              xp_ctx    **xrp)
 {
+    int         inext;
     int         retval = -1;
     int         i;
     cxobj      *x;
@@ -355,11 +357,11 @@ xp_eval_step(xp_ctx     *xc0,
         else{
             for (i=0; i<xc->xc_size; i++){
                 xv = xc->xc_nodeset[i];
-                x = NULL;
                 if ((ret = xpath_optimize_check(xs, xv, &vec, &veclen)) < 0)
                     goto done;
                 if (ret == 0){/* regular code, no optimization made */
-                    while ((x = xml_child_each(xv, x, CX_ELMNT)) != NULL) {
+                    inext = 0;
+                    while ((x = xml_child_iter(xv, &inext, CX_ELMNT)) != NULL) {
                         /* xs->xs_c0 is nodetest */
                         if (nodetest == NULL ||
                             nodetest_eval(x, nodetest, nsc, localonly) == 1){
@@ -1136,6 +1138,7 @@ xp_eval(xp_ctx     *xc,
         xp_ctx    **xrp)
 {
     int        retval = -1;
+    int        inext;
     cxobj     *x;
     xp_ctx    *xr0 = NULL;
     xp_ctx    *xr1 = NULL;
@@ -1293,8 +1296,8 @@ xp_eval(xp_ctx     *xc,
             memset(xr0, 0, sizeof(*xr0));
             xr0->xc_initial = xc->xc_initial;
             xr0->xc_type = XT_NODESET;
-            x = NULL;
-            while ((x = xml_child_each(xc->xc_node, x, CX_ELMNT)) != NULL) {
+            inext = 0;
+            while ((x = xml_child_iter(xc->xc_node, &inext, CX_ELMNT)) != NULL) {
                 if (cxvec_append(x, &xr0->xc_nodeset, &xr0->xc_size) < 0)
                     goto done;
             }
@@ -49,6 +49,7 @@
 #include <stdint.h>
 #include <syslog.h>
 #include <fcntl.h>
+#include <pthread.h>
 #include <math.h> /* NaN */
 
 /* cligen */
@@ -76,6 +77,8 @@ static xpath_tree *_xm = NULL;
 static xpath_tree *_xe = NULL;
 static int _optimize_enable = 1;
 static int _optimize_hits = 0;
+/* Protects lazy initialization of pattern tree, xpath may be evaluated in several threads */
+static pthread_mutex_t _optimize_mutex = PTHREAD_MUTEX_INITIALIZER;
 #endif /* XPATH_LIST_OPTIMIZE */
 
 /* XXX development in clixon_xpath_eval */
@@ -124,6 +127,7 @@ xpath_optimize_init(xpath_tree **xm,
     int         retval = -1;
     xpath_tree *xs;
 
+    pthread_mutex_lock(&_optimize_mutex);
     if (_xm == NULL){
         /* Initialize xpath-tree */
         if (xpath_parse("_x[_y='_z']", &_xmtop) < 0)
@@ -155,6 +159,7 @@ xpath_optimize_init(xpath_tree **xm,
     *xe = _xe;
     retval = 0;
  done:
+    pthread_mutex_unlock(&_optimize_mutex);
     return retval;
 }
 
@@ -638,6 +638,7 @@ yang_stats(yang_stmt *yt,
            uint64_t  *nrp,
            size_t    *szp)
 {
+    int        inext;
     int        retval = -1;
     size_t     sz = 0;
     yang_stmt *ys;
@@ -650,8 +651,8 @@ yang_stats(yang_stmt *yt,
     yang_stats_one(yt, &sz);
     if (szp)
         *szp += sz;
-    ys = NULL;
-    while ((ys = yn_each(yt, ys)) != NULL) {
+    inext = 0;
+    while ((ys = yn_iter(yt, &inext)) != NULL) {
         sz = 0;
         yang_stats(ys, nrp, &sz);
         if (szp)
@@ -1083,6 +1084,7 @@ yn_insert1(yang_stmt *ys_parent,
  * @endcode
  * @note makes uses _ys_vector_i:can be changed if list changed between calls
  * @note also does not work in recursive calls (to same node)
+ * @see yn_iter  external cursor
  */
 yang_stmt *
 yn_each(yang_stmt *yparent,
@@ -1107,6 +1109,38 @@ yn_each(yang_stmt *yparent,
     return yc;
 }
 
+/*! Iterate through all yang statements from a yang node using an external cursor
+ *
+ * Same as yn_each but the iteration state is kept by the caller, so the same node
+ * may be iterated recursively or by several threads at once.
+ * @param[in]     yparent  yang statement whose children are iterated
+ * @param[in,out] inext    Index of next child to check, set to 0 on init
+ * @retval        yc       Next yang statement
+ * @retval        NULL     End of list
+ * @code
+ *   yang_stmt *yc;
+ *   int        inext = 0;
+ *   while ((yc = yn_iter(yparent, &inext)) != NULL) {
+ *     ...yc...
+ *   }
+ * @endcode
+ * @see yn_each
+ */
+yang_stmt *
+yn_iter(yang_stmt *yparent,
+        int       *inext)
+{
+    yang_stmt *yc;
+
+    if (yparent == NULL)
+        return NULL;
+    while (*inext < yparent->ys_len){
+        if ((yc = yparent->ys_stmt[(*inext)++]) != NULL)
+            return yc;
+    }
+    return NULL;
+}
+
 /*! Find first child yang_stmt with matching keyword and argument
  *
  * Find child given keyword and argument.
@@ -1208,17 +1242,19 @@ yang_stmt *
 yang_find_datanode(yang_stmt *yn,
                    char      *argument)
 {
+    int        inext;
+    int        inext1;
     yang_stmt *ys = NULL;
     yang_stmt *yc = NULL;
     yang_stmt *yspec;
     yang_stmt *ysmatch = NULL;
     char      *name;
 
-    ys = NULL;
-    while ((ys = yn_each(yn, ys)) != NULL){
+    inext = 0;
+    while ((ys = yn_iter(yn, &inext)) != NULL){
         if (yang_keyword_get(ys) == Y_CHOICE){ /* Look for its children */
-            yc = NULL;
-            while ((yc = yn_each(ys, yc)) != NULL){
+            inext1 = 0;
+            while ((yc = yn_iter(ys, &inext1)) != NULL){
                 if (yang_keyword_get(yc) == Y_CASE) /* Look for its children */
                     ysmatch = yang_find_datanode(yc, argument);
                 else
@@ -1251,8 +1287,8 @@ yang_find_datanode(yang_stmt *yn,
         (yang_keyword_get(yn) == Y_MODULE ||
          yang_keyword_get(yn) == Y_SUBMODULE)){
         yspec = ys_spec(yn);
-        ys = NULL;
-        while ((ys = yn_each(yn, ys)) != NULL){
+        inext = 0;
+        while ((ys = yn_iter(yn, &inext)) != NULL){
             if (yang_keyword_get(ys) == Y_INCLUDE){
                 name = yang_argument_get(ys);
                 yc = yang_find_module_by_name(yspec, name);
@@ -1431,6 +1467,7 @@ yang_find_prefix_by_namespace(yang_stmt *ys,
                               char      *ns,
                               char     **prefix)
 {
+    int        inext;
     int        retval = -1;
     yang_stmt *my_ymod; /* My module */
     char      *myns;   /* My ns */
@@ -1458,8 +1495,8 @@ yang_find_prefix_by_namespace(yang_stmt *ys,
     modname = yang_argument_get(ymod);
     my_ymod = ys_module(ys);
     /* Loop through import statements to find a match with ymod */
-    yimport = NULL;
-    while ((yimport = yn_each(my_ymod, yimport)) != NULL) {
+    inext = 0;
+    while ((yimport = yn_iter(my_ymod, &inext)) != NULL) {
         if (yang_keyword_get(yimport) == Y_IMPORT &&
             strcmp(modname, yang_argument_get(yimport)) == 0){ /* match */
             yprefix = yang_find(yimport, Y_PREFIX, NULL);
@@ -3909,6 +3946,7 @@ yang_extension_value(yang_stmt *ys,
                      int       *exist,
                      char     **value)
 {
+    int        inext = 0;
     int        retval = -1;
     yang_stmt *yext;
     yang_stmt *ymod;
@@ -3928,7 +3966,7 @@ yang_extension_value(yang_stmt *ys,
         goto done;
     }
     yext = NULL; /* This loop gets complicated in the case the extension is augmented */
-    while ((yext = yn_each(ys, yext)) != NULL) {
+    while ((yext = yn_iter(ys, &inext)) != NULL) {
         if (yang_keyword_get(yext) != Y_UNKNOWN)
             continue;
         if ((ymod = ys_module(yext)) == NULL)
@@ -4087,6 +4125,7 @@ yang_single_child_type(yang_stmt    *ys,
                        enum rfc_6020 subkeyw)
 
 {
+    int           inext = 0;
     yang_stmt    *yc = NULL;
     int           i;
     enum rfc_6020 keyw;
@@ -4099,7 +4138,7 @@ yang_single_child_type(yang_stmt    *ys,
     }
     /* Ensure a single list child and no other data nodes */
     i = 0; /* Number of list nodes */
-    while ((yc = yn_each(ys, yc)) != NULL) {
+    while ((yc = yn_iter(ys, &inext)) != NULL) {
         keyw = yang_keyword_get(yc);
         /* case/choice could hide anything so disqualify those */
         if (keyw == Y_CASE || keyw == Y_CHOICE)
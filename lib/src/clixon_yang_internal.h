@@ -101,6 +101,7 @@ struct yang_stmt{
                                         Y_UNIQUE: vector of descendant schema node ids
                                         Y_EXTENSION: vector of instantiated UNKNOWNS
                                         Y_UNKNOWN: app-dep: yang-mount-points
+                                        Y_MODULE: cached hash, see clixon_bin_module_hash
                                      */
     int                ys_ref;       /* Reference count for free, only YS_SPEC */
     yang_type_cache   *ys_typecache; /* If ys_keyword==Y_TYPE, cache all typedef data except unions */
@@ -535,6 +535,7 @@ yang_stmt *
 yang_find_module_by_prefix(yang_stmt *ys,
                            char      *prefix)
 {
+    int        inext;
     yang_stmt *yimport;
     yang_stmt *yprefix;
     yang_stmt *my_ymod;
@@ -557,8 +558,8 @@ yang_find_module_by_prefix(yang_stmt *ys,
         goto done;
     }
     /* If no match, try imported modules */
-    yimport = NULL;
-    while ((yimport = yn_each(my_ymod, yimport)) != NULL) {
+    inext = 0;
+    while ((yimport = yn_iter(my_ymod, &inext)) != NULL) {
         if (yang_keyword_get(yimport) != Y_IMPORT)
             continue;
         if ((yprefix = yang_find(yimport, Y_PREFIX, NULL)) != NULL &&
@@ -588,10 +589,11 @@ yang_stmt *
 yang_find_module_by_prefix_yspec(yang_stmt *yspec,
                                  char      *prefix)
 {
+    int        inext = 0;
     yang_stmt *ymod = NULL;
     yang_stmt *yprefix;
 
-    while ((ymod = yn_each(yspec, ymod)) != NULL)
+    while ((ymod = yn_iter(yspec, &inext)) != NULL)
         if (yang_keyword_get(ymod) == Y_MODULE &&
             (yprefix = yang_find(ymod, Y_PREFIX, NULL)) != NULL &&
             strcmp(yang_argument_get(yprefix), prefix) == 0)
@@ -613,11 +615,12 @@ yang_stmt *
 yang_find_module_by_namespace(yang_stmt *yspec,
                               char      *ns)
 {
+    int        inext = 0;
     yang_stmt *ymod = NULL;
 
     if (ns == NULL)
         goto done;
-    while ((ymod = yn_each(yspec, ymod)) != NULL) {
+    while ((ymod = yn_iter(yspec, &inext)) != NULL) {
         if (yang_find(ymod, Y_NAMESPACE, ns) != NULL)
             break;
     }
@@ -640,6 +643,7 @@ yang_find_module_by_namespace_revision(yang_stmt  *yspec,
                                        const char *ns,
                                        const char *rev)
 {
+    int        inext = 0;
     yang_stmt *ymod = NULL;
     yang_stmt *yrev;
     char      *rev1;
@@ -648,7 +652,7 @@ yang_find_module_by_namespace_revision(yang_stmt  *yspec,
         clixon_err(OE_CFG, EINVAL, "No ns or rev");
         goto done;
     }
-    while ((ymod = yn_each(yspec, ymod)) != NULL) {
+    while ((ymod = yn_iter(yspec, &inext)) != NULL) {
         if (yang_find(ymod, Y_NAMESPACE, ns) != NULL)
             /* Get FIRST revision */
             if ((yrev = yang_find(ymod, Y_REVISION, NULL)) != NULL){
@@ -676,6 +680,7 @@ yang_find_module_by_name_revision(yang_stmt  *yspec,
                                   const char *name,
                                   const char *rev)
 {
+    int        inext = 0;
     yang_stmt *ymod = NULL;
     yang_stmt *yrev;
     char      *rev1;
@@ -684,7 +689,7 @@ yang_find_module_by_name_revision(yang_stmt  *yspec,
         clixon_err(OE_CFG, EINVAL, "No ns or rev");
         goto done;
     }
-    while ((ymod = yn_each(yspec, ymod)) != NULL) {
+    while ((ymod = yn_iter(yspec, &inext)) != NULL) {
         if (yang_keyword_get(ymod) != Y_MODULE)
             continue;
         if (strcmp(yang_argument_get(ymod), name) != 0)
@@ -715,9 +720,10 @@ yang_stmt *
 yang_find_module_by_name(yang_stmt *yspec,
                          char      *name)
 {
+    int        inext = 0;
     yang_stmt *ymod = NULL;
 
-    while ((ymod = yn_each(yspec, ymod)) != NULL)
+    while ((ymod = yn_iter(yspec, &inext)) != NULL)
         if ((yang_keyword_get(ymod) == Y_MODULE || yang_keyword_get(ymod) == Y_SUBMODULE) &&
             strcmp(yang_argument_get(ymod), name)==0)
             return ymod;
@@ -783,12 +789,13 @@ yang_metadata_annotation_check(cxobj     *xa,
                                int       *ismeta)
 {
     int        retval = -1;
+    int        inext = 0;
     yang_stmt *yma = NULL;
     char      *name;
     cg_var    *cv;
 
     /* Loop through annotations */
-    while ((yma = yn_each(ymod, yma)) != NULL){
+    while ((yma = yn_iter(ymod, &inext)) != NULL){
         /* Assume here md:annotation is written using canonical prefix */
         if (yang_keyword_get(yma) != Y_UNKNOWN)
             continue;
@@ -527,6 +527,23 @@ function chunked_framing()
     printf "\n#%s\n%s\n##\n" ${length} "${str}"
 }
 
+# Remove RFC6242 chunked framing from stdin, write each message followed by newline
+# Chunk sizes are used, a message may be split in several chunks anywhere
+function chunked_deframing()
+{
+    local line
+    while IFS= read -r line; do
+        case "$line" in
+            "##")
+                echo
+                ;;
+            "#"[1-9]*)
+                head -c ${line#\#}
+                ;;
+        esac
+    done
+}
+
 # Start clixon_snmp
 function start_snmp(){
     cfg=$1
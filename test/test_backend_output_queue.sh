@@ -0,0 +1,134 @@
+#!/usr/bin/env bash
+# Backend output queue of a session with a slow subscriber
+# The example backend sends $rate events per second on the EXAMPLE stream.
+# Events are not queued per subscription, but in the output queue of the session, which
+# is bounded by CLICON_BACKEND_OUTPUT_QUEUE_MAX for notifications in all policies:
+# - block: the session is disconnected
+# - drop: notifications are dropped and counted in the session state
+# @see test_netconf_backpressure.sh for per-subscription queues
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+# Events per second
+rate=2000
+
+# High-water mark in bytes of output queue of a session
+omax=10000
+
+cfg=$dir/conf.xml
+fyang=$dir/example.yang
+
+cat <<EOF > $fyang
+module example {
+   namespace "urn:example:clixon";
+   prefix ex;
+   notification event {
+      leaf event-class {
+         type string;
+      }
+      container reportingEntity {
+         leaf card {
+            type string;
+         }
+      }
+      leaf severity {
+         type string;
+      }
+   }
+}
+EOF
+
+# Start backend with output queue policy and a subscriber that does not read
+# 1: output queue policy
+function testrun()
+{
+    policy=$1
+
+    cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>${YANG_INSTALLDIR}</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/run/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_DIR>/usr/local/lib/$APPNAME/backend</CLICON_BACKEND_DIR>
+  <CLICON_BACKEND_REGEXP>example_backend.so$</CLICON_BACKEND_REGEXP>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/run/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+  <CLICON_STREAM_DISCOVERY_RFC5277>true</CLICON_STREAM_DISCOVERY_RFC5277>
+  <CLICON_STREAM_RETENTION>0</CLICON_STREAM_RETENTION>
+  <CLICON_STREAM_QUEUE_MAX>0</CLICON_STREAM_QUEUE_MAX>
+  <CLICON_BACKEND_OUTPUT_QUEUE_MAX>$omax</CLICON_BACKEND_OUTPUT_QUEUE_MAX>
+  <CLICON_BACKEND_OUTPUT_QUEUE_POLICY>$policy</CLICON_BACKEND_OUTPUT_QUEUE_POLICY>
+</clixon-config>
+EOF
+
+    new "test params: -f $cfg"
+    if [ $BE -ne 0 ]; then
+        new "kill old backend"
+        sudo clixon_backend -zf $cfg
+        if [ $? -ne 0 ]; then
+            err
+        fi
+        new "start backend -s init -f $cfg -- -N $rate"
+        start_backend -s init -f $cfg -- -N $rate
+    fi
+
+    new "wait backend"
+    wait_backend
+
+    new "$policy: start subscriber that does not read notifications"
+    rpc=$(chunked_framing "<rpc $DEFAULTNS><create-subscription xmlns=\"urn:ietf:params:xml:ns:netmod:notification\"><stream>EXAMPLE</stream></create-subscription></rpc>")
+    (echo "$DEFAULTHELLO$rpc"; sleep 10) | $clixon_netconf -qef $cfg 2> /dev/null | sleep 10 &
+    sleep 5
+
+    if [ $policy = block ]; then
+        new "$policy: backend is responsive"
+        expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get><filter type=\"xpath\" select=\"n:netconf/n:streams\" xmlns:n=\"urn:ietf:params:xml:ns:netmod:notification\"/></get></rpc>" "" "<rpc-reply $DEFAULTNS><data><netconf xmlns=\"urn:ietf:params:xml:ns:netmod:notification\"><streams><stream><name>EXAMPLE</name><description>Example event stream</description><replay-support>true</replay-support></stream></streams></netconf></data></rpc-reply>"
+
+        # Only the session of the request itself remains
+        new "$policy: subscriber session is disconnected"
+        rpc=$(chunked_framing "<rpc $DEFAULTNS><get><filter type=\"subtree\"><netconf-state xmlns=\"urn:ietf:params:xml:ns:yang:ietf-netconf-monitoring\"><sessions/></netconf-state></filter></get></rpc>")
+        ret=$(echo "$DEFAULTHELLO$rpc" | $clixon_netconf -qef $cfg 2> /dev/null)
+        nr=$(echo "$ret" | grep -o "<session>" | wc -l)
+        if [ $nr -ne 1 ]; then
+            err "1 session" "$ret"
+        fi
+    else
+        new "$policy: subscriber session drops notifications"
+        expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get><filter type=\"subtree\"><netconf-state xmlns=\"urn:ietf:params:xml:ns:yang:ietf-netconf-monitoring\"><sessions/></netconf-state></filter></get></rpc>" "" "<out-queue-drops xmlns=\"http://clicon.org/lib\">[1-9][0-9]*</out-queue-drops>"
+
+        new "$policy: subscriber session is not disconnected"
+        rpc=$(chunked_framing "<rpc $DEFAULTNS><get><filter type=\"subtree\"><netconf-state xmlns=\"urn:ietf:params:xml:ns:yang:ietf-netconf-monitoring\"><sessions/></netconf-state></filter></get></rpc>")
+        ret=$(echo "$DEFAULTHELLO$rpc" | $clixon_netconf -qef $cfg 2> /dev/null)
+        nr=$(echo "$ret" | grep -o "<session>" | wc -l)
+        if [ $nr -ne 2 ]; then
+            err "2 sessions" "$ret"
+        fi
+    fi
+
+    kill $(jobs -p) 2> /dev/null
+    wait 2> /dev/null
+
+    if [ $BE -ne 0 ]; then
+        new "Kill backend"
+        # Check if premature kill
+        pid=$(pgrep -u root -f clixon_backend)
+        if [ -z "$pid" ]; then
+            err "backend already dead"
+        fi
+        # kill backend
+        stop_backend -f $cfg
+    fi
+}
+
+for policy in block drop; do
+    testrun $policy
+done
+
+rm -rf $dir
+
+new "endtest"
+endtest
@@ -0,0 +1,127 @@
+#!/usr/bin/env bash
+# Backend worker threads for get and get-config, see CLICON_BACKEND_WORKER_THREADS
+# Check that replies made by worker threads are the same as in the main thread,
+# including xpath filter, depth and errors, and that clients are served meanwhile
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf.xml
+fyang=$dir/worker.yang
+
+# Number of list entries
+: ${nr:=1000}
+
+cat <<EOF > $fyang
+module worker{
+   yang-version 1.1;
+   namespace "urn:example:clixon";
+   prefix ex;
+   container x {
+    list y {
+      key "a";
+      leaf a {
+        type int32;
+      }
+      leaf b {
+        type string;
+      }
+    }
+  }
+}
+EOF
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>${YANG_INSTALLDIR}</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/run/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/run/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_BACKEND_WORKER_THREADS>2</CLICON_BACKEND_WORKER_THREADS>
+  <CLICON_XMLDB_DIR>$dir</CLICON_XMLDB_DIR>
+</clixon-config>
+EOF
+
+new "generate startup with $nr list entries"
+echo -n "<${DATASTORE_TOP}><x xmlns=\"urn:example:clixon\">" > $dir/startup_db
+for (( i=0; i<$nr; i++ )); do
+    echo -n "<y><a>$i</a><b>$i</b></y>" >> $dir/startup_db
+done
+echo "</x></${DATASTORE_TOP}>" >> $dir/startup_db
+
+new "test params: -f $cfg"
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+        err
+    fi
+    new "start backend -s startup -f $cfg"
+    start_backend -s startup -f $cfg
+fi
+
+new "wait backend"
+wait_backend
+
+new "netconf get-config single entry"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get-config><source><running/></source><filter type=\"xpath\" select=\"/ex:x/ex:y[ex:a='42']\" xmlns:ex=\"urn:example:clixon\"/></get-config></rpc>" "" "<rpc-reply $DEFAULTNS><data><x xmlns=\"urn:example:clixon\"><y><a>42</a><b>42</b></y></x></data></rpc-reply>"
+
+new "netconf get single entry"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get><filter type=\"xpath\" select=\"/ex:x/ex:y[ex:a='7']\" xmlns:ex=\"urn:example:clixon\"/></get></rpc>" "" "<rpc-reply $DEFAULTNS><data><x xmlns=\"urn:example:clixon\"><y><a>7</a><b>7</b></y></x></data></rpc-reply>"
+
+new "netconf get-config depth"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get-config depth=\"1\"><source><running/></source></get-config></rpc>" "" "<rpc-reply $DEFAULTNS><data><x xmlns=\"urn:example:clixon\"/></data></rpc-reply>"
+
+new "netconf get-config no match"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get-config><source><running/></source><filter type=\"xpath\" select=\"/ex:x/ex:y[ex:a='$nr']\" xmlns:ex=\"urn:example:clixon\"/></get-config></rpc>" "" "<rpc-reply $DEFAULTNS><data/></rpc-reply>"
+
+new "netconf several get-config in one session"
+rpc=$(chunked_framing "<rpc $DEFAULTONLY message-id=\"1\"><get-config><source><running/></source><filter type=\"xpath\" select=\"/ex:x/ex:y[ex:a='1']\" xmlns:ex=\"urn:example:clixon\"/></get-config></rpc>")
+rpc+=$(chunked_framing "<rpc $DEFAULTONLY message-id=\"2\"><get-config><source><running/></source><filter type=\"xpath\" select=\"/ex:x/ex:y[ex:a='2']\" xmlns:ex=\"urn:example:clixon\"/></get-config></rpc>")
+ret=$(echo "$DEFAULTHELLO$rpc" | $clixon_netconf -qef $cfg)
+expectpart "$ret" 0 "<rpc-reply $DEFAULTONLY message-id=\"1\"><data><x xmlns=\"urn:example:clixon\"><y><a>1</a><b>1</b></y></x></data></rpc-reply>" "<rpc-reply $DEFAULTONLY message-id=\"2\"><data><x xmlns=\"urn:example:clixon\"><y><a>2</a><b>2</b></y></x></data></rpc-reply>"
+
+# A large reply first, replies to one session are sent in request order
+new "netconf several get-config in one session replies in order"
+rpc=$(chunked_framing "<rpc $DEFAULTONLY message-id=\"1\"><get-config><source><running/></source></get-config></rpc>")
+rpc+=$(chunked_framing "<rpc $DEFAULTONLY message-id=\"2\"><get-config><source><running/></source><filter type=\"xpath\" select=\"/ex:x/ex:y[ex:a='2']\" xmlns:ex=\"urn:example:clixon\"/></get-config></rpc>")
+rpc+=$(chunked_framing "<rpc $DEFAULTONLY message-id=\"3\"><get-config><source><running/></source><filter type=\"xpath\" select=\"/ex:x/ex:y[ex:a='3']\" xmlns:ex=\"urn:example:clixon\"/></get-config></rpc>")
+ret=$(echo "$DEFAULTHELLO$rpc" | $clixon_netconf -qef $cfg | grep -o "message-id=\"[0-9]*\"" | tr -d '\n')
+if [ "$ret" != "message-id=\"1\"message-id=\"2\"message-id=\"3\"" ]; then
+    err "message-id=\"1\"message-id=\"2\"message-id=\"3\"" "$ret"
+fi
+
+new "netconf get-config whole list in background"
+rpc=$(chunked_framing "<rpc $DEFAULTNS><get-config><source><running/></source></get-config></rpc>")
+echo "$DEFAULTHELLO$rpc" | $clixon_netconf -qef $cfg > $dir/output.xml &
+pid=$!
+
+new "netconf edit-config while get in progress"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><x xmlns=\"urn:example:clixon\"><y><a>$nr</a><b>new</b></y></x></config></edit-config></rpc>" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+wait $pid
+
+new "check background get-config reply"
+expectpart "$(cat $dir/output.xml)" 0 "<y><a>0</a><b>0</b></y>" "<y><a>$((nr-1))</a><b>$((nr-1))</b></y></x></data></rpc-reply>"
+
+new "netconf get-config candidate new entry"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get-config><source><candidate/></source><filter type=\"xpath\" select=\"/ex:x/ex:y[ex:a='$nr']\" xmlns:ex=\"urn:example:clixon\"/></get-config></rpc>" "" "<rpc-reply $DEFAULTNS><data><x xmlns=\"urn:example:clixon\"><y><a>$nr</a><b>new</b></y></x></data></rpc-reply>"
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+        err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
+
+new "endtest"
+endtest
@@ -0,0 +1,129 @@
+#!/usr/bin/env bash
+# Backend cache of get and get-config replies, see CLICON_BACKEND_GET_CACHE_MAX
+# Check that a repeated get is a cache hit, that a commit invalidates the cache,
+# and that state data is not cached without TTL, with and without worker threads
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf.xml
+fyang=$dir/cache.yang
+
+cat <<EOF > $fyang
+module cache{
+   yang-version 1.1;
+   namespace "urn:example:clixon";
+   prefix ex;
+   container x {
+    list y {
+      key "a";
+      leaf a {
+        type int32;
+      }
+      leaf b {
+        type string;
+      }
+    }
+  }
+}
+EOF
+
+# Test function
+# Arguments:
+# 1: threads  Number of backend worker threads
+function testrun(){
+    threads=$1
+
+    cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>${YANG_INSTALLDIR}</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_DIR>$dir</CLICON_YANG_MAIN_DIR>
+  <CLICON_SOCK>/usr/local/var/run/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/run/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_BACKEND_WORKER_THREADS>$threads</CLICON_BACKEND_WORKER_THREADS>
+  <CLICON_BACKEND_GET_CACHE_MAX>1000000</CLICON_BACKEND_GET_CACHE_MAX>
+  <CLICON_XMLDB_DIR>$dir</CLICON_XMLDB_DIR>
+</clixon-config>
+EOF
+
+    new "test params: -f $cfg"
+    if [ $BE -ne 0 ]; then
+        new "kill old backend"
+        sudo clixon_backend -zf $cfg
+        if [ $? -ne 0 ]; then
+            err
+        fi
+        new "start backend -s startup -f $cfg"
+        start_backend -s startup -f $cfg
+    fi
+
+    new "wait backend"
+    wait_backend
+
+    new "netconf get-config first with $threads threads"
+    expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get-config><source><running/></source><filter type=\"xpath\" select=\"/ex:x\" xmlns:ex=\"urn:example:clixon\"/></get-config></rpc>" "" "<rpc-reply $DEFAULTNS><data><x xmlns=\"urn:example:clixon\"><y><a>1</a><b>one</b></y></x></data></rpc-reply>"
+
+    new "netconf get-config again"
+    expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get-config><source><running/></source><filter type=\"xpath\" select=\"/ex:x\" xmlns:ex=\"urn:example:clixon\"/></get-config></rpc>" "" "<rpc-reply $DEFAULTNS><data><x xmlns=\"urn:example:clixon\"><y><a>1</a><b>one</b></y></x></data></rpc-reply>"
+
+    new "netconf get-config other prefix same canonical xpath"
+    expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get-config><source><running/></source><filter type=\"xpath\" select=\"/c:x\" xmlns:c=\"urn:example:clixon\"/></get-config></rpc>" "" "<rpc-reply $DEFAULTNS><data><x xmlns=\"urn:example:clixon\"><y><a>1</a><b>one</b></y></x></data></rpc-reply>"
+
+    new "netconf stats cache hit"
+    expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><stats $LIBNS/></rpc>" "" "<get-cache $LIBNS><entries>1</entries><size>[0-9]*</size><hits>2</hits><misses>1</misses></get-cache>"
+
+    new "netconf edit-config"
+    expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><x xmlns=\"urn:example:clixon\"><y><a>1</a><b>changed</b></y></x></config></edit-config></rpc>" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+    new "netconf commit"
+    expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><commit/></rpc>" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+    new "netconf get-config after commit is not stale"
+    expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get-config><source><running/></source><filter type=\"xpath\" select=\"/ex:x\" xmlns:ex=\"urn:example:clixon\"/></get-config></rpc>" "" "<rpc-reply $DEFAULTNS><data><x xmlns=\"urn:example:clixon\"><y><a>1</a><b>changed</b></y></x></data></rpc-reply>"
+
+    new "netconf get state twice"
+    expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get><filter type=\"xpath\" select=\"/ex:x\" xmlns:ex=\"urn:example:clixon\"/></get></rpc><rpc $DEFAULTNS><get><filter type=\"xpath\" select=\"/ex:x\" xmlns:ex=\"urn:example:clixon\"/></get></rpc>" "" "<rpc-reply $DEFAULTNS><data><x xmlns=\"urn:example:clixon\"><y><a>1</a><b>changed</b></y></x></data></rpc-reply>"
+
+    new "netconf stats state not cached"
+    expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><stats $LIBNS/></rpc>" "" "<get-cache $LIBNS><entries>1</entries><size>[0-9]*</size><hits>2</hits><misses>2</misses></get-cache>"
+
+    # The first request is a miss, the second a hit, each reply has its own message-id
+    rpc=$(chunked_framing "<rpc $DEFAULTONLY message-id=\"1\"><get-config><source><running/></source><filter type=\"xpath\" select=\"/ex:x/ex:y\" xmlns:ex=\"urn:example:clixon\"/></get-config></rpc>")
+    rpc+=$(chunked_framing "<rpc $DEFAULTONLY message-id=\"2\"><get-config><source><running/></source><filter type=\"xpath\" select=\"/ex:x/ex:y\" xmlns:ex=\"urn:example:clixon\"/></get-config></rpc>")
+    new "netconf cached get-config with other message-id"
+    ret=$(echo "$DEFAULTHELLO$rpc" | $clixon_netconf -qef $cfg 2> /dev/null)
+    expectpart "$ret" 0 "<rpc-reply $DEFAULTONLY message-id=\"1\"><data><x xmlns=\"urn:example:clixon\"><y><a>1</a><b>changed</b></y></x></data></rpc-reply>" "<rpc-reply $DEFAULTONLY message-id=\"2\"><data><x xmlns=\"urn:example:clixon\"><y><a>1</a><b>changed</b></y></x></data></rpc-reply>" --not-- "message-id=\"1\" message-id" "message-id=\"2\" message-id"
+
+    new "netconf stats cache hit with other message-id"
+    expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><stats $LIBNS/></rpc>" "" "<get-cache $LIBNS><entries>2</entries><size>[0-9]*</size><hits>3</hits><misses>3</misses></get-cache>"
+
+    if [ $BE -ne 0 ]; then
+        new "Kill backend"
+        # Check if premature kill
+        pid=$(pgrep -u root -f clixon_backend)
+        if [ -z "$pid" ]; then
+            err "backend already dead"
+        fi
+        # kill backend
+        stop_backend -f $cfg
+    fi
+}
+
+for threads in 0 2; do
+    cat <<EOF > $dir/startup_db
+<${DATASTORE_TOP}>
+  <x xmlns="urn:example:clixon">
+    <y><a>1</a><b>one</b></y>
+  </x>
+</${DATASTORE_TOP}>
+EOF
+    testrun $threads
+done
+
+rm -rf $dir
+
+new "endtest"
+endtest
@@ -0,0 +1,154 @@
+#!/usr/bin/env bash
+# Binary encoding of get and get-config replies on the internal socket, see CLICON_IPC_BINARY
+# Check that replies are the same as with XML, including choice, augment, depth and empty data,
+# and with worker threads
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf.xml
+flog=$dir/backend.log
+fyang=$dir/binary.yang
+fyang2=$dir/binary-aug.yang
+
+cat <<EOF > $fyang
+module binary{
+   yang-version 1.1;
+   namespace "urn:example:clixon";
+   prefix ex;
+   container x {
+    list y {
+      key "a";
+      leaf a {
+        type int32;
+      }
+      leaf b {
+        type string;
+      }
+      choice c {
+        case c1 {
+          leaf d {
+            type string;
+          }
+        }
+        case c2 {
+          leaf e {
+            type string;
+          }
+        }
+      }
+    }
+  }
+}
+EOF
+
+cat <<EOF > $fyang2
+module binary-aug{
+   yang-version 1.1;
+   namespace "urn:example:aug";
+   prefix aug;
+   import binary {
+      prefix ex;
+   }
+   augment "/ex:x" {
+      leaf f {
+         type string;
+      }
+   }
+}
+EOF
+
+# Test function
+# Arguments:
+# 1: threads  Number of backend worker threads
+function testrun(){
+    threads=$1
+
+    cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>${YANG_INSTALLDIR}</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_DIR>$dir</CLICON_YANG_MAIN_DIR>
+  <CLICON_SOCK>/usr/local/var/run/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/run/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_BACKEND_WORKER_THREADS>$threads</CLICON_BACKEND_WORKER_THREADS>
+  <CLICON_IPC_BINARY>true</CLICON_IPC_BINARY>
+  <CLICON_XMLDB_DIR>$dir</CLICON_XMLDB_DIR>
+</clixon-config>
+EOF
+
+    new "test params: -f $cfg"
+    if [ $BE -ne 0 ]; then
+        new "kill old backend"
+        sudo clixon_backend -zf $cfg
+        if [ $? -ne 0 ]; then
+            err
+        fi
+        sudo rm -f $flog
+        new "start backend -s startup -f $cfg -D backend -l f$flog"
+        start_backend -s startup -f $cfg -D backend -l f$flog
+    fi
+
+    new "wait backend"
+    wait_backend
+
+    new "netconf get-config all with $threads threads"
+    expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get-config><source><running/></source></get-config></rpc>" "" "<rpc-reply $DEFAULTNS><data><x xmlns=\"urn:example:clixon\"><y><a>1</a><b>one</b><d>choice</d></y><y><a>2</a><b>two</b><e>other</e></y><f xmlns=\"urn:example:aug\">aug</f></x></data></rpc-reply>"
+
+    if [ $BE -ne 0 ]; then
+        new "binary encoding negotiated in hello"
+        if ! sudo grep -q "[1-9][0-9]* modules with binary encoding" $flog; then
+            err "[1-9][0-9]* modules with binary encoding" "$(sudo grep "modules with binary encoding" $flog)"
+        fi
+    fi
+
+    new "netconf get single entry"
+    expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get><filter type=\"xpath\" select=\"/ex:x/ex:y[ex:a='2']\" xmlns:ex=\"urn:example:clixon\"/></get></rpc>" "" "<rpc-reply $DEFAULTNS><data><x xmlns=\"urn:example:clixon\"><y><a>2</a><b>two</b><e>other</e></y></x></data></rpc-reply>"
+
+    new "netconf get-config depth"
+    expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get-config depth=\"2\"><source><running/></source></get-config></rpc>" "" "<rpc-reply $DEFAULTNS><data><x xmlns=\"urn:example:clixon\"><y/><y/><f xmlns=\"urn:example:aug\"/></x></data></rpc-reply>"
+
+    new "netconf get-config no match"
+    expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get-config><source><running/></source><filter type=\"xpath\" select=\"/ex:x/ex:y[ex:a='3']\" xmlns:ex=\"urn:example:clixon\"/></get-config></rpc>" "" "<rpc-reply $DEFAULTNS><data/></rpc-reply>"
+
+    new "netconf edit-config"
+    expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><x xmlns=\"urn:example:clixon\"><y><a>3</a><b>three</b></y></x></config></edit-config></rpc>" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+    new "netconf get-config candidate new entry"
+    expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get-config><source><candidate/></source><filter type=\"xpath\" select=\"/ex:x/ex:y[ex:a='3']\" xmlns:ex=\"urn:example:clixon\"/></get-config></rpc>" "" "<rpc-reply $DEFAULTNS><data><x xmlns=\"urn:example:clixon\"><y><a>3</a><b>three</b></y></x></data></rpc-reply>"
+
+    new "netconf discard-changes"
+    expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><discard-changes/></rpc>" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+    if [ $BE -ne 0 ]; then
+        new "Kill backend"
+        # Check if premature kill
+        pid=$(pgrep -u root -f clixon_backend)
+        if [ -z "$pid" ]; then
+            err "backend already dead"
+        fi
+        # kill backend
+        stop_backend -f $cfg
+    fi
+}
+
+cat <<EOF > $dir/startup_db
+<${DATASTORE_TOP}>
+  <x xmlns="urn:example:clixon">
+    <y><a>1</a><b>one</b><d>choice</d></y>
+    <y><a>2</a><b>two</b><e>other</e></y>
+    <f xmlns="urn:example:aug">aug</f>
+  </x>
+</${DATASTORE_TOP}>
+EOF
+
+for threads in 0 2; do
+    testrun $threads
+done
+
+rm -rf $dir
+
+new "endtest"
+endtest
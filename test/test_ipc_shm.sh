@@ -0,0 +1,116 @@
+#!/usr/bin/env bash
+# Large backend replies in shared memory, see CLICON_IPC_SHM_THRESHOLD
+# Check that replies above the threshold are the same as through the socket, with XML and
+# binary encoding, and that small replies and edits still work
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf.xml
+fyang=$dir/shm.yang
+
+# Number of list entries
+: ${nr:=1000}
+
+cat <<EOF > $fyang
+module shm{
+   yang-version 1.1;
+   namespace "urn:example:clixon";
+   prefix ex;
+   container x {
+    list y {
+      key "a";
+      leaf a {
+        type int32;
+      }
+      leaf b {
+        type string;
+      }
+    }
+  }
+}
+EOF
+
+# Test function
+# Arguments:
+# 1: binary  CLICON_IPC_BINARY
+function testrun(){
+    binary=$1
+
+    cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>${YANG_INSTALLDIR}</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/run/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/run/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_IPC_SHM_THRESHOLD>4096</CLICON_IPC_SHM_THRESHOLD>
+  <CLICON_IPC_BINARY>$binary</CLICON_IPC_BINARY>
+  <CLICON_XMLDB_DIR>$dir</CLICON_XMLDB_DIR>
+</clixon-config>
+EOF
+
+    new "test params: -f $cfg"
+    if [ $BE -ne 0 ]; then
+        new "kill old backend"
+        sudo clixon_backend -zf $cfg
+        if [ $? -ne 0 ]; then
+            err
+        fi
+        new "start backend -s startup -f $cfg"
+        start_backend -s startup -f $cfg
+    fi
+
+    new "wait backend"
+    wait_backend
+
+    new "netconf get-config whole list binary:$binary"
+    ret=$(echo "$DEFAULTHELLO$(chunked_framing "<rpc $DEFAULTNS><get-config><source><running/></source></get-config></rpc>")" | $clixon_netconf -qef $cfg)
+    expectpart "$ret" 0 "<rpc-reply $DEFAULTNS><data><x xmlns=\"urn:example:clixon\"><y><a>0</a><b>0</b></y>" "<y><a>$((nr-1))</a><b>$((nr-1))</b></y></x></data></rpc-reply>"
+
+    new "netconf get whole list"
+    ret=$(echo "$DEFAULTHELLO$(chunked_framing "<rpc $DEFAULTNS><get><filter type=\"xpath\" select=\"/ex:x\" xmlns:ex=\"urn:example:clixon\"/></get></rpc>")" | $clixon_netconf -qef $cfg)
+    expectpart "$ret" 0 "<rpc-reply $DEFAULTNS><data><x xmlns=\"urn:example:clixon\"><y><a>0</a><b>0</b></y>" "<y><a>$((nr-1))</a><b>$((nr-1))</b></y></x></data></rpc-reply>"
+
+    new "netconf get-config single entry (below threshold)"
+    expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get-config><source><running/></source><filter type=\"xpath\" select=\"/ex:x/ex:y[ex:a='42']\" xmlns:ex=\"urn:example:clixon\"/></get-config></rpc>" "" "<rpc-reply $DEFAULTNS><data><x xmlns=\"urn:example:clixon\"><y><a>42</a><b>42</b></y></x></data></rpc-reply>"
+
+    new "netconf edit-config"
+    expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><x xmlns=\"urn:example:clixon\"><y><a>$nr</a><b>new</b></y></x></config></edit-config></rpc>" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+    new "netconf get-config candidate whole list"
+    ret=$(echo "$DEFAULTHELLO$(chunked_framing "<rpc $DEFAULTNS><get-config><source><candidate/></source></get-config></rpc>")" | $clixon_netconf -qef $cfg)
+    expectpart "$ret" 0 "<y><a>$((nr-1))</a><b>$((nr-1))</b></y><y><a>$nr</a><b>new</b></y></x></data></rpc-reply>"
+
+    new "netconf discard-changes"
+    expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><discard-changes/></rpc>" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+    if [ $BE -ne 0 ]; then
+        new "Kill backend"
+        # Check if premature kill
+        pid=$(pgrep -u root -f clixon_backend)
+        if [ -z "$pid" ]; then
+            err "backend already dead"
+        fi
+        # kill backend
+        stop_backend -f $cfg
+    fi
+}
+
+new "generate startup with $nr list entries"
+echo -n "<${DATASTORE_TOP}><x xmlns=\"urn:example:clixon\">" > $dir/startup_db
+for (( i=0; i<$nr; i++ )); do
+    echo -n "<y><a>$i</a><b>$i</b></y>" >> $dir/startup_db
+done
+echo "</x></${DATASTORE_TOP}>" >> $dir/startup_db
+
+for binary in false true; do
+    testrun $binary
+done
+
+rm -rf $dir
+
+new "endtest"
+endtest
@@ -0,0 +1,163 @@
+#!/usr/bin/env bash
+# Netconf stream subscriptions with slow subscribers
+# A subscriber of the ON-CHANGE stream does not read notifications while $nr commits are
+# made, each with a large config change. When output to the subscriber is pending, the
+# backend queues its notifications in a bounded queue, see CLICON_STREAM_QUEUE_MAX and
+# CLICON_STREAM_QUEUE_POLICY:
+# - drop-oldest: the notifications of the last commits are kept
+# - drop-newest: the notifications of the last commits are dropped
+# - terminate: the subscriber gets a subscription-terminated notification
+# Queue length and drops of each subscription are in the streams state of its user
+# @see test_netconf_notifications.sh
+# @see test_netconf_onchange.sh
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+# Number of commits
+nr=200
+
+# Max events in queue of subscription
+qmax=10
+
+cfg=$dir/conf.xml
+fyang=$dir/example.yang
+fout=$dir/notifications.xml
+fgo=$dir/go
+fdone=$dir/done
+
+# Large value, so that socket buffers fill up after a few notifications
+pad=$(printf "%08000d" 0)
+
+cat <<EOF > $fyang
+module example {
+   namespace "urn:example:clixon";
+   prefix ex;
+   container z {
+      leaf c {
+         type string;
+      }
+   }
+}
+EOF
+
+# Edit and commit in one session
+rpcs=""
+for (( i=1; i<=$nr; i++ )); do
+    rpcs+=$(chunked_framing "<rpc $DEFAULTONLY message-id=\"e$i\"><edit-config><target><candidate/></target><config><z xmlns=\"urn:example:clixon\"><c>v$i-$pad</c></z></config></edit-config></rpc>")
+    rpcs+=$(chunked_framing "<rpc $DEFAULTONLY message-id=\"c$i\"><commit/></rpc>")
+done
+
+# Start backend with queue policy and a subscriber that does not read until $fgo exists,
+# and that closes its session when $fdone exists
+# 1: queue policy
+function testrun()
+{
+    policy=$1
+
+    cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>${YANG_INSTALLDIR}</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/run/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/run/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>$dir</CLICON_XMLDB_DIR>
+  <CLICON_NACM_CREDENTIALS>none</CLICON_NACM_CREDENTIALS>
+  <CLICON_STREAM_DISCOVERY_RFC5277>true</CLICON_STREAM_DISCOVERY_RFC5277>
+  <CLICON_STREAM_ON_CHANGE>true</CLICON_STREAM_ON_CHANGE>
+  <CLICON_STREAM_QUEUE_MAX>$qmax</CLICON_STREAM_QUEUE_MAX>
+  <CLICON_STREAM_QUEUE_POLICY>$policy</CLICON_STREAM_QUEUE_POLICY>
+</clixon-config>
+EOF
+
+    new "test params: -f $cfg"
+    if [ $BE -ne 0 ]; then
+        new "kill old backend"
+        sudo clixon_backend -zf $cfg
+        if [ $? -ne 0 ]; then
+            err
+        fi
+        new "start backend -s init -f $cfg"
+        start_backend -s init -f $cfg
+    fi
+
+    new "wait backend"
+    wait_backend
+
+    rm -f $fgo $fdone $fout
+    new "$policy: start subscriber that does not read notifications"
+    rpc=$(chunked_framing "<rpc $DEFAULTNS><create-subscription xmlns=\"urn:ietf:params:xml:ns:netmod:notification\"><stream>ON-CHANGE</stream></create-subscription></rpc>")
+    (echo "$DEFAULTHELLO$rpc"; while [ ! -f $fdone ]; do sleep 0.1; done) | $clixon_netconf -qef $cfg 2> /dev/null | (while [ ! -f $fgo ]; do sleep 0.1; done; cat > $fout) &
+    pid=$!
+    sleep 2
+
+    new "$policy: $nr commits"
+    ret=$(echo "$DEFAULTHELLO$rpcs" | $clixon_netconf -qef $cfg 2> /dev/null | grep -o "<ok/>" | wc -l)
+    if [ $ret -ne $((2*nr)) ]; then
+        err "$((2*nr)) ok" "$ret"
+    fi
+
+    if [ $policy = terminate ]; then
+        new "$policy: subscription is terminated"
+        expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get><filter type=\"xpath\" select=\"n:netconf/n:streams\" xmlns:n=\"urn:ietf:params:xml:ns:netmod:notification\"/></get></rpc>" "" "<stream><name>ON-CHANGE</name><description>Config changes of running</description><replay-support>false</replay-support></stream>" --not-- "<subscription>"
+    else
+        new "$policy: subscription queue is full and events are dropped"
+        expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get><filter type=\"xpath\" select=\"n:netconf/n:streams\" xmlns:n=\"urn:ietf:params:xml:ns:netmod:notification\"/></get></rpc>" "" "<stream><name>ON-CHANGE</name><description>Config changes of running</description><replay-support>false</replay-support><subscription><id>[0-9]*</id><queue>$qmax</queue><drops>[1-9][0-9]*</drops></subscription></stream>"
+
+        new "$policy: subscription is not visible to other user"
+        expecteof_netconf "$clixon_netconf -qf $cfg -U wilma" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get><filter type=\"xpath\" select=\"n:netconf/n:streams\" xmlns:n=\"urn:ietf:params:xml:ns:netmod:notification\"/></get></rpc>" "" "<stream><name>ON-CHANGE</name>" --not-- "<subscription>"
+    fi
+
+    # Subscriber reads all notifications
+    touch $fgo
+    sleep 3
+    touch $fdone
+    wait $pid
+
+    new "$policy: notification of first commit is received"
+    expectpart "$(cat $fout)" 0 "<c>v1-"
+
+    nrnotify=$(grep -o "<on-change " $fout | wc -l)
+    new "$policy: notifications of some commits are dropped"
+    if [ $nrnotify -ge $nr ]; then
+        err "less than $nr notifications" "$nrnotify"
+    fi
+
+    case $policy in
+        drop-oldest)
+            new "$policy: notification of last commit is received"
+            expectpart "$(cat $fout)" 0 "<c>v$nr-"
+            ;;
+        drop-newest)
+            new "$policy: notification of last commit is dropped"
+            expectpart "$(cat $fout)" 0 --not-- "<c>v$nr-"
+            ;;
+        terminate)
+            new "$policy: subscriber gets subscription-terminated"
+            expectpart "$(cat $fout)" 0 "<subscription-terminated xmlns=\"http://clicon.org/lib\"><stream>ON-CHANGE</stream><id>[0-9]*</id><reason>queue-full</reason></subscription-terminated>" --not-- "<c>v$nr-"
+            ;;
+    esac
+
+    if [ $BE -ne 0 ]; then
+        new "Kill backend"
+        # Check if premature kill
+        pid=$(pgrep -u root -f clixon_backend)
+        if [ -z "$pid" ]; then
+            err "backend already dead"
+        fi
+        # kill backend
+        stop_backend -f $cfg
+    fi
+}
+
+for policy in drop-oldest drop-newest terminate; do
+    testrun $policy
+done
+
+rm -rf $dir
+
+new "endtest"
+endtest
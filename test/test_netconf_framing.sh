@@ -97,6 +97,34 @@ EOF
 new "Netconf 1.1 multi-chunked framing"
 expecteof_netconf "$clixon_netconf -qef $cfg -o CLICON_NETCONF_BASE_CAPABILITY=1" 0 "$rpc" "" "" "<rpc-reply $DEFAULTNS><data><table xmlns=\"urn:example:clixon\"><parameter><name>a</name></parameter></table></data></rpc-reply>"
 
+# Input split across reads in the end-of-message marker, in chunk headers and in chunk
+# data, and several messages in one read
+rpc1="<rpc $DEFAULTONLY message-id=\"1\"><get-config><source><candidate/></source></get-config></rpc>"
+rpc2="<rpc $DEFAULTONLY message-id=\"2\"><get-config><source><candidate/></source></get-config></rpc>"
+data="<data><table xmlns=\"urn:example:clixon\"><parameter><name>a</name></parameter></table></data>"
+reply1="<rpc-reply $DEFAULTONLY message-id=\"1\">$data</rpc-reply>"
+reply2="<rpc-reply $DEFAULTONLY message-id=\"2\">$data</rpc-reply>"
+hello10="<?xml version=\"1.0\" encoding=\"UTF-8\"?><hello $DEFAULTNS><capabilities><capability>urn:ietf:params:netconf:base:1.0</capability></capabilities></hello>]]>]]>"
+hello11="<?xml version=\"1.0\" encoding=\"UTF-8\"?><hello $DEFAULTNS><capabilities><capability>urn:ietf:params:netconf:base:1.1</capability></capabilities></hello>]]>]]>"
+len1=${#rpc1}
+len2=${#rpc2}
+
+new "Netconf 1.0 eom framing, end marker split across reads"
+ret=$({ printf "%s" "$hello10$rpc1]]>"; sleep 0.5; printf "%s" "]]>$rpc2]]"; sleep 0.5; printf "%s" ">]]>"; } | $clixon_netconf -qef $cfg -o CLICON_NETCONF_BASE_CAPABILITY=0 2> /dev/null)
+expectpart "$ret" 0 "$reply1]]>]]>$reply2]]>]]>"
+
+new "Netconf 1.0 eom framing, several messages in one read"
+ret=$(printf "%s" "$hello10$rpc1]]>]]>$rpc2]]>]]>" | $clixon_netconf -qef $cfg -o CLICON_NETCONF_BASE_CAPABILITY=0 2> /dev/null)
+expectpart "$ret" 0 "$reply1]]>]]>$reply2]]>]]>"
+
+new "Netconf 1.1 chunked framing, chunk header and data split across reads"
+ret=$({ printf "%s\n#%s" "$hello11" "${len1:0:1}"; sleep 0.5; printf "%s\n%s" "${len1:1}" "${rpc1:0:20}"; sleep 0.5; printf "%s\n#" "${rpc1:20}"; sleep 0.5; printf "#\n"; } | $clixon_netconf -qef $cfg -o CLICON_NETCONF_BASE_CAPABILITY=1 2> /dev/null)
+expectpart "$ret" 0 "$reply1"
+
+new "Netconf 1.1 chunked framing, several messages in one read"
+ret=$(printf "%s\n#%d\n%s\n##\n\n#%d\n%s\n##\n" "$hello11" $len1 "$rpc1" $len2 "$rpc2" | $clixon_netconf -qef $cfg -o CLICON_NETCONF_BASE_CAPABILITY=1 2> /dev/null)
+expectpart "$ret" 0 "$reply1" "$reply2"
+
 if [ $BE -ne 0 ]; then
     new "Kill backend"
     # Check if premature kill
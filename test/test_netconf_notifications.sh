@@ -127,6 +127,18 @@ expectwait "$clixon_netconf -D $DBG -qef $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTN
 new "netconf EXAMPLE subscription with filter classifier"
 expectwait "$clixon_netconf -D $DBG -qef $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><create-subscription xmlns=\"urn:ietf:params:xml:ns:netmod:notification\"><stream>EXAMPLE</stream><filter type=\"xpath\" select=\"event[event-class='fault']\"/></create-subscription></rpc>" $NCWAIT "<rpc-reply $DEFAULTNS><ok/></rpc-reply>" "<notification xmlns=\"urn:ietf:params:xml:ns:netconf:notification:1.0\"><eventTime>20" 
 
+new "netconf EXAMPLE subscription with filter on other event element"
+rpc=$(chunked_framing "<rpc $DEFAULTNS><create-subscription xmlns=\"urn:ietf:params:xml:ns:netmod:notification\"><stream>EXAMPLE</stream><filter type=\"xpath\" select=\"other[event-class='fault']\"/></create-subscription></rpc>")
+ret=$( (echo "$DEFAULTHELLO$rpc"; sleep $NCWAIT) | $clixon_netconf -D $DBG -qef $cfg 2> /dev/null)
+match=$(echo "$ret" | grep --null -o "<rpc-reply $DEFAULTNS><ok/></rpc-reply>")
+if [ -z "$match" ]; then
+    err "<rpc-reply $DEFAULTNS><ok/></rpc-reply>" "$ret"
+fi
+match=$(echo "$ret" | grep --null -o "<notification")
+if [ -n "$match" ]; then
+    err "No notification" "$ret"
+fi
+
 new "netconf NONEXIST subscription"
 expectwait "$clixon_netconf -D $DBG -qef $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><create-subscription xmlns=\"urn:ietf:params:xml:ns:netmod:notification\"><stream>NONEXIST</stream></create-subscription></rpc>" $NCWAIT "<rpc-reply $DEFAULTNS><rpc-error><error-type>application</error-type><error-tag>invalid-value</error-tag><error-severity>error</error-severity><error-message>No such stream</error-message></rpc-error></rpc-reply>"
 
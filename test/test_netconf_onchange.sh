@@ -0,0 +1,198 @@
+#!/usr/bin/env bash
+# On-change subscriptions of config changes, see CLICON_STREAM_ON_CHANGE
+# Subscribers of the ON-CHANGE stream get a notification after each commit with the
+# created, deleted and updated config nodes selected by their filter
+# A limited NACM user only gets the nodes it may read
+# @see test_netconf_notifications.sh
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+# Common NACM scripts
+. ./nacm.sh
+
+cfg=$dir/conf.xml
+fyang=$dir/example.yang
+fall=$dir/all.xml
+fone=$dir/one.xml
+flimited=$dir/limited.xml
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>${YANG_INSTALLDIR}</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/run/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/run/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>$dir</CLICON_XMLDB_DIR>
+  <CLICON_STREAM_DISCOVERY_RFC5277>true</CLICON_STREAM_DISCOVERY_RFC5277>
+  <CLICON_STREAM_ON_CHANGE>true</CLICON_STREAM_ON_CHANGE>
+  <CLICON_NACM_MODE>internal</CLICON_NACM_MODE>
+  <CLICON_NACM_CREDENTIALS>none</CLICON_NACM_CREDENTIALS>
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module example {
+   namespace "urn:example:clixon";
+   prefix ex;
+   import ietf-netconf-acm {
+      prefix nacm;
+   }
+   container x {
+      list y {
+         key a;
+         leaf a {
+            type int32;
+         }
+         leaf b {
+            type int32;
+         }
+      }
+   }
+   container z {
+      leaf c {
+         type string;
+      }
+   }
+}
+EOF
+
+# Limited group may not read z
+cat <<EOF > $dir/startup_db
+<${DATASTORE_TOP}>
+   <nacm xmlns="urn:ietf:params:xml:ns:yang:ietf-netconf-acm">
+     <enable-nacm>true</enable-nacm>
+     <read-default>permit</read-default>
+     <write-default>permit</write-default>
+     <exec-default>permit</exec-default>
+     $NGROUPS
+     <rule-list>
+       <name>limited-acl</name>
+       <group>limited</group>
+       <rule>
+         <name>deny-read-z</name>
+         <module-name>example</module-name>
+         <path xmlns:ex="urn:example:clixon">/ex:z</path>
+         <access-operations>read</access-operations>
+         <action>deny</action>
+       </rule>
+     </rule-list>
+     $NADMIN
+   </nacm>
+</${DATASTORE_TOP}>
+EOF
+
+# Edit candidate and commit
+# 1: config
+function editcommit()
+{
+    config=$1
+
+    new "edit-config"
+    expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config>$config</config></edit-config></rpc>" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+    new "commit"
+    expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><commit/></rpc>" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+}
+
+# Check notifications received by subscriber
+# 1: file
+# 2: expected number of notifications
+# 3: expected notification(s), in order
+function checknotify()
+{
+    file=$1
+    nr=$2
+    expect=$3
+
+    ret=$(grep -o "<notification " $file | wc -l)
+    if [ $ret -ne $nr ]; then
+        err "$nr notifications" "$ret"
+    fi
+    # Remove eventTime and chunked framing
+    ret=$(sed -e 's/<eventTime>[^<]*<\/eventTime>//g' $file | tr -d '\n' | sed -e 's/#[0-9]*//g')
+    match=$(echo "$ret" | grep --null -o "$expect")
+    if [ -z "$match" ]; then
+        err "$expect" "$ret"
+    fi
+}
+
+new "test params: -f $cfg"
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+        err
+    fi
+    new "start backend -s startup -f $cfg"
+    start_backend -s startup -f $cfg
+fi
+
+new "wait backend"
+wait_backend
+
+new "ON-CHANGE stream"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get><filter type=\"xpath\" select=\"n:netconf/n:streams\" xmlns:n=\"urn:ietf:params:xml:ns:netmod:notification\"/></get></rpc>" "" "<rpc-reply $DEFAULTNS><data><netconf xmlns=\"urn:ietf:params:xml:ns:netmod:notification\"><streams><stream><name>ON-CHANGE</name><description>Config changes of running</description><replay-support>false</replay-support></stream></streams></netconf></data></rpc-reply>"
+
+new "Invalid on-change filter"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><create-subscription xmlns=\"urn:ietf:params:xml:ns:netmod:notification\"><stream>ON-CHANGE</stream><filter type=\"xpath\" select=\"/xx:x\"/></create-subscription></rpc>" "" "<rpc-reply $DEFAULTNS><rpc-error><error-type>application</error-type><error-tag>bad-attribute</error-tag>"
+
+new "Subscribe to all changes"
+rpc=$(chunked_framing "<rpc $DEFAULTNS><create-subscription xmlns=\"urn:ietf:params:xml:ns:netmod:notification\"><stream>ON-CHANGE</stream></create-subscription></rpc>")
+(echo "$DEFAULTHELLO$rpc"; sleep 15) | $clixon_netconf -qef $cfg > $fall 2> /dev/null &
+
+new "Subscribe to changes of one list entry"
+rpc=$(chunked_framing "<rpc $DEFAULTNS><create-subscription xmlns=\"urn:ietf:params:xml:ns:netmod:notification\"><stream>ON-CHANGE</stream><filter type=\"xpath\" select=\"/ex:x/ex:y[ex:a='1']\" xmlns:ex=\"urn:example:clixon\"/></create-subscription></rpc>")
+(echo "$DEFAULTHELLO$rpc"; sleep 15) | $clixon_netconf -qef $cfg > $fone 2> /dev/null &
+
+new "Limited user subscribes to all changes"
+rpc=$(chunked_framing "<rpc $DEFAULTNS><create-subscription xmlns=\"urn:ietf:params:xml:ns:netmod:notification\"><stream>ON-CHANGE</stream></create-subscription></rpc>")
+(echo "$DEFAULTHELLO$rpc"; sleep 15) | $clixon_netconf -qef $cfg -U wilma > $flimited 2> /dev/null &
+sleep 2
+
+new "Create list entries"
+editcommit "<x xmlns=\"urn:example:clixon\"><y><a>1</a><b>1</b></y><y><a>2</a><b>2</b></y></x><z xmlns=\"urn:example:clixon\"><c>foo</c></z>"
+
+new "Update list entries"
+editcommit "<x xmlns=\"urn:example:clixon\"><y><a>1</a><b>11</b></y><y><a>2</a><b>22</b></y></x>"
+
+new "Update other container"
+editcommit "<z xmlns=\"urn:example:clixon\"><c>bar</c></z>"
+
+new "Delete list entry"
+editcommit "<x xmlns=\"urn:example:clixon\" xmlns:nc=\"${BASENS}\"><y nc:operation=\"delete\"><a>1</a></y></x>"
+
+sleep 2
+kill $(jobs -p) 2> /dev/null
+wait 2> /dev/null
+
+new "Subscriber of all changes"
+checknotify $fall 4 "<notification xmlns=\"urn:ietf:params:xml:ns:netconf:notification:1.0\"><on-change xmlns=\"http://clicon.org/lib\"><created><x xmlns=\"urn:example:clixon\"><y><a>1</a><b>1</b></y><y><a>2</a><b>2</b></y></x><z xmlns=\"urn:example:clixon\"><c>foo</c></z></created></on-change></notification>.*<on-change xmlns=\"http://clicon.org/lib\"><updated><x xmlns=\"urn:example:clixon\"><y><a>1</a><b>11</b></y><y><a>2</a><b>22</b></y></x></updated></on-change>.*<on-change xmlns=\"http://clicon.org/lib\"><updated><z xmlns=\"urn:example:clixon\"><c>bar</c></z></updated></on-change>.*<on-change xmlns=\"http://clicon.org/lib\"><deleted><x xmlns=\"urn:example:clixon\"><y><a>1</a></y></x></deleted></on-change>"
+
+new "Subscriber of one list entry"
+checknotify $fone 3 "<notification xmlns=\"urn:ietf:params:xml:ns:netconf:notification:1.0\"><on-change xmlns=\"http://clicon.org/lib\"><created><x xmlns=\"urn:example:clixon\"><y><a>1</a><b>1</b></y></x></created></on-change></notification>.*<on-change xmlns=\"http://clicon.org/lib\"><updated><x xmlns=\"urn:example:clixon\"><y><a>1</a><b>11</b></y></x></updated></on-change>.*<on-change xmlns=\"http://clicon.org/lib\"><deleted><x xmlns=\"urn:example:clixon\"><y><a>1</a></y></x></deleted></on-change>"
+
+new "Limited subscriber does not get changes of z"
+checknotify $flimited 3 "<notification xmlns=\"urn:ietf:params:xml:ns:netconf:notification:1.0\"><on-change xmlns=\"http://clicon.org/lib\"><created><x xmlns=\"urn:example:clixon\"><y><a>1</a><b>1</b></y><y><a>2</a><b>2</b></y></x></created></on-change></notification>.*<on-change xmlns=\"http://clicon.org/lib\"><updated><x xmlns=\"urn:example:clixon\"><y><a>1</a><b>11</b></y><y><a>2</a><b>22</b></y></x></updated></on-change>.*<on-change xmlns=\"http://clicon.org/lib\"><deleted><x xmlns=\"urn:example:clixon\"><y><a>1</a></y></x></deleted></on-change>"
+
+new "Limited subscriber no z"
+expectpart "$(cat $flimited)" 0 --not-- "<z xmlns"
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+        err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
+
+new "endtest"
+endtest
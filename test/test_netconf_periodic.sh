@@ -0,0 +1,195 @@
+#!/usr/bin/env bash
+# Periodic subscriptions of state data, see CLICON_STREAM_PERIODIC
+# Subscribers of the PERIODIC stream get a notification every period with the state
+# data selected by their filter
+# A limited NACM user only gets the state data it may read
+# State data is sampled once per tick for all subscribers
+# Use main example -- -sS option to add state via a file, and -c to log state callbacks
+# @see test_netconf_onchange.sh
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+# Common NACM scripts
+. ./nacm.sh
+
+cfg=$dir/conf.xml
+fyang=$dir/example.yang
+fstate=$dir/state.xml
+fone=$dir/one.xml
+fall=$dir/all.xml
+flimited=$dir/limited.xml
+flog=$dir/backend.log
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>${YANG_INSTALLDIR}</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/run/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_DIR>/usr/local/lib/$APPNAME/backend</CLICON_BACKEND_DIR>
+  <CLICON_BACKEND_REGEXP>example_backend.so$</CLICON_BACKEND_REGEXP>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/run/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>$dir</CLICON_XMLDB_DIR>
+  <CLICON_STREAM_DISCOVERY_RFC5277>true</CLICON_STREAM_DISCOVERY_RFC5277>
+  <CLICON_STREAM_PERIODIC>true</CLICON_STREAM_PERIODIC>
+  <CLICON_NACM_MODE>internal</CLICON_NACM_MODE>
+  <CLICON_NACM_CREDENTIALS>none</CLICON_NACM_CREDENTIALS>
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module example {
+   namespace "urn:example:clixon";
+   prefix ex;
+   import ietf-netconf-acm {
+      prefix nacm;
+   }
+   container sx {
+      config false;
+      list sy {
+         key k;
+         leaf k {
+            type int32;
+         }
+         leaf v {
+            type int32;
+         }
+      }
+   }
+}
+EOF
+
+cat <<EOF > $fstate
+<sx xmlns="urn:example:clixon"><sy><k>1</k><v>10</v></sy><sy><k>2</k><v>20</v></sy></sx>
+EOF
+
+# Limited group may not read v
+cat <<EOF > $dir/startup_db
+<${DATASTORE_TOP}>
+   <nacm xmlns="urn:ietf:params:xml:ns:yang:ietf-netconf-acm">
+     <enable-nacm>true</enable-nacm>
+     <read-default>permit</read-default>
+     <write-default>deny</write-default>
+     <exec-default>permit</exec-default>
+     $NGROUPS
+     <rule-list>
+       <name>limited-acl</name>
+       <group>limited</group>
+       <rule>
+         <name>deny-read-v</name>
+         <module-name>example</module-name>
+         <path xmlns:ex="urn:example:clixon">/ex:sx/ex:sy/ex:v</path>
+         <access-operations>read</access-operations>
+         <action>deny</action>
+       </rule>
+     </rule-list>
+     $NADMIN
+   </nacm>
+</${DATASTORE_TOP}>
+EOF
+
+new "test params: -f $cfg"
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+        err
+    fi
+    new "start backend -s startup -f $cfg -l f$flog -- -sS $fstate -c"
+    start_backend -s startup -f $cfg -l f$flog -- -sS $fstate -c
+fi
+
+new "wait backend"
+wait_backend
+
+new "Periodic subscription without period"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><create-subscription xmlns=\"urn:ietf:params:xml:ns:netmod:notification\"><stream>PERIODIC</stream></create-subscription></rpc>" "" "<rpc-reply $DEFAULTNS><rpc-error><error-type>application</error-type><error-tag>missing-element</error-tag><error-info><bad-element>period</bad-element></error-info>"
+
+calls0=$(grep -c "example_statefile: call" $flog 2> /dev/null)
+
+new "Subscribe to one list entry every second"
+rpc=$(chunked_framing "<rpc $DEFAULTNS><create-subscription xmlns=\"urn:ietf:params:xml:ns:netmod:notification\"><stream>PERIODIC</stream><filter type=\"xpath\" select=\"/ex:sx/ex:sy[ex:k='1']\" xmlns:ex=\"urn:example:clixon\"/><period>100</period></create-subscription></rpc>")
+(echo "$DEFAULTHELLO$rpc"; sleep 10) | $clixon_netconf -qef $cfg > $fone 2> /dev/null &
+
+new "Subscribe to all state data every other second"
+rpc=$(chunked_framing "<rpc $DEFAULTNS><create-subscription xmlns=\"urn:ietf:params:xml:ns:netmod:notification\"><stream>PERIODIC</stream><period>200</period></create-subscription></rpc>")
+(echo "$DEFAULTHELLO$rpc"; sleep 10) | $clixon_netconf -qef $cfg > $fall 2> /dev/null &
+
+new "Limited user subscribes to all state data every other second"
+(echo "$DEFAULTHELLO$rpc"; sleep 10) | $clixon_netconf -qef $cfg -U wilma > $flimited 2> /dev/null &
+sleep 4
+
+new "Change state data"
+cat <<EOF > $fstate
+<sx xmlns="urn:example:clixon"><sy><k>1</k><v>11</v></sy><sy><k>2</k><v>21</v></sy></sx>
+EOF
+sleep 4
+
+kill $(jobs -p) 2> /dev/null
+wait 2> /dev/null
+calls1=$(grep -c "example_statefile: call" $flog 2> /dev/null)
+
+new "Subscriber of one list entry"
+nr1=$(grep -o "<notification " $fone | wc -l)
+if [ $nr1 -lt 6 ]; then
+    err "At least 6 notifications" "$nr1"
+fi
+ret=$(tr -d '\n' < $fone | sed -e 's/#[0-9]*//g')
+match=$(echo "$ret" | grep --null -o "<periodic xmlns=\"http://clicon.org/lib\"><data><sx xmlns=\"urn:example:clixon\"><sy><k>1</k><v>10</v></sy></sx></data></periodic>.*<periodic xmlns=\"http://clicon.org/lib\"><data><sx xmlns=\"urn:example:clixon\"><sy><k>1</k><v>11</v></sy></sx></data></periodic>")
+if [ -z "$match" ]; then
+    err "periodic notification of list entry 1" "$ret"
+fi
+
+new "Subscriber of all state data"
+nr2=$(grep -o "<notification " $fall | wc -l)
+if [ $nr2 -lt 3 -o $nr2 -ge $nr1 ]; then
+    err "At least 3 and less than $nr1 notifications" "$nr2"
+fi
+ret=$(tr -d '\n' < $fall | sed -e 's/#[0-9]*//g')
+match=$(echo "$ret" | grep --null -o "<periodic xmlns=\"http://clicon.org/lib\"><data><sx xmlns=\"urn:example:clixon\"><sy><k>1</k><v>11</v></sy><sy><k>2</k><v>21</v></sy></sx></data></periodic>")
+if [ -z "$match" ]; then
+    err "periodic notification of all state data" "$ret"
+fi
+
+new "Limited subscriber of all state data"
+nr3=$(grep -o "<notification " $flimited | wc -l)
+if [ $nr3 -lt 3 ]; then
+    err "At least 3 notifications" "$nr3"
+fi
+ret=$(tr -d '\n' < $flimited | sed -e 's/#[0-9]*//g')
+match=$(echo "$ret" | grep --null -o "<periodic xmlns=\"http://clicon.org/lib\"><data><sx xmlns=\"urn:example:clixon\"><sy><k>1</k></sy><sy><k>2</k></sy></sx></data></periodic>")
+if [ -z "$match" ]; then
+    err "periodic notification without v" "$ret"
+fi
+
+new "Limited subscriber no v"
+expectpart "$ret" 0 --not-- "<v>"
+
+# The subscriber of one list entry is due on every tick, the others on every other tick
+# One more call is allowed for a tick whose notification was not read before kill
+if [ $BE -ne 0 ]; then
+    new "One state callback per tick for all subscribers"
+    calls=$((calls1-calls0))
+    if [ $calls -lt $nr1 -o $calls -gt $((nr1+1)) ]; then
+        err "$nr1 state callbacks" "$calls"
+    fi
+fi
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+        err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
+
+new "endtest"
+endtest
@@ -0,0 +1,117 @@
+#!/usr/bin/env bash
+# Netconf RFC5277 stream replay from the replay log
+# The example backend sends an event every 5s on the EXAMPLE stream.
+# With CLICON_STREAM_REPLAY_DIR the replay log is written to segment files and
+# replay survives a backend restart
+# @see test_netconf_notifications.sh
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+NCWAIT=10 # Wait (netconf valgrind may need more time)
+
+cfg=$dir/conf.xml
+fyang=$dir/example.yang
+replaydir=$dir/replay
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>${YANG_INSTALLDIR}</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/run/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_DIR>/usr/local/lib/$APPNAME/backend</CLICON_BACKEND_DIR>
+  <CLICON_BACKEND_REGEXP>example_backend.so$</CLICON_BACKEND_REGEXP>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/run/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+  <CLICON_STREAM_DISCOVERY_RFC5277>true</CLICON_STREAM_DISCOVERY_RFC5277>
+  <CLICON_STREAM_RETENTION>60</CLICON_STREAM_RETENTION>
+  <CLICON_STREAM_REPLAY_MAX>100000</CLICON_STREAM_REPLAY_MAX>
+  <CLICON_STREAM_REPLAY_DIR>$replaydir</CLICON_STREAM_REPLAY_DIR>
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module example {
+   namespace "urn:example:clixon";
+   prefix ex;
+   notification event {
+      leaf event-class {
+         type string;
+      }
+      container reportingEntity {
+         leaf card {
+            type string;
+         }
+      }
+      leaf severity {
+         type string;
+      }
+   }
+}
+EOF
+
+mkdir -p $replaydir
+
+NOTIFICATION="<notification xmlns=\"urn:ietf:params:xml:ns:netconf:notification:1.0\"><eventTime>20[0-9-]*T[0-9:.]*Z</eventTime><event xmlns=\"urn:example:clixon\"><event-class>fault</event-class>"
+
+START=$(date -u +"%Y-%m-%dT%H:%M:%SZ")
+
+new "test params: -f $cfg"
+
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+        err
+    fi
+    new "start backend -s init -f $cfg -- -n"
+    start_backend -s init -f $cfg -- -n # create example notification stream
+fi
+
+new "wait backend"
+wait_backend
+
+# Wait for events
+sleep 11
+
+STOP=$(date -u +"%Y-%m-%dT%H:%M:%SZ")
+
+new "replay segment file written"
+if [ -z "$(ls $replaydir/EXAMPLE/*.replay 2> /dev/null)" ]; then
+    err "$replaydir/EXAMPLE/*.replay" "$(ls $replaydir/EXAMPLE)"
+fi
+
+new "netconf EXAMPLE subscription with replay"
+expectwait "$clixon_netconf -qef $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><create-subscription xmlns=\"urn:ietf:params:xml:ns:netmod:notification\"><stream>EXAMPLE</stream><startTime>$START</startTime><stopTime>$STOP</stopTime></create-subscription></rpc>" $NCWAIT "<rpc-reply $DEFAULTNS><ok/></rpc-reply>" "$NOTIFICATION"
+
+if [ $BE -ne 0 ]; then
+    new "restart backend"
+    stop_backend -f $cfg
+    start_backend -s running -f $cfg -- -n
+fi
+
+new "wait backend"
+wait_backend
+
+# Events before STOP are only in the replay log of the earlier backend
+new "netconf EXAMPLE replay after restart"
+expectwait "$clixon_netconf -qef $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><create-subscription xmlns=\"urn:ietf:params:xml:ns:netmod:notification\"><stream>EXAMPLE</stream><startTime>$START</startTime><stopTime>$STOP</stopTime></create-subscription></rpc>" $NCWAIT "<rpc-reply $DEFAULTNS><ok/></rpc-reply>" "$NOTIFICATION"
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+        err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
+
+new "endtest"
+endtest
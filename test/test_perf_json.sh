@@ -1,6 +1,7 @@
 #!/usr/bin/env bash
 # JSON performance test:
 # 1. parse a long string
+# 2. parse a long yang-bound list with module-qualified names
 
 # Magic line must be first in script (see README.md)
 s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
@@ -11,6 +12,26 @@ s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
 : ${perfnr:=100000}
 
 fjson=$dir/long.json
+flist=$dir/list.json
+fyang=$dir/perf.yang
+
+cat <<EOF > $fyang
+module perf{
+   prefix p;
+   namespace "urn:example:perf";
+   container c{
+     list y{
+       key a;
+       leaf a{
+         type int32;
+       }
+       leaf b{
+         type string;
+       }
+     }
+   }
+}
+EOF
 
 new "generate long file $fjson"
 echo -n '{"foo": "' > $fjson
@@ -24,6 +45,19 @@ new "json parse long string"
 #expecteof_file "$clixon_util_json" 0 "$fjson"
 expecteof_file "time -p $clixon_util_json -j" 0 "$fjson" "$fjson" 2>&1 | awk '/real/ {print $2}'
 
+new "generate long list file $flist"
+echo -n '{"perf:c":{"y":[' > $flist
+for (( i=0; i<$perfnr; i++ )); do
+    if [ $i -ne 0 ]; then
+        echo -n "," >> $flist
+    fi
+    echo -n "{\"a\":$i,\"b\":\"$i\"}" >> $flist
+done
+echo ']}}' >> $flist
+
+new "json parse long list with yang"
+expecteof_file "time -p $clixon_util_json -y $fyang" 0 "$flist" 2>&1 | awk '/real/ {print $2}'
+
 rm -rf $dir
 
 new "endtest"
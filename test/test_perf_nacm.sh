@@ -0,0 +1,223 @@
+#!/usr/bin/env bash
+# Performance of NACM read validation of a large config
+# Users with different read rules get the complete config with get-config
+# Thereafter guest writes a large config that a write rule may deny parts of
+# - andy: admin, permit all
+# - wilma: read-default deny, permits a single list entry
+# - guest: permits all but denies a leaf in every list entry
+# get-config applies NACM rules when copying from the datastore, get applies them
+# on the copy: the replies of the two are compared
+# Write rules are matched per tree level, list entries no deny rule can reach are not
+# traversed
+# Each list entry has three nodes, use perfnr=333334 for a 1M node config
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+# Number of list entries in config
+: ${perfnr:=20000}
+
+# Number of requests made
+: ${perfreq:=10}
+
+# time function (this is a mess to get right on freebsd/linux)
+: ${TIMEFN:=time -p} # portability: 2>&1 | awk '/real/ {print $2}'
+if ! $TIMEFN true; then err "A working time function" "'$TIMEFN' does not work"; fi
+
+APPNAME=example
+
+# Common NACM scripts
+. ./nacm.sh
+
+cfg=$dir/perf-nacm-conf.xml
+fyang=$dir/scaling.yang
+foutput=$dir/output.xml
+foutput2=$dir/output2.xml
+fconfig=$dir/large.xml
+
+cat <<EOF > $fyang
+module scaling{
+   yang-version 1.1;
+   namespace "urn:example:clixon";
+   prefix ex;
+   import ietf-netconf-acm {
+      prefix nacm;
+   }
+   container x {
+    list y {
+      key "a";
+      leaf a {
+        type int32;
+      }
+      leaf b {
+        type int32;
+      }
+    }
+  }
+}
+EOF
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>$dir</CLICON_YANG_DIR>
+  <CLICON_YANG_DIR>${YANG_INSTALLDIR}</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/run/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/run/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>$dir</CLICON_XMLDB_DIR>
+  <CLICON_XMLDB_PRETTY>false</CLICON_XMLDB_PRETTY>
+  <CLICON_NACM_MODE>internal</CLICON_NACM_MODE>
+  <CLICON_NACM_CREDENTIALS>none</CLICON_NACM_CREDENTIALS>
+</clixon-config>
+EOF
+
+RULES=$(cat <<EOF
+   <nacm xmlns="urn:ietf:params:xml:ns:yang:ietf-netconf-acm">
+     <enable-nacm>true</enable-nacm>
+     <read-default>deny</read-default>
+     <write-default>deny</write-default>
+     <exec-default>permit</exec-default>
+     $NGROUPS
+     <rule-list>
+       <name>limited-acl</name>
+       <group>limited</group>
+       <rule>
+         <name>permit-one</name>
+         <module-name>scaling</module-name>
+         <path xmlns:ex="urn:example:clixon">/ex:x/ex:y[ex:a='1']</path>
+         <access-operations>read</access-operations>
+         <action>permit</action>
+       </rule>
+     </rule-list>
+     <rule-list>
+       <name>guest-acl</name>
+       <group>guest</group>
+       <rule>
+         <name>deny-b</name>
+         <module-name>scaling</module-name>
+         <path xmlns:ex="urn:example:clixon">/ex:x/ex:y/ex:b</path>
+         <access-operations>read</access-operations>
+         <action>deny</action>
+       </rule>
+       <rule>
+         <name>permit-x</name>
+         <module-name>scaling</module-name>
+         <path xmlns:ex="urn:example:clixon">/ex:x</path>
+         <access-operations>read</access-operations>
+         <action>permit</action>
+       </rule>
+       <rule>
+         <name>deny-write-zero</name>
+         <module-name>scaling</module-name>
+         <path xmlns:ex="urn:example:clixon">/ex:x/ex:y[ex:a='0']/ex:b</path>
+         <access-operations>create update delete</access-operations>
+         <action>deny</action>
+       </rule>
+       <rule>
+         <name>permit-write-x</name>
+         <module-name>scaling</module-name>
+         <path xmlns:ex="urn:example:clixon">/ex:x</path>
+         <access-operations>create update delete</access-operations>
+         <action>permit</action>
+       </rule>
+     </rule-list>
+     $NADMIN
+   </nacm>
+EOF
+)
+
+new "generate startup config with $perfnr list entries"
+echo -n "<${DATASTORE_TOP}>$RULES<x xmlns=\"urn:example:clixon\">" > $dir/startup_db
+for (( i=0; i<$perfnr; i++ )); do
+    echo -n "<y><a>$i</a><b>$i</b></y>" >> $dir/startup_db
+done
+echo "</x></${DATASTORE_TOP}>" >> $dir/startup_db
+
+new "test params: -f $cfg"
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+        err
+    fi
+    new "start backend -s startup -f $cfg"
+    start_backend -s startup -f $cfg
+fi
+
+new "wait backend"
+wait_backend
+
+new "admin get-config large config"
+expecteof_netconf "time -p $clixon_netconf -qef $cfg -U andy" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get-config><source><running/></source><filter type=\"xpath\" select=\"/ex:x\" xmlns:ex=\"urn:example:clixon\"/></get-config></rpc>" "" "<rpc-reply $DEFAULTNS><data><x xmlns=\"urn:example:clixon\"><y><a>0</a><b>0</b></y><y><a>1</a><b>1</b></y>" 2>&1 | awk '/real/ {print $2}'
+
+new "limited get-config large config"
+expecteof_netconf "time -p $clixon_netconf -qef $cfg -U wilma" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get-config><source><running/></source></get-config></rpc>" "" "^<rpc-reply $DEFAULTNS><data><x xmlns=\"urn:example:clixon\"><y><a>1</a><b>1</b></y></x></data></rpc-reply>$" 2>&1 | awk '/real/ {print $2}'
+
+new "limited get large config"
+expecteof_netconf "time -p $clixon_netconf -qef $cfg -U wilma" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get/></rpc>" "" "^<rpc-reply $DEFAULTNS><data><x xmlns=\"urn:example:clixon\"><y><a>1</a><b>1</b></y></x></data></rpc-reply>$" 2>&1 | awk '/real/ {print $2}'
+
+new "limited get-config $perfreq times"
+{ time -p for (( i=0; i<$perfreq; i++ )); do
+    rpc=$(chunked_framing "<rpc $DEFAULTNS><get-config><source><running/></source></get-config></rpc>")
+    echo "$rpc"
+done | $clixon_netconf -qe1f $cfg -U wilma > /dev/null; } 2>&1 | awk '/real/ {print $2}'
+
+new "guest get-config large config"
+expecteof_netconf "time -p $clixon_netconf -qef $cfg -U guest" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get-config><source><running/></source></get-config></rpc>" "" "<rpc-reply $DEFAULTNS><data><x xmlns=\"urn:example:clixon\"><y><a>0</a></y><y><a>1</a></y>" 2>&1 | awk '/real/ {print $2}'
+
+new "guest get-config and get are equal"
+rpc=$(chunked_framing "<rpc $DEFAULTNS><get-config><source><running/></source></get-config></rpc>")
+echo "$DEFAULTHELLO$rpc" | $clixon_netconf -qef $cfg -U guest > $foutput
+rpc=$(chunked_framing "<rpc $DEFAULTNS><get/></rpc>")
+echo "$DEFAULTHELLO$rpc" | $clixon_netconf -qef $cfg -U guest > $foutput2
+ret=$(diff $foutput $foutput2)
+if [ $? -ne 0 ]; then
+    err1 "get-config equal to get" "$ret"
+fi
+
+new "guest get-config $perfreq times"
+{ time -p for (( i=0; i<$perfreq; i++ )); do
+    rpc=$(chunked_framing "<rpc $DEFAULTNS><get-config><source><running/></source></get-config></rpc>")
+    echo "$rpc"
+done | $clixon_netconf -qe1f $cfg -U guest > /dev/null; } 2>&1 | awk '/real/ {print $2}'
+
+new "generate large edit-config"
+rpc="<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><x xmlns=\"urn:example:clixon\">"
+for (( i=1; i<=$perfnr; i++ )); do
+    rpc+="<y><a>$((i+perfnr))</a><b>$i</b></y>"
+done
+rpc+="</x></config></edit-config></rpc>"
+echo -n "$DEFAULTHELLO" > $fconfig
+echo "$(chunked_framing "$rpc")" >> $fconfig
+
+new "guest write large config"
+expecteof_file "time -p $clixon_netconf -qef $cfg -U guest" 0 "$fconfig" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>$" 2>&1 | awk '/real/ {print $2}'
+
+new "guest discard-changes"
+expecteof_netconf "$clixon_netconf -qf $cfg -U guest" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><discard-changes/></rpc>" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+new "guest write denied leaf"
+expecteof_netconf "$clixon_netconf -qf $cfg -U guest" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><x xmlns=\"urn:example:clixon\"><y><a>0</a><b>42</b></y></x></config></edit-config></rpc>" "" "<rpc-reply $DEFAULTNS><rpc-error><error-type>application</error-type><error-tag>access-denied</error-tag><error-severity>error</error-severity><error-message>access denied</error-message></rpc-error></rpc-reply>"
+
+new "guest write other leaf"
+expecteof_netconf "$clixon_netconf -qf $cfg -U guest" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><x xmlns=\"urn:example:clixon\"><y><a>1</a><b>42</b></y></x></config></edit-config></rpc>" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+new "guest discard-changes"
+expecteof_netconf "$clixon_netconf -qf $cfg -U guest" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><discard-changes/></rpc>" "" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+        err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
+
+new "endtest"
+endtest
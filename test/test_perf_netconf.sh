@@ -122,21 +122,31 @@ new "Check running-db contents"
 rpc=$(chunked_framing "<rpc $DEFAULTNS><get-config><source><running/></source></get-config></rpc>")
 echo "$DEFAULTHELLO$rpc" | $clixon_netconf -qef $cfg > $foutput
 
-rpc="<rpc-reply $DEFAULTNS><data>"
-rpc+="$(cat $fconfigonly)"
-rpc+="</data></rpc-reply>"
-echo "$(chunked_framing "$rpc")" >> $ftest
-
 # Create a file to compare with
-#echo -n "<rpc-reply $DEFAULTNS><data>" > $ftest
-#cat $fconfigonly >> $ftest
-#echo -n "</data></rpc-reply>]]>]]>" >> $ftest
+echo "<rpc-reply $DEFAULTNS><data>$(cat $fconfigonly)</data></rpc-reply>" > $ftest
 
-ret=$(diff $ftest $foutput)
+# Large replies are streamed as several chunks: compare message content
+chunked_deframing < $foutput > $foutput.data
+
+ret=$(diff $ftest $foutput.data)
 if [ $? -ne 0 ]; then
     err1 "Matching running-db with $fconfigonly"
 fi      
 
+# Peak output buffer is bounded: each chunk is flushed at the first element boundary
+# after 64KB, and a large reply is several chunks
+new "netconf large reply is written in bounded chunks"
+nchunks=0
+for len in $(grep -a -E "^#[0-9]+$" $foutput | tr -d '#'); do
+    if [ $len -gt 131072 ]; then
+        err "chunk at most 128KB" "$len"
+    fi
+    nchunks=$((nchunks+1))
+done
+if [ $(wc -c < $foutput.data) -gt 131072 -a $nchunks -lt 2 ]; then
+    err "several chunks" "$nchunks"
+fi
+
 # Now commit it again from candidate (validation takes time when
 # comparing to existing)
 
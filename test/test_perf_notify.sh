@@ -0,0 +1,122 @@
+#!/usr/bin/env bash
+# Performance of notification fan-out to many subscribers
+# The example backend sends $perfrate events per second on the EXAMPLE stream to
+# $perfsubs netconf subscribers. Each event is serialized once for all subscribers.
+# Subscribers use one of two filters, each filter is evaluated once per event.
+# Backend CPU time during $perftime seconds is printed
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+# Number of subscribers
+: ${perfsubs:=1000}
+
+# Events per second
+: ${perfrate:=10000}
+
+# Measurement time in seconds
+: ${perftime:=10}
+
+APPNAME=example
+
+cfg=$dir/conf.xml
+fyang=$dir/example.yang
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>${YANG_INSTALLDIR}</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/run/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_DIR>/usr/local/lib/$APPNAME/backend</CLICON_BACKEND_DIR>
+  <CLICON_BACKEND_REGEXP>example_backend.so$</CLICON_BACKEND_REGEXP>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/run/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+  <CLICON_STREAM_DISCOVERY_RFC5277>true</CLICON_STREAM_DISCOVERY_RFC5277>
+  <CLICON_STREAM_RETENTION>0</CLICON_STREAM_RETENTION>
+  <CLICON_STREAM_REPLAY_MAX>10000000</CLICON_STREAM_REPLAY_MAX>
+  <CLICON_BACKEND_OUTPUT_QUEUE_MAX>1000000</CLICON_BACKEND_OUTPUT_QUEUE_MAX>
+  <CLICON_BACKEND_OUTPUT_QUEUE_POLICY>drop</CLICON_BACKEND_OUTPUT_QUEUE_POLICY>
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module example {
+   namespace "urn:example:clixon";
+   prefix ex;
+   notification event {
+      leaf event-class {
+         type string;
+      }
+      container reportingEntity {
+         leaf card {
+            type string;
+         }
+      }
+      leaf severity {
+         type string;
+      }
+   }
+}
+EOF
+
+new "test params: -f $cfg"
+
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+        err
+    fi
+    new "start backend -s init -f $cfg -- -N $perfrate"
+    start_backend -s init -f $cfg -- -N $perfrate
+fi
+
+new "wait backend"
+wait_backend
+
+new "start $perfsubs subscribers"
+filters=("event[event-class='fault']" "event[severity='major']")
+for (( i=0; i<$perfsubs; i++ )); do
+    rpc=$(chunked_framing "<rpc $DEFAULTNS><create-subscription xmlns=\"urn:ietf:params:xml:ns:netmod:notification\"><stream>EXAMPLE</stream><filter type=\"xpath\" select=\"${filters[$((i%2))]}\"/></create-subscription></rpc>")
+    (echo "$DEFAULTHELLO$rpc"; sleep $((perftime+5))) | $clixon_netconf -qef $cfg > $dir/sub$i.xml 2> /dev/null &
+done
+sleep 3
+
+pid=$(pgrep -u root -f clixon_backend | head -1)
+if [ -z "$pid" ]; then
+    err "backend pid" "no backend"
+fi
+hz=$(getconf CLK_TCK)
+
+new "backend cpu time for $perftime s with $perfrate events/s to $perfsubs subscribers"
+t0=$(awk '{print $14+$15}' /proc/$pid/stat)
+sleep $perftime
+t1=$(awk '{print $14+$15}' /proc/$pid/stat)
+echo "cpu: $(awk -v t0=$t0 -v t1=$t1 -v hz=$hz 'BEGIN {printf "%.2f", (t1-t0)/hz}') s"
+
+kill $(jobs -p) 2> /dev/null
+wait 2> /dev/null
+
+new "subscriber received notifications"
+nr=$(grep -o "<notification " $dir/sub0.xml | wc -l)
+echo "notifications: $nr"
+if [ $nr -eq 0 ]; then
+    err "notifications" "$nr"
+fi
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+        err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
+
+new "endtest"
+endtest
@@ -0,0 +1,127 @@
+#!/usr/bin/env bash
+# Performance of serializing large GET replies in the backend
+# Compare get-config of a large list using different number of print threads
+# and check that the output is identical.
+# The list is not the only top-level node, the tree is partitioned below the top.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+# Number of list entries
+: ${perfnr:=100000}
+
+# Number of print threads to test
+: ${perfthreads:="$(seq -s ' ' 1 16)"}
+
+APPNAME=example
+
+cfg=$dir/perf-print-conf.xml
+fyang=$dir/scaling.yang
+foutput=$dir/output.xml
+fbase=$dir/base.xml
+
+cat <<EOF > $fyang
+module scaling{
+   yang-version 1.1;
+   namespace "urn:example:clixon";
+   prefix ex;
+   container x {
+    list y {
+      key "a";
+      leaf a {
+        type int32;
+      }
+      leaf b {
+        type string;
+      }
+    }
+  }
+  container z {
+    list w {
+      key "c";
+      leaf c {
+        type int32;
+      }
+    }
+  }
+}
+EOF
+
+# Test function
+# Arguments:
+# 1: threads  Number of backend print threads
+function testrun(){
+    threads=$1
+
+    cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>${YANG_INSTALLDIR}</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/run/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/run/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_BACKEND_PRINT_THREADS>$threads</CLICON_BACKEND_PRINT_THREADS>
+  <CLICON_XMLDB_DIR>$dir</CLICON_XMLDB_DIR>
+  <CLICON_XMLDB_PRETTY>false</CLICON_XMLDB_PRETTY>
+</clixon-config>
+EOF
+
+    new "test params: -f $cfg"
+    if [ $BE -ne 0 ]; then
+        new "kill old backend"
+        sudo clixon_backend -zf $cfg
+        if [ $? -ne 0 ]; then
+            err
+        fi
+        new "start backend -s startup -f $cfg"
+        start_backend -s startup -f $cfg
+    fi
+
+    new "wait backend"
+    wait_backend
+
+    new "netconf get-config $perfnr entries with $threads print threads"
+    rpc=$(chunked_framing "<rpc $DEFAULTNS><get-config><source><running/></source></get-config></rpc>")
+    { time -p echo "$DEFAULTHELLO$rpc" | $clixon_netconf -qef $cfg > $foutput; } 2>&1 | awk '/real/ {print $2}'
+
+    if [ ! -f $fbase ]; then
+        cp $foutput $fbase
+    else
+        new "Check output with $threads threads equals first output"
+        ret=$(diff $fbase $foutput)
+        if [ $? -ne 0 ]; then
+            err1 "Identical output" "$ret"
+        fi
+    fi
+
+    if [ $BE -ne 0 ]; then
+        new "Kill backend"
+        # Check if premature kill
+        pid=$(pgrep -u root -f clixon_backend)
+        if [ -z "$pid" ]; then
+            err "backend already dead"
+        fi
+        # kill backend
+        stop_backend -f $cfg
+    fi
+}
+
+new "generate startup with $perfnr list entries"
+echo -n "<${DATASTORE_TOP}><x xmlns=\"urn:example:clixon\">" > $dir/startup_db
+for (( i=0; i<$perfnr; i++ )); do
+    echo -n "<y><a>$i</a><b>$i</b></y>" >> $dir/startup_db
+done
+echo -n "</x><z xmlns=\"urn:example:clixon\">" >> $dir/startup_db
+for (( i=0; i<10; i++ )); do
+    echo -n "<w><c>$i</c></w>" >> $dir/startup_db
+done
+echo "</z></${DATASTORE_TOP}>" >> $dir/startup_db
+
+for threads in $perfthreads; do
+    testrun $threads
+done
+
+rm -rf $dir
+
+new "endtest"
+endtest
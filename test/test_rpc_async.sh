@@ -0,0 +1,115 @@
+#!/usr/bin/env bash
+# Asynchronous rpcs from client to backend
+# Send several rpcs on the same socket without waiting for replies, and check that the
+# replies are matched with the rpcs on message-id
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf_yang.xml
+clidir=$dir/cli
+fyang=$dir/clixon-example.yang
+
+test -d ${clidir} || rm -rf ${clidir}
+mkdir $clidir
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>${YANG_INSTALLDIR}</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_BACKEND_DIR>/usr/local/lib/$APPNAME/backend</CLICON_BACKEND_DIR>
+  <CLICON_CLI_MODE>$APPNAME</CLICON_CLI_MODE>
+  <CLICON_CLI_DIR>/usr/local/lib/$APPNAME/cli</CLICON_CLI_DIR>
+  <CLICON_CLISPEC_DIR>$clidir</CLICON_CLISPEC_DIR>
+  <CLICON_SOCK>/usr/local/var/run/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/run/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module clixon-example {
+    yang-version 1.1;
+    namespace "urn:example:clixon";
+    prefix ex;
+    rpc example {
+        description "Echoes the input";
+        input {
+            leaf x {
+                type string;
+                mandatory true;
+            }
+            leaf y {
+                type string;
+                default "42";
+            }
+        }
+        output {
+            leaf x {
+                type string;
+            }
+            leaf y {
+                type string;
+            }
+        }
+    }
+}
+EOF
+
+cat <<EOF > $clidir/ex.cli
+CLICON_MODE="example";
+CLICON_PROMPT="%U@%H %W> ";
+CLICON_PLUGIN="example_cli";
+
+rpc("example rpc") <a:string>("routing instance"), example_client_rpc("");
+rpc-async("example rpcs without waiting for replies") <a:string>("routing instance") <n:uint32>("number of rpcs"), example_client_rpc_async("");
+EOF
+
+new "test params: -f $cfg"
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -z -f $cfg
+    if [ $? -ne 0 ]; then
+        err
+    fi
+    new "start backend -s init -f $cfg"
+    start_backend -s init -f $cfg
+fi
+
+new "wait backend"
+wait_backend
+
+new "cli one async rpc"
+expectpart "$($clixon_cli -1 -f $cfg -l o rpc-async ipv 1)" 0 "async-0: ipv0"
+
+new "cli pipeline 10 async rpcs"
+ret=$($clixon_cli -1 -f $cfg -l o rpc-async ipv 10)
+expectpart "$ret" 0 "async-0: ipv0" "async-5: ipv5" "async-9: ipv9" --not-- "does not match" "No reply"
+
+new "cli async replies in send order"
+expect=$(for i in $(seq 0 9); do echo "async-$i: ipv$i"; done)
+if [ "$ret" != "$expect" ]; then
+    err "$expect" "$ret"
+fi
+
+new "cli sync rpc"
+expectpart "$($clixon_cli -1 -f $cfg -l o rpc ipv4)" 0 "<x xmlns=\"urn:example:clixon\">ipv4</x>"
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+        err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
+
+new "endtest"
+endtest
@@ -0,0 +1,100 @@
+#!/usr/bin/env bash
+# State data callbacks with declared schema paths, see ca_statedata_paths
+# The example backend reads state from a file with two containers but declares only one
+# of them with -P. The state callback is only called for requests that may select data in
+# the declared path, so the other container is never returned.
+# Use main example -- -sS option to add state via a file
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf.xml
+fyang=$dir/example.yang
+fstate=$dir/state.xml
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>${YANG_INSTALLDIR}</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/run/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_DIR>/usr/local/lib/$APPNAME/backend</CLICON_BACKEND_DIR>
+  <CLICON_BACKEND_REGEXP>example_backend.so$</CLICON_BACKEND_REGEXP>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/run/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>$dir</CLICON_XMLDB_DIR>
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module example {
+   namespace "urn:example:clixon";
+   prefix ex;
+   container sx {
+      config false;
+      list sy {
+         key k;
+         leaf k {
+            type int32;
+         }
+         leaf v {
+            type int32;
+         }
+      }
+   }
+   container sz {
+      config false;
+      leaf w {
+         type int32;
+      }
+   }
+}
+EOF
+
+cat <<EOF > $fstate
+<sx xmlns="urn:example:clixon"><sy><k>1</k><v>10</v></sy><sy><k>2</k><v>20</v></sy></sx>
+<sz xmlns="urn:example:clixon"><w>30</w></sz>
+EOF
+
+new "test params: -f $cfg"
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+        err
+    fi
+    new "start backend -s init -f $cfg -- -sS $fstate -P /example:sx"
+    start_backend -s init -f $cfg -- -sS $fstate -P /example:sx
+fi
+
+new "wait backend"
+wait_backend
+
+new "get declared path"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get><filter type=\"xpath\" select=\"/ex:sx\" xmlns:ex=\"urn:example:clixon\"/></get></rpc>" "" "<rpc-reply $DEFAULTNS><data><sx xmlns=\"urn:example:clixon\"><sy><k>1</k><v>10</v></sy><sy><k>2</k><v>20</v></sy></sx></data></rpc-reply>"
+
+new "get descendant of declared path"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get><filter type=\"xpath\" select=\"/ex:sx/ex:sy[ex:k='2']/ex:v\" xmlns:ex=\"urn:example:clixon\"/></get></rpc>" "" "<rpc-reply $DEFAULTNS><data><sx xmlns=\"urn:example:clixon\"><sy><k>2</k><v>20</v></sy></sx></data></rpc-reply>"
+
+new "get other path, state callback is not called"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get><filter type=\"xpath\" select=\"/ex:sz\" xmlns:ex=\"urn:example:clixon\"/></get></rpc>" "" "<rpc-reply $DEFAULTNS><data/></rpc-reply>"
+
+new "get union, state callback is called"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get><filter type=\"xpath\" select=\"/ex:sz | /ex:sx/ex:sy[ex:k='1']\" xmlns:ex=\"urn:example:clixon\"/></get></rpc>" "" "<rpc-reply $DEFAULTNS><data><sx xmlns=\"urn:example:clixon\"><sy><k>1</k><v>10</v></sy></sx><sz xmlns=\"urn:example:clixon\"><w>30</w></sz></data></rpc-reply>"
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+        err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
+
+new "endtest"
+endtest
@@ -0,0 +1,180 @@
+#!/usr/bin/env bash
+# Thread-safe state data callbacks, see ca_statedata_threadsafe
+# Compile one backend plugin twice into two state data providers, each with a declared
+# path (ca_statedata_paths) and declared thread-safe. A request selecting both providers
+# calls their callbacks in threads, a request selecting one calls it in the main thread.
+# Each callback reports in its state data whether it was called in a thread.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf_yang.xml
+fyang=$dir/example.yang
+cfile=$dir/example-state.c
+pdir=$dir/plugin
+
+if [ ! -d $pdir ]; then
+    mkdir $pdir
+fi
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>${YANG_INSTALLDIR}</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/run/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_DIR>$pdir</CLICON_BACKEND_DIR>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/run/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>$dir</CLICON_XMLDB_DIR>
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module example {
+   namespace "urn:example:clixon";
+   prefix ex;
+   container sx {
+      config false;
+      leaf threaded {
+         type boolean;
+      }
+   }
+   container sz {
+      config false;
+      leaf threaded {
+         type boolean;
+      }
+   }
+}
+EOF
+
+# STATE is the name of the state container of the plugin
+cat<<EOF > $cfile
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+/* cligen */
+#include <cligen/cligen.h>
+
+/* Clixon */
+#include <clixon/clixon.h>
+
+/* These include signatures for plugin and transaction callbacks. */
+#include <clixon/clixon_backend.h>
+
+/* Thread the plugin is loaded in */
+static pthread_t _main_thread;
+
+static const char *_state_paths[] = {"/example:" STATE, NULL};
+
+/*! State data callback, may be called in a thread
+ *
+ * Only creates xml nodes, does not use the clixon handle
+ */
+static int
+example_state_threaded(clixon_handle h,
+                       cvec         *nsc,
+                       char         *xpath,
+                       cxobj        *xstate)
+{
+    cxobj *xs;
+    cxobj *x;
+
+    if ((xs = xml_new(STATE, xstate, CX_ELMNT)) == NULL)
+        return -1;
+    if (xmlns_set(xs, NULL, "urn:example:clixon") < 0)
+        return -1;
+    if ((x = xml_new("threaded", xs, CX_ELMNT)) == NULL)
+        return -1;
+    if ((x = xml_new("body", x, CX_BODY)) == NULL)
+        return -1;
+    if (xml_value_set(x, pthread_equal(pthread_self(), _main_thread)?"false":"true") < 0)
+        return -1;
+    return 0;
+}
+
+clixon_plugin_api *clixon_plugin_init(clixon_handle h);
+
+static clixon_plugin_api api = {
+    "state-" STATE,     /* name */           /*--- Common fields.  ---*/
+    clixon_plugin_init, /* init */
+};
+
+/*! Backend plugin initialization
+ * @param[in]  h    Clixon handle
+ * @retval     NULL
+ * @retval     api  Pointer to API struct
+ */
+clixon_plugin_api *
+clixon_plugin_init(clixon_handle h)
+{
+    _main_thread = pthread_self();
+    api.ca_statedata = example_state_threaded;
+    api.ca_statedata_paths = _state_paths;
+    api.ca_statedata_threadsafe = 1;
+    return &api;
+}
+EOF
+
+for state in sx sz; do
+    new "compile $cfile as state-$state.so"
+    # -I /usr/local_include for eg freebsd
+    expectpart "$($CC -g -Wall -rdynamic -fPIC -shared -I/usr/local/include -DSTATE=\"$state\" $cfile -o $pdir/state-$state.so)" 0 ""
+done
+
+new "test params: -f $cfg"
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+        err
+    fi
+    new "start backend -s init -f $cfg"
+    start_backend -s init -f $cfg
+fi
+
+new "wait backend"
+wait_backend
+
+new "get wildcard of both providers, callbacks are called in threads"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get><filter type=\"xpath\" select=\"/ex:*\" xmlns:ex=\"urn:example:clixon\"/></get></rpc>" "" "<rpc-reply $DEFAULTNS><data><sx xmlns=\"urn:example:clixon\"><threaded>true</threaded></sx><sz xmlns=\"urn:example:clixon\"><threaded>true</threaded></sz></data></rpc-reply>"
+
+new "get union of both providers, callbacks are called in threads"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get><filter type=\"xpath\" select=\"/ex:sz | /ex:sx\" xmlns:ex=\"urn:example:clixon\"/></get></rpc>" "" "<rpc-reply $DEFAULTNS><data><sx xmlns=\"urn:example:clixon\"><threaded>true</threaded></sx><sz xmlns=\"urn:example:clixon\"><threaded>true</threaded></sz></data></rpc-reply>"
+
+new "get one provider, callback is called in main thread"
+expecteof_netconf "$clixon_netconf -qf $cfg" 0 "$DEFAULTHELLO" "<rpc $DEFAULTNS><get><filter type=\"xpath\" select=\"/ex:sz\" xmlns:ex=\"urn:example:clixon\"/></get></rpc>" "" "<rpc-reply $DEFAULTNS><data><sz xmlns=\"urn:example:clixon\"><threaded>false</threaded></sz></data></rpc-reply>"
+
+# Many requests, each joining the threads of its callbacks
+rpc=$(chunked_framing "<rpc $DEFAULTNS><get><filter type=\"xpath\" select=\"/ex:*\" xmlns:ex=\"urn:example:clixon\"/></get></rpc>")
+rpcs=""
+for i in $(seq 1 20); do
+    rpcs="$rpcs$rpc"
+done
+new "get both providers 20 times in one session"
+ret=$(echo "$DEFAULTHELLO$rpcs" | $clixon_netconf -qef $cfg 2> /dev/null | tr -d '\n' | sed -e 's/#[0-9]*//g')
+nr=$(echo "$ret" | grep -o "<sx xmlns=\"urn:example:clixon\"><threaded>true</threaded></sx><sz xmlns=\"urn:example:clixon\"><threaded>true</threaded></sz>" | wc -l)
+if [ $nr -ne 20 ]; then
+    err "20 replies with state of both providers" "$ret"
+fi
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+        err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
+
+new "endtest"
+endtest